@@ -0,0 +1,249 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/arena.h"
+#include "../include/fen_utils.h"
+
+#define ROUNDS 5
+#define GAMES 20000
+// Objects made per game: about a Move and a FEN_Board per ply
+#define OBJECTS_PER_GAME 160
+#define CHURN_GAMES 200000
+#define RESERVOIR 200000
+
+static const char *const PGN =
+    "1. e4 e5 2. Nf3 Nc6 3. Bb5 a6 4. Ba4 Nf6 5. O-O Be7 6. Re1 b5 7. Bb3 d6 "
+    "8. c3 O-O 9. h3 Nb8 10. d4 Nbd7 11. c4 c6 12. cxb5 axb5 13. Nc3 Bb7 "
+    "14. Bg5 b4 15. Nb1 h6 16. Bh4 c5 17. dxe5 Nxe4 18. Bxe7 Qxe7 19. exd6 Qf6 "
+    "20. Nbd2 Nxd6 21. Nc4 Nxc4 22. Bxc4 Nb6 23. Ne5 Rae8 24. Bxf7+ Rxf7 1-0";
+static const char *const FEN = "r1bqkbnr/pppp1ppp/2n5/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 3 3";
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Keeps the compiler from dropping allocations whose result is unused
+static volatile uintptr_t sink;
+
+static void objects_malloc(void) {
+    void *objects[OBJECTS_PER_GAME];
+    for (int game = 0; game < GAMES; game++) {
+        for (int i = 0; i < OBJECTS_PER_GAME; i++) {
+            objects[i] = malloc(i & 1 ? sizeof(FEN_Board) : sizeof(Move));
+            sink += (uintptr_t)objects[i];
+        }
+        for (int i = 0; i < OBJECTS_PER_GAME; i++) {
+            free(objects[i]);
+        }
+    }
+}
+
+static void objects_arena(void) {
+    Arena arena;
+    arena_init(&arena, 0);
+    for (int game = 0; game < GAMES; game++) {
+        for (int i = 0; i < OBJECTS_PER_GAME; i++) {
+            sink += (uintptr_t)arena_alloc(&arena, i & 1 ? sizeof(FEN_Board) : sizeof(Move));
+        }
+        arena_reset(&arena);
+    }
+    arena_free(&arena);
+}
+
+static void objects_pool(void) {
+    Pool pool;
+    pool_init(&pool, sizeof(FEN_Board), 1024);
+    void *objects[OBJECTS_PER_GAME];
+    for (int game = 0; game < GAMES; game++) {
+        for (int i = 0; i < OBJECTS_PER_GAME; i++) {
+            objects[i] = pool_alloc(&pool);
+            sink += (uintptr_t)objects[i];
+        }
+        for (int i = 0; i < OBJECTS_PER_GAME; i++) {
+            pool_release(&pool, objects[i]);
+        }
+    }
+    pool_free(&pool);
+}
+
+static void moves_malloc(void) {
+    int count = get_move_numbers_from_pgn_string(PGN);
+    for (int game = 0; game < GAMES / 10; game++) {
+        Move **moves = get_moves_from_pgn_string(PGN);
+        for (int i = 0; i < count; i++) {
+            free(moves[i]);
+        }
+        free(moves);
+    }
+}
+
+static void moves_arena(void) {
+    Arena arena;
+    arena_init(&arena, 0);
+    for (int game = 0; game < GAMES / 10; game++) {
+        sink += (uintptr_t)get_moves_from_pgn_string_arena(PGN, &arena);
+        arena_reset(&arena);
+    }
+    arena_free(&arena);
+}
+
+static void boards_malloc(void) {
+    char fen[128];
+    for (int game = 0; game < GAMES; game++) {
+        strcpy(fen, FEN);
+        free(create_fen_board(fen));
+    }
+}
+
+static void boards_arena(void) {
+    Arena arena;
+    arena_init(&arena, 0);
+    for (int game = 0; game < GAMES; game++) {
+        sink += (uintptr_t)create_fen_board_arena(FEN, &arena);
+        arena_reset(&arena);
+    }
+    arena_free(&arena);
+}
+
+static void measure(const char *label, void (*run)(void), double allocations) {
+    double best = 1e30;
+    for (int round = 0; round < ROUNDS; round++) {
+        double start = now_seconds();
+        run();
+        double elapsed = now_seconds() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    printf("%-26s %8.1f M allocs/s  %6.1f ns/alloc\n", label, allocations / best / 1e6,
+           best * 1e9 / allocations);
+}
+
+static double resident_mb(void) {
+    FILE *file = fopen("/proc/self/statm", "r");
+    unsigned long size = 0, resident = 0;
+    if (file != NULL) {
+        if (fscanf(file, "%lu %lu", &size, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(file);
+    }
+    return resident * (double)sysconf(_SC_PAGESIZE) / (1 << 20);
+}
+
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// The conversion's allocation pattern: every game makes short-lived moves
+// and boards, and keeps one FEN_Plus in a reservoir that replaces a random
+// older one, so long-lived objects die in no particular order. Afterwards
+// 90% of the reservoir is dropped, which is where fragmentation shows: RSS
+// that stays behind is held by freed memory the allocator cannot return.
+static void churn(bool use_arena) {
+    FEN_Plus **reservoir = calloc(RESERVOIR, sizeof(FEN_Plus *));
+    Arena arena;
+    Pool pool;
+    arena_init(&arena, 0);
+    fen_plus_pool_init(&pool);
+    void *objects[OBJECTS_PER_GAME];
+    uint64_t state = 88172645463325252ull;
+    double base = resident_mb();
+
+    for (int game = 0; game < CHURN_GAMES; game++) {
+        int count = OBJECTS_PER_GAME / 2 + (int)(next_random(&state) % (OBJECTS_PER_GAME / 2));
+        for (int i = 0; i < count; i++) {
+            size_t size = i & 1 ? sizeof(FEN_Board) : sizeof(Move);
+            objects[i] = use_arena ? arena_alloc(&arena, size) : malloc(size);
+            memset(objects[i], 0, size);
+        }
+
+        FEN_Plus *fen_plus;
+        if (use_arena) {
+            fen_plus = create_fen_plus_pooled(&pool);
+        } else {
+            fen_plus = calloc(1, sizeof(FEN_Plus));
+            fen_plus->board = calloc(1, sizeof(FEN_Board));
+            fen_plus->move = calloc(1, sizeof(Move));
+        }
+        size_t slot = next_random(&state) % RESERVOIR;
+        if (reservoir[slot] != NULL) {
+            if (use_arena) {
+                free_fen_plus_pooled(reservoir[slot], &pool);
+            } else {
+                free_fen_plus(reservoir[slot]);
+            }
+        }
+        reservoir[slot] = fen_plus;
+
+        if (use_arena) {
+            arena_reset(&arena);
+        } else {
+            for (int i = 0; i < count; i++) {
+                free(objects[i]);
+            }
+        }
+    }
+    size_t live = 0;
+    for (size_t slot = 0; slot < RESERVOIR; slot++) {
+        live += reservoir[slot] != NULL;
+    }
+    double live_mb = live * (sizeof(FEN_Plus) + sizeof(FEN_Board) + sizeof(Move)) / (double)(1 << 20);
+    double after_churn = resident_mb() - base;
+
+    for (size_t slot = 0; slot < RESERVOIR; slot++) {
+        if (reservoir[slot] != NULL && next_random(&state) % 10 != 0) {
+            if (use_arena) {
+                free_fen_plus_pooled(reservoir[slot], &pool);
+            } else {
+                free_fen_plus(reservoir[slot]);
+            }
+            reservoir[slot] = NULL;
+            live--;
+        }
+    }
+    double kept_mb = live * (sizeof(FEN_Plus) + sizeof(FEN_Board) + sizeof(Move)) / (double)(1 << 20);
+    double after_drop = resident_mb() - base;
+
+    printf("%-12s live %6.1f MB  RSS %6.1f MB (x%.2f)   after drop: live %5.1f MB  RSS %6.1f MB (x%.2f)\n",
+           use_arena ? "arena+pool" : "glibc", live_mb, after_churn, after_churn / live_mb, kept_mb, after_drop,
+           after_drop / kept_mb);
+    fflush(stdout);
+    arena_free(&arena);
+    pool_free(&pool);
+}
+
+int main(void) {
+    int plies = get_move_numbers_from_pgn_string(PGN);
+    printf("Allocation throughput, best of %d\n", ROUNDS);
+    measure("malloc/free (per game)", objects_malloc, (double)GAMES * OBJECTS_PER_GAME);
+    measure("arena + reset", objects_arena, (double)GAMES * OBJECTS_PER_GAME);
+    measure("pool alloc/release", objects_pool, (double)GAMES * OBJECTS_PER_GAME);
+    measure("moves from PGN, malloc", moves_malloc, (double)GAMES / 10 * (plies + 1));
+    measure("moves from PGN, arena", moves_arena, (double)GAMES / 10 * (plies + 1));
+    measure("create_fen_board, malloc", boards_malloc, GAMES);
+    measure("create_fen_board, arena", boards_arena, GAMES);
+
+    // Each allocator gets a fresh process so one's heap does not skew the other
+    printf("\nRSS over %d games, %d long-lived FEN_Plus slots\n", CHURN_GAMES, RESERVOIR);
+    fflush(stdout);
+    for (int use_arena = 0; use_arena < 2; use_arena++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            churn(use_arena);
+            _exit(0);
+        }
+        int status;
+        waitpid(pid, &status, 0);
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/attacks.h"
+#include "../include/fen_plus.h"
+#include "../include/fen_utils.h"
+#include "../include/output_writer.h"
+#include "../include/pgn_stream.h"
+#include "../include/pgn_tokenizer.h"
+#include "../include/san.h"
+
+#define ARTIFACT_DIR "src_python/test/test_artifacts/"
+#define ROWS 1000000
+#define ROUNDS 5
+// Same flush granularity as a pipeline batch
+#define BATCH_BYTES (256u * 1024)
+
+typedef struct {
+    Position pos;
+    ChessMove move;
+    int elo;
+} Sample;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Every position of the artifact games, with the move played from it
+static size_t load_samples(Sample *samples, size_t capacity) {
+    const char *names[3] = {"game_1.pgn", "game_2.pgn", "game_3.pgn"};
+    size_t count = 0;
+    for (int i = 0; i < 3; i++) {
+        char path[256];
+        snprintf(path, sizeof(path), ARTIFACT_DIR "%s", names[i]);
+        PGN_Stream *stream = pgn_stream_open(path);
+        if (stream == NULL) {
+            fprintf(stderr, "cannot open %s (run from the repository root)\n", path);
+            exit(1);
+        }
+        PGN_Game game;
+        while (pgn_stream_next_game(stream, &game)) {
+            Position pos;
+            position_set_start(&pos);
+            PGN_Tokenizer tokenizer;
+            pgn_tokenizer_init(&tokenizer, game.movetext, game.movetext_len);
+            const char *token;
+            size_t token_len;
+            while (count < capacity && pgn_tokenizer_next(&tokenizer, &token, &token_len)) {
+                ChessMove move;
+                if (san_to_move(&pos, token, token_len, &move) != SAN_OK) {
+                    break;
+                }
+                samples[count].pos = pos;
+                samples[count].move = move;
+                samples[count].elo = 1200 + (int)(count % 1500);
+                count++;
+                position_make_move(&pos, move);
+            }
+        }
+        pgn_stream_close(stream);
+    }
+    return count;
+}
+
+static void write_fd(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            perror("write");
+            exit(1);
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+}
+
+// The previous row path: FEN_Board, strcat/sprintf FEN, snprintf row, and a
+// write() per batch
+static size_t rows_legacy(const Sample *samples, size_t count, int fd, Text_Buffer *out) {
+    size_t total = 0;
+    out->length = 0;
+    for (size_t i = 0; i < ROWS; i++) {
+        const Sample *s = &samples[i % count];
+        text_buffer_reserve(out, FEN_PLUS_MAX_ROW);
+        FEN_Board board;
+        char fen[100];
+        char uci[6];
+        position_to_fen_board(&s->pos, &board);
+        fen_board_to_fen_string(&board, fen);
+        move_to_uci(s->move, uci);
+        out->length += (size_t)snprintf(out->data + out->length, FEN_PLUS_MAX_ROW, "%.*s,%d,%s,%d,%s\n",
+                                        5, "180+0", s->pos.fullmove_number, fen, s->elo, uci);
+        if (out->length >= BATCH_BYTES) {
+            write_fd(fd, out->data, out->length);
+            total += out->length;
+            out->length = 0;
+        }
+    }
+    write_fd(fd, out->data, out->length);
+    return total + out->length;
+}
+
+// fen_plus_write_row into the batch, batches queued on an Output_Writer
+static size_t rows_direct(const Sample *samples, size_t count, int fd, Text_Buffer *out) {
+    Output_Writer writer;
+    if (!output_writer_init(&writer, fd)) {
+        exit(1);
+    }
+    out->length = 0;
+    for (size_t i = 0; i < ROWS; i++) {
+        const Sample *s = &samples[i % count];
+        text_buffer_reserve(out, FEN_PLUS_MAX_ROW);
+        out->length += fen_plus_write_row(out->data + out->length, "180+0", 5, &s->pos, s->elo, s->move);
+        if (out->length >= BATCH_BYTES) {
+            output_writer_write(&writer, out->data, out->length);
+            out->length = 0;
+        }
+    }
+    output_writer_write(&writer, out->data, out->length);
+    output_writer_flush(&writer);
+    size_t total = (size_t)writer.bytes_written;
+    output_writer_free(&writer);
+    return total;
+}
+
+typedef size_t (*Row_Writer)(const Sample *, size_t, int, Text_Buffer *);
+
+static void measure(const char *label, Row_Writer run, const Sample *samples, size_t count,
+                    const char *path) {
+    Text_Buffer out = {0};
+    double best = 1e30;
+    size_t bytes = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            perror(path);
+            exit(1);
+        }
+        double start = now_seconds();
+        bytes = run(samples, count, fd, &out);
+        double elapsed = now_seconds() - start;
+        close(fd);
+        best = elapsed < best ? elapsed : best;
+    }
+    printf("%-22s %-24s %7.2f M rows/s  %6.1f ns/row  %6.0f MB/s\n", label, path,
+           ROWS / best / 1e6, best * 1e9 / ROWS, bytes / best / 1e6);
+    text_buffer_free(&out);
+}
+
+int main(void) {
+    attacks_init();
+    Sample *samples = malloc(sizeof(Sample) * 4096);
+    size_t count = load_samples(samples, 4096);
+    printf("%d rows from %zu artifact positions, best of %d\n", ROWS, count, ROUNDS);
+
+    // Both paths must agree byte for byte before their speed means anything
+    for (size_t i = 0; i < count; i++) {
+        char expected[FEN_PLUS_MAX_ROW + 1];
+        char row[FEN_PLUS_MAX_ROW];
+        FEN_Board board;
+        char fen[100];
+        char uci[6];
+        position_to_fen_board(&samples[i].pos, &board);
+        fen_board_to_fen_string(&board, fen);
+        move_to_uci(samples[i].move, uci);
+        int length = snprintf(expected, sizeof(expected), "180+0,%d,%s,%d,%s\n",
+                              samples[i].pos.fullmove_number, fen, samples[i].elo, uci);
+        size_t row_len = fen_plus_write_row(row, "180+0", 5, &samples[i].pos, samples[i].elo,
+                                            samples[i].move);
+        if (row_len != (size_t)length || memcmp(row, expected, row_len) != 0) {
+            fprintf(stderr, "row %zu differs:\n%s%.*s", i, expected, (int)row_len, row);
+            return 1;
+        }
+    }
+
+    const char *targets[2] = {"/dev/null", "obj/bench_fen_plus.csv"};
+    for (int t = 0; t < 2; t++) {
+        measure("snprintf + FEN_Board", rows_legacy, samples, count, targets[t]);
+        measure("direct + Output_Writer", rows_direct, samples, count, targets[t]);
+    }
+    remove(targets[1]);
+    free(samples);
+    return 0;
+}
@@ -0,0 +1,103 @@
+"""
+Plies per second of the chess_native extension against the src_python
+prototype (pgn_reader.get_piece_from_char on every SAN move).
+
+    make python
+    PYTHONPATH=. python3 bench/bench_native.py [corpus.pgn[.zst]]
+
+The prototype only parses SAN tokens; the extension also replays every move
+and builds the FEN+ record, so the ratio understates the gap. On a corpus
+the prototype gets the first --python-games games, with comments and "N..."
+move numbers stripped beforehand (untimed), since it cannot parse either.
+"""
+import argparse
+import os
+import re
+import subprocess
+import tempfile
+import time
+
+import numpy as np
+
+import src_python.pgn_reader as pgn_reader
+import src_python.test.test_artifacts as test_artifacts
+from src_python import chess_native
+
+ARTIFACTS = [os.path.join(test_artifacts.__path__[0], name)
+             for name in ("game_1.pgn", "game_2.pgn", "game_3.pgn")]
+_COMMENT = re.compile(r"\{[^}]*\}|\d+\.\.\.")
+
+
+def python_plies(games):
+    """
+    Runs the prototype over game texts; returns the SAN moves it parsed.
+    """
+    plies = 0
+    for text in games:
+        for white, black in pgn_reader._get_moves_list_from_pgn_file(text):
+            pgn_reader.get_piece_from_char(white, "white")
+            plies += 1
+            if black:
+                pgn_reader.get_piece_from_char(black, "black")
+                plies += 1
+    return plies
+
+
+def native_plies(path, batch_rows=65536):
+    plies = 0
+    for batch in chess_native.Reader(path, batch_rows=batch_rows):
+        records = np.asarray(batch)
+        plies += len(records)
+    return plies
+
+
+def timed(function, *args, rounds=1):
+    best = None
+    for _ in range(rounds):
+        start = time.perf_counter()
+        result = function(*args)
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return result, best
+
+
+def report(name, python, native):
+    (python_count, python_seconds), (native_count, native_seconds) = python, native
+    python_rate = python_count / python_seconds
+    native_rate = native_count / native_seconds
+    print(f"{name:<10} python {python_rate:12,.0f} plies/s   native {native_rate:12,.0f} plies/s"
+          f"   {native_rate / python_rate:7.1f}x")
+
+
+def read_text(path):
+    if path.endswith(".zst"):
+        return subprocess.run(["zstd", "-dcq", path], check=True, capture_output=True).stdout.decode()
+    with open(path) as file:
+        return file.read()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("corpus", nargs="?", help="large .pgn or .pgn.zst input")
+    parser.add_argument("--rounds", type=int, default=20, help="runs over the artifacts, best counts")
+    parser.add_argument("--python-games", type=int, default=2000)
+    args = parser.parse_args()
+
+    games = [pgn_reader.read_pgn_file(path) for path in ARTIFACTS]
+    with tempfile.NamedTemporaryFile("w", suffix=".pgn", delete=False) as joined:
+        joined.write("\n\n".join(games) + "\n")
+    try:
+        report("artifacts", timed(python_plies, games, rounds=args.rounds),
+               timed(native_plies, joined.name, rounds=args.rounds))
+    finally:
+        os.unlink(joined.name)
+
+    if args.corpus:
+        text = read_text(args.corpus)
+        sample = ["[Event" + game for game in text.split("\n[Event")[1:args.python_games + 1]]
+        sample = [re.sub(r"[ \t]+", " ", _COMMENT.sub("", game)) for game in sample]
+        report("corpus", timed(python_plies, sample), timed(native_plies, args.corpus))
+
+
+if __name__ == "__main__":
+    main()
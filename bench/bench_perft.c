@@ -0,0 +1,61 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../include/attacks.h"
+#include "../include/movegen.h"
+#include "../include/position.h"
+
+// The standard perft positions with their published node counts. A wrong
+// count fails the run, so this doubles as the correctness gate for changes
+// to move generation or make_move.
+static const struct {
+    const char *name;
+    const char *fen;
+    int depth;
+    uint64_t nodes;
+} POSITIONS[] = {
+    {"start", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 6, 119060324ULL},
+    {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5, 193690690ULL},
+    {"position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6, 11030083ULL},
+    {"position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292ULL},
+    {"position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 5, 89941194ULL},
+    {"position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 5,
+     164075551ULL},
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(void) {
+    attacks_init();
+    uint64_t total_nodes = 0;
+    double total_seconds = 0;
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(POSITIONS) / sizeof(POSITIONS[0]); i++) {
+        Position pos;
+        if (!position_from_fen(POSITIONS[i].fen, &pos)) {
+            fprintf(stderr, "cannot parse %s\n", POSITIONS[i].fen);
+            return 1;
+        }
+        double start = now_seconds();
+        uint64_t nodes = perft(&pos, POSITIONS[i].depth);
+        double elapsed = now_seconds() - start;
+        bool ok = nodes == POSITIONS[i].nodes;
+        failures += !ok;
+        total_nodes += nodes;
+        total_seconds += elapsed;
+        printf("%-11s depth %d  %12llu nodes  %6.2f s  %7.1f M nodes/s  %s\n", POSITIONS[i].name,
+               POSITIONS[i].depth, (unsigned long long)nodes, elapsed, nodes / elapsed / 1e6,
+               ok ? "ok" : "WRONG");
+        if (!ok) {
+            printf("            expected %llu\n", (unsigned long long)POSITIONS[i].nodes);
+        }
+    }
+    printf("total                %12llu nodes  %6.2f s  %7.1f M nodes/s\n", (unsigned long long)total_nodes,
+           total_seconds, total_nodes / total_seconds / 1e6);
+    return failures == 0 ? 0 : 1;
+}
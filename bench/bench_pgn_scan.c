@@ -0,0 +1,246 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/fen_plus.h"
+#include "../include/pgn_scan.h"
+
+#define ARTIFACT_DIR "src_python/test/test_artifacts/"
+// Small enough to stay in cache, like the text pgn_stream has just
+// decompressed; each measurement loops over it PASSES times.
+#define CORPUS_BYTES (1u << 20)
+#define PASSES 64
+#define ROUNDS 5
+
+typedef struct {
+    size_t header_offset;
+    size_t header_len;
+} Game_Span;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char *read_file(const char *path, size_t *len_out) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "cannot open %s (run from the repository root)\n", path);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = malloc((size_t)len + 1);
+    if (data == NULL || fread(data, 1, (size_t)len, f) != (size_t)len) {
+        exit(1);
+    }
+    data[len] = '\0';
+    fclose(f);
+    *len_out = (size_t)len;
+    return data;
+}
+
+// Appends text, adding a Lichess-style clock comment after every move when
+// clocks is set, the way the monthly dumps annotate most games
+static size_t append_game(char *out, const char *game, bool clocks) {
+    const char *movetext = strstr(game, "\n\n1. ");
+    size_t pos = 0;
+    if (!clocks || movetext == NULL) {
+        size_t len = strlen(game);
+        memcpy(out, game, len);
+        pos = len;
+    } else {
+        size_t header_len = (size_t)(movetext - game) + 2;
+        memcpy(out, game, header_len);
+        pos = header_len;
+        const char *p = movetext + 2;
+        while (*p) {
+            const char *space = strchr(p, ' ');
+            size_t len = space ? (size_t)(space - p) : strlen(p);
+            memcpy(out + pos, p, len);
+            pos += len;
+            bool is_number = p[len - 1] == '.';
+            bool is_result = p[0] == '1' || p[0] == '0' || p[0] == '*';
+            if (!is_number && !is_result) {
+                memcpy(out + pos, " { [%clk 0:02:58] }", 19);
+                pos += 19;
+            }
+            if (!space) break;
+            out[pos++] = ' ';
+            p = space + 1;
+        }
+    }
+    memcpy(out + pos, "\n\n", 2);
+    return pos + 2;
+}
+
+static char *build_corpus(size_t *len_out, Game_Span **spans_out, size_t *count_out) {
+    const char *names[3] = {"game_1.pgn", "game_2.pgn", "game_3.pgn"};
+    char *games[3];
+    for (int i = 0; i < 3; i++) {
+        char path[256];
+        size_t len;
+        snprintf(path, sizeof(path), ARTIFACT_DIR "%s", names[i]);
+        games[i] = read_file(path, &len);
+    }
+    char *corpus = malloc(CORPUS_BYTES + 65536);
+    Game_Span *spans = malloc(sizeof(Game_Span) * (CORPUS_BYTES / 512));
+    size_t len = 0, count = 0;
+    while (len < CORPUS_BYTES) {
+        const char *game = games[count % 3];
+        spans[count].header_offset = len;
+        spans[count].header_len = (size_t)(strstr(game, "\n\n1. ") - game);
+        len += append_game(corpus + len, game, count % 2 == 0);
+        count++;
+    }
+    for (int i = 0; i < 3; i++) free(games[i]);
+    *len_out = len;
+    *spans_out = spans;
+    *count_out = count;
+    return corpus;
+}
+
+// Game boundaries the way pgn_stream used to find them: line by line
+static size_t find_games_by_line(const char *data, size_t len) {
+    size_t games = 0;
+    const char *p = data;
+    const char *end = data + len;
+    while (p < end) {
+        if (end - p >= 6 && memcmp(p, "[Event", 6) == 0) {
+            games++;
+        }
+        const char *newline = memchr(p, '\n', (size_t)(end - p));
+        p = newline ? newline + 1 : end;
+    }
+    return games;
+}
+
+// Byte-at-a-time classification, the isspace/isdigit loop style
+static uint64_t classify_bytewise(const char *data, size_t len) {
+    uint64_t count = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+        count += c == '\n' || c == '[' || c == ']' || c == '"' || c == '{' || c == '}';
+    }
+    return count;
+}
+
+int main(void) {
+    size_t len, game_count;
+    Game_Span *spans;
+    char *corpus = build_corpus(&len, &spans, &game_count);
+    double gb = (double)len * PASSES / 1e9;
+    printf("corpus: %.1f MB x %d passes, %zu games (half with [%%clk] comments), best of %d\n",
+           len / 1e6, PASSES, game_count, ROUNDS);
+
+    volatile uint64_t sink = 0;
+    double best = 1e30;
+    for (int r = 0; r < ROUNDS; r++) {
+        double start = now_seconds();
+        for (int pass = 0; pass < PASSES; pass++) {
+            sink += classify_bytewise(corpus, len);
+        }
+        double elapsed = now_seconds() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+    printf("%-28s %6.2f GB/s\n", "classify, byte loop", gb / best);
+
+    best = 1e30;
+    for (int r = 0; r < ROUNDS; r++) {
+        double start = now_seconds();
+        for (int pass = 0; pass < PASSES; pass++) {
+            sink += find_games_by_line(corpus, len);
+        }
+        double elapsed = now_seconds() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+    printf("%-28s %6.2f GB/s\n", "boundaries, memchr lines", gb / best);
+
+    best = 1e30;
+    for (int r = 0; r < ROUNDS; r++) {
+        double start = now_seconds();
+        for (size_t g = 0; g < game_count * PASSES; g++) {
+            const char *header = corpus + spans[g % game_count].header_offset;
+            const char *value;
+            size_t value_len;
+            const char *tags[5] = {"WhiteElo", "BlackElo", "TimeControl", "Termination", "Result"};
+            for (int t = 0; t < 5; t++) {
+                if (pgn_header_value(header, spans[g % game_count].header_len, tags[t], &value, &value_len)) {
+                    sink += value_len;
+                }
+            }
+        }
+        double elapsed = now_seconds() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+    printf("%-28s %6.1f ns/game\n", "headers, pgn_header_value", best * 1e9 / (game_count * PASSES));
+
+    PGN_Scan_Impl impls[3] = {PGN_SCAN_SCALAR, PGN_SCAN_SSE2, PGN_SCAN_AVX2};
+    for (int i = 0; i < 3; i++) {
+        if (!pgn_scan_select(impls[i])) {
+            printf("%s: not supported by this CPU\n", impls[i] == PGN_SCAN_SSE2 ? "sse2" : "avx2");
+            continue;
+        }
+        const char *name = pgn_scan_impl_name();
+        char label[64];
+
+        best = 1e30;
+        for (int r = 0; r < ROUNDS; r++) {
+            double start = now_seconds();
+            PGN_Scan_Masks masks;
+            for (int pass = 0; pass < PASSES; pass++) {
+                for (size_t pos = 0; pos + 64 <= len; pos += 64) {
+                    pgn_scan_block(corpus + pos, &masks);
+                    sink += masks.newline ^ masks.quote ^ masks.open_brace;
+                }
+            }
+            double elapsed = now_seconds() - start;
+            best = elapsed < best ? elapsed : best;
+        }
+        snprintf(label, sizeof(label), "classify, %s masks", name);
+        printf("%-28s %6.2f GB/s\n", label, gb / best);
+
+        best = 1e30;
+        size_t found = 0;
+        for (int r = 0; r < ROUNDS; r++) {
+            double start = now_seconds();
+            for (int pass = 0; pass < PASSES; pass++) {
+                found = 0;
+                for (size_t pos = 0; (pos = pgn_scan_find_game(corpus, len, pos)) < len; pos++) {
+                    found++;
+                }
+            }
+            double elapsed = now_seconds() - start;
+            best = elapsed < best ? elapsed : best;
+        }
+        if (found + 1 != game_count) {
+            fprintf(stderr, "%s: found %zu boundaries, expected %zu\n", name, found, game_count - 1);
+            return 1;
+        }
+        snprintf(label, sizeof(label), "boundaries, %s masks", name);
+        printf("%-28s %6.2f GB/s\n", label, gb / best);
+
+        best = 1e30;
+        for (int r = 0; r < ROUNDS; r++) {
+            double start = now_seconds();
+            for (size_t g = 0; g < game_count * PASSES; g++) {
+                PGN_Header_Tags tags;
+                const Game_Span *span = &spans[g % game_count];
+                pgn_scan_headers(corpus + span->header_offset, span->header_len, &tags);
+                sink += tags.white_elo.length + tags.result.length;
+            }
+            double elapsed = now_seconds() - start;
+            best = elapsed < best ? elapsed : best;
+        }
+        snprintf(label, sizeof(label), "headers, %s masks", name);
+        printf("%-28s %6.1f ns/game\n", label, best * 1e9 / (game_count * PASSES));
+    }
+    printf("checksum %llu\n", (unsigned long long)sink);
+
+    free(spans);
+    free(corpus);
+    return 0;
+}
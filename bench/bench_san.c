@@ -0,0 +1,194 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/position.h"
+#include "../include/attacks.h"
+#include "../include/san.h"
+
+#define ARTIFACT_DIR "src_python/test/test_artifacts/"
+#define SYNTHETIC_GAMES 5000
+#define MAX_PLIES 160
+
+typedef struct {
+    Position pos;
+    char san[16];
+    size_t len;
+} Sample;
+
+typedef struct {
+    char (*tokens)[16];
+    int plies;
+} Game;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t rng_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// Legal moves without castling, enough to play random synthetic games
+static int legal_moves(const Position *pos, ChessMove *moves) {
+    int us = pos->side_to_move;
+    Bitboard own = pos->occupancy[us];
+    Bitboard occupied = position_occupied(pos);
+    int n = 0;
+    for (int type = PAWN; type <= KING; type++) {
+        Bitboard pieces = pos->pieces[MAKE_PIECE(us, type)];
+        while (pieces) {
+            int from = bitboard_pop_lsb(&pieces);
+            Bitboard targets;
+            if (type == PAWN) {
+                int forward = us == WHITE ? 8 : -8;
+                targets = PAWN_ATTACKS[us][from] & (pos->occupancy[us ^ 1] |
+                          (pos->en_passant != NO_SQUARE ? square_bit(pos->en_passant) : 0));
+                if (!(occupied & square_bit(from + forward))) {
+                    targets |= square_bit(from + forward);
+                    int start_rank = us == WHITE ? 1 : 6;
+                    if (SQUARE_RANK(from) == start_rank && !(occupied & square_bit(from + 2 * forward))) {
+                        targets |= square_bit(from + 2 * forward);
+                    }
+                }
+            } else {
+                targets = piece_attacks(type, from, occupied) & ~own;
+            }
+            while (targets) {
+                int to = bitboard_pop_lsb(&targets);
+                ChessMove move = position_encode_move(pos, from, to, rng_next() % 4 ? QUEEN : KNIGHT);
+                if (position_leaves_king_safe(pos, move)) {
+                    moves[n++] = move;
+                }
+            }
+        }
+    }
+    return n;
+}
+
+static int load_artifact_samples(Sample *samples) {
+    const char *names[3] = {"game_1.pgn", "game_2.pgn", "game_3.pgn"};
+    int n = 0;
+    for (int g = 0; g < 3; g++) {
+        char path[256], text[4096];
+        snprintf(path, sizeof(path), ARTIFACT_DIR "%s", names[g]);
+        FILE *f = fopen(path, "rb");
+        if (f == NULL) {
+            fprintf(stderr, "cannot open %s (run from the repository root)\n", path);
+            exit(1);
+        }
+        size_t len = fread(text, 1, sizeof(text) - 1, f);
+        text[len] = '\0';
+        fclose(f);
+
+        Position pos;
+        position_set_start(&pos);
+        char *save;
+        for (char *token = strtok_r(strstr(text, "\n1. "), " \n", &save); token;
+             token = strtok_r(NULL, " \n", &save)) {
+            if ((token[0] >= '0' && token[0] <= '9') || token[0] == '*') {
+                continue;
+            }
+            ChessMove move;
+            if (san_to_move(&pos, token, strlen(token), &move) != SAN_OK) {
+                fprintf(stderr, "cannot resolve %s\n", token);
+                exit(1);
+            }
+            samples[n].pos = pos;
+            samples[n].len = strlen(token);
+            memcpy(samples[n].san, token, samples[n].len + 1);
+            n++;
+            position_make_move(&pos, move);
+        }
+    }
+    return n;
+}
+
+static long generate_games(Game *games, int count) {
+    long total = 0;
+    ChessMove moves[256];
+    for (int g = 0; g < count; g++) {
+        games[g].tokens = malloc(sizeof(*games[g].tokens) * MAX_PLIES);
+        Position pos;
+        position_set_start(&pos);
+        int plies = 0;
+        int length = 20 + (int)(rng_next() % (MAX_PLIES - 20));
+        while (plies < length) {
+            int n = legal_moves(&pos, moves);
+            if (n == 0) {
+                break;
+            }
+            ChessMove move = moves[rng_next() % n];
+            san_from_move(&pos, move, games[g].tokens[plies]);
+            position_make_move(&pos, move);
+            plies++;
+        }
+        games[g].plies = plies;
+        total += plies;
+    }
+    return total;
+}
+
+int main(void) {
+    attacks_init();
+
+    static Sample samples[512];
+    int sample_count = load_artifact_samples(samples);
+    long iterations = 20000;
+    unsigned checksum = 0;
+    double start = now_seconds();
+    for (long it = 0; it < iterations; it++) {
+        for (int i = 0; i < sample_count; i++) {
+            ChessMove move;
+            san_to_move(&samples[i].pos, samples[i].san, samples[i].len, &move);
+            checksum += move;
+        }
+    }
+    double elapsed = now_seconds() - start;
+    printf("test_artifacts: %d moves x %ld, %.1f ns/move (resolve only)\n",
+           sample_count, iterations, elapsed * 1e9 / ((double)sample_count * iterations));
+
+    Game *games = malloc(sizeof(Game) * SYNTHETIC_GAMES);
+    long plies = generate_games(games, SYNTHETIC_GAMES);
+    // Best of several rounds, to filter out noise from other processes
+    int rounds = 5;
+    double best = 1e30;
+    for (int r = 0; r < rounds; r++) {
+        start = now_seconds();
+        for (int g = 0; g < SYNTHETIC_GAMES; g++) {
+            Position pos;
+            position_set_start(&pos);
+            for (int p = 0; p < games[g].plies; p++) {
+                ChessMove move;
+                const char *token = games[g].tokens[p];
+                if (san_to_move(&pos, token, strlen(token), &move) != SAN_OK) {
+                    fprintf(stderr, "synthetic game %d ply %d: cannot resolve %s\n", g, p, token);
+                    return 1;
+                }
+                position_make_move(&pos, move);
+                checksum += move;
+            }
+        }
+        elapsed = now_seconds() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    printf("synthetic: %d games, %ld moves, %.1f ns/move (resolve + make_move, best of %d)\n",
+           SYNTHETIC_GAMES, plies, best * 1e9 / (double)plies, rounds);
+    printf("checksum %u\n", checksum);
+
+    for (int g = 0; g < SYNTHETIC_GAMES; g++) {
+        free(games[g].tokens);
+    }
+    free(games);
+    return 0;
+}
@@ -0,0 +1,422 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/attacks.h"
+#include "../include/fen_plus.h"
+#include "../include/fen_utils.h"
+#include "../include/game_record.h"
+#include "../include/pgn_stream.h"
+#include "../include/pgn_tokenizer.h"
+#include "../include/pipeline.h"
+#include "../include/san.h"
+
+// Games loaded into memory for the microbenchmarks; the end-to-end run
+// converts the whole corpus
+#define MAX_GAMES 10000
+#define MAX_FENS 200000
+#define ROUNDS 3
+
+typedef struct {
+    size_t movetext_offset;
+    size_t movetext_len;
+    size_t header_offset;
+    size_t header_len;
+} Loaded_Game;
+
+typedef struct {
+    Text_Buffer text;
+    Loaded_Game *games;
+    size_t count;
+    size_t movetext_bytes;
+} Corpus;
+
+typedef struct {
+    const char *name;
+    const char *unit;       // what ops counts
+    uint64_t ops;
+    uint64_t bytes;         // input bytes per round, 0 if not meaningful
+    double seconds;         // best round
+} Result;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void load_corpus(const char *path, Corpus *corpus) {
+    PGN_Stream *stream = pgn_stream_open(path);
+    if (stream == NULL) {
+        fprintf(stderr, "cannot open %s (make bench generates it)\n", path);
+        exit(1);
+    }
+    memset(corpus, 0, sizeof(*corpus));
+    corpus->games = (Loaded_Game *)malloc(MAX_GAMES * sizeof(Loaded_Game));
+    PGN_Game game;
+    while (corpus->count < MAX_GAMES && pgn_stream_next_game(stream, &game)) {
+        Loaded_Game *slot = &corpus->games[corpus->count++];
+        slot->header_offset = corpus->text.length;
+        slot->header_len = game.header_len;
+        slot->movetext_offset = corpus->text.length + game.header_len;
+        slot->movetext_len = game.movetext_len;
+        if (!text_buffer_append(&corpus->text, game.header, game.header_len) ||
+            !text_buffer_append(&corpus->text, game.movetext, game.movetext_len)) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        corpus->movetext_bytes += game.movetext_len;
+    }
+    pgn_stream_close(stream);
+}
+
+static uint64_t run_tokenize(const Corpus *corpus) {
+    uint64_t tokens = 0;
+    for (size_t i = 0; i < corpus->count; i++) {
+        PGN_Tokenizer tokenizer;
+        pgn_tokenizer_init(&tokenizer, corpus->text.data + corpus->games[i].movetext_offset,
+                           corpus->games[i].movetext_len);
+        const char *token;
+        size_t token_len;
+        while (pgn_tokenizer_next(&tokenizer, &token, &token_len)) {
+            tokens++;
+        }
+    }
+    return tokens;
+}
+
+// Tokenizing plus SAN resolution and make_move: everything but the output
+static uint64_t run_san(const Corpus *corpus) {
+    uint64_t plies = 0;
+    for (size_t i = 0; i < corpus->count; i++) {
+        Position pos;
+        position_set_start(&pos);
+        PGN_Tokenizer tokenizer;
+        pgn_tokenizer_init(&tokenizer, corpus->text.data + corpus->games[i].movetext_offset,
+                           corpus->games[i].movetext_len);
+        const char *token;
+        size_t token_len;
+        while (pgn_tokenizer_next(&tokenizer, &token, &token_len)) {
+            ChessMove move;
+            if (san_to_move(&pos, token, token_len, &move) != SAN_OK) {
+                break;
+            }
+            position_make_move(&pos, move);
+            plies++;
+        }
+    }
+    return plies;
+}
+
+static Text_Buffer bench_rows;
+
+// Single-threaded FEN+ CSV rows, without the write
+static uint64_t run_rows(const Corpus *corpus) {
+    FEN_Plus_Stats stats;
+    memset(&stats, 0, sizeof(stats));
+    for (size_t i = 0; i < corpus->count; i++) {
+        const Loaded_Game *slot = &corpus->games[i];
+        PGN_Game game;
+        game.header = corpus->text.data + slot->header_offset;
+        game.header_len = slot->header_len;
+        game.movetext = corpus->text.data + slot->movetext_offset;
+        game.movetext_len = slot->movetext_len;
+        game.index = i;
+        bench_rows.length = 0;
+        if (!fen_plus_append_game(&game, NULL, &bench_rows, &stats)) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    return stats.plies;
+}
+
+static Game_Record_File *bench_games;
+
+// FEN+ records rebuilt from a compressed game file, replaying every game
+static uint64_t run_game_rows(const Corpus *corpus) {
+    (void)corpus;
+    uint64_t rows = 0;
+    for (uint64_t i = 0; i < game_record_count(bench_games); i++) {
+        Game_Record_Cursor cursor;
+        FEN_Record record;
+        if (!game_record_seek(bench_games, i, 0, &cursor)) {
+            fprintf(stderr, "game file: cannot read game %llu\n", (unsigned long long)i);
+            exit(1);
+        }
+        while (game_record_next(&cursor, &record)) {
+            rows++;
+        }
+    }
+    return rows;
+}
+
+// The FEN of every position in the loaded games, up to MAX_FENS
+static size_t collect_fens(const Corpus *corpus, char (*fens)[100]) {
+    size_t count = 0;
+    for (size_t i = 0; i < corpus->count && count < MAX_FENS; i++) {
+        Position pos;
+        position_set_start(&pos);
+        PGN_Tokenizer tokenizer;
+        pgn_tokenizer_init(&tokenizer, corpus->text.data + corpus->games[i].movetext_offset,
+                           corpus->games[i].movetext_len);
+        const char *token;
+        size_t token_len;
+        while (count < MAX_FENS && pgn_tokenizer_next(&tokenizer, &token, &token_len)) {
+            ChessMove move;
+            if (san_to_move(&pos, token, token_len, &move) != SAN_OK) {
+                break;
+            }
+            position_make_move(&pos, move);
+            position_to_fen(&pos, fens[count++]);
+        }
+    }
+    return count;
+}
+
+static char (*bench_fens)[100];
+static FEN_Board *bench_boards;
+static size_t bench_fen_count;
+
+static uint64_t run_create_fen_board(const Corpus *corpus) {
+    (void)corpus;
+    for (size_t i = 0; i < bench_fen_count; i++) {
+        FEN_Board *board = create_fen_board(bench_fens[i]);
+        if (board == NULL) {
+            fprintf(stderr, "cannot parse %s\n", bench_fens[i]);
+            exit(1);
+        }
+        free(board);
+    }
+    return bench_fen_count;
+}
+
+// Every FEN parsed FEN_PARSE_PASSES times into a stack board: about a
+// million FENs with no allocation in the way
+#define FEN_PARSE_PASSES 5
+static uint64_t run_fen_board_parse(const Corpus *corpus) {
+    (void)corpus;
+    uint64_t sink = 0;
+    for (int pass = 0; pass < FEN_PARSE_PASSES; pass++) {
+        for (size_t i = 0; i < bench_fen_count; i++) {
+            FEN_Board board;
+            if (fen_board_parse(bench_fens[i], strlen(bench_fens[i]), &board) != FEN_OK) {
+                fprintf(stderr, "cannot parse %s\n", bench_fens[i]);
+                exit(1);
+            }
+            sink += (uint64_t)board.fullmove_number;
+        }
+    }
+    return sink > 0 ? FEN_PARSE_PASSES * bench_fen_count : 0;
+}
+
+static uint64_t run_fen_board_to_fen_string(const Corpus *corpus) {
+    (void)corpus;
+    char fen[100];
+    size_t length = 0;
+    for (size_t i = 0; i < bench_fen_count; i++) {
+        fen_board_to_fen_string(&bench_boards[i], fen);
+        length += fen[0];
+    }
+    return length > 0 ? bench_fen_count : 0;
+}
+
+static void measure(Result *result, const char *name, const char *unit, uint64_t bytes,
+                    uint64_t (*run)(const Corpus *), const Corpus *corpus) {
+    result->name = name;
+    result->unit = unit;
+    result->bytes = bytes;
+    result->seconds = 1e30;
+    for (int r = 0; r < ROUNDS; r++) {
+        double start = now_seconds();
+        result->ops = run(corpus);
+        double elapsed = now_seconds() - start;
+        if (elapsed < result->seconds) {
+            result->seconds = elapsed;
+        }
+    }
+}
+
+static double per_second(double amount, double seconds) {
+    return seconds > 0 ? amount / seconds : 0;
+}
+
+// ops_per_second of benchmark name in a report written by an earlier run
+static double baseline_rate(const char *report, const char *name) {
+    char key[64];
+    snprintf(key, sizeof(key), "\"%s\": {", name);
+    const char *at = report != NULL ? strstr(report, key) : NULL;
+    at = at != NULL ? strstr(at, "\"ops_per_second\": ") : NULL;
+    return at != NULL ? atof(at + strlen("\"ops_per_second\": ")) : 0;
+}
+
+static char *read_text_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    Text_Buffer text = {0};
+    char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0 && text_buffer_append(&text, chunk, n)) {
+    }
+    fclose(f);
+    if (!text_buffer_append(&text, "", 1)) {
+        text_buffer_free(&text);
+        return NULL;
+    }
+    return text.data;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [--json PATH] [--baseline PATH] [--commit ID] [--threads N] <corpus.pgn[.zst]>\n"
+            "  --json PATH      write the results as JSON (default: stdout)\n"
+            "  --baseline PATH  compare against the JSON of an earlier run\n"
+            "  --commit ID      recorded in the JSON, e.g. the output of git rev-parse\n"
+            "  --threads N      worker threads of the end-to-end run (default: online CPUs)\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+    const char *json_path = NULL;
+    const char *baseline_path = NULL;
+    const char *commit = "unknown";
+    const char *corpus_path = NULL;
+    Pipeline_Options options;
+    pipeline_default_options(&options);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--commit") == 0 && i + 1 < argc) {
+            commit = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threads = atoi(argv[++i]);
+        } else if (corpus_path == NULL && argv[i][0] != '-') {
+            corpus_path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (corpus_path == NULL) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    attacks_init();
+    Corpus corpus;
+    load_corpus(corpus_path, &corpus);
+    bench_fens = malloc(MAX_FENS * sizeof(*bench_fens));
+    bench_boards = malloc(MAX_FENS * sizeof(FEN_Board));
+    if (bench_fens == NULL || bench_boards == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    bench_fen_count = collect_fens(&corpus, bench_fens);
+    for (size_t i = 0; i < bench_fen_count; i++) {
+        FEN_Board *board = create_fen_board(bench_fens[i]);
+        bench_boards[i] = *board;
+        free(board);
+    }
+    uint64_t fen_bytes = 0;
+    for (size_t i = 0; i < bench_fen_count; i++) {
+        fen_bytes += strlen(bench_fens[i]);
+    }
+
+    Result results[8];
+    measure(&results[0], "tokenize", "tokens", corpus.movetext_bytes, run_tokenize, &corpus);
+    measure(&results[1], "san_resolve", "plies", corpus.movetext_bytes, run_san, &corpus);
+    measure(&results[2], "create_fen_board", "boards", fen_bytes, run_create_fen_board, &corpus);
+    measure(&results[3], "fen_board_parse", "boards", FEN_PARSE_PASSES * fen_bytes, run_fen_board_parse, &corpus);
+    measure(&results[4], "fen_board_to_fen_string", "boards", 0, run_fen_board_to_fen_string, &corpus);
+    measure(&results[5], "fen_plus_rows", "rows", corpus.text.length, run_rows, &corpus);
+
+    // End to end: the whole corpus through the pipeline into /dev/null
+    Pipeline_Stats stats;
+    int fd = open("/dev/null", O_WRONLY);
+    bool ok = fd >= 0 && pipeline_run(corpus_path, fd, &options, &stats);
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (!ok) {
+        fprintf(stderr, "pipeline: %s\n", stats.error);
+        return 1;
+    }
+    results[6] = (Result){"pipeline_end_to_end", "rows", stats.plies, stats.bytes_decoded, stats.wall_seconds};
+
+    // The whole corpus as a zstd game file, read back row by row
+    char game_path[] = "/tmp/bench_suite_XXXXXX";
+    Pipeline_Options game_options = options;
+    game_options.format = PIPELINE_FORMAT_GAMES;
+    game_options.compression_level = 3;
+    fd = mkstemp(game_path);
+    ok = fd >= 0 && pipeline_run(corpus_path, fd, &game_options, &stats);
+    if (fd >= 0) {
+        close(fd);
+    }
+    bench_games = ok ? game_record_open(game_path) : NULL;
+    unlink(game_path);
+    if (bench_games == NULL) {
+        fprintf(stderr, "game file: %s\n", ok ? "cannot open" : stats.error);
+        return 1;
+    }
+    measure(&results[7], "game_record_rows", "rows", 0, run_game_rows, &corpus);
+    game_record_close(bench_games);
+    int result_count = 8;
+
+    char *baseline = baseline_path != NULL ? read_text_file(baseline_path) : NULL;
+    if (baseline_path != NULL && baseline == NULL) {
+        perror(baseline_path);
+    }
+    FILE *out = json_path != NULL ? fopen(json_path, "w") : stdout;
+    if (out == NULL) {
+        perror(json_path);
+        return 1;
+    }
+    fprintf(out, "{\n  \"commit\": \"%s\",\n  \"corpus\": \"%s\",\n", commit, corpus_path);
+    fprintf(out, "  \"corpus_games\": %zu,\n  \"threads\": %d,\n  \"rounds\": %d,\n", corpus.count, options.threads,
+            ROUNDS);
+    fprintf(out, "  \"benchmarks\": {\n");
+    for (int i = 0; i < result_count; i++) {
+        const Result *r = &results[i];
+        fprintf(out, "    \"%s\": {\"unit\": \"%s\", \"ops\": %llu, \"seconds\": %.6f, \"ops_per_second\": %.1f, "
+                     "\"ns_per_op\": %.1f",
+                r->name, r->unit, (unsigned long long)r->ops, r->seconds, per_second((double)r->ops, r->seconds),
+                r->ops > 0 ? r->seconds * 1e9 / r->ops : 0.0);
+        if (r->bytes > 0) {
+            fprintf(out, ", \"mb_per_second\": %.1f", per_second(r->bytes / 1048576.0, r->seconds));
+        }
+        fprintf(out, "}%s\n", i + 1 < result_count ? "," : "");
+    }
+    fprintf(out, "  }\n}\n");
+    if (out != stdout && fclose(out) != 0) {
+        perror(json_path);
+        return 1;
+    }
+
+    // Human-readable summary, with the change against the baseline
+    for (int i = 0; i < result_count; i++) {
+        const Result *r = &results[i];
+        double rate = per_second((double)r->ops, r->seconds);
+        fprintf(stderr, "%-24s %12.0f %s/s %8.1f ns/op", r->name, rate, r->unit,
+                r->ops > 0 ? r->seconds * 1e9 / r->ops : 0.0);
+        double before = baseline_rate(baseline, r->name);
+        if (before > 0) {
+            fprintf(stderr, "  %+6.1f%% vs baseline", 100.0 * (rate - before) / before);
+        }
+        fprintf(stderr, "\n");
+    }
+    free(baseline);
+    free(bench_fens);
+    free(bench_boards);
+    text_buffer_free(&bench_rows);
+    text_buffer_free(&corpus.text);
+    free(corpus.games);
+    return 0;
+}
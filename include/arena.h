@@ -0,0 +1,70 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Alignment of every arena and pool allocation
+#define ARENA_ALIGN 16
+#define ARENA_DEFAULT_CHUNK_BYTES (64u << 10)
+
+typedef struct Arena_Chunk Arena_Chunk;
+
+// Bump allocator for objects that all die at the same time, such as the
+// moves and boards made while converting one game. Allocation is a pointer
+// bump; arena_reset releases everything at once in O(1) and keeps the
+// chunks for the next game, so a warmed-up arena never calls malloc. Not
+// thread-safe: give each thread its own arena.
+typedef struct {
+    Arena_Chunk *first;     // chunks in allocation order, kept across resets
+    Arena_Chunk *current;   // chunk being bumped
+    char *next;             // next free byte of current
+    char *end;              // end of current
+    size_t chunk_bytes;     // usable bytes of a regular chunk
+    size_t reserved;        // usable bytes of all chunks
+    uint64_t allocations;   // since arena_init
+} Arena;
+
+// Free-list allocator for objects of one size that outlive a game and are
+// freed in any order. Objects are carved from slabs and recycled through an
+// intrusive free list; slabs go back to the system only in pool_free. Not
+// thread-safe.
+typedef struct {
+    size_t object_size;     // rounded up to ARENA_ALIGN
+    size_t objects_per_slab;
+    void *free_list;        // released objects, linked through their first word
+    void *slabs;            // slabs, linked through their first word
+    size_t slab_used;       // objects carved from the newest slab
+    size_t live;            // objects handed out and not released
+    size_t capacity;        // objects in all slabs
+} Pool;
+
+bool arena_init(Arena *arena, size_t chunk_bytes);
+void *arena_alloc_slow(Arena *arena, size_t size);
+void arena_reset(Arena *arena);
+void arena_free(Arena *arena);
+
+/**
+ * @brief Returns size bytes aligned to ARENA_ALIGN, valid until the next
+ *        arena_reset or arena_free.
+ *
+ * @return NULL only if a new chunk cannot be allocated.
+ */
+static inline void *arena_alloc(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    arena->allocations++;
+    if (size <= (size_t)(arena->end - arena->next)) {
+        void *object = arena->next;
+        arena->next += size;
+        return object;
+    }
+    return arena_alloc_slow(arena, size);
+}
+
+bool pool_init(Pool *pool, size_t object_size, size_t objects_per_slab);
+void *pool_alloc(Pool *pool);
+void pool_release(Pool *pool, void *object);
+void pool_free(Pool *pool);
+
+#endif
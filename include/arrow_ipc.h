@@ -0,0 +1,64 @@
+#ifndef ARROW_IPC_H
+#define ARROW_IPC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "fen_plus.h"
+#include "fen_record.h"
+#include "output_writer.h"
+
+// Columnar FEN+ output in the Arrow IPC file format (Feather v2), readable by
+// pyarrow.ipc.open_file, pyarrow.feather and other Arrow readers. A file is
+//
+//   "ARROW1" and padding, the schema message
+//   one record batch per pipeline batch, each written by the worker that
+//   converted it, with every buffer a zstd frame unless the level is 0
+//   the uci_move and time_control dictionary batches, an end-of-stream marker
+//   the footer: schema and the offsets of every dictionary and record batch
+//
+// The columns hold the FEN_Record fields, one row per ply:
+//
+//   board           fixed_size_binary[32]  FEN_Record.board: 4 bits per square
+//   flags           uint8                  bit 0 black to move, bits 4-7 CASTLE_*
+//   en_passant      uint8                  target square, NO_SQUARE (64) if none
+//   halfmove_clock  uint16
+//   move_number     uint16                 fullmove number, as in the CSV
+//   elo             uint16                 of the side to move, 0 if unknown
+//   uci_move        dictionary<int16, utf8>   over all 1968 moves a piece can make
+//   time_control    dictionary<int32, utf8>   the file's time-control table
+//   game            uint32                 index of the game in the input
+
+#define ARROW_IPC_MAGIC "ARROW1"
+// Moves in the uci_move dictionary: queen and knight moves between any two
+// squares plus the promotions
+#define ARROW_IPC_UCI_MOVES 1968
+
+// Footer entry: where a message starts and how long its parts are
+typedef struct {
+    uint64_t offset;
+    int32_t metadata_length;    // continuation marker, length and flatbuffer, padded
+    int64_t body_length;
+} Arrow_IPC_Block;
+
+// Record batches written so far and where the next one goes
+typedef struct {
+    Arrow_IPC_Block *batches;
+    size_t count;
+    size_t capacity;
+    uint64_t offset;
+    uint64_t rows;
+} Arrow_IPC_Index;
+
+bool arrow_ipc_write_header(Output_Writer *writer, Arrow_IPC_Index *index);
+bool arrow_ipc_encode_batch(const FEN_Record *records, size_t count, int level, void **context,
+                            Text_Buffer *scratch, Text_Buffer *out);
+bool arrow_ipc_add_batch(Arrow_IPC_Index *index, const char *message, size_t length, size_t rows);
+bool arrow_ipc_write_footer(Output_Writer *writer, Arrow_IPC_Index *index,
+                            const FEN_Record_Time_Controls *time_controls);
+void arrow_ipc_index_free(Arrow_IPC_Index *index);
+
+int arrow_ipc_uci_move_id(ChessMove move);
+const char *arrow_ipc_uci_move_name(int id);
+
+#endif
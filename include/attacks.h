@@ -0,0 +1,55 @@
+#ifndef ATTACKS_H
+#define ATTACKS_H
+
+#include <stdbool.h>
+#include "position.h"
+
+#define FILE_A_BB 0x0101010101010101ULL
+#define FILE_H_BB 0x8080808080808080ULL
+#define RANK_1_BB 0x00000000000000FFULL
+#define RANK_8_BB 0xFF00000000000000ULL
+
+// Magic bitboard entry for one square: the attack set for an occupancy is
+// attacks[((occupied & mask) * magic) >> shift].
+typedef struct {
+    Bitboard *attacks;
+    Bitboard mask;
+    Bitboard magic;
+    unsigned shift;
+} Magic;
+
+extern Bitboard KNIGHT_ATTACKS[64];
+extern Bitboard KING_ATTACKS[64];
+extern Bitboard PAWN_ATTACKS[2][64];    // squares a pawn of that color attacks
+extern Magic BISHOP_MAGICS[64];
+extern Magic ROOK_MAGICS[64];
+// Squares strictly between two squares on a rank, file or diagonal, else 0
+extern Bitboard BETWEEN_BB[64][64];
+// The whole rank, file or diagonal through two squares, else 0
+extern Bitboard LINE_BB[64][64];
+
+// Fills all tables. Idempotent; call it once before any other attack lookup,
+// and before starting worker threads.
+void attacks_init(void);
+
+static inline Bitboard bishop_attacks(int square, Bitboard occupied) {
+    const Magic *m = &BISHOP_MAGICS[square];
+    return m->attacks[((occupied & m->mask) * m->magic) >> m->shift];
+}
+
+static inline Bitboard rook_attacks(int square, Bitboard occupied) {
+    const Magic *m = &ROOK_MAGICS[square];
+    return m->attacks[((occupied & m->mask) * m->magic) >> m->shift];
+}
+
+static inline Bitboard queen_attacks(int square, Bitboard occupied) {
+    return bishop_attacks(square, occupied) | rook_attacks(square, occupied);
+}
+
+Bitboard piece_attacks(int piece_type, int square, Bitboard occupied);
+Bitboard attackers_to(const Position *pos, int square, Bitboard occupied);
+bool position_square_attacked(const Position *pos, int square, int by_color);
+bool position_in_check(const Position *pos);
+bool position_leaves_king_safe(const Position *pos, ChessMove move);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef CORPUS_GEN_H
+#define CORPUS_GEN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "fen_plus.h"
+
+// Share of games with engine evaluations in their comments, in percent
+#define CORPUS_EVAL_PERCENT 7
+
+// Synthetic Lichess-like PGN. Games are legal random playouts with the tag
+// set of a Lichess dump, clock comments on every move, evaluations on a few
+// games, and ratings, speeds and game lengths drawn to resemble the real
+// distributions. Game i depends only on (seed, i), so a corpus is
+// reproducible byte for byte and can be generated in pieces.
+typedef struct {
+    uint64_t seed;
+    uint64_t next_game;     // index of the game corpus_generate_game writes next
+    uint64_t plies;         // moves written so far
+} Corpus_Generator;
+
+void corpus_generator_init(Corpus_Generator *generator, uint64_t seed, uint64_t first_game);
+bool corpus_generate_game(Corpus_Generator *generator, Text_Buffer *out);
+
+#endif
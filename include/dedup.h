@@ -0,0 +1,41 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "position.h"
+
+// Slots probed before a pair counts as untracked
+#define DEDUP_MAX_PROBES 16
+#define DEDUP_DEFAULT_MEMORY (64u << 20)
+
+enum Dedup_Result {
+    DEDUP_KEEP,         // within the allowed frequency, or sampled
+    DEDUP_DROP,         // over the limit
+    DEDUP_UNTRACKED     // table full around this key; kept
+};
+
+// Occurrence counts of (position, move) pairs in a fixed-size, lock-free
+// open-addressing table. Each slot is one 64-bit word: the high 36 bits are
+// a tag from the key and the low 28 bits its count, so a slot is claimed and
+// counted with one compare-and-swap. Pairs that find no slot within
+// DEDUP_MAX_PROBES are kept and not counted.
+typedef struct {
+    uint64_t *slots;
+    size_t mask;
+    uint32_t max_count;     // occurrences kept before down-sampling starts
+    uint32_t keep_every;    // beyond max_count keep every Nth one; 0 drops them all
+} Dedup_Table;
+
+static inline uint64_t dedup_pair_key(uint64_t position_key, ChessMove move) {
+    return position_key ^ ((uint64_t)(move + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+bool dedup_table_init(Dedup_Table *table, size_t memory_bytes, uint32_t max_count, uint32_t keep_every);
+enum Dedup_Result dedup_check(Dedup_Table *table, uint64_t key);
+size_t dedup_table_memory(const Dedup_Table *table);
+size_t dedup_table_used(const Dedup_Table *table);
+void dedup_table_free(Dedup_Table *table);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef FEN_PLUS_H
+#define FEN_PLUS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dedup.h"
+#include "perf_counters.h"
+#include "pgn_stream.h"
+#include "position.h"
+#include "san_cache.h"
+
+#define FEN_PLUS_CSV_HEADER "time_format,move_number,fen,elo,uci_move\n"
+// Upper bound for one row: time control (clipped to 32), move number, FEN,
+// Elo and UCI move with separators
+#define FEN_PLUS_MAX_ROW (32 + 1 + 5 + 1 + FEN_MAX_LENGTH + 1 + 10 + 1 + 5 + 1)
+
+// Growable output buffer. Reused across games and batches, so in steady state
+// it stops reallocating.
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} Text_Buffer;
+
+// Header facts repeated on every row of a game
+typedef struct {
+    const char *time_control;   // points into the header, "-" if missing
+    size_t time_control_len;    // clipped to 32 bytes
+    int elo[2];                 // by color, 0 if missing
+} FEN_Plus_Game;
+
+typedef struct {
+    uint64_t games;         // games converted
+    uint64_t rejected;      // games dropped because a move did not resolve or was illegal
+    uint64_t plies;         // rows written
+    uint64_t duplicates;    // rows dropped by the dedup table
+    uint64_t untracked;     // rows kept because the dedup table had no room
+    uint64_t san_cache_hits;    // moves resolved from the SAN cache
+    uint64_t san_cache_misses;  // moves looked up there in vain
+    Perf_Counters *perf;    // the converting thread's counters, NULL to not time
+    San_Cache *san_cache;   // the converting thread's SAN cache, NULL to resolve every move
+} FEN_Plus_Stats;
+
+enum FEN_Plus_Replay_Status {
+    FEN_PLUS_REPLAY_OK,
+    FEN_PLUS_REPLAY_REJECTED,   // a move did not resolve or was illegal, or the format refused the game
+    FEN_PLUS_REPLAY_FAILED      // out of memory or a write failed: stop the run
+};
+
+// A game being replayed: its header facts and the position before the next move
+typedef struct {
+    const PGN_Game *game;
+    FEN_Plus_Game info;
+    Position pos;
+    uint32_t ply;               // moves played so far, kept by dedup or not
+} FEN_Plus_Replay;
+
+// A format's per-ply step: emits the row for move, played from replay->pos.
+// Plies the dedup table drops never reach it.
+typedef enum FEN_Plus_Replay_Status (*FEN_Plus_Emit)(void *context, const FEN_Plus_Replay *replay,
+                                                     ChessMove move);
+
+bool text_buffer_reserve(Text_Buffer *buffer, size_t extra);
+bool text_buffer_append(Text_Buffer *buffer, const char *data, size_t length);
+void text_buffer_free(Text_Buffer *buffer);
+
+bool pgn_header_value(const char *header, size_t header_len, const char *tag,
+                      const char **value_out, size_t *value_len_out);
+bool fen_plus_start_game(const PGN_Game *game, FEN_Plus_Game *info, Position *pos);
+size_t fen_plus_write_row(char *out, const char *time_control, size_t time_control_len,
+                          const Position *pos, int elo, ChessMove move);
+bool fen_plus_move_is_legal(const Position *pos, const char *san, size_t len, ChessMove move);
+bool fen_plus_replay_start(FEN_Plus_Replay *replay, const PGN_Game *game, FEN_Plus_Stats *stats);
+enum FEN_Plus_Replay_Status fen_plus_replay_moves(FEN_Plus_Replay *replay, Dedup_Table *dedup,
+                                                  FEN_Plus_Stats *stats, FEN_Plus_Emit emit, void *context);
+bool fen_plus_append_game(const PGN_Game *game, Dedup_Table *dedup, Text_Buffer *out,
+                          FEN_Plus_Stats *stats);
+bool fen_plus_dedup_keep(Dedup_Table *dedup, const Position *pos, ChessMove move, FEN_Plus_Stats *stats);
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef FEN_RECORD_H
+#define FEN_RECORD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "fen_plus.h"
+#include "output_writer.h"
+#include "pgn_stream.h"
+#include "position.h"
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "FEN record files are little-endian and written with native stores"
+#endif
+
+// Binary FEN+ output. A file is
+//
+//   FEN_Record_File_Header
+//   blocks of FEN_Record, each raw or one zstd frame
+//   FEN_Record_Block_Entry[blocks]
+//   time-control table: per entry one length byte and the text
+//   FEN_Record_Trailer
+//
+// All integers are little-endian. Raw files keep every record contiguous
+// from offset FEN_RECORD_DATA_OFFSET, so they can be mapped as an array;
+// src_python/fen_record.py has the matching numpy dtype.
+
+#define FEN_RECORD_MAGIC "FENREC01"
+#define FEN_RECORD_TRAILER_MAGIC "FENRIDX1"
+#define FEN_RECORD_VERSION 1
+#define FEN_RECORD_DATA_OFFSET 32
+#define FEN_RECORD_COMPRESSION_NONE 0
+#define FEN_RECORD_COMPRESSION_ZSTD 1
+// Time controls past the table limit all share this id
+#define FEN_RECORD_TIME_CONTROL_OTHER 0xFFFF
+#define FEN_RECORD_MAX_TIME_CONTROLS 0xFFFF
+
+// One row of FEN+ output, 48 bytes, no padding
+typedef struct {
+    uint8_t board[32];          // 4 bits per square, a1 in the low nibble of byte 0:
+                                // 0 empty, otherwise enum Piece + 1
+    uint8_t flags;              // bit 0: black to move, bits 4-7: CASTLE_* rights
+    uint8_t en_passant;         // target square, NO_SQUARE if none
+    uint16_t halfmove_clock;
+    uint16_t fullmove_number;
+    uint16_t move;              // ChessMove played from this position
+    uint16_t elo;               // Elo of the side to move, 0 if unknown
+    uint16_t time_control;      // index into the file's time-control table
+    uint32_t game;              // index of the game in the input (low 32 bits)
+} FEN_Record;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t compression;       // FEN_RECORD_COMPRESSION_*
+    uint32_t reserved[3];
+} FEN_Record_File_Header;
+
+typedef struct {
+    uint64_t offset;            // file offset of the block
+    uint32_t stored_size;       // bytes in the file
+    uint32_t records;
+} FEN_Record_Block_Entry;
+
+typedef struct {
+    uint64_t index_offset;      // FEN_Record_Block_Entry[blocks]
+    uint64_t time_control_offset;
+    uint64_t records;
+    uint32_t blocks;
+    uint32_t time_controls;
+    char magic[8];
+} FEN_Record_Trailer;
+
+// Time-control strings and the ids they were given, in first-seen order
+typedef struct {
+    Text_Buffer names;          // length byte + text per entry
+    uint32_t *offsets;          // entry id -> offset into names
+    uint16_t *slots;            // open-addressing table of id + 1, 0 = empty
+    size_t count;
+    size_t slot_count;
+} FEN_Record_Time_Controls;
+
+// Block index and totals collected while a file is written
+typedef struct {
+    FEN_Record_Block_Entry *entries;
+    size_t count;
+    size_t capacity;
+    uint64_t offset;            // where the next block starts
+    uint64_t records;
+} FEN_Record_Index;
+
+void fen_record_from_position(const Position *pos, ChessMove move, int elo, uint16_t time_control,
+                              uint64_t game, FEN_Record *record);
+bool fen_record_to_position(const FEN_Record *record, Position *pos);
+
+bool fen_record_append_game(const PGN_Game *game, uint16_t time_control, Dedup_Table *dedup,
+                            Text_Buffer *out, FEN_Plus_Stats *stats);
+
+uint16_t fen_record_time_control_id(FEN_Record_Time_Controls *table, const char *name, size_t length);
+const char *fen_record_time_control_name(const FEN_Record_Time_Controls *table, uint16_t id,
+                                         size_t *length_out);
+void fen_record_time_controls_free(FEN_Record_Time_Controls *table);
+
+bool fen_record_compress_block(const char *records, size_t length, int level, void **context,
+                               Text_Buffer *out);
+void fen_record_free_context(void *context);
+
+bool fen_record_write_header(Output_Writer *writer, int level, FEN_Record_Index *index);
+bool fen_record_add_block(FEN_Record_Index *index, size_t stored_size, size_t records);
+bool fen_record_write_footer(Output_Writer *writer, const FEN_Record_Index *index,
+                             const FEN_Record_Time_Controls *time_controls);
+void fen_record_index_free(FEN_Record_Index *index);
+
+// Footer pieces game files share
+bool fen_record_write_padding(Output_Writer *writer, uint64_t *offset);
+bool fen_record_read_frame(const uint8_t *map, size_t size, void *header, size_t header_size,
+                           const char *magic, void *trailer, size_t trailer_size, const char *trailer_magic);
+const char **fen_record_read_time_controls(const char *table, const char *end, uint32_t count);
+
+// Reader
+typedef struct FEN_Record_File FEN_Record_File;
+
+FEN_Record_File *fen_record_open(const char *path);
+uint64_t fen_record_count(const FEN_Record_File *file);
+size_t fen_record_block_count(const FEN_Record_File *file);
+size_t fen_record_block_records(const FEN_Record_File *file, size_t block);
+size_t fen_record_read_block(FEN_Record_File *file, size_t block, FEN_Record *out);
+const FEN_Record *fen_record_mapped(const FEN_Record_File *file);
+const char *fen_record_file_time_control(const FEN_Record_File *file, uint16_t id, size_t *length_out);
+void fen_record_close(FEN_Record_File *file);
+
+#endif
@@ -8,39 +8,70 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <limits.h>
+#include <stdint.h>
+#include "arena.h"
 
-// UCI move representation (e.g., "e2e4", "g8f6")
+// SAN move text (e.g., "e4", "Nf3", "O-O"), as pgn_tokenize_moves copies it
 typedef struct {
-    char from_square[3];  // e.g., "e2"
-    char to_square[3];    // e.g., "e4"
-    char promotion[2];    // e.g., "q" for queen promotion, "" if no promotion
-} uci_move;
-
-// SAN move representation (e.g., "e4", "Nf3", "O-O")
-typedef struct {
-    char notation[32];    // e.g., "e4", "Nf3", "O-O"
+    char notation[32];
 } san_move;
 
-// Move struct with union to handle both UCI and SAN formats
+enum Move_Tag {
+    MOVE_TAG_SAN,       // as written in the movetext, origin not resolved yet
+    MOVE_TAG_UCI        // origin and destination known
+};
+
+// A move packed into 32 bits. A SAN move keeps everything its text says
+// (piece, destination, disambiguation, capture, promotion, check) without
+// needing a board; translate_san_to_uci fills in the origin and turns it into
+// a UCI move that can still be written back as SAN. A whole game's moves fit
+// in a few cache lines. Read it through the move_* functions below.
+//
+//   bits  0-5   destination square (a1 = 0, ..., h8 = 63)
+//   bits  6-11  origin square; for SAN only the parts flagged in bits 22-23
+//   bits 12-14  promotion: 0 none, 1 knight, 2 bishop, 3 rook, 4 queen
+//   bit  15     capture
+//   bits 16-17  castling: king side, queen side
+//   bit  18     en passant (known once resolved)
+//   bits 19-21  moving piece: 0 pawn ... 5 king (SAN)
+//   bits 22-23  origin file / origin rank given (SAN)
+//   bits 24-25  suffix: 0 none, 1 '+', 2 '#' (SAN)
+//   bits 26-27  player: 0 unknown, 1 white, 2 black
+//   bit  28     tag (enum Move_Tag)
+//   bit  29     SAN fields are set
 typedef struct {
-    char player;        // 'w' for white, 'b' for black
-    char *type;          // "uci" or "san" to distinguish between formats
-    union {
-        uci_move uci;
-        san_move san;
-    } move_data;
+    uint32_t bits;
 } Move;
 
+// Enough for any move_format_san or move_format_uci output and terminator
+#define MOVE_TEXT_MAX 12
+
+static inline enum Move_Tag move_tag(const Move *move) {
+    return (enum Move_Tag)((move->bits >> 28) & 1);
+}
+static inline int move_target(const Move *move) { return move->bits & 63; }
+static inline int move_origin(const Move *move) { return (move->bits >> 6) & 63; }
+static inline char move_player(const Move *move) {
+    return "?wb?"[(move->bits >> 26) & 3];
+}
+static inline void move_set_player(Move *move, char player) {
+    uint32_t code = player == 'w' ? 1u : player == 'b' ? 2u : 0u;
+    move->bits = (move->bits & ~(3u << 26)) | code << 26;
+}
+
 enum Termination {
     NORMAL,
     TIME_FORFEIT,
-    ABANDONED
+    ABANDONED,
+    RULES_INFRACTION,
+    UNTERMINATED
 };
 
 enum GameResult {
     WHITE_WINS,
     BLACK_WINS,
-    DRAW
+    DRAW,
+    ONGOING     // "*"
 };
 
 typedef struct {
@@ -54,6 +85,18 @@ typedef struct {
     int fullmove_number;
 } FEN_Board;
 
+// Why fen_board_parse rejected a FEN
+enum Fen_Status {
+    FEN_OK,
+    FEN_SYNTAX_ERROR,       // a field is missing, or text follows the last one
+    FEN_BAD_BOARD,          // unknown piece letter, or not 8 ranks of 8 squares
+    FEN_BAD_PIECES,         // king, pawn or promoted piece counts impossible, pawn on rank 1 or 8
+    FEN_BAD_SIDE,           // side to move is not "w" or "b"
+    FEN_BAD_CASTLING,       // not "-" or "KQkq" order, or the king or rook is not at home
+    FEN_BAD_EN_PASSANT,     // not a square on the right rank behind a pawn that just moved two
+    FEN_BAD_CLOCK           // clocks not decimal, out of range, or fullmove number 0
+};
+
 typedef struct {
     char time_control[20];  // Fixed size for time format (e.g., "10", "10+3", "600+0")
     FEN_Board* board;
@@ -64,18 +107,38 @@ typedef struct {
 
 char *get_termination_string(enum Termination termination);
 char *get_game_result_string(enum GameResult game_result);
+bool get_termination_from_string(const char *text, size_t length, enum Termination *out);
+bool get_game_result_from_string(const char *text, size_t length, enum GameResult *out);
 Move *get_move_from_uci(char *uci_move);
+Move *get_move_from_san(char *san_move);
+Move *get_move_from_uci_arena(const char *uci_move, Arena *arena);
+Move *get_move_from_san_arena(const char *san_move, Arena *arena);
+bool move_parse_uci(const char *uci, size_t length, Move *out);
+bool move_parse_san(const char *san, size_t length, Move *out);
+size_t move_format_uci(const Move *move, char *out);
+size_t move_format_san(const Move *move, char *out);
+const char *move_type_string(const Move *move);
 bool string_to_int(const char *str, int *out);
 
 
 int get_move_numbers_from_pgn_string(const char *pgn_string);
 Move **get_moves_from_pgn_string(const char *pgn_string);
+Move **get_moves_from_pgn_string_arena(const char *pgn_string, Arena *arena);
 
+enum Fen_Status fen_board_parse(const char *fen, size_t length, FEN_Board *out);
+const char *fen_status_string(enum Fen_Status status);
 FEN_Board *create_fen_board(char *fen_string);
+FEN_Board *create_fen_board_arena(const char *fen_string, Arena *arena);
 bool fen_board_to_fen_string(FEN_Board *board, char *fen_string_out);
 bool free_fen_plus(FEN_Plus *fen_plus);
+bool fen_plus_pool_init(Pool *pool);
+FEN_Plus *create_fen_plus_pooled(Pool *pool);
+bool free_fen_plus_pooled(FEN_Plus *fen_plus, Pool *pool);
 FEN_Board *generate_starting_position_fen();
 
+bool find_move_starting_position_of_piece(char piece, FEN_Board *board,
+                                          const char destination_square[3],
+                                          char starting_position[3]);
 bool translate_san_to_uci(Move *san_move, FEN_Board *board);
 
 #endif
\ No newline at end of file
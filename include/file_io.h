@@ -0,0 +1,19 @@
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Helpers of the external-memory passes (record_shuffle, opening_book):
+// scratch files, positioned reads and writes that survive EINTR and short
+// transfers, pass timing and the first-error rule of their worker threads.
+
+double file_io_seconds(void);
+int file_io_open_temp(const char *dir, const char *prefix);
+bool file_io_write_at(int fd, const void *data, size_t length, uint64_t offset);
+bool file_io_read_at(int fd, void *data, size_t length, uint64_t offset);
+void file_io_first_error(bool *failed, char *error, size_t error_size, const char *format, va_list args);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stdint.h>
+
+// Writes value in decimal at out without a terminator and returns the end.
+// Replaces sprintf("%d") on the output hot path.
+static inline char *format_uint(char *out, uint32_t value) {
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (n > 0) {
+        *out++ = digits[--n];
+    }
+    return out;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef GAME_FILTER_H
+#define GAME_FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "fen_utils.h"
+#include "pgn_scan.h"
+
+#define GAME_FILTER_MAX_TIME_CONTROLS 8
+
+// Lichess speed categories, by estimated duration base + 40 * increment
+enum Time_Control_Speed {
+    SPEED_ULTRABULLET,
+    SPEED_BULLET,
+    SPEED_BLITZ,
+    SPEED_RAPID,
+    SPEED_CLASSICAL,
+    SPEED_CORRESPONDENCE    // TimeControl "-"
+};
+
+// Conditions on header tags alone. A game passes when it meets every
+// condition that is set; an unset filter passes everything.
+typedef struct {
+    int min_elo;                // both players at least this, 0 = no limit
+    int max_elo;                // both players at most this, 0 = no limit
+    uint32_t speeds;            // bit per enum Time_Control_Speed, 0 = any
+    char time_controls[GAME_FILTER_MAX_TIME_CONTROLS][33];    // exact values, e.g. "600+0"
+    int time_control_count;
+    uint32_t terminations;      // bit per enum Termination, 0 = any
+    uint32_t results;           // bit per enum GameResult, 0 = any
+} Game_Filter;
+
+void game_filter_init(Game_Filter *filter);
+bool game_filter_active(const Game_Filter *filter);
+bool game_filter_add_time_controls(Game_Filter *filter, const char *list);
+bool game_filter_add_terminations(Game_Filter *filter, const char *list);
+bool game_filter_add_results(Game_Filter *filter, const char *list);
+bool game_filter_matches(const Game_Filter *filter, const PGN_Header_Tags *tags);
+int game_filter_time_control_speed(const PGN_Tag *tag);
+const char *game_filter_speed_name(int speed);
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef GAME_RECORD_H
+#define GAME_RECORD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "fen_plus.h"
+#include "fen_record.h"
+#include "output_writer.h"
+#include "pgn_stream.h"
+#include "position.h"
+
+// Game-level FEN+ storage: each game once, as its header facts, its start
+// position and its moves, instead of one row per ply. A file is
+//
+//   Game_Record_File_Header
+//   blocks of games, each raw or one zstd frame
+//   Game_Record_Block_Entry[blocks]
+//   uint32_t[games]: offset of every game within its uncompressed block
+//   time-control table, as in record files
+//   Game_Record_Trailer
+//
+// A game is a Game_Record, then a FEN_Record holding the start position if
+// the game had a FEN tag (GAME_RECORD_CUSTOM_START), then plies ChessMoves.
+// Readers rebuild the position before every ply by playing the moves, so
+// the rows come out exactly as record files hold them.
+
+#define GAME_RECORD_MAGIC "FENGAME1"
+#define GAME_RECORD_TRAILER_MAGIC "FENGIDX1"
+#define GAME_RECORD_VERSION 1
+#define GAME_RECORD_COMPRESSION_NONE 0
+#define GAME_RECORD_COMPRESSION_ZSTD 1
+#define GAME_RECORD_CUSTOM_START 1
+// Longer games are rejected; no legal game comes near this
+#define GAME_RECORD_MAX_PLIES 0xFFFF
+
+// Per game, 16 bytes, followed by its start position (if custom) and moves
+typedef struct {
+    uint32_t game;              // index of the game in the input (low 32 bits)
+    uint16_t plies;
+    uint16_t time_control;      // index into the file's time-control table
+    uint16_t elo[2];            // by color, 0 if unknown
+    uint8_t flags;              // GAME_RECORD_CUSTOM_START
+    uint8_t reserved[3];
+} Game_Record;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t compression;       // GAME_RECORD_COMPRESSION_*
+    uint32_t reserved[4];
+} Game_Record_File_Header;
+
+typedef struct {
+    uint64_t offset;            // file offset of the block
+    uint32_t stored_size;       // bytes in the file
+    uint32_t raw_size;          // bytes once decompressed
+    uint32_t games;
+    uint32_t plies;
+} Game_Record_Block_Entry;
+
+typedef struct {
+    uint64_t index_offset;      // Game_Record_Block_Entry[blocks], then the game offsets
+    uint64_t time_control_offset;
+    uint64_t games;
+    uint64_t plies;
+    uint32_t blocks;
+    uint32_t time_controls;
+    char magic[8];
+} Game_Record_Trailer;
+
+// Blocks and game offsets collected while a file is written
+typedef struct {
+    Game_Record_Block_Entry *entries;
+    size_t count;
+    size_t capacity;
+    uint32_t *game_offsets;
+    size_t game_count;
+    size_t game_capacity;
+    uint64_t offset;            // where the next block starts
+    uint64_t plies;
+} Game_Record_Index;
+
+bool game_record_append_game(const PGN_Game *game, uint16_t time_control, Text_Buffer *out,
+                             FEN_Plus_Stats *stats);
+
+bool game_record_write_header(Output_Writer *writer, int level, Game_Record_Index *index);
+bool game_record_add_block(Game_Record_Index *index, const char *games, size_t raw_size, size_t stored_size);
+bool game_record_write_footer(Output_Writer *writer, const Game_Record_Index *index,
+                              const FEN_Record_Time_Controls *time_controls);
+void game_record_index_free(Game_Record_Index *index);
+
+// Reader
+typedef struct Game_Record_File Game_Record_File;
+
+// Replays one game: pos is the position before move ply
+typedef struct {
+    Game_Record info;
+    Position pos;
+    const ChessMove *moves;     // into the file's mapping or current block
+    uint32_t ply;
+    bool corrupt;               // a stored move was not legal where it was played
+} Game_Record_Cursor;
+
+Game_Record_File *game_record_open(const char *path);
+uint64_t game_record_count(const Game_Record_File *file);
+uint64_t game_record_plies(const Game_Record_File *file);
+bool game_record_seek(Game_Record_File *file, uint64_t game, uint32_t ply, Game_Record_Cursor *cursor);
+bool game_record_next(Game_Record_Cursor *cursor, FEN_Record *record);
+const char *game_record_file_time_control(const Game_Record_File *file, uint16_t id, size_t *length_out);
+void game_record_close(Game_Record_File *file);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "position.h"
+
+// No legal chess position has more than 218 moves
+#define MAX_MOVES 256
+
+// Moves of one position, filled in place so generation never allocates
+typedef struct {
+    ChessMove moves[MAX_MOVES];
+    int count;
+} Move_List;
+
+// All functions below need attacks_init() to have been called once.
+int generate_legal_moves(const Position *pos, Move_List *list);
+bool position_is_legal_move(const Position *pos, ChessMove move);
+uint64_t perft(const Position *pos, int depth);
+
+#endif
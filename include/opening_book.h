@@ -0,0 +1,121 @@
+#ifndef OPENING_BOOK_H
+#define OPENING_BOOK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "fen_plus.h"
+#include "output_writer.h"
+#include "pgn_stream.h"
+#include "position.h"
+
+// Move frequencies per position: for every Zobrist key, how often each move
+// was played from it, counted separately per Elo band of the mover and speed
+// category of the game. A file is
+//
+//   Opening_Book_File_Header
+//   Opening_Book_Position[positions], sorted by key
+//   Opening_Book_Move[moves], each position's moves sorted by move, band, speed
+//   uint64_t[index_entries]: the key of every index_stride-th position
+//   Opening_Book_Trailer
+//
+// Books are built map-reduce style. Each worker counts into a map of its own
+// and, when the map fills up, sorts it and appends it to its run file as a
+// sorted run. At the end the key space is cut into ranges that are merged
+// from all runs in parallel, so memory stays fixed however large the input.
+// The file depends on the input alone, not on the thread count or memory.
+
+#define OPENING_BOOK_MAGIC "FENBOOK1"
+#define OPENING_BOOK_TRAILER_MAGIC "FENBIDX1"
+#define OPENING_BOOK_VERSION 1
+#define OPENING_BOOK_INDEX_STRIDE 1024
+// Elo band or speed of a move whose game lacks the tag
+#define OPENING_BOOK_UNKNOWN 255
+#define OPENING_BOOK_DEFAULT_MEMORY (256u << 20)
+#define OPENING_BOOK_DEFAULT_ELO_BAND 200
+
+// A counted (position, move, band, speed), 16 bytes: map slot and run entry
+typedef struct {
+    uint64_t key;
+    uint16_t move;              // ChessMove
+    uint8_t elo_band;           // mover's Elo / elo_band, OPENING_BOOK_UNKNOWN if unrated
+    uint8_t speed;              // enum Time_Control_Speed, OPENING_BOOK_UNKNOWN if unparsable
+    uint32_t count;
+} Opening_Book_Entry;
+
+typedef struct {
+    uint64_t key;
+    uint64_t first_move;        // index of its first Opening_Book_Move; the next position's ends it
+} Opening_Book_Position;
+
+typedef struct {
+    uint16_t move;
+    uint8_t elo_band;
+    uint8_t speed;
+    uint32_t count;
+} Opening_Book_Move;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t elo_band;          // Elo points per band
+    uint32_t min_count;         // positions played fewer times were left out
+    uint32_t index_stride;
+    uint32_t reserved[2];
+} Opening_Book_File_Header;
+
+typedef struct {
+    uint64_t positions;
+    uint64_t moves;
+    uint64_t moves_offset;
+    uint64_t index_offset;
+    uint64_t index_entries;
+    uint64_t total_count;       // moves counted over all positions kept
+    uint64_t reserved;
+    char magic[8];
+} Opening_Book_Trailer;
+
+typedef struct {
+    size_t memory;              // bytes for the maps, over all workers
+    uint32_t elo_band;          // Elo points per band
+    uint32_t min_count;         // leave out positions played fewer times
+    const char *temp_dir;       // run files; NULL uses TMPDIR or /tmp
+} Opening_Book_Options;
+
+typedef struct {
+    uint64_t runs;              // sorted runs spilled, over all workers
+    uint64_t run_entries;
+    uint64_t run_bytes;
+    uint64_t positions;         // written to the book
+    uint64_t moves;
+    uint64_t pruned;            // positions below min_count
+    uint64_t partitions;        // key ranges merged
+    double spill_seconds;       // sorting and writing runs, summed over workers
+    double merge_seconds;       // wall time of the final spill, merge and assembly
+    char error[256];
+} Opening_Book_Stats;
+
+// Builder
+typedef struct Opening_Book_Builder Opening_Book_Builder;
+
+void opening_book_default_options(Opening_Book_Options *options);
+int opening_book_elo_band(uint32_t band_width, int elo);
+Opening_Book_Builder *opening_book_builder_create(const Opening_Book_Options *options, int workers,
+                                                  char *error, size_t error_size);
+bool opening_book_add_game(Opening_Book_Builder *builder, int worker, const PGN_Game *game,
+                           FEN_Plus_Stats *stats);
+const char *opening_book_builder_error(Opening_Book_Builder *builder);
+bool opening_book_finish(Opening_Book_Builder *builder, Output_Writer *writer, int threads,
+                         Opening_Book_Stats *stats);
+void opening_book_builder_free(Opening_Book_Builder *builder);
+
+// Reader
+typedef struct Opening_Book Opening_Book;
+
+Opening_Book *opening_book_open(const char *path);
+size_t opening_book_lookup(const Opening_Book *book, uint64_t key, const Opening_Book_Move **moves_out);
+const Opening_Book_File_Header *opening_book_header(const Opening_Book *book);
+const Opening_Book_Trailer *opening_book_trailer(const Opening_Book *book);
+void opening_book_close(Opening_Book *book);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef OUTPUT_WRITER_H
+#define OUTPUT_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Block size of the writer: every write() but the last one covers a whole
+// number of blocks, so file offsets stay block aligned.
+#define OUTPUT_WRITER_BLOCK (1u << 20)
+
+// Buffers output for a file descriptor and hands it to the kernel in large
+// aligned writes instead of one call per row or per batch.
+typedef struct {
+    int fd;
+    char *buffer;           // OUTPUT_WRITER_BLOCK bytes, page aligned
+    size_t length;
+    uint64_t bytes_written; // bytes handed to write() so far
+    uint64_t write_calls;
+    int error;              // errno of the first failed write, 0 if none
+} Output_Writer;
+
+bool output_writer_init(Output_Writer *writer, int fd);
+bool output_writer_write(Output_Writer *writer, const char *data, size_t length);
+bool output_writer_flush(Output_Writer *writer);
+void output_writer_free(Output_Writer *writer);
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+// Per-stage instrumentation of the conversion. Build with -DPERF_COUNTERS=0
+// (make PERF=0) and every PERF_* macro below expands to nothing.
+#ifndef PERF_COUNTERS
+#define PERF_COUNTERS 1
+#endif
+
+// One game in this many is timed ply by ply, to split SAN resolution from
+// row formatting without reading the clock twice on every ply
+#ifndef PERF_SAMPLE_EVERY
+#define PERF_SAMPLE_EVERY 16
+#endif
+// Game latency histogram: bucket b counts games taking [2^b, 2^(b+1)) ticks
+#define PERF_LATENCY_BUCKETS 48
+
+enum Perf_Stage {
+    PERF_DECOMPRESS,    // reading and decompressing the input (reader)
+    PERF_SCAN,          // splitting games, header tags, filter, copy into batches (reader)
+    PERF_SAN,           // tokenizing, SAN resolution and make_move (workers, sampled)
+    PERF_FORMAT,        // dedup and FEN+ row or record encoding (workers, sampled)
+    PERF_COMPRESS,      // zstd compression of record blocks and CSV shards (workers)
+    PERF_WRITE,         // output writes (writer)
+    PERF_STAGE_COUNT
+};
+
+// Counters of one thread. Only the owning thread writes them, with plain
+// stores, so counting costs no locked instructions; a report taken while the
+// conversion runs reads them with relaxed loads. Keep each thread's counters
+// on their own cache lines.
+typedef struct {
+    uint64_t ticks[PERF_STAGE_COUNT];
+    uint64_t bytes[PERF_STAGE_COUNT];
+    uint64_t games;             // games converted, rejected ones included
+    uint64_t plies;             // rows written
+    uint64_t sampled_games;     // games that fed the PERF_SAN and PERF_FORMAT ticks
+    uint64_t san_cache_ticks[2];    // PERF_SAN ticks of sampled plies that hit [0] or missed [1]
+    uint64_t san_cache_plies[2];    // the SAN cache, see san_cache.h
+    uint64_t latency[PERF_LATENCY_BUCKETS];
+} __attribute__((aligned(64))) Perf_Counters;
+
+// Ply-by-ply timer of one sampled game; counters is NULL for the others
+typedef struct {
+    Perf_Counters *counters;
+    uint64_t last;
+} Perf_Sample;
+
+// Converts ticks to seconds: started with the run, read at report time
+typedef struct {
+    uint64_t start_ticks;
+    double start_seconds;
+} Perf_Clock;
+
+/**
+ * @brief Cheap monotonic tick count: the TSC on x86, nanoseconds elsewhere.
+ */
+static inline uint64_t perf_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Plain load and store, not an atomic add: only the owner thread writes
+static inline void perf_add(uint64_t *counter, uint64_t amount) {
+    __atomic_store_n(counter, *counter + amount, __ATOMIC_RELAXED);
+}
+
+static inline void perf_stop(Perf_Counters *counters, int stage, uint64_t start) {
+    if (counters != NULL) {
+        perf_add(&counters->ticks[stage], perf_ticks() - start);
+    }
+}
+
+static inline void perf_game(Perf_Counters *counters, uint64_t start) {
+    if (counters != NULL) {
+        uint64_t ticks = perf_ticks() - start;
+        int bucket = 63 - __builtin_clzll(ticks | 1);
+        if (bucket >= PERF_LATENCY_BUCKETS) {
+            bucket = PERF_LATENCY_BUCKETS - 1;
+        }
+        perf_add(&counters->latency[bucket], 1);
+        perf_add(&counters->games, 1);
+    }
+}
+
+static inline Perf_Sample perf_sample_begin(Perf_Counters *counters, uint64_t game_index) {
+    Perf_Sample sample = {NULL, 0};
+    if (counters != NULL && game_index % PERF_SAMPLE_EVERY == 0) {
+        sample.counters = counters;
+        sample.last = perf_ticks();
+        perf_add(&counters->sampled_games, 1);
+    }
+    return sample;
+}
+
+// Charges the time since the previous mark to stage
+static inline void perf_sample_mark(Perf_Sample *sample, int stage) {
+    if (sample->counters != NULL) {
+        uint64_t now = perf_ticks();
+        perf_add(&sample->counters->ticks[stage], now - sample->last);
+        sample->last = now;
+    }
+}
+
+// Like perf_sample_mark for PERF_SAN, also charging the time to the SAN
+// cache outcome: lookup is an enum San_Cache_Lookup, 1 a hit and 2 a miss
+static inline void perf_sample_san(Perf_Sample *sample, int lookup) {
+    if (sample->counters != NULL) {
+        uint64_t now = perf_ticks();
+        perf_add(&sample->counters->ticks[PERF_SAN], now - sample->last);
+        if (lookup == 1 || lookup == 2) {
+            perf_add(&sample->counters->san_cache_ticks[lookup - 1], now - sample->last);
+            perf_add(&sample->counters->san_cache_plies[lookup - 1], 1);
+        }
+        sample->last = now;
+    }
+}
+
+#if PERF_COUNTERS
+#define PERF_START(name) uint64_t name = perf_ticks()
+#define PERF_STOP(counters, stage, name) perf_stop((counters), (stage), (name))
+#define PERF_BYTES(counters, stage, amount) \
+    do { if ((counters) != NULL) perf_add(&(counters)->bytes[(stage)], (amount)); } while (0)
+#define PERF_PLIES(counters, amount) \
+    do { if ((counters) != NULL) perf_add(&(counters)->plies, (amount)); } while (0)
+#define PERF_GAME(counters, name) perf_game((counters), (name))
+#define PERF_SAMPLE_BEGIN(name, counters, game_index) \
+    Perf_Sample name = perf_sample_begin((counters), (game_index))
+#define PERF_SAMPLE_MARK(name, stage) perf_sample_mark(&(name), (stage))
+#define PERF_SAMPLE_SAN(name, lookup) perf_sample_san(&(name), (int)(lookup))
+#else
+#define PERF_START(name) ((void)0)
+#define PERF_STOP(counters, stage, name) ((void)0)
+#define PERF_BYTES(counters, stage, amount) ((void)0)
+#define PERF_PLIES(counters, amount) ((void)0)
+#define PERF_GAME(counters, name) ((void)0)
+#define PERF_SAMPLE_BEGIN(name, counters, game_index) ((void)0)
+#define PERF_SAMPLE_MARK(name, stage) ((void)0)
+#define PERF_SAMPLE_SAN(name, lookup) ((void)0)
+#endif
+
+void perf_clock_start(Perf_Clock *clock);
+double perf_ticks_per_second(const Perf_Clock *clock);
+void perf_counters_sum(const Perf_Counters *counters, size_t count, Perf_Counters *total);
+uint64_t perf_peak_rss_bytes(void);
+void perf_write_json(const Perf_Counters *total, double ticks_per_second, FILE *out);
+
+#endif
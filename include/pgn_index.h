@@ -0,0 +1,41 @@
+#ifndef PGN_INDEX_H
+#define PGN_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PGN_INDEX_MAGIC "PGNZIDX1"
+// Decoded bytes per frame written by pgn_index_reencode by default
+#define PGN_INDEX_DEFAULT_FRAME_BYTES (4u << 20)
+
+// zstd seekable format: a skippable frame holding one entry per frame,
+// followed by a footer with this magic
+#define PGN_INDEX_SEEK_TABLE_MAGIC 0x184D2A5Eu
+#define PGN_INDEX_SEEKABLE_MAGIC 0x8F92EAB1u
+
+typedef struct {
+    uint64_t offset;                // of the frame in the compressed file
+    uint64_t compressed_size;
+    uint64_t decompressed_size;     // 0 if the frame header does not say
+} PGN_Index_Frame;
+
+// The data frames of a .zst file, in file order. Skippable frames (such as
+// a seek table) are not listed. Frames can be decoded independently, which
+// is what lets several threads decompress one file.
+typedef struct {
+    PGN_Index_Frame *frames;
+    size_t count;
+    size_t capacity;
+    uint64_t file_size;
+} PGN_Index;
+
+bool pgn_index_build(const char *path, PGN_Index *index);
+bool pgn_index_save(const PGN_Index *index, const char *index_path);
+bool pgn_index_load(const char *path, PGN_Index *index);
+bool pgn_index_reencode(const char *input_path, const char *output_path, size_t frame_bytes, int level,
+                        uint64_t *games_out);
+void pgn_index_sidecar_path(const char *path, char *out, size_t out_size);
+void pgn_index_free(PGN_Index *index);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef PGN_SCAN_H
+#define PGN_SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bit i of each mask is set when byte i of a 64-byte block is that character
+typedef struct {
+    uint64_t newline;
+    uint64_t open_bracket;
+    uint64_t close_bracket;
+    uint64_t quote;
+    uint64_t open_brace;
+    uint64_t close_brace;
+} PGN_Scan_Masks;
+
+typedef enum {
+    PGN_SCAN_AUTO,      // best implementation the CPU supports
+    PGN_SCAN_SCALAR,
+    PGN_SCAN_SSE2,
+    PGN_SCAN_AVX2
+} PGN_Scan_Impl;
+
+// A tag value inside the header text, without quotes. NULL if absent.
+typedef struct {
+    const char *value;
+    size_t length;
+} PGN_Tag;
+
+typedef struct {
+    PGN_Tag white_elo;
+    PGN_Tag black_elo;
+    PGN_Tag time_control;
+    PGN_Tag termination;
+    PGN_Tag result;
+    PGN_Tag fen;
+} PGN_Header_Tags;
+
+bool pgn_scan_select(PGN_Scan_Impl impl);
+const char *pgn_scan_impl_name(void);
+void pgn_scan_block(const char *block, PGN_Scan_Masks *masks);
+void pgn_scan_headers(const char *header, size_t length, PGN_Header_Tags *tags);
+size_t pgn_scan_find_game(const char *data, size_t length, size_t from);
+
+#endif
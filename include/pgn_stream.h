@@ -0,0 +1,50 @@
+#ifndef PGN_STREAM_H
+#define PGN_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "perf_counters.h"
+#include "pgn_index.h"
+
+// Default size of the decompressed text buffer. Games are a few KB each, so
+// this holds hundreds of games; it only grows if a single game is larger.
+#define PGN_STREAM_DEFAULT_BUFFER (4u << 20)
+// Hard upper bound for the buffer, i.e. for the size of a single game.
+#define PGN_STREAM_MAX_BUFFER (64u << 20)
+// Compressed bytes a decoder thread takes at a time in parallel mode
+#define PGN_STREAM_SEGMENT_BYTES (1u << 20)
+// Mapped mode: text exposed per refill, and the granularity at which pages
+// already read are given back to the kernel
+#define PGN_STREAM_MAP_WINDOW (16u << 20)
+
+// One game handed out by the stream. Both slices point into the stream's
+// buffer (no copies) and stay valid only until the next call to
+// pgn_stream_next_game or pgn_stream_close.
+typedef struct {
+    const char *header;     // "[Event ...]" up to the end of the last tag line
+    size_t header_len;
+    const char *movetext;   // "1. e4 e5 ..." without trailing whitespace
+    size_t movetext_len;
+    uint64_t index;         // 0-based position of the game in the stream
+    uint64_t offset;        // decoded input offset of its "[Event" line
+} PGN_Game;
+
+typedef struct PGN_Stream PGN_Stream;
+
+PGN_Stream *pgn_stream_open(const char *path);
+PGN_Stream *pgn_stream_open_with_buffer(const char *path, size_t buffer_capacity);
+PGN_Stream *pgn_stream_open_mapped(const char *path, uint64_t range_start, uint64_t range_end);
+PGN_Stream *pgn_stream_open_parallel(const char *path, const PGN_Index *index, int threads,
+                                     size_t segment_bytes);
+bool pgn_stream_seek(PGN_Stream *stream, uint64_t offset, uint64_t first_index, const PGN_Index *index);
+bool pgn_stream_next_game(PGN_Stream *stream, PGN_Game *game_out);
+uint64_t pgn_stream_offset(const PGN_Stream *stream);
+const char *pgn_stream_error(const PGN_Stream *stream);
+uint64_t pgn_stream_bytes_read(const PGN_Stream *stream);
+uint64_t pgn_stream_bytes_decoded(const PGN_Stream *stream);
+size_t pgn_stream_buffer_capacity(const PGN_Stream *stream);
+void pgn_stream_set_counters(PGN_Stream *stream, Perf_Counters *counters);
+void pgn_stream_close(PGN_Stream *stream);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef PGN_TOKENIZER_H
+#define PGN_TOKENIZER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "fen_utils.h"
+
+// Movetext cursor. Tokens are slices of the movetext, so tokenizing a game
+// needs no copies and no allocations.
+typedef struct {
+    const char *cursor;
+    const char *end;
+    bool finished;      // result token reached
+} PGN_Tokenizer;
+
+void pgn_tokenizer_init(PGN_Tokenizer *tokenizer, const char *movetext, size_t length);
+bool pgn_tokenizer_next(PGN_Tokenizer *tokenizer, const char **token_out, size_t *length_out);
+int pgn_tokenize_moves(const char *movetext, size_t length, san_move *moves, int capacity);
+
+#endif
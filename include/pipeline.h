@@ -0,0 +1,86 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "game_filter.h"
+#include "opening_book.h"
+
+#define PIPELINE_DEFAULT_BATCH_BYTES (256 * 1024)
+#define PIPELINE_DEFAULT_COMPRESSION_LEVEL 3
+#define PIPELINE_DEFAULT_SHARD_BYTES (1ull << 30)
+
+enum Pipeline_Format {
+    PIPELINE_FORMAT_CSV,        // FEN+ rows as text
+    PIPELINE_FORMAT_RECORDS,    // fixed-size binary records, see fen_record.h
+    PIPELINE_FORMAT_ARROW,      // columnar Arrow IPC file, see arrow_ipc.h
+    PIPELINE_FORMAT_GAMES,      // one entry per game, rows rebuilt on read, see game_record.h
+    PIPELINE_FORMAT_BOOK        // move counts per position, see opening_book.h
+};
+
+typedef struct {
+    int threads;            // worker threads; 0 converts on the calling thread
+    int decode_threads;     // threads decompressing an indexed .zst input; 0 decodes on the reader
+    bool map_input;         // memory-map a plain .pgn input instead of reading it
+    size_t batch_bytes;     // PGN bytes handed to a worker at a time
+    bool write_header;      // start the output with the CSV header line
+    int format;             // enum Pipeline_Format
+    int compression_level;  // zstd level of record and game blocks, Arrow buffers and CSV shards, 0 stores them raw
+    uint32_t dedup_max_count;   // keep this many rows per (position, move); 0 disables dedup, which
+                                // game output requires
+    uint32_t dedup_keep_every;  // beyond that keep every Nth row; 0 drops them all
+    size_t dedup_memory;        // bytes for the dedup table
+    size_t san_cache_memory;    // bytes for each worker's SAN cache, 0 resolves every move
+    Game_Filter filter;         // games to keep, judged on header tags before any movetext work
+    Opening_Book_Options book;  // book output: map memory, Elo bands, pruning and run files
+    const char *output_dir;     // write numbered shards and a checkpoint here instead of output_fd
+    uint64_t shard_bytes;       // start a new shard once the open one holds this many bytes
+    bool resume;                // continue from the checkpoint in output_dir; not with dedup
+    uint64_t range_start;       // convert only games whose "[Event" line starts in
+    uint64_t range_end;         // [range_start, range_end) of the decoded input; 0 = to the end
+    const char *report_path;    // write a JSON run report here at the end and on request; NULL = none
+} Pipeline_Options;
+
+// Busy time per stage excludes time spent waiting on other stages, so a stage
+// whose busy time is close to the wall time is the bottleneck.
+typedef struct {
+    uint64_t games;
+    uint64_t rejected;
+    uint64_t plies;
+    uint64_t filtered_games;    // games skipped by the header filter
+    uint64_t filtered_bytes;    // PGN bytes of those games
+    uint64_t duplicates;        // rows dropped by dedup
+    uint64_t untracked;         // rows dedup kept because its table had no room
+    uint64_t dedup_pairs;       // distinct (position, move) pairs in the table
+    uint64_t dedup_memory;      // bytes of the dedup table
+    uint64_t san_cache_hits;    // moves resolved from a worker's SAN cache
+    uint64_t san_cache_misses;  // moves looked up there in vain
+    uint64_t san_cache_memory;  // bytes of SAN cache per worker
+    uint64_t batches;
+    uint64_t steals;            // batches run by a worker other than their owner
+    uint64_t bytes_read;        // input bytes, compressed if the input is .zst
+    uint64_t bytes_decoded;
+    uint64_t bytes_written;
+    int threads;
+    int decode_threads;         // 0 if the input was decoded sequentially
+    bool mapped_input;          // the input was read through a memory mapping
+    uint64_t start_offset;      // decoded offset the run started at (resume or range)
+    uint64_t first_shard;       // number of the first shard this run wrote
+    uint64_t shards;            // shards finished by this run
+    Opening_Book_Stats book;    // book output: runs spilled and what was merged
+    double read_seconds;
+    double convert_seconds;     // summed over all workers
+    double write_seconds;
+    double wall_seconds;
+    char error[256];            // set when pipeline_run returns false
+} Pipeline_Stats;
+
+void pipeline_default_options(Pipeline_Options *options);
+bool pipeline_run(const char *input_path, int output_fd, const Pipeline_Options *options,
+                  Pipeline_Stats *stats);
+void pipeline_print_report(const Pipeline_Stats *stats, FILE *out);
+void pipeline_request_report(void);
+
+#endif
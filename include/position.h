@@ -0,0 +1,124 @@
+#ifndef POSITION_H
+#define POSITION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "fen_utils.h"
+
+// Squares are numbered a1 = 0, b1 = 1, ..., h1 = 7, a2 = 8, ..., h8 = 63.
+#define NO_SQUARE 64
+// Longest FEN position_write_fen can produce, without terminator
+#define FEN_MAX_LENGTH 96
+#define SQUARE(file, rank) ((rank) * 8 + (file))
+#define SQUARE_FILE(square) ((square) & 7)
+#define SQUARE_RANK(square) ((square) >> 3)
+
+typedef uint64_t Bitboard;
+
+enum Color {
+    WHITE,
+    BLACK
+};
+
+enum PieceType {
+    PAWN,
+    KNIGHT,
+    BISHOP,
+    ROOK,
+    QUEEN,
+    KING
+};
+
+// Index into Position.pieces: color * 6 + piece type
+enum Piece {
+    WHITE_PAWN, WHITE_KNIGHT, WHITE_BISHOP, WHITE_ROOK, WHITE_QUEEN, WHITE_KING,
+    BLACK_PAWN, BLACK_KNIGHT, BLACK_BISHOP, BLACK_ROOK, BLACK_QUEEN, BLACK_KING,
+    NO_PIECE
+};
+
+#define MAKE_PIECE(color, type) ((color) * 6 + (type))
+#define PIECE_COLOR(piece) ((piece) >= BLACK_PAWN)
+#define PIECE_TYPE(piece) ((piece) % 6)
+
+enum CastlingRight {
+    CASTLE_WHITE_KING = 1,
+    CASTLE_WHITE_QUEEN = 2,
+    CASTLE_BLACK_KING = 4,
+    CASTLE_BLACK_QUEEN = 8
+};
+
+// Bitboard position. 12 piece bitboards plus one occupancy mask per color,
+// the rest of the FEN state packed into 8 bytes and the Zobrist key, so the
+// whole struct is two cache lines.
+typedef struct __attribute__((aligned(64))) {
+    Bitboard pieces[12];        // indexed by enum Piece
+    Bitboard occupancy[2];      // all white / all black pieces
+    uint8_t side_to_move;       // WHITE or BLACK
+    uint8_t castling;           // CASTLE_* bits
+    uint8_t en_passant;         // target square, NO_SQUARE if none
+    uint8_t reserved;
+    uint16_t halfmove_clock;
+    uint16_t fullmove_number;
+    uint64_t key;               // Zobrist key, kept up to date by make_move
+} Position;
+
+// 16-bit move: from square (bits 0-5), to square (bits 6-11) and a 4-bit
+// flag (bits 12-15) telling make_move what kind of move it is.
+typedef uint16_t ChessMove;
+
+#define NULL_MOVE ((ChessMove)0)
+
+enum MoveFlag {
+    MOVE_QUIET = 0,
+    MOVE_DOUBLE_PUSH = 1,
+    MOVE_KING_CASTLE = 2,
+    MOVE_QUEEN_CASTLE = 3,
+    MOVE_CAPTURE = 4,
+    MOVE_EN_PASSANT = 5,
+    MOVE_PROMOTION = 8,         // + (promotion piece type - KNIGHT)
+    MOVE_PROMOTION_CAPTURE = 12 // + (promotion piece type - KNIGHT)
+};
+
+static inline ChessMove move_encode(int from, int to, int flags) {
+    return (ChessMove)(from | (to << 6) | (flags << 12));
+}
+
+static inline int move_from(ChessMove move) { return move & 63; }
+static inline int move_to(ChessMove move) { return (move >> 6) & 63; }
+static inline int move_flags(ChessMove move) { return move >> 12; }
+static inline bool move_is_capture(ChessMove move) { return (move >> 12) & MOVE_CAPTURE; }
+static inline bool move_is_promotion(ChessMove move) { return (move >> 12) & MOVE_PROMOTION; }
+static inline int move_promotion_type(ChessMove move) { return KNIGHT + ((move >> 12) & 3); }
+
+static inline Bitboard square_bit(int square) { return (Bitboard)1 << square; }
+static inline int bitboard_lsb(Bitboard bb) { return __builtin_ctzll(bb); }
+static inline int bitboard_count(Bitboard bb) { return __builtin_popcountll(bb); }
+static inline int bitboard_pop_lsb(Bitboard *bb) {
+    int square = __builtin_ctzll(*bb);
+    *bb &= *bb - 1;
+    return square;
+}
+
+static inline Bitboard position_occupied(const Position *pos) {
+    return pos->occupancy[WHITE] | pos->occupancy[BLACK];
+}
+
+int square_from_string(const char *square);
+void square_to_string(int square, char out[3]);
+char piece_to_char(int piece);
+int piece_from_char(char c);
+
+uint64_t position_compute_key(const Position *pos);
+void position_clear(Position *pos);
+bool position_from_fen_board(const FEN_Board *board, Position *pos);
+bool position_to_fen_board(const Position *pos, FEN_Board *board);
+bool position_from_fen(const char *fen_string, Position *pos);
+bool position_to_fen(const Position *pos, char *fen_string_out);
+size_t position_write_fen(const Position *pos, char *out);
+void position_set_start(Position *pos);
+int position_piece_at(const Position *pos, int square);
+
+ChessMove position_encode_move(const Position *pos, int from, int to, int promotion_type);
+void position_make_move(Position *pos, ChessMove move);
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Ranges this short are finished by insertion sort
+#define RADIX_SORT_INSERTION_MAX 24
+
+// Defines static void name(Type *entries, size_t count, int shift): an
+// in-place MSD radix sort (American flag sort) on the byte of the uint64_t
+// entries[i].key at shift, then on the bytes below it. before(a, b) is the
+// full order, key first; it finishes short ranges and, by qsort, the ranges
+// left once the key is used up. Keys should be close to uniform, so that
+// each level cuts the ranges about 256-fold. Start with shift 56 to sort on
+// the whole key, or lower when the bytes above are known to be equal; a
+// shift that is not a multiple of 8 is fine, the last level uses byte 0.
+#define RADIX_SORT_DEFINE(name, Type, before)                                                     \
+    static int name##_compare(const void *a, const void *b) {                                     \
+        const Type *x = (const Type *)a;                                                          \
+        const Type *y = (const Type *)b;                                                          \
+        return before(x, y) ? -1 : before(y, x) ? 1 : 0;                                          \
+    }                                                                                             \
+                                                                                                  \
+    static void name(Type *entries, size_t count, int shift) {                                    \
+        if (count <= RADIX_SORT_INSERTION_MAX) {                                                  \
+            for (size_t i = 1; i < count; i++) {                                                  \
+                Type item = entries[i];                                                           \
+                size_t j = i;                                                                     \
+                for (; j > 0 && before(&item, &entries[j - 1]); j--) {                            \
+                    entries[j] = entries[j - 1];                                                  \
+                }                                                                                 \
+                entries[j] = item;                                                                \
+            }                                                                                     \
+            return;                                                                               \
+        }                                                                                         \
+        if (shift <= -8) {                                                                        \
+            qsort(entries, count, sizeof(Type), name##_compare);                                  \
+            return;                                                                               \
+        }                                                                                         \
+        if (shift < 0) {                                                                          \
+            shift = 0;                                                                            \
+        }                                                                                         \
+        size_t heads[256] = {0};                                                                  \
+        size_t tails[256];                                                                        \
+        for (size_t i = 0; i < count; i++) {                                                      \
+            heads[(entries[i].key >> shift) & 0xFF]++;                                            \
+        }                                                                                         \
+        size_t start = 0;                                                                         \
+        for (int d = 0; d < 256; d++) {                                                           \
+            size_t n = heads[d];                                                                  \
+            heads[d] = start;                                                                     \
+            start += n;                                                                           \
+            tails[d] = start;                                                                     \
+        }                                                                                         \
+        /* Moves every entry to its digit's range along cycles of swaps */                       \
+        for (int d = 0; d < 256; d++) {                                                           \
+            while (heads[d] < tails[d]) {                                                         \
+                Type item = entries[heads[d]];                                                    \
+                int digit = (int)((item.key >> shift) & 0xFF);                                    \
+                while (digit != d) {                                                              \
+                    Type next = entries[heads[digit]];                                            \
+                    entries[heads[digit]++] = item;                                               \
+                    item = next;                                                                  \
+                    digit = (int)((item.key >> shift) & 0xFF);                                    \
+                }                                                                                 \
+                entries[heads[d]++] = item;                                                       \
+            }                                                                                     \
+        }                                                                                         \
+        start = 0;                                                                                \
+        for (int d = 0; d < 256; d++) {                                                           \
+            name(entries + start, tails[d] - start, shift - 8);                                   \
+            start = tails[d];                                                                     \
+        }                                                                                         \
+    }
+
+#endif
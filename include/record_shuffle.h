@@ -0,0 +1,65 @@
+#ifndef RECORD_SHUFFLE_H
+#define RECORD_SHUFFLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// External-memory global shuffle of record files into train, validation and
+// test splits.
+//
+// Every record gets a 64-bit key hashed from the seed and its position in
+// the input. Pass one scatters the records into buckets on disk by the high
+// bits of the key, each worker buffering a bounded slice per bucket; pass two
+// loads one bucket at a time, radix sorts it by key and appends it to its
+// split.
+// Since the buckets partition the key range, the output is the input sorted
+// by key: a random permutation that depends on the seed alone, not on the
+// thread count, the memory ceiling or the bucket count.
+//
+// The split of a record is hashed from the seed and its game index, so all
+// plies of a game land in the same split.
+
+enum Record_Shuffle_Split {
+    RECORD_SHUFFLE_TRAIN,
+    RECORD_SHUFFLE_VAL,
+    RECORD_SHUFFLE_TEST,
+    RECORD_SHUFFLE_SPLITS
+};
+
+typedef struct {
+    uint64_t seed;
+    double val_fraction;        // of games
+    double test_fraction;
+    size_t memory;              // bytes for scatter buffers and loaded buckets, over all threads
+    int threads;                // 0 runs both passes on the calling thread
+    int compression_level;      // zstd level of the output blocks, 0 stores them raw
+    uint32_t block_records;     // records per output block
+    uint32_t buckets;           // per split, rounded up to a power of two; 0 sizes them from memory
+    const char *temp_dir;       // bucket files; NULL puts them in the output directory
+} Record_Shuffle_Options;
+
+typedef struct {
+    uint64_t input_records;
+    uint64_t records[RECORD_SHUFFLE_SPLITS];
+    uint32_t buckets;           // over all splits
+    uint64_t largest_bucket;    // records
+    uint64_t temp_bytes;        // written to bucket files
+    uint64_t bytes_written;     // to the split files
+    int threads;
+    double scatter_seconds;
+    double shuffle_seconds;
+    double wall_seconds;
+    char error[256];            // set when record_shuffle_run returns false
+} Record_Shuffle_Stats;
+
+extern const char *const RECORD_SHUFFLE_SPLIT_NAMES[RECORD_SHUFFLE_SPLITS];
+
+void record_shuffle_default_options(Record_Shuffle_Options *options);
+int record_shuffle_split(uint64_t game, const Record_Shuffle_Options *options);
+bool record_shuffle_run(const char *const *inputs, int input_count, const char *output_dir,
+                        const Record_Shuffle_Options *options, Record_Shuffle_Stats *stats);
+void record_shuffle_print_report(const Record_Shuffle_Stats *stats, FILE *out);
+
+#endif
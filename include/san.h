@@ -0,0 +1,23 @@
+#ifndef SAN_H
+#define SAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "position.h"
+
+enum SanStatus {
+    SAN_OK,
+    SAN_SYNTAX_ERROR,   // not a SAN move at all
+    SAN_NO_PIECE,       // no piece of the side to move can make the move
+    SAN_AMBIGUOUS       // more than one piece can legally make the move
+};
+
+// All functions below need attacks_init() to have been called once.
+enum SanStatus san_to_move(const Position *pos, const char *san, size_t len, ChessMove *move_out);
+enum SanStatus san_find_origin(const Position *pos, int piece_type, int to,
+                               Bitboard from_mask, bool capture, int *from_out);
+size_t san_from_move(const Position *pos, ChessMove move, char *san_out);
+size_t move_to_uci(ChessMove move, char *uci_out);
+const char *san_status_string(enum SanStatus status);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef SAN_CACHE_H
+#define SAN_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "position.h"
+#include "san.h"
+
+#define SAN_CACHE_DEFAULT_MEMORY (1u << 20)
+// Only positions up to this full move are looked up: past the opening,
+// positions rarely repeat across games and a probe would almost always miss
+#define SAN_CACHE_MAX_MOVE 12
+
+enum San_Cache_Lookup {
+    SAN_CACHE_BYPASS,   // not looked up: no cache, past the opening, or a token too long to key
+    SAN_CACHE_HIT,      // resolved from the cache
+    SAN_CACHE_MISS      // resolved by san_to_move and, if it resolved, stored
+};
+
+// One cached resolution. The token (suffixes stripped, at most 6 bytes) is
+// kept whole next to the Zobrist key, so a hit needs both to match exactly.
+typedef struct {
+    uint64_t position_key;
+    uint64_t token_move;    // token bytes in the high 48 bits, the ChessMove in the low 16
+} San_Cache_Entry;
+
+// Direct-mapped memo of SAN resolutions keyed on (position, token), owned by
+// one thread. A new entry simply replaces whatever shared its slot.
+typedef struct {
+    San_Cache_Entry *entries;
+    int shift;              // 64 - log2(entry count): the top hash bits pick the slot
+} San_Cache;
+
+bool san_cache_init(San_Cache *cache, size_t memory_bytes);
+enum SanStatus san_cache_resolve(San_Cache *cache, const Position *pos, const char *san, size_t len,
+                                 ChessMove *move_out, enum San_Cache_Lookup *lookup_out);
+size_t san_cache_memory(const San_Cache *cache);
+void san_cache_free(San_Cache *cache);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef SHARD_WRITER_H
+#define SHARD_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "fen_plus.h"
+#include "output_writer.h"
+
+#define SHARD_CHECKPOINT_NAME "checkpoint"
+#define SHARD_CHECKPOINT_MAGIC "chess_pipeline checkpoint 1"
+#define SHARD_PATH_MAX 4096
+
+// Where a sharded conversion stands after its last finished shard. Shards
+// end at batch boundaries, so next_game and offset always name the start of
+// a game: a resumed run converts exactly the games that were not yet in a
+// finished shard.
+typedef struct {
+    uint64_t input_size;    // of the input file, to refuse resuming another file
+    uint64_t range_end;     // end of the input range being converted, 0 = to the end
+    uint64_t next_game;     // index of the first game not in a finished shard
+    uint64_t offset;        // decoded input offset where that game starts
+    uint64_t shard;         // number of the next shard
+    uint64_t games;         // totals over the finished shards
+    uint64_t rejected;
+    uint64_t plies;
+    uint64_t duplicates;
+    uint64_t bytes_written;
+    bool complete;          // the whole input (or range) is converted
+    Text_Buffer time_controls;  // record ids so far: a length byte + name per id
+} Shard_Checkpoint;
+
+// Writes numbered output files dir/part-00000<extension>, ... one at a time.
+// A shard is written as <name>.tmp and renamed only after it is complete and
+// synced, so every part-* file without the suffix is whole.
+typedef struct {
+    char dir[SHARD_PATH_MAX - 64];
+    char extension[16];
+    uint64_t shard;         // number of the open shard, or of the next one
+    int fd;                 // -1 while no shard is open
+    Output_Writer writer;   // buffers the open shard
+    uint64_t bytes_written; // over all closed shards
+} Shard_Writer;
+
+bool shard_writer_init(Shard_Writer *shards, const char *dir, const char *extension, uint64_t first_shard);
+bool shard_writer_open(Shard_Writer *shards);
+bool shard_writer_close(Shard_Writer *shards);
+void shard_writer_free(Shard_Writer *shards);
+void shard_path(const char *dir, uint64_t shard, const char *extension, char *out, size_t out_size);
+
+bool shard_checkpoint_save(const char *dir, const Shard_Checkpoint *checkpoint);
+bool shard_checkpoint_load(const char *dir, Shard_Checkpoint *checkpoint);
+void shard_checkpoint_free(Shard_Checkpoint *checkpoint);
+
+#endif
@@ -0,0 +1,161 @@
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Header of a chunk; its usable bytes follow, ARENA_ALIGN aligned
+struct Arena_Chunk {
+    Arena_Chunk *next;
+    size_t size;
+};
+
+static char *chunk_data(Arena_Chunk *chunk) {
+    return (char *)chunk + sizeof(Arena_Chunk);
+}
+
+static void arena_use_chunk(Arena *arena, Arena_Chunk *chunk) {
+    arena->current = chunk;
+    arena->next = chunk_data(chunk);
+    arena->end = arena->next + chunk->size;
+}
+
+/**
+ * @brief Sets up an empty arena. Nothing is allocated until the first
+ *        arena_alloc.
+ *
+ * @param chunk_bytes Size of the chunks the arena grows by; larger requests
+ *        get a chunk of their own. 0 picks ARENA_DEFAULT_CHUNK_BYTES.
+ */
+bool arena_init(Arena *arena, size_t chunk_bytes) {
+    memset(arena, 0, sizeof(*arena));
+    if (chunk_bytes == 0) {
+        chunk_bytes = ARENA_DEFAULT_CHUNK_BYTES;
+    }
+    arena->chunk_bytes = (chunk_bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    return true;
+}
+
+/**
+ * @brief Moves on to the next chunk, reusing one kept from before the last
+ *        reset when it is large enough, or allocating a new one.
+ *
+ * Called by arena_alloc when the current chunk is full; size is already
+ * rounded to ARENA_ALIGN.
+ */
+void *arena_alloc_slow(Arena *arena, size_t size) {
+    if (size > SIZE_MAX / 2) {
+        return NULL;
+    }
+    Arena_Chunk *next = arena->current != NULL ? arena->current->next : arena->first;
+    if (next == NULL || next->size < size) {
+        size_t chunk_size = size > arena->chunk_bytes ? size : arena->chunk_bytes;
+        Arena_Chunk *chunk = (Arena_Chunk *)malloc(sizeof(Arena_Chunk) + chunk_size);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunk->size = chunk_size;
+        chunk->next = next;
+        if (arena->current != NULL) {
+            arena->current->next = chunk;
+        } else {
+            arena->first = chunk;
+        }
+        arena->reserved += chunk_size;
+        next = chunk;
+    }
+    arena_use_chunk(arena, next);
+    void *object = arena->next;
+    arena->next += size;
+    return object;
+}
+
+/**
+ * @brief Releases every allocation at once; the chunks stay for reuse.
+ */
+void arena_reset(Arena *arena) {
+    if (arena->first != NULL) {
+        arena_use_chunk(arena, arena->first);
+    }
+}
+
+void arena_free(Arena *arena) {
+    Arena_Chunk *chunk = arena->first;
+    while (chunk != NULL) {
+        Arena_Chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    memset(arena, 0, sizeof(*arena));
+}
+
+/**
+ * @brief Sets up a pool of objects of one size.
+ *
+ * @param objects_per_slab Objects allocated from the system at a time.
+ */
+bool pool_init(Pool *pool, size_t object_size, size_t objects_per_slab) {
+    memset(pool, 0, sizeof(*pool));
+    if (object_size == 0 || objects_per_slab == 0) {
+        return false;
+    }
+    if (object_size < sizeof(void *)) {
+        object_size = sizeof(void *);
+    }
+    pool->object_size = (object_size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    pool->objects_per_slab = objects_per_slab;
+    return true;
+}
+
+/**
+ * @brief Returns an object of pool->object_size bytes, the most recently
+ *        released one if any (it is likely still in cache).
+ *
+ * @return NULL only if a new slab cannot be allocated.
+ */
+void *pool_alloc(Pool *pool) {
+    void *object = pool->free_list;
+    if (object != NULL) {
+        pool->free_list = *(void **)object;
+    } else {
+        if (pool->slabs == NULL || pool->slab_used == pool->objects_per_slab) {
+            // The slab's link takes the first ARENA_ALIGN bytes
+            char *slab = (char *)malloc(ARENA_ALIGN + pool->object_size * pool->objects_per_slab);
+            if (slab == NULL) {
+                return NULL;
+            }
+            *(void **)slab = pool->slabs;
+            pool->slabs = slab;
+            pool->slab_used = 0;
+            pool->capacity += pool->objects_per_slab;
+        }
+        object = (char *)pool->slabs + ARENA_ALIGN + pool->slab_used++ * pool->object_size;
+    }
+    pool->live++;
+    return object;
+}
+
+/**
+ * @brief Gives an object from pool_alloc back for reuse.
+ */
+void pool_release(Pool *pool, void *object) {
+    if (object == NULL) {
+        return;
+    }
+    *(void **)object = pool->free_list;
+    pool->free_list = object;
+    pool->live--;
+}
+
+void pool_free(Pool *pool) {
+    void *slab = pool->slabs;
+    while (slab != NULL) {
+        void *next = *(void **)slab;
+        free(slab);
+        slab = next;
+    }
+    pool->slabs = NULL;
+    pool->free_list = NULL;
+    pool->slab_used = 0;
+    pool->live = 0;
+    pool->capacity = 0;
+}
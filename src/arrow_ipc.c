@@ -0,0 +1,621 @@
+#include "arrow_ipc.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zstd.h>
+#include "san.h"
+
+// Enum values from Arrow's Schema.fbs and Message.fbs
+#define ARROW_METADATA_V5 4
+#define ARROW_HEADER_SCHEMA 1
+#define ARROW_HEADER_DICTIONARY_BATCH 2
+#define ARROW_HEADER_RECORD_BATCH 3
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_UTF8 5
+#define ARROW_TYPE_FIXED_SIZE_BINARY 15
+#define ARROW_COMPRESSION_ZSTD 1
+
+enum Arrow_Column_Kind {
+    COLUMN_UINT,            // unsigned integer of width bytes
+    COLUMN_FIXED_BINARY,    // width bytes per row
+    COLUMN_DICTIONARY       // signed index of width bytes into utf8 values
+};
+
+// In schema order
+enum {
+    COLUMN_BOARD,
+    COLUMN_FLAGS,
+    COLUMN_EN_PASSANT,
+    COLUMN_HALFMOVE_CLOCK,
+    COLUMN_MOVE_NUMBER,
+    COLUMN_ELO,
+    COLUMN_UCI_MOVE,
+    COLUMN_TIME_CONTROL,
+    COLUMN_GAME,
+    COLUMN_COUNT
+};
+
+enum {
+    DICTIONARY_UCI_MOVE,
+    DICTIONARY_TIME_CONTROL,
+    DICTIONARY_COUNT
+};
+
+static const struct {
+    const char *name;
+    int kind;
+    int width;
+    int dictionary;
+} COLUMNS[COLUMN_COUNT] = {
+    {"board", COLUMN_FIXED_BINARY, 32, 0},
+    {"flags", COLUMN_UINT, 1, 0},
+    {"en_passant", COLUMN_UINT, 1, 0},
+    {"halfmove_clock", COLUMN_UINT, 2, 0},
+    {"move_number", COLUMN_UINT, 2, 0},
+    {"elo", COLUMN_UINT, 2, 0},
+    {"uci_move", COLUMN_DICTIONARY, 2, DICTIONARY_UCI_MOVE},
+    {"time_control", COLUMN_DICTIONARY, 4, DICTIONARY_TIME_CONTROL},
+    {"game", COLUMN_UINT, 4, 0},
+};
+
+// The uci_move dictionary, built once: ids in square order of the origin,
+// then the target, then the promotions
+static pthread_once_t uci_moves_once = PTHREAD_ONCE_INIT;
+static int16_t UCI_MOVE_IDS[64][64];        // -1 where no piece moves that way
+static int16_t UCI_PROMOTION_IDS[64][64];   // id of the knight promotion, then b, r, q
+static char UCI_MOVE_NAMES[ARROW_IPC_UCI_MOVES][6];
+
+static void uci_moves_init(void) {
+    memset(UCI_MOVE_IDS, 0xff, sizeof(UCI_MOVE_IDS));
+    memset(UCI_PROMOTION_IDS, 0xff, sizeof(UCI_PROMOTION_IDS));
+    int id = 0;
+    for (int from = 0; from < 64; from++) {
+        for (int to = 0; to < 64; to++) {
+            int files = abs(SQUARE_FILE(to) - SQUARE_FILE(from));
+            int ranks = abs(SQUARE_RANK(to) - SQUARE_RANK(from));
+            bool queen = (files == 0) != (ranks == 0) || (files == ranks && files > 0);
+            if (queen || files * ranks == 2) {
+                UCI_MOVE_IDS[from][to] = (int16_t)id;
+                move_to_uci(move_encode(from, to, MOVE_QUIET), UCI_MOVE_NAMES[id++]);
+            }
+        }
+    }
+    for (int color = WHITE; color <= BLACK; color++) {
+        int rank = color == WHITE ? 6 : 1;
+        int forward = color == WHITE ? 8 : -8;
+        for (int file = 0; file < 8; file++) {
+            for (int side = -1; side <= 1; side++) {
+                if (file + side < 0 || file + side > 7) {
+                    continue;
+                }
+                int from = SQUARE(file, rank);
+                int to = from + forward + side;
+                UCI_PROMOTION_IDS[from][to] = (int16_t)id;
+                for (int type = KNIGHT; type <= QUEEN; type++) {
+                    move_to_uci(move_encode(from, to, MOVE_PROMOTION + type - KNIGHT), UCI_MOVE_NAMES[id++]);
+                }
+            }
+        }
+    }
+}
+
+static inline int uci_move_id(ChessMove move) {
+    int from = move_from(move), to = move_to(move);
+    if (move_is_promotion(move)) {
+        return UCI_PROMOTION_IDS[from][to] + move_promotion_type(move) - KNIGHT;
+    }
+    return UCI_MOVE_IDS[from][to];
+}
+
+/**
+ * @brief Id of a move in the uci_move dictionary, -1 for a move no piece
+ *        can make.
+ */
+int arrow_ipc_uci_move_id(ChessMove move) {
+    pthread_once(&uci_moves_once, uci_moves_init);
+    return uci_move_id(move);
+}
+
+const char *arrow_ipc_uci_move_name(int id) {
+    pthread_once(&uci_moves_once, uci_moves_init);
+    return id >= 0 && id < ARROW_IPC_UCI_MOVES ? UCI_MOVE_NAMES[id] : NULL;
+}
+
+// Minimal flatbuffer writer. Objects are laid out front to back: a table
+// comes before the objects it refers to, and the offsets to those, which
+// must point forward, are patched in once they are written. Positions are
+// relative to the start of the flatbuffer, which sits at an 8-byte aligned
+// file offset.
+typedef struct {
+    Text_Buffer *out;
+    size_t base;
+    bool ok;
+} Flat;
+
+// A table field; size 0 leaves it at its default. Offsets are 4-byte
+// fields with value 0, patched through the position flat_table returns.
+typedef struct {
+    uint8_t size;
+    uint64_t value;
+} Flat_Field;
+
+#define FLAT_MAX_FIELDS 8
+
+static size_t flat_position(const Flat *f) {
+    return f->out->length - f->base;
+}
+
+static void flat_bytes(Flat *f, const void *data, size_t length) {
+    f->ok = f->ok && text_buffer_append(f->out, (const char *)data, length);
+}
+
+// Pads with zeros until position + phase is a multiple of align
+static void flat_align(Flat *f, size_t align, size_t phase) {
+    static const char zeros[8] = {0};
+    flat_bytes(f, zeros, (align - (flat_position(f) + phase) % align) % align);
+}
+
+static void flat_patch(Flat *f, size_t at, size_t target) {
+    if (f->ok) {
+        uint32_t offset = (uint32_t)(target - at);
+        memcpy(f->out->data + f->base + at, &offset, sizeof(offset));
+    }
+}
+
+/**
+ * @brief Writes a vtable and its table, widest fields first so each is
+ *        naturally aligned.
+ *
+ * @param field_at Receives the position of every field, for flat_patch.
+ * @return Position of the table.
+ */
+static size_t flat_table(Flat *f, const Flat_Field *fields, int count, size_t *field_at) {
+    uint16_t vtable[2 + FLAT_MAX_FIELDS] = {0};
+    uint16_t size = 4;  // the vtable offset
+    for (int width = 8; width >= 1; width /= 2) {
+        for (int i = 0; i < count; i++) {
+            if (fields[i].size == width) {
+                vtable[2 + i] = size;
+                size += (uint16_t)width;
+            }
+        }
+    }
+    vtable[0] = (uint16_t)(2 * (2 + count));
+    vtable[1] = size;
+    flat_align(f, 2, 0);
+    size_t vtable_at = flat_position(f);
+    flat_bytes(f, vtable, vtable[0]);
+    flat_align(f, 8, 4);
+    size_t table_at = flat_position(f);
+    int32_t vtable_offset = (int32_t)(table_at - vtable_at);
+    flat_bytes(f, &vtable_offset, sizeof(vtable_offset));
+    for (int width = 8; width >= 1; width /= 2) {
+        for (int i = 0; i < count; i++) {
+            if (fields[i].size == width) {
+                flat_bytes(f, &fields[i].value, (size_t)width);    // little-endian: the low bytes
+            }
+        }
+    }
+    for (int i = 0; field_at != NULL && i < count; i++) {
+        field_at[i] = table_at + vtable[2 + i];
+    }
+    return table_at;
+}
+
+// Starts a vector with its elements aligned to align; returns the position
+// of its length word, which is what offsets to it point at
+static size_t flat_vector(Flat *f, uint32_t count, size_t align) {
+    flat_align(f, align < 4 ? 4 : align, 4);
+    size_t at = flat_position(f);
+    flat_bytes(f, &count, sizeof(count));
+    return at;
+}
+
+// A vector of count offsets, zero until patched; returns the vector
+static size_t flat_offsets(Flat *f, uint32_t count) {
+    size_t at = flat_vector(f, count, 4);
+    static const uint32_t zero = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        flat_bytes(f, &zero, sizeof(zero));
+    }
+    return at;
+}
+
+static size_t flat_string(Flat *f, const char *text) {
+    size_t length = strlen(text);
+    size_t at = flat_vector(f, (uint32_t)length, 1);
+    flat_bytes(f, text, length + 1);
+    return at;
+}
+
+// Int type table, signed or not
+static size_t flat_int_type(Flat *f, int bits, bool is_signed) {
+    Flat_Field fields[2] = {{4, (uint64_t)bits}, {1, is_signed}};
+    return flat_table(f, fields, 2, NULL);
+}
+
+// Schema table with the FEN+ columns; returns its position
+static size_t flat_schema(Flat *f) {
+    // endianness left at its default, little
+    Flat_Field schema_fields[2] = {{0, 0}, {4, 0}};
+    size_t schema_at[2];
+    size_t schema = flat_table(f, schema_fields, 2, schema_at);
+    size_t columns = flat_offsets(f, COLUMN_COUNT);
+    flat_patch(f, schema_at[1], columns);
+    for (int i = 0; i < COLUMN_COUNT; i++) {
+        int kind = COLUMNS[i].kind;
+        int type = kind == COLUMN_UINT ? ARROW_TYPE_INT
+                   : kind == COLUMN_FIXED_BINARY ? ARROW_TYPE_FIXED_SIZE_BINARY
+                                                 : ARROW_TYPE_UTF8;
+        // name, nullable, type type, type, dictionary, children
+        Flat_Field fields[6] = {{4, 0}, {0, 0}, {1, (uint64_t)type}, {4, 0},
+                                {kind == COLUMN_DICTIONARY ? 4 : 0, 0}, {4, 0}};
+        size_t at[6];
+        size_t field = flat_table(f, fields, 6, at);
+        flat_patch(f, columns + 4 + 4 * (size_t)i, field);
+        flat_patch(f, at[0], flat_string(f, COLUMNS[i].name));
+        if (kind == COLUMN_UINT) {
+            flat_patch(f, at[3], flat_int_type(f, 8 * COLUMNS[i].width, false));
+        } else if (kind == COLUMN_FIXED_BINARY) {
+            Flat_Field width = {4, (uint64_t)COLUMNS[i].width};
+            flat_patch(f, at[3], flat_table(f, &width, 1, NULL));
+        } else {
+            flat_patch(f, at[3], flat_table(f, NULL, 0, NULL));
+            // id, index type, ordered
+            Flat_Field encoding[3] = {{8, (uint64_t)COLUMNS[i].dictionary}, {4, 0}, {0, 0}};
+            size_t encoding_at[3];
+            flat_patch(f, at[4], flat_table(f, encoding, 3, encoding_at));
+            flat_patch(f, encoding_at[1], flat_int_type(f, 8 * COLUMNS[i].width, true));
+        }
+        flat_patch(f, at[5], flat_vector(f, 0, 4));
+    }
+    return schema;
+}
+
+/**
+ * @brief Starts an encapsulated message in out: continuation marker, a
+ *        metadata length filled in by message_end, and the Message table.
+ *
+ * @param header_at Receives the position of the header offset to patch.
+ */
+static void message_begin(Flat *f, Text_Buffer *out, int header_type, int64_t body_length, size_t *header_at) {
+    uint32_t prefix[2] = {0xFFFFFFFFu, 0};
+    f->out = out;
+    f->ok = text_buffer_append(out, (const char *)prefix, sizeof(prefix));
+    f->base = out->length;
+    uint32_t root = 0;
+    flat_bytes(f, &root, sizeof(root));
+    // version, header type, header, body length
+    Flat_Field fields[4] = {{2, ARROW_METADATA_V5}, {1, (uint64_t)header_type}, {4, 0}, {8, (uint64_t)body_length}};
+    size_t at[4];
+    flat_patch(f, 0, flat_table(f, fields, 4, at));
+    *header_at = at[2];
+}
+
+// Pads the metadata to 8 bytes and fills in its length
+static void message_end(Flat *f) {
+    flat_align(f, 8, 0);
+    if (f->ok) {
+        int32_t length = (int32_t)flat_position(f);
+        memcpy(f->out->data + f->base - sizeof(length), &length, sizeof(length));
+    }
+}
+
+// Position and stored length of one body buffer
+typedef struct {
+    int64_t offset;
+    int64_t length;
+} Arrow_Buffer;
+
+/**
+ * @brief Appends a buffer to a message body, padded to 8 bytes.
+ *
+ * With compression on it becomes the uncompressed length followed by a zstd
+ * frame, or by the raw bytes with a length of -1 where zstd does not help,
+ * as the Arrow format lays out compressed buffers.
+ */
+static bool body_buffer(Text_Buffer *body, const void *data, size_t length, int level, void **context,
+                        Arrow_Buffer *buffer) {
+    static const char zeros[8] = {0};
+    buffer->offset = (int64_t)body->length;
+    if (level > 0 && length > 0) {
+        if (*context == NULL) {
+            *context = ZSTD_createCCtx();
+            if (*context == NULL) {
+                return false;
+            }
+        }
+        if (!text_buffer_reserve(body, sizeof(int64_t) + ZSTD_compressBound(length) + 8)) {
+            return false;
+        }
+        char *at = body->data + body->length;
+        size_t size = ZSTD_compressCCtx((ZSTD_CCtx *)*context, at + sizeof(int64_t), ZSTD_compressBound(length),
+                                        data, length, level);
+        if (ZSTD_isError(size)) {
+            return false;
+        }
+        int64_t prefix = (int64_t)length;
+        if (size >= length) {
+            prefix = -1;
+            size = length;
+            memcpy(at + sizeof(int64_t), data, length);
+        }
+        memcpy(at, &prefix, sizeof(prefix));
+        body->length += sizeof(int64_t) + size;
+    } else if (!text_buffer_append(body, (const char *)data, length)) {
+        return false;
+    }
+    buffer->length = (int64_t)body->length - buffer->offset;
+    return text_buffer_append(body, zeros, (size_t)(-body->length & 7));
+}
+
+// Writes the RecordBatch table of a batch of rows with the given buffers
+static size_t flat_record_batch(Flat *f, int64_t rows, int columns, const Arrow_Buffer *buffers, int buffer_count,
+                                bool compressed) {
+    // length, nodes, buffers, compression
+    Flat_Field fields[4] = {{8, (uint64_t)rows}, {4, 0}, {4, 0}, {compressed ? 4 : 0, 0}};
+    size_t at[4];
+    size_t batch = flat_table(f, fields, 4, at);
+    flat_patch(f, at[1], flat_vector(f, (uint32_t)columns, 8));
+    for (int i = 0; i < columns; i++) {
+        int64_t node[2] = {rows, 0};    // length, null count
+        flat_bytes(f, node, sizeof(node));
+    }
+    flat_patch(f, at[2], flat_vector(f, (uint32_t)buffer_count, 8));
+    flat_bytes(f, buffers, (size_t)buffer_count * sizeof(Arrow_Buffer));
+    if (compressed) {
+        // codec; the method is BUFFER, the default
+        Flat_Field codec = {1, ARROW_COMPRESSION_ZSTD};
+        flat_patch(f, at[3], flat_table(f, &codec, 1, NULL));
+    }
+    return batch;
+}
+
+// One column of the records, in its Arrow layout
+static void column_values(const FEN_Record *records, size_t count, int column, char *out) {
+    for (size_t i = 0; i < count; i++) {
+        const FEN_Record *r = &records[i];
+        switch (column) {
+            case COLUMN_BOARD: memcpy(out + 32 * i, r->board, 32); break;
+            case COLUMN_FLAGS: out[i] = (char)r->flags; break;
+            case COLUMN_EN_PASSANT: out[i] = (char)r->en_passant; break;
+            case COLUMN_HALFMOVE_CLOCK: memcpy(out + 2 * i, &r->halfmove_clock, 2); break;
+            case COLUMN_MOVE_NUMBER: memcpy(out + 2 * i, &r->fullmove_number, 2); break;
+            case COLUMN_ELO: memcpy(out + 2 * i, &r->elo, 2); break;
+            case COLUMN_UCI_MOVE: {
+                int16_t id = (int16_t)uci_move_id(r->move);
+                memcpy(out + 2 * i, &id, 2);
+                break;
+            }
+            case COLUMN_TIME_CONTROL: {
+                int32_t id = r->time_control;
+                memcpy(out + 4 * i, &id, 4);
+                break;
+            }
+            case COLUMN_GAME: memcpy(out + 4 * i, &r->game, 4); break;
+        }
+    }
+}
+
+/**
+ * @brief Encodes records as one record batch message, ready to be written
+ *        between arrow_ipc_write_header and arrow_ipc_write_footer.
+ *
+ * Called by the workers, each on its own batch, so that compression is
+ * spread over the threads like record blocks are.
+ *
+ * @param level zstd level for every buffer, 0 to store them raw.
+ * @param context zstd context, created on first use; free it with
+ *        fen_record_free_context.
+ * @param scratch Buffer for one uncompressed column at a time.
+ * @param out Receives the message, replacing what it held.
+ */
+bool arrow_ipc_encode_batch(const FEN_Record *records, size_t count, int level, void **context,
+                            Text_Buffer *scratch, Text_Buffer *out) {
+    pthread_once(&uci_moves_once, uci_moves_init);
+    // The body goes first, then the metadata describing it is written after
+    // it and both are swapped into place
+    Arrow_Buffer buffers[2 * COLUMN_COUNT];
+    out->length = 0;
+    for (int column = 0; column < COLUMN_COUNT; column++) {
+        size_t length = count * (size_t)COLUMNS[column].width;
+        scratch->length = 0;
+        if (!text_buffer_reserve(scratch, length)) {
+            return false;
+        }
+        column_values(records, count, column, scratch->data);
+        // No nulls, so no validity bitmap
+        buffers[2 * column] = (Arrow_Buffer){(int64_t)out->length, 0};
+        if (!body_buffer(out, scratch->data, length, level, context, &buffers[2 * column + 1])) {
+            return false;
+        }
+    }
+    size_t body_length = out->length;
+
+    Flat f;
+    size_t header_at;
+    message_begin(&f, out, ARROW_HEADER_RECORD_BATCH, (int64_t)body_length, &header_at);
+    flat_patch(&f, header_at,
+               flat_record_batch(&f, (int64_t)count, COLUMN_COUNT, buffers, 2 * COLUMN_COUNT, level > 0));
+    message_end(&f);
+    if (!f.ok) {
+        return false;
+    }
+    // Rotate the metadata in front of the body
+    size_t metadata_length = out->length - body_length;
+    if (!text_buffer_reserve(out, metadata_length)) {
+        return false;
+    }
+    memcpy(out->data + out->length, out->data + body_length, metadata_length);
+    memmove(out->data + metadata_length, out->data, body_length);
+    memcpy(out->data, out->data + out->length, metadata_length);
+    return true;
+}
+
+/**
+ * @brief Starts an Arrow file: writes the magic and the schema message and
+ *        resets index.
+ */
+bool arrow_ipc_write_header(Output_Writer *writer, Arrow_IPC_Index *index) {
+    memset(index, 0, sizeof(*index));
+    Text_Buffer header = {0};
+    bool ok = text_buffer_append(&header, ARROW_IPC_MAGIC "\0\0", 8);
+    Flat f;
+    size_t header_at;
+    message_begin(&f, &header, ARROW_HEADER_SCHEMA, 0, &header_at);
+    flat_patch(&f, header_at, flat_schema(&f));
+    message_end(&f);
+    ok = ok && f.ok && output_writer_write(writer, header.data, header.length);
+    index->offset = header.length;
+    text_buffer_free(&header);
+    return ok;
+}
+
+/**
+ * @brief Records a record batch message of length bytes, as made by
+ *        arrow_ipc_encode_batch, written at index->offset.
+ */
+bool arrow_ipc_add_batch(Arrow_IPC_Index *index, const char *message, size_t length, size_t rows) {
+    if (index->count == index->capacity) {
+        size_t capacity = index->capacity ? index->capacity * 2 : 256;
+        Arrow_IPC_Block *batches = (Arrow_IPC_Block *)realloc(index->batches, capacity * sizeof(Arrow_IPC_Block));
+        if (batches == NULL) {
+            return false;
+        }
+        index->batches = batches;
+        index->capacity = capacity;
+    }
+    int32_t flatbuffer_length;
+    memcpy(&flatbuffer_length, message + 4, sizeof(flatbuffer_length));
+    Arrow_IPC_Block *block = &index->batches[index->count++];
+    block->offset = index->offset;
+    block->metadata_length = 8 + flatbuffer_length;
+    block->body_length = (int64_t)length - block->metadata_length;
+    index->offset += length;
+    index->rows += rows;
+    return true;
+}
+
+/**
+ * @brief Appends a dictionary batch message of utf8 values to out.
+ *
+ * @param names count values: if length_prefixed, each a length byte and
+ *        the text, otherwise null-terminated text in slots of stride bytes.
+ */
+static bool dictionary_message(int id, const char *names, size_t count, bool length_prefixed, size_t stride,
+                               Text_Buffer *out, Arrow_IPC_Block *block) {
+    Text_Buffer body = {0};
+    size_t offsets_length = (count + 1) * sizeof(int32_t);
+    bool ok = text_buffer_reserve(&body, offsets_length + 8);
+    int32_t text_length = 0;
+    const char *at = names;
+    for (size_t i = 0; ok && i <= count; i++) {
+        memcpy(body.data + body.length, &text_length, sizeof(text_length));
+        body.length += sizeof(text_length);
+        if (i < count) {
+            text_length += (int32_t)(length_prefixed ? (uint8_t)at[0] : strlen(at));
+            at += length_prefixed ? (size_t)1 + (uint8_t)at[0] : stride;
+        }
+    }
+    static const char zeros[8] = {0};
+    ok = ok && text_buffer_append(&body, zeros, (size_t)(-body.length & 7));
+    size_t text_offset = body.length;
+    at = names;
+    for (size_t i = 0; ok && i < count; i++) {
+        size_t length = length_prefixed ? (uint8_t)at[0] : strlen(at);
+        ok = text_buffer_append(&body, length_prefixed ? at + 1 : at, length);
+        at += length_prefixed ? 1 + length : stride;
+    }
+    size_t text_end = body.length;
+    ok = ok && text_buffer_append(&body, zeros, (size_t)(-body.length & 7));
+
+    size_t start = out->length;
+    Flat f;
+    size_t header_at;
+    message_begin(&f, out, ARROW_HEADER_DICTIONARY_BATCH, (int64_t)body.length, &header_at);
+    // id, data, delta
+    Flat_Field fields[3] = {{8, (uint64_t)id}, {4, 0}, {0, 0}};
+    size_t dictionary_at[3];
+    flat_patch(&f, header_at, flat_table(&f, fields, 3, dictionary_at));
+    Arrow_Buffer buffers[3] = {
+        {0, 0},     // no nulls
+        {0, (int64_t)offsets_length},
+        {(int64_t)text_offset, (int64_t)(text_end - text_offset)},
+    };
+    flat_patch(&f, dictionary_at[1], flat_record_batch(&f, (int64_t)count, 1, buffers, 3, false));
+    message_end(&f);
+    block->metadata_length = (int32_t)(out->length - start);
+    block->body_length = (int64_t)body.length;
+    ok = ok && f.ok && text_buffer_append(out, body.data, body.length);
+    text_buffer_free(&body);
+    return ok;
+}
+
+// Vector of footer blocks, 24-byte structs with 4 bytes of padding
+static size_t flat_blocks(Flat *f, const Arrow_IPC_Block *blocks, size_t count) {
+    size_t at = flat_vector(f, (uint32_t)count, 8);
+    for (size_t i = 0; i < count; i++) {
+        int32_t padding = 0;
+        flat_bytes(f, &blocks[i].offset, 8);
+        flat_bytes(f, &blocks[i].metadata_length, 4);
+        flat_bytes(f, &padding, 4);
+        flat_bytes(f, &blocks[i].body_length, 8);
+    }
+    return at;
+}
+
+/**
+ * @brief Ends an Arrow file with the two dictionaries, the end-of-stream
+ *        marker and the footer that indexes every batch.
+ *
+ * The time_control dictionary holds the entries of time_controls in id
+ * order, plus "other" at FEN_RECORD_TIME_CONTROL_OTHER once the table is
+ * full, so every id in the file has a value.
+ */
+bool arrow_ipc_write_footer(Output_Writer *writer, Arrow_IPC_Index *index,
+                            const FEN_Record_Time_Controls *time_controls) {
+    pthread_once(&uci_moves_once, uci_moves_init);
+    Text_Buffer tail = {0};
+    Arrow_IPC_Block dictionaries[DICTIONARY_COUNT];
+    bool ok = dictionary_message(DICTIONARY_UCI_MOVE, UCI_MOVE_NAMES[0], ARROW_IPC_UCI_MOVES, false,
+                                 sizeof(UCI_MOVE_NAMES[0]), &tail, &dictionaries[DICTIONARY_UCI_MOVE]);
+    dictionaries[DICTIONARY_UCI_MOVE].offset = index->offset;
+
+    Text_Buffer names = {0};
+    ok = ok && text_buffer_append(&names, time_controls->names.data, time_controls->names.length);
+    size_t count = time_controls->count;
+    if (count >= FEN_RECORD_MAX_TIME_CONTROLS) {
+        ok = ok && text_buffer_append(&names, "\005other", 6);
+        count++;
+    }
+    dictionaries[DICTIONARY_TIME_CONTROL].offset = index->offset + tail.length;
+    ok = ok && dictionary_message(DICTIONARY_TIME_CONTROL, names.data != NULL ? names.data : "", count, true, 0,
+                                  &tail, &dictionaries[DICTIONARY_TIME_CONTROL]);
+    text_buffer_free(&names);
+    static const uint32_t end_of_stream[2] = {0xFFFFFFFFu, 0};
+    ok = ok && text_buffer_append(&tail, (const char *)end_of_stream, sizeof(end_of_stream));
+
+    Flat f = {&tail, tail.length, ok};
+    uint32_t root = 0;
+    flat_bytes(&f, &root, sizeof(root));
+    // version, schema, dictionaries, record batches
+    Flat_Field fields[4] = {{2, ARROW_METADATA_V5}, {4, 0}, {4, 0}, {4, 0}};
+    size_t at[4];
+    flat_patch(&f, 0, flat_table(&f, fields, 4, at));
+    flat_patch(&f, at[1], flat_schema(&f));
+    flat_patch(&f, at[2], flat_blocks(&f, dictionaries, DICTIONARY_COUNT));
+    flat_patch(&f, at[3], flat_blocks(&f, index->batches, index->count));
+    int32_t footer_length = (int32_t)flat_position(&f);
+    flat_bytes(&f, &footer_length, sizeof(footer_length));
+    flat_bytes(&f, ARROW_IPC_MAGIC, 6);
+    ok = f.ok && output_writer_write(writer, tail.data, tail.length);
+    index->offset += tail.length;
+    text_buffer_free(&tail);
+    return ok;
+}
+
+void arrow_ipc_index_free(Arrow_IPC_Index *index) {
+    free(index->batches);
+    memset(index, 0, sizeof(*index));
+}
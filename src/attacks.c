@@ -0,0 +1,229 @@
+#include "attacks.h"
+
+Bitboard KNIGHT_ATTACKS[64];
+Bitboard KING_ATTACKS[64];
+Bitboard PAWN_ATTACKS[2][64];
+Magic BISHOP_MAGICS[64];
+Magic ROOK_MAGICS[64];
+Bitboard BETWEEN_BB[64][64];
+Bitboard LINE_BB[64][64];
+
+// Sum over all squares of 2^(relevant occupancy bits)
+static Bitboard bishop_table[5248];
+static Bitboard rook_table[102400];
+static bool attacks_ready = false;
+
+static const int ROOK_DIRECTIONS[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+static const int BISHOP_DIRECTIONS[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+// Offsets as (file, rank) pairs; jumps leaving the board are dropped
+static Bitboard jump_attacks(int square, const int offsets[8][2]) {
+    Bitboard attacks = 0;
+    int file = SQUARE_FILE(square);
+    int rank = SQUARE_RANK(square);
+    for (int i = 0; i < 8; i++) {
+        int f = file + offsets[i][0];
+        int r = rank + offsets[i][1];
+        if (f >= 0 && f < 8 && r >= 0 && r < 8) {
+            attacks |= square_bit(SQUARE(f, r));
+        }
+    }
+    return attacks;
+}
+
+// Slow ray walk, used only to fill the magic tables
+static Bitboard slider_attacks(int square, Bitboard occupied, const int directions[4][2]) {
+    Bitboard attacks = 0;
+    for (int d = 0; d < 4; d++) {
+        int f = SQUARE_FILE(square) + directions[d][0];
+        int r = SQUARE_RANK(square) + directions[d][1];
+        while (f >= 0 && f < 8 && r >= 0 && r < 8) {
+            Bitboard bit = square_bit(SQUARE(f, r));
+            attacks |= bit;
+            if (occupied & bit) {
+                break;
+            }
+            f += directions[d][0];
+            r += directions[d][1];
+        }
+    }
+    return attacks;
+}
+
+// Squares whose occupancy matters for a slider: the rays without the last
+// square before the edge, since nothing lies behind it.
+static Bitboard slider_mask(int square, const int directions[4][2]) {
+    Bitboard mask = 0;
+    for (int d = 0; d < 4; d++) {
+        int f = SQUARE_FILE(square) + directions[d][0];
+        int r = SQUARE_RANK(square) + directions[d][1];
+        while (f + directions[d][0] >= 0 && f + directions[d][0] < 8 &&
+               r + directions[d][1] >= 0 && r + directions[d][1] < 8) {
+            mask |= square_bit(SQUARE(f, r));
+            f += directions[d][0];
+            r += directions[d][1];
+        }
+    }
+    return mask;
+}
+
+// xorshift64*, fixed seed so the magics (and table layout) are reproducible
+static uint64_t magic_rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t magic_random(void) {
+    magic_rng_state ^= magic_rng_state >> 12;
+    magic_rng_state ^= magic_rng_state << 25;
+    magic_rng_state ^= magic_rng_state >> 27;
+    return magic_rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief Finds a magic multiplier for one square and fills its attack table.
+ *
+ * Enumerates every subset of the relevant occupancy mask, then tries sparse
+ * random numbers until one maps all subsets to table slots without a
+ * destructive collision.
+ *
+ * @return Number of table entries used, 1 << (bits in mask).
+ */
+static size_t init_magic(Magic *magic, int square, Bitboard *table, const int directions[4][2]) {
+    static Bitboard occupancies[4096];
+    static Bitboard references[4096];
+    static unsigned epoch[4096];
+    static unsigned attempt = 0;
+
+    magic->attacks = table;
+    magic->mask = slider_mask(square, directions);
+    int bits = bitboard_count(magic->mask);
+    magic->shift = 64 - bits;
+    size_t size = (size_t)1 << bits;
+
+    // Carry-rippler trick enumerates all subsets of the mask
+    Bitboard subset = 0;
+    for (size_t i = 0; i < size; i++) {
+        occupancies[i] = subset;
+        references[i] = slider_attacks(square, subset, directions);
+        subset = (subset - magic->mask) & magic->mask;
+    }
+
+    for (;;) {
+        magic->magic = magic_random() & magic_random() & magic_random();
+        if (bitboard_count((magic->mask * magic->magic) >> 56) < 6) {
+            continue;
+        }
+        attempt++;
+        size_t i;
+        for (i = 0; i < size; i++) {
+            size_t index = (size_t)((occupancies[i] * magic->magic) >> magic->shift);
+            if (epoch[index] < attempt) {
+                epoch[index] = attempt;
+                table[index] = references[i];
+            } else if (table[index] != references[i]) {
+                break;
+            }
+        }
+        if (i == size) {
+            return size;
+        }
+    }
+}
+
+void attacks_init(void) {
+    if (attacks_ready) {
+        return;
+    }
+    static const int knight_offsets[8][2] = {
+        {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+    static const int king_offsets[8][2] = {
+        {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+
+    Bitboard *bishop_next = bishop_table;
+    Bitboard *rook_next = rook_table;
+    for (int square = 0; square < 64; square++) {
+        KNIGHT_ATTACKS[square] = jump_attacks(square, knight_offsets);
+        KING_ATTACKS[square] = jump_attacks(square, king_offsets);
+        Bitboard bit = square_bit(square);
+        PAWN_ATTACKS[WHITE][square] = ((bit << 7) & ~FILE_H_BB) | ((bit << 9) & ~FILE_A_BB);
+        PAWN_ATTACKS[BLACK][square] = ((bit >> 9) & ~FILE_H_BB) | ((bit >> 7) & ~FILE_A_BB);
+        bishop_next += init_magic(&BISHOP_MAGICS[square], square, bishop_next, BISHOP_DIRECTIONS);
+        rook_next += init_magic(&ROOK_MAGICS[square], square, rook_next, ROOK_DIRECTIONS);
+    }
+    for (int a = 0; a < 64; a++) {
+        for (int b = 0; b < 64; b++) {
+            Bitboard ends = square_bit(a) | square_bit(b);
+            if (a != b && (rook_attacks(a, 0) & square_bit(b))) {
+                LINE_BB[a][b] = (rook_attacks(a, 0) & rook_attacks(b, 0)) | ends;
+                BETWEEN_BB[a][b] = rook_attacks(a, square_bit(b)) & rook_attacks(b, square_bit(a));
+            } else if (a != b && (bishop_attacks(a, 0) & square_bit(b))) {
+                LINE_BB[a][b] = (bishop_attacks(a, 0) & bishop_attacks(b, 0)) | ends;
+                BETWEEN_BB[a][b] = bishop_attacks(a, square_bit(b)) & bishop_attacks(b, square_bit(a));
+            }
+        }
+    }
+    attacks_ready = true;
+}
+
+Bitboard piece_attacks(int piece_type, int square, Bitboard occupied) {
+    switch (piece_type) {
+        case KNIGHT: return KNIGHT_ATTACKS[square];
+        case BISHOP: return bishop_attacks(square, occupied);
+        case ROOK: return rook_attacks(square, occupied);
+        case QUEEN: return queen_attacks(square, occupied);
+        case KING: return KING_ATTACKS[square];
+        default: return 0;
+    }
+}
+
+/**
+ * @brief Returns every piece, of either color, attacking a square.
+ *
+ * @param occupied Occupancy used to block sliders; pass a modified mask to
+ *                 ask "what if" questions about a move.
+ */
+Bitboard attackers_to(const Position *pos, int square, Bitboard occupied) {
+    const Bitboard *p = pos->pieces;
+    return (PAWN_ATTACKS[BLACK][square] & p[WHITE_PAWN]) |
+           (PAWN_ATTACKS[WHITE][square] & p[BLACK_PAWN]) |
+           (KNIGHT_ATTACKS[square] & (p[WHITE_KNIGHT] | p[BLACK_KNIGHT])) |
+           (KING_ATTACKS[square] & (p[WHITE_KING] | p[BLACK_KING])) |
+           (bishop_attacks(square, occupied) &
+            (p[WHITE_BISHOP] | p[BLACK_BISHOP] | p[WHITE_QUEEN] | p[BLACK_QUEEN])) |
+           (rook_attacks(square, occupied) &
+            (p[WHITE_ROOK] | p[BLACK_ROOK] | p[WHITE_QUEEN] | p[BLACK_QUEEN]));
+}
+
+bool position_square_attacked(const Position *pos, int square, int by_color) {
+    return (attackers_to(pos, square, position_occupied(pos)) & pos->occupancy[by_color]) != 0;
+}
+
+bool position_in_check(const Position *pos) {
+    int us = pos->side_to_move;
+    int king = bitboard_lsb(pos->pieces[MAKE_PIECE(us, KING)]);
+    return position_square_attacked(pos, king, us ^ 1);
+}
+
+/**
+ * @brief Tells whether a pseudo-legal move keeps the mover's king out of check.
+ *
+ * Works on occupancy masks only, without copying the position: the moved
+ * piece leaves from, lands on to, and any captured piece stops attacking.
+ */
+bool position_leaves_king_safe(const Position *pos, ChessMove move) {
+    int us = pos->side_to_move;
+    int them = us ^ 1;
+    int to = move_to(move);
+    Bitboard from_bit = square_bit(move_from(move));
+    Bitboard to_bit = square_bit(to);
+    Bitboard occupied = (position_occupied(pos) ^ from_bit) | to_bit;
+    Bitboard removed = to_bit;
+
+    if (move_flags(move) == MOVE_EN_PASSANT) {
+        Bitboard victim = square_bit(to ^ 8);
+        occupied ^= victim;
+        removed |= victim;
+    }
+
+    Bitboard king_bit = pos->pieces[MAKE_PIECE(us, KING)];
+    int king = (king_bit & from_bit) ? to : bitboard_lsb(king_bit);
+    return (attackers_to(pos, king, occupied) & pos->occupancy[them] & ~removed) == 0;
+}
@@ -0,0 +1,376 @@
+#include "corpus_gen.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "attacks.h"
+#include "movegen.h"
+#include "san.h"
+
+// Game lengths in plies, as weights per range. Shaped after Lichess rated
+// games: few very short games, a broad peak around 60-90 plies and a tail
+// past 150.
+static const struct {
+    int min_plies;
+    int max_plies;
+    int weight;
+} GAME_LENGTHS[] = {
+    {2, 9, 2},     {10, 19, 3},   {20, 29, 4},   {30, 39, 6},   {40, 49, 8},
+    {50, 59, 10},  {60, 69, 11},  {70, 79, 11},  {80, 89, 10},  {90, 99, 9},
+    {100, 119, 12}, {120, 149, 9}, {150, 199, 4}, {200, 299, 1},
+};
+
+// Time controls with their share of rated games, in percent
+static const struct {
+    const char *speed;
+    const char *time_control;
+    int base;           // seconds
+    int increment;
+    int weight;
+} TIME_CONTROLS[] = {
+    {"UltraBullet", "15+0", 15, 0, 1},   {"Bullet", "60+0", 60, 0, 19},    {"Bullet", "120+1", 120, 1, 8},
+    {"Blitz", "180+0", 180, 0, 20},      {"Blitz", "180+2", 180, 2, 10},   {"Blitz", "300+0", 300, 0, 10},
+    {"Blitz", "300+3", 300, 3, 6},       {"Rapid", "600+0", 600, 0, 12},   {"Rapid", "600+5", 600, 5, 5},
+    {"Rapid", "900+10", 900, 10, 4},     {"Classical", "1800+0", 1800, 0, 3},
+    {"Classical", "1800+20", 1800, 20, 2},
+};
+
+// Tag values only: the moves are random and do not follow the opening
+static const struct {
+    const char *eco;
+    const char *name;
+} OPENINGS[] = {
+    {"A00", "Van't Kruijs Opening"}, {"A40", "Queen's Pawn Game"},     {"B00", "Owen Defense"},
+    {"B01", "Scandinavian Defense: Mieses-Kotroc Variation"},           {"B10", "Caro-Kann Defense"},
+    {"B20", "Sicilian Defense"},     {"C00", "French Defense: Knight Variation"},
+    {"C20", "King's Pawn Game"},     {"C41", "Philidor Defense"},      {"C44", "Scotch Game"},
+    {"C50", "Italian Game"},         {"D00", "Queen's Pawn Game: Accelerated London System"},
+};
+
+static const char *const NAME_PARTS[] = {
+    "chess", "Knight", "pawn", "Rook", "blitz", "Dragon", "zug", "Gambit", "fork", "Pin", "tempo", "Fianchetto",
+    "endgame", "Castle", "queen", "Tactic",
+};
+
+static const char BASE62[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+// splitmix64: small state, and any seed gives a good sequence
+typedef struct {
+    uint64_t state;
+} Corpus_Rng;
+
+static uint64_t rng_next(Corpus_Rng *rng) {
+    uint64_t z = (rng->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, n)
+static uint32_t rng_below(Corpus_Rng *rng, uint32_t n) {
+    return (uint32_t)(((rng_next(rng) >> 32) * n) >> 32);
+}
+
+// Roughly normal around mean, by summing twelve uniforms
+static int rng_normal(Corpus_Rng *rng, int mean, int deviation) {
+    int sum = 0;
+    for (int i = 0; i < 12; i++) {
+        sum += (int)rng_below(rng, 1000);
+    }
+    return mean + (sum - 6000) * deviation / 1000;
+}
+
+static size_t append_int(char *out, long value) {
+    char digits[24];
+    size_t n = 0;
+    size_t length = 0;
+    unsigned long magnitude = value < 0 ? 0ul - (unsigned long)value : (unsigned long)value;
+    if (value < 0) {
+        out[length++] = '-';
+    }
+    do {
+        digits[n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    while (n > 0) {
+        out[length++] = digits[--n];
+    }
+    return length;
+}
+
+// H:MM:SS, as in Lichess [%clk] comments
+static size_t append_clock(char *out, int seconds) {
+    size_t length = append_int(out, seconds / 3600);
+    out[length++] = ':';
+    out[length++] = (char)('0' + seconds / 600 % 6);
+    out[length++] = (char)('0' + seconds / 60 % 10);
+    out[length++] = ':';
+    out[length++] = (char)('0' + seconds % 60 / 10);
+    out[length++] = (char)('0' + seconds % 10);
+    return length;
+}
+
+// Centipawns as pawns with two decimals, e.g. -1.35
+static size_t append_eval(char *out, int centipawns) {
+    size_t length = 0;
+    if (centipawns < 0) {
+        out[length++] = '-';
+        centipawns = -centipawns;
+    }
+    length += append_int(out + length, centipawns / 100);
+    out[length++] = '.';
+    out[length++] = (char)('0' + centipawns / 10 % 10);
+    out[length++] = (char)('0' + centipawns % 10);
+    return length;
+}
+
+// Tag values are short and bounded, so a game's header fits in HEADER_MAX
+#define HEADER_MAX 1024
+
+static void append_tag(char *header, size_t *length, const char *name, const char *value) {
+    *length += (size_t)snprintf(header + *length, HEADER_MAX - *length, "[%s \"%s\"]\n", name, value);
+}
+
+static const char *result_string(int winner) {
+    return winner == WHITE ? "1-0" : winner == BLACK ? "0-1" : "1/2-1/2";
+}
+
+void corpus_generator_init(Corpus_Generator *generator, uint64_t seed, uint64_t first_game) {
+    attacks_init();
+    generator->seed = seed;
+    generator->next_game = first_game;
+    generator->plies = 0;
+}
+
+// Picks a move uniformly, but a capture a quarter of the time when there is
+// one, so that material comes off the board at a plausible pace
+static ChessMove pick_move(Corpus_Rng *rng, const Move_List *list) {
+    if (rng_below(rng, 4) == 0) {
+        int captures = 0;
+        for (int i = 0; i < list->count; i++) {
+            captures += move_is_capture(list->moves[i]);
+        }
+        if (captures > 0) {
+            int pick = (int)rng_below(rng, (uint32_t)captures);
+            for (int i = 0; i < list->count; i++) {
+                if (move_is_capture(list->moves[i]) && pick-- == 0) {
+                    return list->moves[i];
+                }
+            }
+        }
+    }
+    return list->moves[rng_below(rng, (uint32_t)list->count)];
+}
+
+/**
+ * @brief Appends the movetext of one game and decides its result.
+ *
+ * Plays random legal moves up to target_plies. The game ends earlier on
+ * mate or stalemate, or when a player's clock runs out.
+ *
+ * @return false if out of memory.
+ */
+static bool append_movetext(Corpus_Rng *rng, int target_plies, int base, int increment, bool evals,
+                            Text_Buffer *out, int *winner_out, bool *time_forfeit_out, uint64_t *plies_out) {
+    Position pos;
+    position_set_start(&pos);
+    int clocks[2] = {base, base};
+    int eval = 20;
+    // Lichess thinks in whole seconds here; bullet moves often take none
+    int max_think = 2 * base / 45 + increment + 1;
+    int winner = -1;
+    bool time_forfeit = false;
+    int ply = 0;
+    char text[256];
+    for (; ply < target_plies; ply++) {
+        Move_List list;
+        if (generate_legal_moves(&pos, &list) == 0) {
+            // Mate or stalemate; a mating move was written with '#'
+            winner = position_in_check(&pos) ? (pos.side_to_move ^ 1) : 2;
+            break;
+        }
+        int us = pos.side_to_move;
+        int think = (int)rng_below(rng, (uint32_t)max_think);
+        if (think > clocks[us]) {
+            winner = us ^ 1;
+            time_forfeit = true;
+            break;
+        }
+        clocks[us] += increment - think;
+
+        ChessMove move = pick_move(rng, &list);
+        // Every move follows a comment, so Black's moves carry the number too
+        size_t length = append_int(text, pos.fullmove_number);
+        memcpy(text + length, us == WHITE ? ". " : "... ", us == WHITE ? 2 : 4);
+        length += us == WHITE ? 2 : 4;
+        length += san_from_move(&pos, move, text + length);
+        Position after = pos;
+        position_make_move(&after, move);
+        Move_List replies;
+        if (position_in_check(&after) && generate_legal_moves(&after, &replies) == 0) {
+            text[length - 1] = '#';
+        }
+
+        int previous_eval = eval;
+        if (evals) {
+            eval += (int)rng_below(rng, 61) - 30;
+            if (rng_below(rng, 25) == 0) {
+                eval += (us == WHITE ? -1 : 1) * (int)(60 + rng_below(rng, 300));
+            }
+        }
+        int loss = us == WHITE ? previous_eval - eval : eval - previous_eval;
+        const char *judgement = NULL;
+        if (evals && loss >= 50) {
+            judgement = loss >= 300 ? "Blunder" : loss >= 100 ? "Mistake" : "Inaccuracy";
+            const char *glyph = loss >= 300 ? "??" : loss >= 100 ? "?" : "?!";
+            memcpy(text + length, glyph, strlen(glyph));
+            length += strlen(glyph);
+        }
+        text[length++] = ' ';
+
+        if (judgement != NULL) {
+            // Lichess names the better move in an analysis comment
+            ChessMove best = list.moves[rng_below(rng, (uint32_t)list.count)];
+            char best_san[16];
+            size_t best_len = san_from_move(&pos, best, best_san);
+            memcpy(text + length, "{ (", 3);
+            length += 3;
+            length += append_eval(text + length, previous_eval);
+            memcpy(text + length, " \xE2\x86\x92 ", 5);
+            length += 5;
+            length += append_eval(text + length, eval);
+            length += (size_t)snprintf(text + length, sizeof(text) - length, ") %s. %.*s was best. } ", judgement,
+                                       (int)best_len, best_san);
+        }
+        memcpy(text + length, "{ ", 2);
+        length += 2;
+        if (evals) {
+            memcpy(text + length, "[%eval ", 7);
+            length += 7;
+            length += append_eval(text + length, eval);
+            memcpy(text + length, "] ", 2);
+            length += 2;
+        }
+        memcpy(text + length, "[%clk ", 6);
+        length += 6;
+        length += append_clock(text + length, clocks[us]);
+        memcpy(text + length, "] } ", 4);
+        length += 4;
+        if (!text_buffer_append(out, text, length)) {
+            return false;
+        }
+        pos = after;
+    }
+    if (winner < 0) {
+        // Resignation or agreed draw
+        uint32_t roll = rng_below(rng, 100);
+        winner = roll < 50 ? WHITE : roll < 95 ? BLACK : 2;
+    }
+    *winner_out = winner;
+    *time_forfeit_out = time_forfeit;
+    *plies_out = (uint64_t)ply;
+    const char *result = result_string(winner);
+    return text_buffer_append(out, result, strlen(result)) && text_buffer_append(out, "\n\n", 2);
+}
+
+/**
+ * @brief Appends game generator->next_game, headers and movetext, to out.
+ *
+ * The header is written after the movetext, since the result and the
+ * termination depend on it, and moved in front of it.
+ *
+ * @return false if out of memory.
+ */
+bool corpus_generate_game(Corpus_Generator *generator, Text_Buffer *out) {
+    Corpus_Rng rng = {generator->seed ^ (generator->next_game * 0xD1B54A32D192ED03ULL)};
+    rng_next(&rng);
+
+    int pick = (int)rng_below(&rng, 100);
+    size_t control = 0;
+    while (pick >= TIME_CONTROLS[control].weight) {
+        pick -= TIME_CONTROLS[control].weight;
+        control++;
+    }
+    pick = (int)rng_below(&rng, 100);
+    size_t range = 0;
+    while (pick >= GAME_LENGTHS[range].weight) {
+        pick -= GAME_LENGTHS[range].weight;
+        range++;
+    }
+    int target_plies = GAME_LENGTHS[range].min_plies +
+                       (int)rng_below(&rng, (uint32_t)(GAME_LENGTHS[range].max_plies - GAME_LENGTHS[range].min_plies + 1));
+    bool evals = rng_below(&rng, 100) < CORPUS_EVAL_PERCENT;
+
+    int white_elo = rng_normal(&rng, 1550, 330);
+    white_elo = white_elo < 600 ? 600 : white_elo > 3100 ? 3100 : white_elo;
+    int black_elo = rng_normal(&rng, white_elo, 110);
+    black_elo = black_elo < 600 ? 600 : black_elo > 3100 ? 3100 : black_elo;
+    char site[40] = "https://lichess.org/";
+    for (int i = 0; i < 8; i++) {
+        site[20 + i] = BASE62[rng_below(&rng, 62)];
+    }
+    site[28] = '\0';
+    char names[2][40];
+    for (int side = 0; side < 2; side++) {
+        snprintf(names[side], sizeof(names[side]), "%s%s%u", NAME_PARTS[rng_below(&rng, 16)],
+                 NAME_PARTS[rng_below(&rng, 16)], rng_below(&rng, 1000));
+    }
+    int day = 1 + (int)rng_below(&rng, 31);
+    int seconds = (int)rng_below(&rng, 86400);
+    size_t opening = rng_below(&rng, sizeof(OPENINGS) / sizeof(OPENINGS[0]));
+
+    size_t game_start = out->length;
+    int winner;
+    bool time_forfeit;
+    uint64_t plies;
+    if (!append_movetext(&rng, target_plies, TIME_CONTROLS[control].base, TIME_CONTROLS[control].increment,
+                         evals, out, &winner, &time_forfeit, &plies)) {
+        out->length = game_start;
+        return false;
+    }
+    size_t movetext_len = out->length - game_start;
+
+    char header[HEADER_MAX];
+    size_t length = 0;
+    char value[64];
+    snprintf(value, sizeof(value), "Rated %s game", TIME_CONTROLS[control].speed);
+    append_tag(header, &length, "Event", value);
+    append_tag(header, &length, "Site", site);
+    snprintf(value, sizeof(value), "2024.01.%02d", day);
+    append_tag(header, &length, "Date", value);
+    append_tag(header, &length, "Round", "-");
+    append_tag(header, &length, "White", names[WHITE]);
+    append_tag(header, &length, "Black", names[BLACK]);
+    append_tag(header, &length, "Result", result_string(winner));
+    append_tag(header, &length, "UTCDate", value);
+    snprintf(value, sizeof(value), "%02d:%02d:%02d", seconds / 3600, seconds / 60 % 60, seconds % 60);
+    append_tag(header, &length, "UTCTime", value);
+    snprintf(value, sizeof(value), "%d", white_elo);
+    append_tag(header, &length, "WhiteElo", value);
+    snprintf(value, sizeof(value), "%d", black_elo);
+    append_tag(header, &length, "BlackElo", value);
+    int change = 3 + (int)rng_below(&rng, 10);
+    for (int side = 0; side < 2; side++) {
+        // A draw moves the lower-rated player up a point
+        int diff = winner == 2 ? ((side == WHITE) == (white_elo < black_elo) ? 1 : -1)
+                   : winner == side ? change : -change;
+        snprintf(value, sizeof(value), "%+d", diff);
+        append_tag(header, &length, side == WHITE ? "WhiteRatingDiff" : "BlackRatingDiff", value);
+    }
+    append_tag(header, &length, "ECO", OPENINGS[opening].eco);
+    append_tag(header, &length, "Opening", OPENINGS[opening].name);
+    append_tag(header, &length, "TimeControl", TIME_CONTROLS[control].time_control);
+    append_tag(header, &length, "Termination", time_forfeit ? "Time forfeit" : "Normal");
+    header[length++] = '\n';
+    if (!text_buffer_reserve(out, length)) {
+        out->length = game_start;
+        return false;
+    }
+    char *game = out->data + game_start;
+    memmove(game + length, game, movetext_len);
+    memcpy(game, header, length);
+    out->length += length;
+
+    generator->next_game++;
+    generator->plies += plies;
+    return true;
+}
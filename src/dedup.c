@@ -0,0 +1,98 @@
+#include "dedup.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define COUNT_BITS 28
+#define COUNT_MASK ((1ULL << COUNT_BITS) - 1)
+
+/**
+ * @brief Allocates a table of the largest power-of-two slot count that fits
+ *        in memory_bytes.
+ *
+ * @param max_count Occurrences of each pair to keep, at least 1.
+ * @param keep_every Beyond max_count, keep one in keep_every occurrences
+ *        (0 drops all of them).
+ * @return false if memory_bytes holds no slots or allocation fails.
+ */
+bool dedup_table_init(Dedup_Table *table, size_t memory_bytes, uint32_t max_count, uint32_t keep_every) {
+    memset(table, 0, sizeof(*table));
+    size_t slots = 1;
+    while (slots * 2 * sizeof(uint64_t) <= memory_bytes) {
+        slots *= 2;
+    }
+    if (slots * sizeof(uint64_t) > memory_bytes || max_count == 0) {
+        return false;
+    }
+    table->slots = (uint64_t *)calloc(slots, sizeof(uint64_t));
+    if (table->slots == NULL) {
+        return false;
+    }
+    table->mask = slots - 1;
+    table->max_count = max_count;
+    table->keep_every = keep_every;
+    return true;
+}
+
+/**
+ * @brief Counts one occurrence of key and decides whether to keep it.
+ *
+ * Safe to call from many threads at once. The n-th occurrence of a pair is
+ * kept if n <= max_count, or if keep_every > 0 and (n - max_count) is a
+ * multiple of keep_every. Which thread's occurrence is the n-th depends on
+ * scheduling, but how many of each pair are kept does not.
+ */
+enum Dedup_Result dedup_check(Dedup_Table *table, uint64_t key) {
+    uint64_t tag = key & ~COUNT_MASK;
+    if (tag == 0) {
+        tag = 1ULL << COUNT_BITS;   // an all-zero word marks an empty slot
+    }
+    // Zobrist keys are uniform, so the low bits index and the high bits tag
+    size_t slot = (size_t)key & table->mask;
+    for (int probe = 0; probe < DEDUP_MAX_PROBES; probe++) {
+        uint64_t *word = &table->slots[(slot + (size_t)probe) & table->mask];
+        uint64_t current = __atomic_load_n(word, __ATOMIC_RELAXED);
+        for (;;) {
+            uint64_t next;
+            if (current == 0) {
+                next = tag | 1;
+            } else if ((current & ~COUNT_MASK) == tag) {
+                uint64_t count = current & COUNT_MASK;
+                next = count == COUNT_MASK ? current : current + 1;
+            } else {
+                break;      // another pair's slot, probe on
+            }
+            if (__atomic_compare_exchange_n(word, &current, next, true, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                uint64_t seen = next & COUNT_MASK;
+                if (seen <= table->max_count) {
+                    return DEDUP_KEEP;
+                }
+                if (table->keep_every > 0 && (seen - table->max_count) % table->keep_every == 0) {
+                    return DEDUP_KEEP;
+                }
+                return DEDUP_DROP;
+            }
+            // current now holds the word another thread just stored; retry
+        }
+    }
+    return DEDUP_UNTRACKED;
+}
+
+size_t dedup_table_memory(const Dedup_Table *table) {
+    return table->slots ? (table->mask + 1) * sizeof(uint64_t) : 0;
+}
+
+// Distinct pairs tracked; scans the table, so call it once at the end
+size_t dedup_table_used(const Dedup_Table *table) {
+    size_t used = 0;
+    for (size_t i = 0; table->slots != NULL && i <= table->mask; i++) {
+        used += table->slots[i] != 0;
+    }
+    return used;
+}
+
+void dedup_table_free(Dedup_Table *table) {
+    free(table->slots);
+    memset(table, 0, sizeof(*table));
+}
@@ -0,0 +1,286 @@
+#include "fen_plus.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "format.h"
+#include "movegen.h"
+#include "pgn_scan.h"
+#include "pgn_tokenizer.h"
+#include "position.h"
+#include "san.h"
+
+bool text_buffer_reserve(Text_Buffer *buffer, size_t extra) {
+    if (buffer->length + extra <= buffer->capacity) {
+        return true;
+    }
+    size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+    while (capacity < buffer->length + extra) {
+        capacity *= 2;
+    }
+    char *data = (char *)realloc(buffer->data, capacity);
+    if (data == NULL) {
+        return false;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return true;
+}
+
+bool text_buffer_append(Text_Buffer *buffer, const char *data, size_t length) {
+    if (!text_buffer_reserve(buffer, length)) {
+        return false;
+    }
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    return true;
+}
+
+void text_buffer_free(Text_Buffer *buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
+
+/**
+ * @brief Finds the value of a tag in a PGN header block.
+ *
+ * @param header Header text, "[Tag \"value\"]" lines.
+ * @param tag Tag name, e.g. "WhiteElo".
+ * @param value_out Receives a pointer to the value inside header (no quotes).
+ * @return true if the tag is present.
+ */
+bool pgn_header_value(const char *header, size_t header_len, const char *tag,
+                      const char **value_out, size_t *value_len_out) {
+    size_t tag_len = strlen(tag);
+    const char *p = header;
+    const char *end = header + header_len;
+    while (p < end) {
+        const char *line_end = memchr(p, '\n', (size_t)(end - p));
+        if (line_end == NULL) {
+            line_end = end;
+        }
+        if (p[0] == '[' && (size_t)(line_end - p) > tag_len + 3 &&
+            memcmp(p + 1, tag, tag_len) == 0 && p[tag_len + 1] == ' ' && p[tag_len + 2] == '"') {
+            const char *value = p + tag_len + 3;
+            const char *close = memchr(value, '"', (size_t)(line_end - value));
+            if (close == NULL) {
+                return false;
+            }
+            *value_out = value;
+            *value_len_out = (size_t)(close - value);
+            return true;
+        }
+        p = line_end + 1;
+    }
+    return false;
+}
+
+static int parse_elo(const PGN_Tag *tag) {
+    int elo = 0;
+    for (size_t i = 0; i < tag->length && tag->value[i] >= '0' && tag->value[i] <= '9'; i++) {
+        elo = elo * 10 + (tag->value[i] - '0');
+    }
+    return elo;
+}
+
+/**
+ * @brief Formats one FEN+ row: time_format,move_number,fen,elo,uci_move.
+ *
+ * Encodes straight into out with a moving cursor: the FEN comes from
+ * position_write_fen and numbers from format_uint, no printf involved.
+ *
+ * @param out Room for FEN_PLUS_MAX_ROW bytes.
+ * @param pos Position before the move; also gives the move number.
+ * @return Number of bytes written, including the trailing newline.
+ */
+size_t fen_plus_write_row(char *out, const char *time_control, size_t time_control_len,
+                          const Position *pos, int elo, ChessMove move) {
+    char *p = out;
+    memcpy(p, time_control, time_control_len);
+    p += time_control_len;
+    *p++ = ',';
+    p = format_uint(p, pos->fullmove_number);
+    *p++ = ',';
+    p += position_write_fen(pos, p);
+    *p++ = ',';
+    p = format_uint(p, (uint32_t)elo);
+    *p++ = ',';
+    p += move_to_uci(move, p);
+    *p++ = '\n';
+    return (size_t)(p - out);
+}
+
+/**
+ * @brief Reads the header fields the rows need and sets up the first position.
+ *
+ * @param pos Receives the start position, or the [FEN] tag's position.
+ * @return false if the game has a [FEN] tag that does not parse.
+ */
+bool fen_plus_start_game(const PGN_Game *game, FEN_Plus_Game *info, Position *pos) {
+    PGN_Header_Tags tags;
+    pgn_scan_headers(game->header, game->header_len, &tags);
+    info->time_control = "-";
+    info->time_control_len = 1;
+    if (tags.time_control.value != NULL) {
+        info->time_control = tags.time_control.value;
+        info->time_control_len = tags.time_control.length > 32 ? 32 : tags.time_control.length;
+    }
+    info->elo[WHITE] = parse_elo(&tags.white_elo);
+    info->elo[BLACK] = parse_elo(&tags.black_elo);
+
+    if (tags.fen.value == NULL) {
+        position_set_start(pos);
+        return true;
+    }
+    char fen[128];
+    if (tags.fen.length >= sizeof(fen)) {
+        return false;
+    }
+    memcpy(fen, tags.fen.value, tags.fen.length);
+    fen[tags.fen.length] = '\0';
+    return position_from_fen(fen, pos);
+}
+
+/**
+ * @brief Asks the dedup table whether the row for (pos, move) is wanted.
+ *
+ * @param dedup NULL keeps every row.
+ */
+bool fen_plus_dedup_keep(Dedup_Table *dedup, const Position *pos, ChessMove move, FEN_Plus_Stats *stats) {
+    if (dedup == NULL) {
+        return true;
+    }
+    switch (dedup_check(dedup, dedup_pair_key(pos->key, move))) {
+        case DEDUP_DROP:
+            stats->duplicates++;
+            return false;
+        case DEDUP_UNTRACKED:
+            stats->untracked++;
+            return true;
+        default:
+            return true;
+    }
+}
+
+/**
+ * @brief Tells whether a resolved SAN move may really be played.
+ *
+ * The resolver only finds the piece that reaches the target square; it does
+ * not look at checks, castling through attacked squares, or whether an 'x'
+ * has anything to capture. Those games are corrupt and must not give rows.
+ */
+bool fen_plus_move_is_legal(const Position *pos, const char *san, size_t len, ChessMove move) {
+    bool marked_capture = memchr(san, 'x', len) != NULL || memchr(san, ':', len) != NULL;
+    return (!marked_capture || move_is_capture(move)) && position_is_legal_move(pos, move);
+}
+
+/**
+ * @brief Reads a game's header and sets up its first position.
+ *
+ * @return false if the game has a [FEN] tag that does not parse; it is then
+ *         counted as rejected.
+ */
+bool fen_plus_replay_start(FEN_Plus_Replay *replay, const PGN_Game *game, FEN_Plus_Stats *stats) {
+    replay->game = game;
+    replay->ply = 0;
+    if (!fen_plus_start_game(game, &replay->info, &replay->pos)) {
+        stats->rejected++;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Resolves a game's moves one by one and hands each ply the dedup
+ *        table keeps to emit, the only step the output formats differ in.
+ *
+ * @param dedup Optional table that drops frequent (position, move) pairs;
+ *        NULL passes every ply. Pairs of a game that is later rejected
+ *        stay counted in the table, but not in stats.
+ * @return FEN_PLUS_REPLAY_OK with the game and its emitted plies counted;
+ *         FEN_PLUS_REPLAY_REJECTED, counted, if a move did not resolve, was
+ *         illegal (fen_plus_move_is_legal) or emit refused the game; FEN_PLUS_REPLAY_FAILED if emit failed.
+ *         Either way the caller undoes what emit wrote.
+ */
+enum FEN_Plus_Replay_Status fen_plus_replay_moves(FEN_Plus_Replay *replay, Dedup_Table *dedup,
+                                                  FEN_Plus_Stats *stats, FEN_Plus_Emit emit, void *context) {
+    uint64_t plies = 0;
+    uint64_t duplicates = stats->duplicates;
+    uint64_t untracked = stats->untracked;
+    PERF_SAMPLE_BEGIN(sample, stats->perf, replay->game->index);
+    PGN_Tokenizer tokenizer;
+    pgn_tokenizer_init(&tokenizer, replay->game->movetext, replay->game->movetext_len);
+    const char *token;
+    size_t token_len;
+    while (pgn_tokenizer_next(&tokenizer, &token, &token_len)) {
+        ChessMove move;
+        enum San_Cache_Lookup lookup;
+        enum FEN_Plus_Replay_Status status = FEN_PLUS_REPLAY_REJECTED;
+        if (san_cache_resolve(stats->san_cache, &replay->pos, token, token_len, &move, &lookup) == SAN_OK &&
+            fen_plus_move_is_legal(&replay->pos, token, token_len, move)) {
+            stats->san_cache_hits += lookup == SAN_CACHE_HIT;
+            stats->san_cache_misses += lookup == SAN_CACHE_MISS;
+            PERF_SAMPLE_SAN(sample, lookup);
+            status = FEN_PLUS_REPLAY_OK;
+            if (fen_plus_dedup_keep(dedup, &replay->pos, move, stats)) {
+                status = emit(context, replay, move);
+                plies++;
+                PERF_SAMPLE_MARK(sample, PERF_FORMAT);
+            }
+        }
+        if (status != FEN_PLUS_REPLAY_OK) {
+            if (status == FEN_PLUS_REPLAY_REJECTED) {
+                stats->duplicates = duplicates;
+                stats->untracked = untracked;
+                stats->rejected++;
+            }
+            return status;
+        }
+        position_make_move(&replay->pos, move);
+        replay->ply++;
+    }
+
+    stats->games++;
+    stats->plies += plies;
+    return FEN_PLUS_REPLAY_OK;
+}
+
+static enum FEN_Plus_Replay_Status emit_row(void *context, const FEN_Plus_Replay *replay, ChessMove move) {
+    Text_Buffer *out = (Text_Buffer *)context;
+    if (!text_buffer_reserve(out, FEN_PLUS_MAX_ROW)) {
+        return FEN_PLUS_REPLAY_FAILED;
+    }
+    const FEN_Plus_Game *info = &replay->info;
+    out->length += fen_plus_write_row(out->data + out->length, info->time_control, info->time_control_len,
+                                      &replay->pos, info->elo[replay->pos.side_to_move], move);
+    return FEN_PLUS_REPLAY_OK;
+}
+
+/**
+ * @brief Appends one FEN+ CSV row per move of a game to out.
+ *
+ * Rows are time_format,move_number,fen,elo,uci_move with the FEN of the
+ * position before the move and the Elo of the player making it. Games that
+ * start from a [FEN] tag are replayed from that position. If any move fails
+ * to resolve or is illegal, the game's rows are removed again and it
+ * counts as rejected.
+ *
+ * @param dedup Optional table that drops frequent (position, move) pairs;
+ *        NULL writes every ply.
+ * @return false only if out runs out of memory; games whose moves do not
+ *         resolve are counted as rejected and leave out unchanged.
+ */
+bool fen_plus_append_game(const PGN_Game *game, Dedup_Table *dedup, Text_Buffer *out,
+                          FEN_Plus_Stats *stats) {
+    FEN_Plus_Replay replay;
+    if (!fen_plus_replay_start(&replay, game, stats)) {
+        return true;
+    }
+    size_t game_start = out->length;
+    enum FEN_Plus_Replay_Status status = fen_plus_replay_moves(&replay, dedup, stats, emit_row, out);
+    if (status != FEN_PLUS_REPLAY_OK) {
+        out->length = game_start;
+    }
+    return status != FEN_PLUS_REPLAY_FAILED;
+}
@@ -0,0 +1,515 @@
+#define _POSIX_C_SOURCE 200809L
+#include "fen_record.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+
+typedef char fen_record_is_48_bytes[sizeof(FEN_Record) == 48 ? 1 : -1];
+typedef char file_header_is_32_bytes[sizeof(FEN_Record_File_Header) == FEN_RECORD_DATA_OFFSET ? 1 : -1];
+
+/**
+ * @brief Packs a position, the move played from it and the game's header
+ *        facts into a record.
+ */
+void fen_record_from_position(const Position *pos, ChessMove move, int elo, uint16_t time_control,
+                              uint64_t game, FEN_Record *record) {
+    memset(record->board, 0, sizeof(record->board));
+    for (int piece = 0; piece < NO_PIECE; piece++) {
+        Bitboard pieces = pos->pieces[piece];
+        while (pieces) {
+            int square = bitboard_pop_lsb(&pieces);
+            record->board[square >> 1] |= (uint8_t)((piece + 1) << ((square & 1) * 4));
+        }
+    }
+    record->flags = (uint8_t)(pos->side_to_move | (pos->castling << 4));
+    record->en_passant = pos->en_passant;
+    record->halfmove_clock = pos->halfmove_clock;
+    record->fullmove_number = pos->fullmove_number;
+    record->move = move;
+    record->elo = (uint16_t)(elo > 0xFFFF ? 0xFFFF : elo);
+    record->time_control = time_control;
+    record->game = (uint32_t)game;
+}
+
+/**
+ * @brief Rebuilds the Position a record was made from.
+ *
+ * @return false if the record holds an invalid piece code or square.
+ */
+bool fen_record_to_position(const FEN_Record *record, Position *pos) {
+    position_clear(pos);
+    for (int square = 0; square < 64; square++) {
+        int code = (record->board[square >> 1] >> ((square & 1) * 4)) & 15;
+        if (code == 0) {
+            continue;
+        }
+        if (code > NO_PIECE) {
+            return false;
+        }
+        Bitboard bit = square_bit(square);
+        pos->pieces[code - 1] |= bit;
+        pos->occupancy[PIECE_COLOR(code - 1)] |= bit;
+    }
+    if (record->en_passant > NO_SQUARE) {
+        return false;
+    }
+    pos->side_to_move = record->flags & 1;
+    pos->castling = record->flags >> 4;
+    pos->en_passant = record->en_passant;
+    pos->halfmove_clock = record->halfmove_clock;
+    pos->fullmove_number = record->fullmove_number;
+    pos->key = position_compute_key(pos);
+    return true;
+}
+
+typedef struct {
+    Text_Buffer *out;
+    uint16_t time_control;
+} FEN_Record_Rows;
+
+static enum FEN_Plus_Replay_Status emit_record(void *context, const FEN_Plus_Replay *replay, ChessMove move) {
+    FEN_Record_Rows *rows = (FEN_Record_Rows *)context;
+    if (!text_buffer_reserve(rows->out, sizeof(FEN_Record))) {
+        return FEN_PLUS_REPLAY_FAILED;
+    }
+    FEN_Record record;
+    fen_record_from_position(&replay->pos, move, replay->info.elo[replay->pos.side_to_move], rows->time_control,
+                             replay->game->index, &record);
+    memcpy(rows->out->data + rows->out->length, &record, sizeof(record));
+    rows->out->length += sizeof(record);
+    return FEN_PLUS_REPLAY_OK;
+}
+
+/**
+ * @brief Appends one record per ply of a game, the binary twin of
+ *        fen_plus_append_game.
+ *
+ * @param time_control Id of the game's time control in the file's table.
+ * @param dedup Optional table that drops frequent (position, move) pairs.
+ * @return false only if out runs out of memory; games whose moves do not
+ *         resolve are counted as rejected and leave out unchanged.
+ */
+bool fen_record_append_game(const PGN_Game *game, uint16_t time_control, Dedup_Table *dedup,
+                            Text_Buffer *out, FEN_Plus_Stats *stats) {
+    FEN_Plus_Replay replay;
+    if (!fen_plus_replay_start(&replay, game, stats)) {
+        return true;
+    }
+    size_t game_start = out->length;
+    FEN_Record_Rows rows = {out, time_control};
+    enum FEN_Plus_Replay_Status status = fen_plus_replay_moves(&replay, dedup, stats, emit_record, &rows);
+    if (status != FEN_PLUS_REPLAY_OK) {
+        out->length = game_start;
+    }
+    return status != FEN_PLUS_REPLAY_FAILED;
+}
+
+static uint32_t hash_name(const char *name, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool grow_slots(FEN_Record_Time_Controls *table) {
+    size_t slot_count = table->slot_count ? table->slot_count * 2 : 256;
+    uint16_t *slots = (uint16_t *)calloc(slot_count, sizeof(uint16_t));
+    uint32_t *offsets = (uint32_t *)realloc(table->offsets, slot_count / 2 * sizeof(uint32_t));
+    if (slots == NULL || offsets == NULL) {
+        free(slots);
+        if (offsets != NULL) {
+            table->offsets = offsets;
+        }
+        return false;
+    }
+    table->offsets = offsets;
+    for (size_t id = 0; id < table->count; id++) {
+        const char *entry = table->names.data + offsets[id];
+        size_t slot = hash_name(entry + 1, (uint8_t)entry[0]) & (slot_count - 1);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        slots[slot] = (uint16_t)(id + 1);
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slot_count = slot_count;
+    return true;
+}
+
+/**
+ * @brief Returns the id of a time control, adding it to the table if new.
+ *
+ * Ids are handed out in first-seen order. Names are clipped to 255 bytes.
+ *
+ * @return The id, or FEN_RECORD_TIME_CONTROL_OTHER once the table is full or
+ *         cannot grow.
+ */
+uint16_t fen_record_time_control_id(FEN_Record_Time_Controls *table, const char *name, size_t length) {
+    if (length > 255) {
+        length = 255;
+    }
+    uint32_t hash = hash_name(name, length);
+    if (table->slot_count > 0) {
+        size_t slot = hash & (table->slot_count - 1);
+        while (table->slots[slot] != 0) {
+            const char *entry = table->names.data + table->offsets[table->slots[slot] - 1];
+            if ((uint8_t)entry[0] == length && memcmp(entry + 1, name, length) == 0) {
+                return (uint16_t)(table->slots[slot] - 1);
+            }
+            slot = (slot + 1) & (table->slot_count - 1);
+        }
+    }
+    if (table->count >= FEN_RECORD_MAX_TIME_CONTROLS) {
+        return FEN_RECORD_TIME_CONTROL_OTHER;
+    }
+    if (2 * (table->count + 1) > table->slot_count && !grow_slots(table)) {
+        return FEN_RECORD_TIME_CONTROL_OTHER;
+    }
+    size_t offset = table->names.length;
+    char length_byte = (char)length;
+    if (!text_buffer_append(&table->names, &length_byte, 1) ||
+        !text_buffer_append(&table->names, name, length)) {
+        table->names.length = offset;
+        return FEN_RECORD_TIME_CONTROL_OTHER;
+    }
+    uint16_t id = (uint16_t)table->count++;
+    table->offsets[id] = (uint32_t)offset;
+    size_t slot = hash & (table->slot_count - 1);
+    while (table->slots[slot] != 0) {
+        slot = (slot + 1) & (table->slot_count - 1);
+    }
+    table->slots[slot] = (uint16_t)(id + 1);
+    return id;
+}
+
+const char *fen_record_time_control_name(const FEN_Record_Time_Controls *table, uint16_t id,
+                                         size_t *length_out) {
+    if (id >= table->count) {
+        return NULL;
+    }
+    const char *entry = table->names.data + table->offsets[id];
+    *length_out = (uint8_t)entry[0];
+    return entry + 1;
+}
+
+void fen_record_time_controls_free(FEN_Record_Time_Controls *table) {
+    text_buffer_free(&table->names);
+    free(table->offsets);
+    free(table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+/**
+ * @brief Compresses a block of records into one zstd frame, replacing out.
+ *
+ * @param context Compression context reused across calls, created on first
+ *        use; release it with fen_record_free_context.
+ */
+bool fen_record_compress_block(const char *records, size_t length, int level, void **context,
+                               Text_Buffer *out) {
+    if (*context == NULL) {
+        *context = ZSTD_createCCtx();
+        if (*context == NULL) {
+            return false;
+        }
+    }
+    out->length = 0;
+    if (!text_buffer_reserve(out, ZSTD_compressBound(length))) {
+        return false;
+    }
+    size_t size = ZSTD_compressCCtx((ZSTD_CCtx *)*context, out->data, out->capacity, records, length, level);
+    if (ZSTD_isError(size)) {
+        return false;
+    }
+    out->length = size;
+    return true;
+}
+
+void fen_record_free_context(void *context) {
+    ZSTD_freeCCtx((ZSTD_CCtx *)context);
+}
+
+/**
+ * @brief Starts a record file: writes the header and resets index.
+ *
+ * @param level zstd level for the blocks, 0 for raw blocks.
+ */
+bool fen_record_write_header(Output_Writer *writer, int level, FEN_Record_Index *index) {
+    memset(index, 0, sizeof(*index));
+    FEN_Record_File_Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FEN_RECORD_MAGIC, sizeof(header.magic));
+    header.version = FEN_RECORD_VERSION;
+    header.record_size = sizeof(FEN_Record);
+    header.compression = level > 0 ? FEN_RECORD_COMPRESSION_ZSTD : FEN_RECORD_COMPRESSION_NONE;
+    index->offset = sizeof(header);
+    return output_writer_write(writer, (const char *)&header, sizeof(header));
+}
+
+/**
+ * @brief Records a block of stored_size bytes, written at index->offset.
+ */
+bool fen_record_add_block(FEN_Record_Index *index, size_t stored_size, size_t records) {
+    if (index->count == index->capacity) {
+        size_t capacity = index->capacity ? index->capacity * 2 : 256;
+        FEN_Record_Block_Entry *entries =
+            (FEN_Record_Block_Entry *)realloc(index->entries, capacity * sizeof(FEN_Record_Block_Entry));
+        if (entries == NULL) {
+            return false;
+        }
+        index->entries = entries;
+        index->capacity = capacity;
+    }
+    FEN_Record_Block_Entry *entry = &index->entries[index->count++];
+    entry->offset = index->offset;
+    entry->stored_size = (uint32_t)stored_size;
+    entry->records = (uint32_t)records;
+    index->offset += stored_size;
+    index->records += records;
+    return true;
+}
+
+/**
+ * @brief Pads the output to the next 8-byte boundary, so that the footer
+ *        sections after it are aligned.
+ *
+ * @param offset File offset reached so far; advanced past the padding.
+ */
+bool fen_record_write_padding(Output_Writer *writer, uint64_t *offset) {
+    static const char zeros[8] = {0};
+    size_t padding = (size_t)(-*offset & 7);
+    *offset += padding;
+    return output_writer_write(writer, zeros, padding);
+}
+
+/**
+ * @brief Ends a record file with the block index, the time-control table and
+ *        the trailer. Sections start on 8-byte boundaries.
+ */
+bool fen_record_write_footer(Output_Writer *writer, const FEN_Record_Index *index,
+                             const FEN_Record_Time_Controls *time_controls) {
+    FEN_Record_Trailer trailer;
+    memset(&trailer, 0, sizeof(trailer));
+    uint64_t offset = index->offset;
+    bool ok = fen_record_write_padding(writer, &offset);
+    trailer.index_offset = offset;
+    size_t index_bytes = index->count * sizeof(FEN_Record_Block_Entry);
+    ok = ok && output_writer_write(writer, (const char *)index->entries, index_bytes);
+    offset += index_bytes;
+    trailer.time_control_offset = offset;
+    ok = ok && output_writer_write(writer, time_controls->names.data, time_controls->names.length);
+    offset += time_controls->names.length;
+    ok = ok && fen_record_write_padding(writer, &offset);
+    trailer.records = index->records;
+    trailer.blocks = (uint32_t)index->count;
+    trailer.time_controls = (uint32_t)time_controls->count;
+    memcpy(trailer.magic, FEN_RECORD_TRAILER_MAGIC, sizeof(trailer.magic));
+    return ok && output_writer_write(writer, (const char *)&trailer, sizeof(trailer));
+}
+
+void fen_record_index_free(FEN_Record_Index *index) {
+    free(index->entries);
+    memset(index, 0, sizeof(*index));
+}
+
+struct FEN_Record_File {
+    const uint8_t *map;
+    size_t size;
+    FEN_Record_File_Header header;
+    FEN_Record_Trailer trailer;
+    const FEN_Record_Block_Entry *entries;
+    const char **time_controls;
+    ZSTD_DCtx *dctx;
+};
+
+/**
+ * @brief Copies out the header and trailer of a mapped file and checks the
+ *        magic that starts the one and ends the other.
+ *
+ * Record and game files share this frame; each checks its own fields after.
+ */
+bool fen_record_read_frame(const uint8_t *map, size_t size, void *header, size_t header_size,
+                           const char *magic, void *trailer, size_t trailer_size, const char *trailer_magic) {
+    if (size < header_size + trailer_size) {
+        return false;
+    }
+    memcpy(header, map, header_size);
+    memcpy(trailer, map + size - trailer_size, trailer_size);
+    return memcmp(header, magic, 8) == 0 && memcmp((const char *)trailer + trailer_size - 8, trailer_magic, 8) == 0;
+}
+
+/**
+ * @brief Indexes the time-control table of a mapped file: count entries of
+ *        a length byte and the text, starting at table and ending by end.
+ *
+ * @return count + 1 pointers to the length bytes (the last one NULL), for
+ *         the caller to free; NULL if memory runs out or an entry runs
+ *         past end.
+ */
+const char **fen_record_read_time_controls(const char *table, const char *end, uint32_t count) {
+    const char **entries = (const char **)calloc((size_t)count + 1, sizeof(char *));
+    if (entries == NULL) {
+        return NULL;
+    }
+    const char *p = table;
+    for (uint32_t i = 0; i < count; i++) {
+        if (p >= end || (uint8_t)p[0] >= end - p) {
+            free(entries);
+            return NULL;
+        }
+        entries[i] = p;
+        p += 1 + (uint8_t)p[0];
+    }
+    return entries;
+}
+
+// Checks that the header, trailer and every index entry describe the file
+static bool validate(FEN_Record_File *file) {
+    const FEN_Record_File_Header *header = &file->header;
+    const FEN_Record_Trailer *trailer = &file->trailer;
+    if (!fen_record_read_frame(file->map, file->size, &file->header, sizeof(file->header), FEN_RECORD_MAGIC,
+                               &file->trailer, sizeof(file->trailer), FEN_RECORD_TRAILER_MAGIC) ||
+        header->version != FEN_RECORD_VERSION || header->record_size != sizeof(FEN_Record) ||
+        header->compression > FEN_RECORD_COMPRESSION_ZSTD) {
+        return false;
+    }
+    uint64_t footer_end = file->size - sizeof(*trailer);
+    if (trailer->index_offset % 8 != 0 || trailer->index_offset < sizeof(*header) ||
+        trailer->index_offset > footer_end ||
+        (footer_end - trailer->index_offset) / sizeof(FEN_Record_Block_Entry) < trailer->blocks ||
+        trailer->time_control_offset != trailer->index_offset +
+                                            (uint64_t)trailer->blocks * sizeof(FEN_Record_Block_Entry)) {
+        return false;
+    }
+    file->entries = (const FEN_Record_Block_Entry *)(file->map + trailer->index_offset);
+
+    uint64_t offset = sizeof(*header);
+    uint64_t records = 0;
+    for (uint32_t i = 0; i < trailer->blocks; i++) {
+        const FEN_Record_Block_Entry *entry = &file->entries[i];
+        if (entry->offset != offset || entry->stored_size > trailer->index_offset - offset ||
+            (header->compression == FEN_RECORD_COMPRESSION_NONE &&
+             entry->stored_size != (uint64_t)entry->records * sizeof(FEN_Record))) {
+            return false;
+        }
+        offset += entry->stored_size;
+        records += entry->records;
+    }
+    if (records != trailer->records || trailer->index_offset - offset >= 8) {
+        return false;
+    }
+    file->time_controls = fen_record_read_time_controls((const char *)file->map + trailer->time_control_offset,
+                                                        (const char *)file->map + footer_end,
+                                                        trailer->time_controls);
+    return file->time_controls != NULL;
+}
+
+/**
+ * @brief Opens a record file written by the pipeline.
+ *
+ * The file is mapped, so opening costs no reads beyond the footer.
+ *
+ * @return NULL if the file cannot be read or is not a valid record file.
+ */
+FEN_Record_File *fen_record_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    FEN_Record_File *file = (FEN_Record_File *)calloc(1, sizeof(FEN_Record_File));
+    if (file == NULL || fstat(fd, &st) != 0 || st.st_size == 0) {
+        free(file);
+        close(fd);
+        return NULL;
+    }
+    file->size = (size_t)st.st_size;
+    void *map = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        free(file);
+        return NULL;
+    }
+    file->map = (const uint8_t *)map;
+    if (!validate(file)) {
+        fen_record_close(file);
+        return NULL;
+    }
+    return file;
+}
+
+uint64_t fen_record_count(const FEN_Record_File *file) {
+    return file->trailer.records;
+}
+
+size_t fen_record_block_count(const FEN_Record_File *file) {
+    return file->trailer.blocks;
+}
+
+size_t fen_record_block_records(const FEN_Record_File *file, size_t block) {
+    return block < file->trailer.blocks ? file->entries[block].records : 0;
+}
+
+/**
+ * @brief Copies (raw files) or decompresses (zstd files) one block.
+ *
+ * @param out Room for fen_record_block_records(file, block) records.
+ * @return Records read; 0 if the block is out of range or corrupt.
+ */
+size_t fen_record_read_block(FEN_Record_File *file, size_t block, FEN_Record *out) {
+    if (block >= file->trailer.blocks) {
+        return 0;
+    }
+    const FEN_Record_Block_Entry *entry = &file->entries[block];
+    size_t expected = (size_t)entry->records * sizeof(FEN_Record);
+    const uint8_t *stored = file->map + entry->offset;
+    if (file->header.compression == FEN_RECORD_COMPRESSION_NONE) {
+        memcpy(out, stored, expected);
+        return entry->records;
+    }
+    if (file->dctx == NULL && (file->dctx = ZSTD_createDCtx()) == NULL) {
+        return 0;
+    }
+    size_t size = ZSTD_decompressDCtx(file->dctx, out, expected, stored, entry->stored_size);
+    if (ZSTD_isError(size) || size != expected) {
+        return 0;
+    }
+    return entry->records;
+}
+
+/**
+ * @brief All records of a raw file as one array, straight from the mapping.
+ *
+ * @return NULL for compressed files; use fen_record_read_block instead.
+ */
+const FEN_Record *fen_record_mapped(const FEN_Record_File *file) {
+    if (file->header.compression != FEN_RECORD_COMPRESSION_NONE) {
+        return NULL;
+    }
+    return (const FEN_Record *)(file->map + sizeof(FEN_Record_File_Header));
+}
+
+const char *fen_record_file_time_control(const FEN_Record_File *file, uint16_t id, size_t *length_out) {
+    if (id >= file->trailer.time_controls) {
+        return NULL;
+    }
+    *length_out = (uint8_t)file->time_controls[id][0];
+    return file->time_controls[id] + 1;
+}
+
+void fen_record_close(FEN_Record_File *file) {
+    if (file == NULL) {
+        return;
+    }
+    munmap((void *)file->map, file->size);
+    free(file->time_controls);
+    ZSTD_freeDCtx(file->dctx);
+    free(file);
+}
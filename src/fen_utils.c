@@ -1,5 +1,9 @@
 
+#define _POSIX_C_SOURCE 200809L
 #include "fen_utils.h"
+#include "attacks.h"
+#include "pgn_tokenizer.h"
+#include "san.h"
 
 
 char *get_termination_string(enum Termination termination) {
@@ -10,6 +14,10 @@ char *get_termination_string(enum Termination termination) {
             return "Time forfeit";
         case ABANDONED:
             return "Abandoned";
+        case RULES_INFRACTION:
+            return "Rules infraction";
+        case UNTERMINATED:
+            return "Unterminated";
         default:
             return "Unknown";
     }
@@ -28,46 +36,306 @@ char *get_game_result_string(enum GameResult game_result) {
     }
 }
 
+/**
+ * @brief Parses a [Termination] tag value, e.g. "Time forfeit".
+ *
+ * @param text Tag value, not NUL-terminated.
+ * @return false if the value is not one of the enum's strings.
+ */
+bool get_termination_from_string(const char *text, size_t length, enum Termination *out) {
+    for (int t = NORMAL; t <= UNTERMINATED; t++) {
+        const char *name = get_termination_string((enum Termination)t);
+        if (strlen(name) == length && memcmp(name, text, length) == 0) {
+            *out = (enum Termination)t;
+            return true;
+        }
+    }
+    return false;
+}
 
-Move *get_move_from_uci(char *uci_move) {
-    Move *move = (Move *)malloc(sizeof(Move));
-    if (!move) return NULL;
+/**
+ * @brief Parses a [Result] tag value: "1-0", "0-1", "1/2-1/2" or "*".
+ */
+bool get_game_result_from_string(const char *text, size_t length, enum GameResult *out) {
+    for (int r = WHITE_WINS; r <= ONGOING; r++) {
+        const char *name = get_game_result_string((enum GameResult)r);
+        if (strlen(name) == length && memcmp(name, text, length) == 0) {
+            *out = (enum GameResult)r;
+            return true;
+        }
+    }
+    return false;
+}
 
-    move->type = "uci";
-    size_t len = strlen(uci_move);
-    if (len != 4 && len != 5) {
-        printf("Invalid UCI move: %s\n", uci_move);
-        free(move);
-        return NULL;
+
+// Objects come from the arena when one is given, from malloc otherwise
+static void *object_alloc(Arena *arena, size_t size) {
+    return arena != NULL ? arena_alloc(arena, size) : malloc(size);
+}
+
+// Fields of Move.bits, as laid out in fen_utils.h
+#define MOVE_ORIGIN_SHIFT 6
+#define MOVE_PROMOTION_SHIFT 12
+#define MOVE_BIT_CAPTURE (1u << 15)
+#define MOVE_BIT_KING_CASTLE (1u << 16)
+#define MOVE_BIT_QUEEN_CASTLE (1u << 17)
+#define MOVE_BIT_EN_PASSANT (1u << 18)
+#define MOVE_PIECE_SHIFT 19
+#define MOVE_BIT_FILE_GIVEN (1u << 22)
+#define MOVE_BIT_RANK_GIVEN (1u << 23)
+#define MOVE_SUFFIX_SHIFT 24
+#define MOVE_BIT_UCI (1u << 28)
+#define MOVE_BIT_SAN (1u << 29)
+
+static const char MOVE_PIECE_CHARS[] = "PNBRQK";
+static const char MOVE_PROMOTION_CHARS[] = "nbrq";
+
+static int move_square(char file, char rank) {
+    if (file < 'a' || file > 'h' || rank < '1' || rank > '8') {
+        return -1;
     }
+    return (rank - '1') * 8 + (file - 'a');
+}
 
-    strncpy(move->move_data.uci.from_square, uci_move, 2);
-    move->move_data.uci.from_square[2] = '\0';
+/**
+ * @brief Packs a UCI move such as "e2e4" or "e7e8q".
+ *
+ * Only the squares and the promotion are known; capture, castling and en
+ * passant bits stay clear.
+ *
+ * @return false if it is not 4 or 5 characters of UCI.
+ */
+bool move_parse_uci(const char *uci, size_t length, Move *out) {
+    if (length != 4 && length != 5) {
+        return false;
+    }
+    int from = move_square(uci[0], uci[1]);
+    int to = move_square(uci[2], uci[3]);
+    if (from < 0 || to < 0) {
+        return false;
+    }
+    uint32_t bits = (uint32_t)to | (uint32_t)from << MOVE_ORIGIN_SHIFT | MOVE_BIT_UCI;
+    if (length == 5) {
+        const char *promotion = memchr(MOVE_PROMOTION_CHARS, tolower((unsigned char)uci[4]), 4);
+        if (promotion == NULL) {
+            return false;
+        }
+        bits |= (uint32_t)(promotion - MOVE_PROMOTION_CHARS + 1) << MOVE_PROMOTION_SHIFT;
+    }
+    out->bits = bits;
+    return true;
+}
+
+/**
+ * @brief Packs a SAN move such as "Nbxd7+", "exd8=Q" or "O-O" without a board.
+ *
+ * Annotations ('!', '?') are dropped; '+' and '#' are kept. Whether the move
+ * is legal, or which piece makes it, is only known after
+ * translate_san_to_uci.
+ *
+ * @return false if the text is not SAN.
+ */
+bool move_parse_san(const char *san, size_t length, Move *out) {
+    while (length > 0 && (san[length - 1] == '!' || san[length - 1] == '?')) {
+        length--;
+    }
+    uint32_t suffix = 0;
+    if (length > 0 && (san[length - 1] == '+' || san[length - 1] == '#')) {
+        suffix = san[length - 1] == '+' ? 1 : 2;
+        length--;
+    }
+    if (length < 2) {
+        return false;
+    }
+    uint32_t bits = MOVE_BIT_SAN | suffix << MOVE_SUFFIX_SHIFT;
+
+    if (san[0] == 'O' || san[0] == '0') {
+        char c = san[0];
+        if (length == 3 && san[1] == '-' && san[2] == c) {
+            bits |= MOVE_BIT_KING_CASTLE;
+        } else if (length == 5 && san[1] == '-' && san[2] == c && san[3] == '-' && san[4] == c) {
+            bits |= MOVE_BIT_QUEEN_CASTLE;
+        } else {
+            return false;
+        }
+        bits |= 5u << MOVE_PIECE_SHIFT;
+        out->bits = bits;
+        return true;
+    }
+
+    size_t i = 0;
+    uint32_t piece = 0;
+    const char *piece_char = memchr(MOVE_PIECE_CHARS + 1, san[0], 5);
+    if (piece_char != NULL) {
+        piece = (uint32_t)(piece_char - MOVE_PIECE_CHARS);
+        i = 1;
+    }
 
-    strncpy(move->move_data.uci.to_square, uci_move + 2, 2);
-    move->move_data.uci.to_square[2] = '\0';
+    if (piece == 0 && length >= 3) {
+        const char *promotion = memchr(MOVE_PROMOTION_CHARS, tolower((unsigned char)san[length - 1]), 4);
+        if (promotion != NULL && isupper((unsigned char)san[length - 1])) {
+            bits |= (uint32_t)(promotion - MOVE_PROMOTION_CHARS + 1) << MOVE_PROMOTION_SHIFT;
+            length--;
+            if (san[length - 1] == '=') {
+                length--;
+            }
+        }
+    }
+
+    if (length < i + 2) {
+        return false;
+    }
+    int to = move_square(san[length - 2], san[length - 1]);
+    if (to < 0) {
+        return false;
+    }
+    bits |= (uint32_t)to | piece << MOVE_PIECE_SHIFT;
+
+    for (size_t j = i; j < length - 2; j++) {
+        char c = san[j];
+        if (c >= 'a' && c <= 'h' && !(bits & MOVE_BIT_FILE_GIVEN)) {
+            bits |= MOVE_BIT_FILE_GIVEN | (uint32_t)(c - 'a') << MOVE_ORIGIN_SHIFT;
+        } else if (c >= '1' && c <= '8' && !(bits & MOVE_BIT_RANK_GIVEN)) {
+            bits |= MOVE_BIT_RANK_GIVEN | (uint32_t)(c - '1') << (MOVE_ORIGIN_SHIFT + 3);
+        } else if (c == 'x' || c == ':') {
+            bits |= MOVE_BIT_CAPTURE;
+        } else if (c != '-') {
+            return false;
+        }
+    }
+    // A pawn moving to another file is a capture even without the 'x'
+    if (piece == 0 && (bits & MOVE_BIT_FILE_GIVEN) &&
+        (int)((bits >> MOVE_ORIGIN_SHIFT) & 7) != (to & 7)) {
+        bits |= MOVE_BIT_CAPTURE;
+    }
+    out->bits = bits;
+    return true;
+}
 
-    if (len == 5) {
-        strncpy(move->move_data.uci.promotion, uci_move + 4, 1);
-        move->move_data.uci.promotion[1] = '\0';
+/**
+ * @brief Writes a resolved move as UCI.
+ *
+ * @param out Buffer of at least MOVE_TEXT_MAX bytes.
+ * @return Length written, 0 for a SAN move that is not resolved yet.
+ */
+size_t move_format_uci(const Move *move, char *out) {
+    if (move_tag(move) != MOVE_TAG_UCI) {
+        out[0] = '\0';
+        return 0;
+    }
+    int from = move_origin(move);
+    int to = move_target(move);
+    uint32_t promotion = (move->bits >> MOVE_PROMOTION_SHIFT) & 7;
+    out[0] = (char)('a' + (from & 7));
+    out[1] = (char)('1' + (from >> 3));
+    out[2] = (char)('a' + (to & 7));
+    out[3] = (char)('1' + (to >> 3));
+    size_t length = 4;
+    if (promotion != 0) {
+        out[length++] = MOVE_PROMOTION_CHARS[promotion - 1];
+    }
+    out[length] = '\0';
+    return length;
+}
+
+/**
+ * @brief Writes a move parsed from SAN back as SAN, in canonical form
+ *        ("0-0" becomes "O-O", "e8Q" becomes "e8=Q").
+ *
+ * @param out Buffer of at least MOVE_TEXT_MAX bytes.
+ * @return Length written, 0 for a move that was not parsed from SAN.
+ */
+size_t move_format_san(const Move *move, char *out) {
+    uint32_t bits = move->bits;
+    size_t length = 0;
+    if (!(bits & MOVE_BIT_SAN)) {
+        out[0] = '\0';
+        return 0;
+    }
+    if (bits & (MOVE_BIT_KING_CASTLE | MOVE_BIT_QUEEN_CASTLE)) {
+        memcpy(out, "O-O-O", 5);
+        length = bits & MOVE_BIT_KING_CASTLE ? 3 : 5;
     } else {
-        move->move_data.uci.promotion[0] = '\0';  // No promotion
+        uint32_t piece = (bits >> MOVE_PIECE_SHIFT) & 7;
+        uint32_t promotion = (bits >> MOVE_PROMOTION_SHIFT) & 7;
+        int to = move_target(move);
+        if (piece != 0) {
+            out[length++] = MOVE_PIECE_CHARS[piece];
+        }
+        if (bits & MOVE_BIT_FILE_GIVEN) {
+            out[length++] = (char)('a' + ((bits >> MOVE_ORIGIN_SHIFT) & 7));
+        }
+        if (bits & MOVE_BIT_RANK_GIVEN) {
+            out[length++] = (char)('1' + ((bits >> (MOVE_ORIGIN_SHIFT + 3)) & 7));
+        }
+        if (bits & MOVE_BIT_CAPTURE) {
+            out[length++] = 'x';
+        }
+        out[length++] = (char)('a' + (to & 7));
+        out[length++] = (char)('1' + (to >> 3));
+        if (promotion != 0) {
+            out[length++] = '=';
+            out[length++] = (char)toupper((unsigned char)MOVE_PROMOTION_CHARS[promotion - 1]);
+        }
     }
+    uint32_t suffix = (bits >> MOVE_SUFFIX_SHIFT) & 3;
+    if (suffix != 0) {
+        out[length++] = suffix == 1 ? '+' : '#';
+    }
+    out[length] = '\0';
+    return length;
+}
 
-    return move;
+/**
+ * @brief "uci" or "san", for callers that used to compare Move.type.
+ */
+const char *move_type_string(const Move *move) {
+    return move_tag(move) == MOVE_TAG_UCI ? "uci" : "san";
 }
 
-Move *get_move_from_san(char *san_move) {
-    Move *move = (Move *)malloc(sizeof(Move));
-    if (!move) return NULL;
+Move *get_move_from_uci(char *uci_move) {
+    return get_move_from_uci_arena(uci_move, NULL);
+}
 
-    move->type = "san";
-    move->player = '?';
-    size_t cap = sizeof(move->move_data.san.notation);
+/**
+ * @brief Like get_move_from_uci, with the Move taken from arena.
+ *
+ * The Move lives until the arena is reset and must not be freed. With a
+ * NULL arena it is malloc'd, as get_move_from_uci does.
+ */
+Move *get_move_from_uci_arena(const char *uci_move, Arena *arena) {
+    Move parsed;
+    if (!move_parse_uci(uci_move, strlen(uci_move), &parsed)) {
+        printf("Invalid UCI move: %s\n", uci_move);
+        return NULL;
+    }
+    Move *move = (Move *)object_alloc(arena, sizeof(Move));
+    if (!move) return NULL;
+    *move = parsed;
+    return move;
+}
 
-    strncpy(move->move_data.san.notation, san_move, cap - 1);
-    move->move_data.san.notation[cap - 1] = '\0';
+/**
+ * @brief Creates a Move from SAN text; see move_parse_san.
+ *
+ * @return NULL if the text is not SAN or allocation fails.
+ */
+Move *get_move_from_san(char *san_move) {
+    return get_move_from_san_arena(san_move, NULL);
+}
 
+/**
+ * @brief Like get_move_from_san, with the Move taken from arena (malloc'd
+ *        if arena is NULL).
+ */
+Move *get_move_from_san_arena(const char *san_move, Arena *arena) {
+    Move parsed;
+    if (!move_parse_san(san_move, strlen(san_move), &parsed)) {
+        return NULL;
+    }
+    Move *move = (Move *)object_alloc(arena, sizeof(Move));
+    if (!move) return NULL;
+    *move = parsed;
     return move;
 }
 
@@ -90,155 +358,342 @@ bool string_to_int(const char *str, int *out) {
     return true; // success
 }
 
+/**
+ * @brief Counts the SAN moves in a movetext.
+ *
+ * Move numbers, comments, variations, NAGs and the result are not counted.
+ */
 int get_move_numbers_from_pgn_string(const char *pgn_string) {
     if (!pgn_string) return 0;
-
-    int move_count = 0;
-    const unsigned char *p = (const unsigned char *)pgn_string;
-
-    while (*p != '\0') {
-        // 1) Skip move numbers, dots, and whitespace
-        while (*p != '\0' && (isdigit(*p) || *p == '.' || isspace(*p))) {
-            p++;
-        }
-        if (*p == '\0') break;
-
-        // 2) At start of a SAN token -> count one move
-        move_count++;
-
-        // 3) Skip the token (non-space run)
-        while (*p != '\0' && !isspace(*p)) {
-            p++;
-        }
-        // loop continues; no extra p++ here
-    }
-
-    return move_count;
+    return pgn_tokenize_moves(pgn_string, strlen(pgn_string), NULL, 0);
 }
 
+/**
+ * @brief Splits a movetext into heap-allocated SAN moves.
+ *
+ * Kept for existing callers; it allocates the array and one Move per token.
+ * Code on the hot path should walk the movetext with pgn_tokenizer_next or
+ * fill a reusable array with pgn_tokenize_moves instead.
+ *
+ * @return Array of get_move_numbers_from_pgn_string(pgn_string) moves, or
+ *         NULL if there are none. The caller frees each Move and the array.
+ */
 Move **get_moves_from_pgn_string(const char *pgn_string){
-    if (!pgn_string) return NULL;
-    
+    return get_moves_from_pgn_string_arena(pgn_string, NULL);
+}
+
+/**
+ * @brief Like get_moves_from_pgn_string, with the array and every Move taken
+ *        from arena: nothing to free, and one arena_reset per game releases
+ *        them all. With a NULL arena everything is malloc'd.
+ */
+Move **get_moves_from_pgn_string_arena(const char *pgn_string, Arena *arena){
     int move_count = get_move_numbers_from_pgn_string(pgn_string);
     if (move_count == 0) return NULL;
-    Move **moves = (Move **)malloc(sizeof(Move *) * move_count);
+    Move **moves = (Move **)object_alloc(arena, sizeof(Move *) * move_count);
     if (!moves) return NULL;
 
-    // Make a copy of the PGN string since strtok modifies it
-    size_t pgn_size = strlen(pgn_string);
-    char pgn_copy[pgn_size + 1];
-    strncpy(pgn_copy, pgn_string, sizeof(pgn_copy) - 1);
-    pgn_copy[sizeof(pgn_copy) - 1] = '\0';
-
-    char *token = strtok(pgn_copy, " \t\r\n");
+    PGN_Tokenizer tokenizer;
+    pgn_tokenizer_init(&tokenizer, pgn_string, strlen(pgn_string));
+    const char *token;
+    size_t token_length;
     int move_index = 0;
-    while (token != NULL && move_index < move_count) {
-        if (isdigit(token[0]) || token[0] == '.') {
-            token = strtok(NULL, " \t\r\n");
-            continue; // Skip move numbers and dots
+    while (move_index < move_count && pgn_tokenizer_next(&tokenizer, &token, &token_length)) {
+        Move parsed;
+        moves[move_index] = NULL;
+        if (move_parse_san(token, token_length, &parsed)) {
+            moves[move_index] = (Move *)object_alloc(arena, sizeof(Move));
+        }
+        if (moves[move_index] != NULL) {
+            *moves[move_index] = parsed;
+        }
+        if (!moves[move_index]) {
+            if (arena == NULL) {
+                while (move_index > 0) free(moves[--move_index]);
+                free(moves);
+            }
+            return NULL;
         }
-        moves[move_index] = get_move_from_san(token);
         move_index++;
-        token = strtok(NULL, " \t\r\n");
     }
 
     return moves;
 }
 
+// What a piece placement character does, packed so the parser needs one
+// load per character: bits 0-7 squares covered, 8-15 the character those
+// squares get, 16-23 rank advance (8 for '/'), 32-47 all set for '/', then
+// flags. Characters not in the table are 0 and so lack FEN_VALID.
+#define FEN_VALID (1ull << 48)
+#define FEN_DIGIT (1ull << 49)
+#define FEN_PIECE(letter) ((uint64_t)(letter) << 8 | 1 | FEN_VALID)
+#define FEN_EMPTY(squares) ((uint64_t)' ' << 8 | (squares) | FEN_DIGIT | FEN_VALID)
+static const uint64_t FEN_PLACEMENT[256] = {
+    ['P'] = FEN_PIECE('P'), ['N'] = FEN_PIECE('N'), ['B'] = FEN_PIECE('B'),
+    ['R'] = FEN_PIECE('R'), ['Q'] = FEN_PIECE('Q'), ['K'] = FEN_PIECE('K'),
+    ['p'] = FEN_PIECE('p'), ['n'] = FEN_PIECE('n'), ['b'] = FEN_PIECE('b'),
+    ['r'] = FEN_PIECE('r'), ['q'] = FEN_PIECE('q'), ['k'] = FEN_PIECE('k'),
+    ['1'] = FEN_EMPTY(1), ['2'] = FEN_EMPTY(2), ['3'] = FEN_EMPTY(3), ['4'] = FEN_EMPTY(4),
+    ['5'] = FEN_EMPTY(5), ['6'] = FEN_EMPTY(6), ['7'] = FEN_EMPTY(7), ['8'] = FEN_EMPTY(8),
+    ['/'] = (uint64_t)' ' << 8 | 8 << 16 | 0xffffull << 32 | FEN_VALID,
+};
+// One side's piece counts, a byte each for pawns, knights, bishops, rooks,
+// queens and king, kept in a register while the placement is read
+static const uint64_t FEN_WHITE_COUNT[256] = {
+    ['P'] = 1, ['N'] = 1ull << 8, ['B'] = 1ull << 16, ['R'] = 1ull << 24, ['Q'] = 1ull << 32, ['K'] = 1ull << 40,
+};
+static const uint64_t FEN_BLACK_COUNT[256] = {
+    ['p'] = 1, ['n'] = 1ull << 8, ['b'] = 1ull << 16, ['r'] = 1ull << 24, ['q'] = 1ull << 32, ['k'] = 1ull << 40,
+};
+// Longest piece placement: pieces and single empty squares alternating
+#define FEN_PLACEMENT_MAX 71
+// Castling letters as bits in "KQkq-" order
+#define FEN_NO_CASTLING 16
+static const unsigned char FEN_CASTLING_BIT[256] = {['K'] = 1, ['Q'] = 2, ['k'] = 4, ['q'] = 8, ['-'] = FEN_NO_CASTLING};
+static const unsigned char FEN_PAWN[256] = {['P'] = 1, ['p'] = 1};
+// Side to move plus one, 0 if not a side
+static const unsigned char FEN_SIDE[256] = {['w'] = 1, ['b'] = 2};
+
+// Moves *p past the blanks between two fields; false if there are none
+static bool fen_field_gap(const char **p, const char *end) {
+    const char *start = *p;
+    while (*p < end && **p == ' ') {
+        (*p)++;
+    }
+    return *p > start && *p < end;
+}
+
+// Reads a decimal clock of at most 5 digits, up to 65535
+static bool fen_clock(const char **p, const char *end, int *out) {
+    int value = 0;
+    int digits = 0;
+    while (*p < end && (unsigned)(**p - '0') < 10u) {
+        value = value * 10 + (**p - '0');
+        (*p)++;
+        if (++digits > 5) {
+            return false;
+        }
+    }
+    *out = value;
+    return digits > 0 && value <= 65535;
+}
+
+// Every piece beyond the starting set must be a promoted pawn. Written
+// without && so that it compiles to straight-line code.
+static bool fen_piece_counts_possible(uint64_t counts) {
+    unsigned pawns = counts & 0xff;
+    unsigned knights = counts >> 8 & 0xff;
+    unsigned bishops = counts >> 16 & 0xff;
+    unsigned rooks = counts >> 24 & 0xff;
+    unsigned queens = counts >> 32 & 0xff;
+    unsigned kings = counts >> 40 & 0xff;
+    unsigned promoted = (knights > 2) * (knights - 2) + (bishops > 2) * (bishops - 2) + (rooks > 2) * (rooks - 2) +
+                        (queens > 1) * (queens - 1);
+    return (kings == 1) & (pawns + promoted <= 8);
+}
+
+
+
 /**
- * @brief Parses a FEN (Forsyth–Edwards Notation) string and fills a FEN_Board struct.
- *
- * This function takes a FEN string describing a chess position and populates the provided
- * FEN_Board structure with the board state, side to move, castling rights, en passant target,
- * halfmove clock, and fullmove number.
+ * @brief Parses and validates a FEN in one pass over (fen, length).
  *
- * @param output Pointer to a FEN_Board struct to be filled. If NULL, memory will be allocated.
- * @param fen_string Null-terminated string containing the FEN position.
- * @return true if parsing was successful and the board was filled, false otherwise.
+ * The input needs no terminator and is never modified or copied, and the
+ * parser keeps no state between calls, so any number of threads can use it
+ * at once. Besides the syntax, it checks what a FEN_Board can say about
+ * legality: exactly one king per side, pawn and promoted piece counts, no
+ * pawn on the first or last rank, castling rights only with the king and
+ * rook on their home squares, and an en passant square behind a pawn that
+ * has just moved two squares. Fields may be separated by several spaces and
+ * trailing whitespace is ignored; nothing else may follow the fullmove
+ * number.
  *
- * The function expects the FEN string to be well-formed. If any part is missing or invalid,
- * the function returns false. If output is NULL, the function will allocate memory for it,
- * but the caller is responsible for freeing it.
+ * @param out The parsed board; unspecified unless FEN_OK is returned.
+ * @return FEN_OK, or the first problem found.
  */
-FEN_Board *create_fen_board(char *fen_string) {
-    if (fen_string == NULL) {
-        return NULL;
+enum Fen_Status fen_board_parse(const char *fen, size_t length, FEN_Board *out) {
+    if (fen == NULL || out == NULL) {
+        return FEN_SYNTAX_ERROR;
     }
-    FEN_Board *output = (FEN_Board *)malloc(sizeof(FEN_Board));
-    if (output == NULL) {
-        return NULL;
+    const char *p = fen;
+    const char *end = fen + length;
+
+    // Piece placement. Real positions mix pieces and empty runs too
+    // irregularly for branches to predict, so each character is one table
+    // lookup and problems only set bits, looked at once the field is read.
+    // Square i in FEN order (a8 first) is board square i ^ 56; a malformed
+    // field that runs past h1 wraps around and is rejected afterwards.
+    const char *field_end = memchr(p, ' ', length);
+    if (field_end == NULL) {
+        return FEN_SYNTAX_ERROR;
     }
-    
-    // Initialize board with empty squares
-    for (int rank = 0; rank < 8; rank++) {
-        for (int file = 0; file < 8; file++) {
-            output->board[rank][file] = ' ';
-        }
+    if (field_end - p > FEN_PLACEMENT_MAX) {
+        return FEN_BAD_BOARD;
     }
-    
-    // Make a copy of the FEN string since strtok modifies it
-    char fen_copy[200];
-    strncpy(fen_copy, fen_string, sizeof(fen_copy) - 1);
-    fen_copy[sizeof(fen_copy) - 1] = '\0';
-    
-    char *board_part = strtok(fen_copy, " ");        // points into `fen`
-    char *side = strtok(NULL, " ");             // "w"
-    char *castling = strtok(NULL, " ");         // "KQkq"
-    char *en_passant = strtok(NULL, " ");       // "e3"
-    char *halfmove = strtok(NULL, " ");         // "0"
-    char *fullmove = strtok(NULL, " ");         // "1"
-    
-    if (!board_part || !side || !castling || !en_passant || !halfmove || !fullmove) {
-        free(output);
-        return NULL;
+    char *squares = &out->board[0][0];
+    memset(squares, ' ', 64);
+    // Few enough live values to stay in registers: squares filled so far in
+    // the low 16 bits of position, the first square of the current rank in
+    // the next 16.
+    uint64_t white_counts = 0, black_counts = 0;
+    uint64_t position = 0, bad = 0, previous = 0;
+    for (; p < field_end; p++) {
+        unsigned char c = (unsigned char)*p;
+        uint64_t action = FEN_PLACEMENT[c];
+        squares[(position ^ 56) & 63] = (char)(action >> 8);
+        position += action & 0xff00ff;
+        // A '/' must come right after the 8 squares of its rank, and two
+        // digits in a row are not a FEN even if they add up
+        bad |= ((position ^ position >> 16) & 0xffff) << 32 & action;
+        bad |= (action & previous & FEN_DIGIT) | (~action & FEN_VALID);
+        white_counts += FEN_WHITE_COUNT[c];
+        black_counts += FEN_BLACK_COUNT[c];
+        previous = action;
     }
-    
-    // Parse the board part
-    int rank_index = 7;
-    int file_index = 0;
-    int board_string_index = 0;
-    
-    while (board_part[board_string_index] != '\0' && rank_index >= 0) {
-        char c = board_part[board_string_index];
-        
-        if (c == '/') {
-            rank_index--;
-            file_index = 0;
-        } else if (isdigit(c)) {
-            int empty_squares = c - '0';
-            file_index += empty_squares;
-        } else if (file_index < 8) {
-            output->board[rank_index][file_index] = c;
-            file_index++;
-        }
-        board_string_index++;
-    }
-    
-    // Parse side to move
-    output->side_to_move = (side[0] == 'w') ? 0 : 1;
-    
-    // Parse castling rights
-    strncpy(output->castling_rights, castling, sizeof(output->castling_rights) - 1);
-    output->castling_rights[sizeof(output->castling_rights) - 1] = '\0';
-    
-    // Parse en passant square
-    if (strcmp(en_passant, "-") != 0) {
-        output->en_passant_square_file = en_passant[0] - 'a';
-        output->en_passant_square_rank = en_passant[1] - '1';
+    if (bad != 0 || position != (56 << 16 | 64)) {
+        return FEN_BAD_BOARD;
+    }
+    unsigned back_rank_pawns = 0;
+    for (int file = 0; file < 8; file++) {
+        back_rank_pawns |= FEN_PAWN[(unsigned char)out->board[0][file]] | FEN_PAWN[(unsigned char)out->board[7][file]];
+    }
+    if (back_rank_pawns | !fen_piece_counts_possible(white_counts) | !fen_piece_counts_possible(black_counts)) {
+        return FEN_BAD_PIECES;
+    }
+
+    // Side to move
+    if (!fen_field_gap(&p, end)) {
+        return FEN_SYNTAX_ERROR;
+    }
+    unsigned side = FEN_SIDE[(unsigned char)*p];
+    if (side == 0 || (++p < end && *p != ' ')) {
+        return FEN_BAD_SIDE;
+    }
+    out->side_to_move = (int)side - 1;
+
+    // Castling rights: "-" or a subset of "KQkq" in that order, each backed
+    // by the king and rook on their home squares
+    if (!fen_field_gap(&p, end)) {
+        return FEN_SYNTAX_ERROR;
+    }
+    // Reading the field's first 5 bytes (at most 4 letters and the space
+    // after them) before knowing its length keeps this branch-free. Each
+    // letter must come later in "KQkq-" than all before it; anything else,
+    // or a '-' with company, fails.
+    if (end - p < 5) {
+        return FEN_SYNTAX_ERROR;
+    }
+    unsigned rights = 0, letters = 0, in_field = 1, misplaced = 0;
+    for (int i = 0; i < 4; i++) {
+        in_field &= p[i] != ' ';
+        unsigned bit = FEN_CASTLING_BIT[(unsigned char)p[i]] & -in_field;
+        misplaced |= in_field & (bit <= rights);
+        rights |= bit;
+        letters += in_field;
+        out->castling_rights[i] = p[i];
+    }
+    p += letters;
+    const char *white = out->board[0];
+    const char *black = out->board[7];
+    unsigned possible = (white[4] == 'K') * ((white[7] == 'R') | (white[0] == 'R') << 1) |
+                        (black[4] == 'k') * ((black[7] == 'r') << 2 | (black[0] == 'r') << 3) | FEN_NO_CASTLING;
+    if (misplaced | (rights > FEN_NO_CASTLING) | ((rights & ~possible) != 0) | (*p != ' ')) {
+        return FEN_BAD_CASTLING;
+    }
+    out->castling_rights[letters] = '\0';
+
+    // En passant target: on rank 6 with white to move (3 with black), empty
+    // along with the square the pawn left, and the pawn right in front
+    if (!fen_field_gap(&p, end)) {
+        return FEN_SYNTAX_ERROR;
+    }
+    if (*p == '-') {
+        out->en_passant_square_file = -1;
+        out->en_passant_square_rank = -1;
+        p++;
     } else {
-        output->en_passant_square_file = -1;
-        output->en_passant_square_rank = -1;
-    }
-    
-    // Parse halfmove clock and fullmove number
-    bool halfmove_convert_success = string_to_int(halfmove, &output->halfmove_clock);
-    bool fullmove_convert_success = string_to_int(fullmove, &output->fullmove_number);
-    
-    if (!halfmove_convert_success || !fullmove_convert_success) {
-        free(output);
-        return NULL;
+        if (end - p < 2 || p[0] < 'a' || p[0] > 'h' || p[1] != (out->side_to_move == 0 ? '6' : '3')) {
+            return FEN_BAD_EN_PASSANT;
+        }
+        int file = p[0] - 'a';
+        int rank = p[1] - '1';
+        int ahead = out->side_to_move == 0 ? -1 : 1;  // towards the pawn
+        if (out->board[rank][file] != ' ' || out->board[rank - ahead][file] != ' ' ||
+            out->board[rank + ahead][file] != (out->side_to_move == 0 ? 'p' : 'P')) {
+            return FEN_BAD_EN_PASSANT;
+        }
+        out->en_passant_square_file = file;
+        out->en_passant_square_rank = rank;
+        p += 2;
+    }
+    if (p < end && *p != ' ') {
+        return FEN_BAD_EN_PASSANT;
+    }
+
+    // Halfmove clock and fullmove number
+    if (!fen_field_gap(&p, end)) {
+        return FEN_SYNTAX_ERROR;
+    }
+    if (!fen_clock(&p, end, &out->halfmove_clock) || (p < end && *p != ' ')) {
+        return FEN_BAD_CLOCK;
+    }
+    if (!fen_field_gap(&p, end)) {
+        return FEN_SYNTAX_ERROR;
+    }
+    if (!fen_clock(&p, end, &out->fullmove_number) || out->fullmove_number == 0) {
+        return FEN_BAD_CLOCK;
+    }
+    const char *clock_end = p;
+    while (p < end && (*p == ' ' || *p == '\r' || *p == '\n')) {
+        p++;
+    }
+    if (p == clock_end && p != end) {
+        return FEN_BAD_CLOCK;
+    }
+    if (p != end) {
+        return FEN_SYNTAX_ERROR;
     }
+    out->move_number = out->fullmove_number;
+    return FEN_OK;
+}
+
+const char *fen_status_string(enum Fen_Status status) {
+    switch (status) {
+        case FEN_OK: return "ok";
+        case FEN_SYNTAX_ERROR: return "missing or extra field";
+        case FEN_BAD_BOARD: return "bad piece placement";
+        case FEN_BAD_PIECES: return "impossible piece counts";
+        case FEN_BAD_SIDE: return "bad side to move";
+        case FEN_BAD_CASTLING: return "bad castling rights";
+        case FEN_BAD_EN_PASSANT: return "bad en passant square";
+        case FEN_BAD_CLOCK: return "bad move clock";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Parses a FEN (Forsyth–Edwards Notation) string into a new FEN_Board.
+ *
+ * @param fen_string Null-terminated string containing the FEN position.
+ * @return A malloc'd board the caller frees, or NULL if fen_board_parse
+ *         rejects the FEN (use it directly to learn why) or memory runs out.
+ */
+FEN_Board *create_fen_board(char *fen_string) {
+    return create_fen_board_arena(fen_string, NULL);
+}
 
+/**
+ * @brief Like create_fen_board, with the board taken from arena (malloc'd if
+ *        arena is NULL). Nothing is allocated for a FEN that fails to parse.
+ */
+FEN_Board *create_fen_board_arena(const char *fen_string, Arena *arena) {
+    FEN_Board board;
+    if (fen_string == NULL || fen_board_parse(fen_string, strlen(fen_string), &board) != FEN_OK) {
+        return NULL;
+    }
+    FEN_Board *output = (FEN_Board *)object_alloc(arena, sizeof(FEN_Board));
+    if (output != NULL) {
+        *output = board;
+    }
     return output;
 }
 
@@ -317,6 +772,48 @@ bool free_fen_plus(FEN_Plus *fen_plus){
     return true;
 }
 
+// A pooled FEN_Plus carries its board and move in the same pool object
+typedef struct {
+    FEN_Plus fen_plus;
+    FEN_Board board;
+    Move move;
+} Pooled_FEN_Plus;
+
+/**
+ * @brief Sets up a pool for create_fen_plus_pooled.
+ */
+bool fen_plus_pool_init(Pool *pool) {
+    return pool_init(pool, sizeof(Pooled_FEN_Plus), 1024);
+}
+
+/**
+ * @brief Returns a zeroed FEN_Plus from pool whose board and move point to
+ *        storage inside the same object: one pool_alloc instead of three
+ *        mallocs. Release it with free_fen_plus_pooled, not free_fen_plus.
+ */
+FEN_Plus *create_fen_plus_pooled(Pool *pool) {
+    Pooled_FEN_Plus *pooled = (Pooled_FEN_Plus *)pool_alloc(pool);
+    if (pooled == NULL) {
+        return NULL;
+    }
+    memset(pooled, 0, sizeof(*pooled));
+    pooled->fen_plus.board = &pooled->board;
+    pooled->fen_plus.move = &pooled->move;
+    return &pooled->fen_plus;
+}
+
+/**
+ * @brief Returns a FEN_Plus from create_fen_plus_pooled, with its board and
+ *        move, to pool.
+ */
+bool free_fen_plus_pooled(FEN_Plus *fen_plus, Pool *pool) {
+    if (fen_plus == NULL || pool == NULL) {
+        return false;
+    }
+    pool_release(pool, fen_plus);
+    return true;
+}
+
 
 
 FEN_Board *generate_starting_position_fen(void){
@@ -325,29 +822,91 @@ FEN_Board *generate_starting_position_fen(void){
     return create_fen_board(fen_string);
 }
 
-char *find_move_starting_position_of_piece(char piece, FEN_Board *board, char destination_square[3], char *starting_position){
-    // TODO: fill this function
-    
-    return NULL;
+/**
+ * @brief Finds the square a piece has to start from to reach a destination.
+ *
+ * @param piece Piece letter as in FEN ('N' white knight, 'p' black pawn, ...);
+ *              its case selects the color that moves.
+ * @param board Current position.
+ * @param destination_square Target square such as "d7".
+ * @param starting_position Receives the origin square, e.g. "b8".
+ * @return true if exactly one piece of that kind can legally get there.
+ */
+bool find_move_starting_position_of_piece(char piece, FEN_Board *board,
+                                          const char destination_square[3],
+                                          char starting_position[3]) {
+    int piece_index = piece_from_char(piece);
+    int to = square_from_string(destination_square);
+    if (board == NULL || piece_index == NO_PIECE || to == NO_SQUARE) {
+        return false;
+    }
+    attacks_init();
+    Position pos;
+    if (!position_from_fen_board(board, &pos)) {
+        return false;
+    }
+    pos.side_to_move = (uint8_t)PIECE_COLOR(piece_index);
+
+    bool capture = (pos.occupancy[pos.side_to_move ^ 1] & square_bit(to)) != 0 ||
+                   (PIECE_TYPE(piece_index) == PAWN && to == pos.en_passant);
+    int from;
+    if (san_find_origin(&pos, PIECE_TYPE(piece_index), to, ~(Bitboard)0, capture, &from) != SAN_OK) {
+        return false;
+    }
+    square_to_string(from, starting_position);
+    return true;
 }
 
+/**
+ * @brief Converts a SAN move into UCI notation in place.
+ *
+ * The SAN move is resolved against the board (which is not modified). On
+ * success its tag becomes MOVE_TAG_UCI, with origin, capture, castling and
+ * en passant filled in and the player set from the side to move; it can
+ * still be written back with move_format_san.
+ *
+ * @param san_move Move created by get_move_from_san; UCI moves pass through.
+ * @param board Position the move is played from.
+ * @return true if the move was resolved, false if it is invalid or ambiguous.
+ */
 bool translate_san_to_uci(Move *san_move, FEN_Board *board){
     if (san_move == NULL || board == NULL) {
         return false;
     }
-    if (strcmp(san_move->type, "uci") == 0) {
+    if (move_tag(san_move) == MOVE_TAG_UCI) {
         return true; // Already in UCI format
     }
-    if (strcmp(san_move->type, "san") != 0) {
-        return false; // not UCI and not SAN, something is wrong
+
+    attacks_init();
+    Position pos;
+    if (!position_from_fen_board(board, &pos)) {
+        return false;
+    }
+    char notation[MOVE_TEXT_MAX];
+    size_t length = move_format_san(san_move, notation);
+    ChessMove move;
+    if (san_to_move(&pos, notation, length, &move) != SAN_OK) {
+        return false;
     }
 
-    uci_move uci;
-    size_t san_length = strlen(san_move->move_data.san.notation);
-    if( san_length==2){ // this happens only when we move a pawn to an empty square
-        strncmp(san_move->move_data.san.notation,uci.to_square, 2);
-        uci.to_square[2] = '\0';
-        char from_square[3];
-        find_move_starting_position_of_piece("p", board, uci.to_square, &from_square);
+    // Keep the SAN fields so the move can still be written as SAN
+    uint32_t bits = san_move->bits & (MOVE_BIT_SAN | 7u << MOVE_PIECE_SHIFT | MOVE_BIT_FILE_GIVEN |
+                                      MOVE_BIT_RANK_GIVEN | 3u << MOVE_SUFFIX_SHIFT);
+    bits |= (uint32_t)move_to(move) | (uint32_t)move_from(move) << MOVE_ORIGIN_SHIFT | MOVE_BIT_UCI;
+    if (move_is_promotion(move)) {
+        bits |= (uint32_t)(move_promotion_type(move) - KNIGHT + 1) << MOVE_PROMOTION_SHIFT;
     }
+    if (move_is_capture(move)) {
+        bits |= MOVE_BIT_CAPTURE;
+    }
+    if (move_flags(move) == MOVE_KING_CASTLE) {
+        bits |= MOVE_BIT_KING_CASTLE;
+    } else if (move_flags(move) == MOVE_QUEEN_CASTLE) {
+        bits |= MOVE_BIT_QUEEN_CASTLE;
+    } else if (move_flags(move) == MOVE_EN_PASSANT) {
+        bits |= MOVE_BIT_EN_PASSANT;
+    }
+    san_move->bits = bits;
+    move_set_player(san_move, pos.side_to_move == WHITE ? 'w' : 'b');
+    return true;
 }
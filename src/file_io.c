@@ -0,0 +1,105 @@
+#define _POSIX_C_SOURCE 200809L
+#include "file_io.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+// Longest scratch file path
+#define FILE_IO_PATH_MAX 4096
+
+/**
+ * @brief Monotonic wall clock in seconds, for timing whole passes.
+ */
+double file_io_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Creates a scratch file in dir and unlinks it at once, so nothing
+ *        is left behind however the run ends.
+ *
+ * @param prefix Start of the file name, followed by the pid and a counter.
+ * @return The descriptor, open for reading and writing; -1 with errno set.
+ */
+int file_io_open_temp(const char *dir, const char *prefix) {
+    static uint32_t counter;
+    char path[FILE_IO_PATH_MAX];
+    int length = snprintf(path, sizeof(path), "%s/%s-%ld-%u.tmp", dir, prefix, (long)getpid(),
+                          __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED));
+    if (length < 0 || (size_t)length >= sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) {
+        unlink(path);
+    }
+    return fd;
+}
+
+/**
+ * @brief Writes all of data at offset, whatever pwrite returns in pieces.
+ *
+ * @return false with errno set if the write fails.
+ */
+bool file_io_write_at(int fd, const void *data, size_t length, uint64_t offset) {
+    const char *p = (const char *)data;
+    while (length > 0) {
+        ssize_t n = pwrite(fd, p, length, (off_t)offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        length -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads all of length bytes at offset.
+ *
+ * @return false if the read fails (errno set) or the file ends first
+ *         (errno 0).
+ */
+bool file_io_read_at(int fd, void *data, size_t length, uint64_t offset) {
+    char *p = (char *)data;
+    while (length > 0) {
+        ssize_t n = pread(fd, p, length, (off_t)offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (n == 0) {
+                errno = 0;
+            }
+            return false;
+        }
+        p += n;
+        length -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+/**
+ * @brief Records the first failure of a run in error; later ones only stop
+ *        it. The caller holds the lock that guards error.
+ *
+ * @param failed Set with a release store, so that workers polling it
+ *        without the lock see the message once they see the flag.
+ */
+void file_io_first_error(bool *failed, char *error, size_t error_size, const char *format, va_list args) {
+    if (!*failed) {
+        vsnprintf(error, error_size, format, args);
+        __atomic_store_n(failed, true, __ATOMIC_RELEASE);
+    }
+}
@@ -0,0 +1,221 @@
+#include "game_filter.h"
+
+#include <ctype.h>
+#include <string.h>
+
+static const char *SPEED_NAMES[] = {"ultrabullet", "bullet", "blitz", "rapid", "classical", "correspondence"};
+
+void game_filter_init(Game_Filter *filter) {
+    memset(filter, 0, sizeof(*filter));
+}
+
+const char *game_filter_speed_name(int speed) {
+    return speed >= SPEED_ULTRABULLET && speed <= SPEED_CORRESPONDENCE ? SPEED_NAMES[speed] : "unknown";
+}
+
+bool game_filter_active(const Game_Filter *filter) {
+    return filter->min_elo > 0 || filter->max_elo > 0 || filter->speeds != 0 ||
+           filter->time_control_count > 0 || filter->terminations != 0 || filter->results != 0;
+}
+
+// Case-insensitive, with '-' and '_' matching a space: "time-forfeit"
+// names "Time forfeit"
+static bool option_equals(const char *option, size_t length, const char *name) {
+    if (strlen(name) != length) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        char c = option[i];
+        if (c == '-' || c == '_') {
+            c = ' ';
+        }
+        if (tolower((unsigned char)c) != tolower((unsigned char)name[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Calls add for each comma-separated item of list; false if any item fails
+static bool for_each_item(Game_Filter *filter, const char *list,
+                          bool (*add)(Game_Filter *filter, const char *item, size_t length)) {
+    const char *p = list;
+    for (;;) {
+        const char *comma = strchr(p, ',');
+        size_t length = comma ? (size_t)(comma - p) : strlen(p);
+        if (length == 0 || !add(filter, p, length)) {
+            return false;
+        }
+        if (comma == NULL) {
+            return true;
+        }
+        p = comma + 1;
+    }
+}
+
+static bool add_time_control(Game_Filter *filter, const char *item, size_t length) {
+    for (int s = SPEED_ULTRABULLET; s <= SPEED_CORRESPONDENCE; s++) {
+        if (option_equals(item, length, SPEED_NAMES[s])) {
+            filter->speeds |= 1u << s;
+            return true;
+        }
+    }
+    // Anything else is an exact TimeControl value such as "600+0"
+    for (size_t i = 0; i < length; i++) {
+        if (!isdigit((unsigned char)item[i]) && item[i] != '+' && item[i] != '-') {
+            return false;
+        }
+    }
+    if (length > 32 || filter->time_control_count == GAME_FILTER_MAX_TIME_CONTROLS) {
+        return false;
+    }
+    memcpy(filter->time_controls[filter->time_control_count], item, length);
+    filter->time_controls[filter->time_control_count][length] = '\0';
+    filter->time_control_count++;
+    return true;
+}
+
+static bool add_termination(Game_Filter *filter, const char *item, size_t length) {
+    for (int t = NORMAL; t <= UNTERMINATED; t++) {
+        if (option_equals(item, length, get_termination_string((enum Termination)t))) {
+            filter->terminations |= 1u << t;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool add_result(Game_Filter *filter, const char *item, size_t length) {
+    enum GameResult result;
+    if (!get_game_result_from_string(item, length, &result)) {
+        return false;
+    }
+    filter->results |= 1u << result;
+    return true;
+}
+
+/**
+ * @brief Adds time controls from a comma-separated list.
+ *
+ * Items are speed categories ("bullet", "blitz", "rapid", ...) or exact
+ * TimeControl values ("600+0"); a game passes if it matches any of them.
+ *
+ * @return false on an item that is neither, or too many exact values.
+ */
+bool game_filter_add_time_controls(Game_Filter *filter, const char *list) {
+    return for_each_item(filter, list, add_time_control);
+}
+
+/**
+ * @brief Adds terminations from a comma-separated list, e.g. "normal,time-forfeit".
+ */
+bool game_filter_add_terminations(Game_Filter *filter, const char *list) {
+    return for_each_item(filter, list, add_termination);
+}
+
+/**
+ * @brief Adds results from a comma-separated list, e.g. "1-0,0-1".
+ */
+bool game_filter_add_results(Game_Filter *filter, const char *list) {
+    return for_each_item(filter, list, add_result);
+}
+
+// Digits of a tag value, -1 if missing or not a number ("?")
+static int tag_number(const PGN_Tag *tag) {
+    if (tag->value == NULL || tag->length == 0 || tag->length > 6) {
+        return -1;
+    }
+    int number = 0;
+    for (size_t i = 0; i < tag->length; i++) {
+        if (!isdigit((unsigned char)tag->value[i])) {
+            return -1;
+        }
+        number = number * 10 + (tag->value[i] - '0');
+    }
+    return number;
+}
+
+/**
+ * @brief Speed category of a TimeControl value.
+ *
+ * @return enum Time_Control_Speed, or -1 if the value does not parse.
+ */
+int game_filter_time_control_speed(const PGN_Tag *tag) {
+    if (tag->value == NULL) {
+        return -1;
+    }
+    if (tag->length == 1 && tag->value[0] == '-') {
+        return SPEED_CORRESPONDENCE;
+    }
+    const char *plus = memchr(tag->value, '+', tag->length);
+    if (plus == NULL) {
+        return -1;
+    }
+    PGN_Tag base = {tag->value, (size_t)(plus - tag->value)};
+    PGN_Tag increment = {plus + 1, tag->length - base.length - 1};
+    int base_seconds = tag_number(&base);
+    int increment_seconds = tag_number(&increment);
+    if (base_seconds < 0 || increment_seconds < 0) {
+        return -1;
+    }
+    int estimate = base_seconds + 40 * increment_seconds;
+    if (estimate < 30) return SPEED_ULTRABULLET;
+    if (estimate < 180) return SPEED_BULLET;
+    if (estimate < 480) return SPEED_BLITZ;
+    if (estimate < 1500) return SPEED_RAPID;
+    return SPEED_CLASSICAL;
+}
+
+static bool time_control_matches(const Game_Filter *filter, const PGN_Tag *tag) {
+    if (tag->value == NULL) {
+        return false;
+    }
+    for (int i = 0; i < filter->time_control_count; i++) {
+        if (strlen(filter->time_controls[i]) == tag->length &&
+            memcmp(filter->time_controls[i], tag->value, tag->length) == 0) {
+            return true;
+        }
+    }
+    int speed = game_filter_time_control_speed(tag);
+    return speed >= 0 && (filter->speeds & (1u << speed)) != 0;
+}
+
+/**
+ * @brief Decides from the header tags alone whether a game is wanted.
+ *
+ * Elo limits apply to both players; a game with a missing Elo, time
+ * control, termination or result fails any condition on that tag.
+ */
+bool game_filter_matches(const Game_Filter *filter, const PGN_Header_Tags *tags) {
+    if (filter->min_elo > 0 || filter->max_elo > 0) {
+        int white = tag_number(&tags->white_elo);
+        int black = tag_number(&tags->black_elo);
+        if (white < 0 || black < 0 || white < filter->min_elo || black < filter->min_elo) {
+            return false;
+        }
+        if (filter->max_elo > 0 && (white > filter->max_elo || black > filter->max_elo)) {
+            return false;
+        }
+    }
+    if ((filter->speeds != 0 || filter->time_control_count > 0) &&
+        !time_control_matches(filter, &tags->time_control)) {
+        return false;
+    }
+    if (filter->terminations != 0) {
+        enum Termination termination;
+        if (tags->termination.value == NULL ||
+            !get_termination_from_string(tags->termination.value, tags->termination.length, &termination) ||
+            (filter->terminations & (1u << termination)) == 0) {
+            return false;
+        }
+    }
+    if (filter->results != 0) {
+        enum GameResult result;
+        if (tags->result.value == NULL ||
+            !get_game_result_from_string(tags->result.value, tags->result.length, &result) ||
+            (filter->results & (1u << result)) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
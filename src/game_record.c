@@ -0,0 +1,439 @@
+#define _POSIX_C_SOURCE 200809L
+#include "game_record.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+#include "movegen.h"
+
+typedef char game_record_is_16_bytes[sizeof(Game_Record) == 16 ? 1 : -1];
+typedef char game_file_header_is_32_bytes[sizeof(Game_Record_File_Header) == 32 ? 1 : -1];
+
+// Bytes of a stored game: its record, start position and moves
+static size_t game_size(const Game_Record *record) {
+    return sizeof(Game_Record) + (record->flags & GAME_RECORD_CUSTOM_START ? sizeof(FEN_Record) : 0) +
+           (size_t)record->plies * sizeof(ChessMove);
+}
+
+static enum FEN_Plus_Replay_Status emit_move(void *context, const FEN_Plus_Replay *replay, ChessMove move) {
+    Text_Buffer *out = (Text_Buffer *)context;
+    if (replay->ply == GAME_RECORD_MAX_PLIES) {
+        return FEN_PLUS_REPLAY_REJECTED;
+    }
+    if (!text_buffer_reserve(out, sizeof(move))) {
+        return FEN_PLUS_REPLAY_FAILED;
+    }
+    memcpy(out->data + out->length, &move, sizeof(move));
+    out->length += sizeof(move);
+    return FEN_PLUS_REPLAY_OK;
+}
+
+/**
+ * @brief Resolves a game's moves and appends it to out as one stored game.
+ *
+ * The start position is stored only when it is not the standard one.
+ *
+ * @param time_control Id of the game's time control in the file's table.
+ * @return false only if out runs out of memory; games whose moves do not
+ *         resolve, or that run past GAME_RECORD_MAX_PLIES, are counted as
+ *         rejected and leave out unchanged.
+ */
+bool game_record_append_game(const PGN_Game *game, uint16_t time_control, Text_Buffer *out,
+                             FEN_Plus_Stats *stats) {
+    FEN_Plus_Replay replay;
+    if (!fen_plus_replay_start(&replay, game, stats)) {
+        return true;
+    }
+
+    Game_Record record;
+    memset(&record, 0, sizeof(record));
+    record.game = (uint32_t)game->index;
+    record.time_control = time_control;
+    for (int color = WHITE; color <= BLACK; color++) {
+        int elo = replay.info.elo[color];
+        record.elo[color] = (uint16_t)(elo > 0xFFFF ? 0xFFFF : elo);
+    }
+    FEN_Record start, standard;
+    Position standard_pos;
+    position_set_start(&standard_pos);
+    fen_record_from_position(&replay.pos, 0, 0, 0, 0, &start);
+    fen_record_from_position(&standard_pos, 0, 0, 0, 0, &standard);
+    if (memcmp(&start, &standard, sizeof(start)) != 0) {
+        record.flags |= GAME_RECORD_CUSTOM_START;
+    }
+
+    size_t game_start = out->length;
+    size_t header_size = sizeof(record) + (record.flags & GAME_RECORD_CUSTOM_START ? sizeof(start) : 0);
+    if (!text_buffer_reserve(out, header_size)) {
+        return false;
+    }
+    out->length += sizeof(record);
+    if (record.flags & GAME_RECORD_CUSTOM_START) {
+        memcpy(out->data + out->length, &start, sizeof(start));
+        out->length += sizeof(start);
+    }
+
+    enum FEN_Plus_Replay_Status status = fen_plus_replay_moves(&replay, NULL, stats, emit_move, out);
+    if (status != FEN_PLUS_REPLAY_OK) {
+        out->length = game_start;
+        return status != FEN_PLUS_REPLAY_FAILED;
+    }
+    record.plies = (uint16_t)replay.ply;
+    memcpy(out->data + game_start, &record, sizeof(record));
+    return true;
+}
+
+/**
+ * @brief Starts a game file: writes the header and resets index.
+ *
+ * @param level zstd level for the blocks, 0 for raw blocks.
+ */
+bool game_record_write_header(Output_Writer *writer, int level, Game_Record_Index *index) {
+    memset(index, 0, sizeof(*index));
+    Game_Record_File_Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GAME_RECORD_MAGIC, sizeof(header.magic));
+    header.version = GAME_RECORD_VERSION;
+    header.compression = level > 0 ? GAME_RECORD_COMPRESSION_ZSTD : GAME_RECORD_COMPRESSION_NONE;
+    index->offset = sizeof(header);
+    return output_writer_write(writer, (const char *)&header, sizeof(header));
+}
+
+/**
+ * @brief Records a block written at index->offset: stored_size bytes in the
+ *        file, holding the raw_size bytes of games.
+ *
+ * @param games The block's games before compression, walked to collect the
+ *        offset of each.
+ */
+bool game_record_add_block(Game_Record_Index *index, const char *games, size_t raw_size, size_t stored_size) {
+    if (index->count == index->capacity) {
+        size_t capacity = index->capacity ? index->capacity * 2 : 256;
+        Game_Record_Block_Entry *entries =
+            (Game_Record_Block_Entry *)realloc(index->entries, capacity * sizeof(Game_Record_Block_Entry));
+        if (entries == NULL) {
+            return false;
+        }
+        index->entries = entries;
+        index->capacity = capacity;
+    }
+    Game_Record_Block_Entry *entry = &index->entries[index->count];
+    entry->offset = index->offset;
+    entry->stored_size = (uint32_t)stored_size;
+    entry->raw_size = (uint32_t)raw_size;
+    entry->games = 0;
+    entry->plies = 0;
+    for (size_t at = 0; at < raw_size;) {
+        if (index->game_count == index->game_capacity) {
+            size_t capacity = index->game_capacity ? index->game_capacity * 2 : 4096;
+            uint32_t *offsets = (uint32_t *)realloc(index->game_offsets, capacity * sizeof(uint32_t));
+            if (offsets == NULL) {
+                index->game_count -= entry->games;
+                return false;
+            }
+            index->game_offsets = offsets;
+            index->game_capacity = capacity;
+        }
+        Game_Record record;
+        memcpy(&record, games + at, sizeof(record));
+        index->game_offsets[index->game_count++] = (uint32_t)at;
+        entry->games++;
+        entry->plies += record.plies;
+        at += game_size(&record);
+    }
+    index->count++;
+    index->offset += stored_size;
+    index->plies += entry->plies;
+    return true;
+}
+
+/**
+ * @brief Ends a game file with the block index, the game offsets, the
+ *        time-control table and the trailer.
+ */
+bool game_record_write_footer(Output_Writer *writer, const Game_Record_Index *index,
+                              const FEN_Record_Time_Controls *time_controls) {
+    Game_Record_Trailer trailer;
+    memset(&trailer, 0, sizeof(trailer));
+    uint64_t offset = index->offset;
+    bool ok = fen_record_write_padding(writer, &offset);
+    trailer.index_offset = offset;
+    size_t index_bytes = index->count * sizeof(Game_Record_Block_Entry);
+    size_t offset_bytes = index->game_count * sizeof(uint32_t);
+    ok = ok && output_writer_write(writer, (const char *)index->entries, index_bytes) &&
+         output_writer_write(writer, (const char *)index->game_offsets, offset_bytes);
+    offset += index_bytes + offset_bytes;
+    trailer.time_control_offset = offset;
+    ok = ok && output_writer_write(writer, time_controls->names.data, time_controls->names.length);
+    offset += time_controls->names.length;
+    ok = ok && fen_record_write_padding(writer, &offset);
+    trailer.games = index->game_count;
+    trailer.plies = index->plies;
+    trailer.blocks = (uint32_t)index->count;
+    trailer.time_controls = (uint32_t)time_controls->count;
+    memcpy(trailer.magic, GAME_RECORD_TRAILER_MAGIC, sizeof(trailer.magic));
+    return ok && output_writer_write(writer, (const char *)&trailer, sizeof(trailer));
+}
+
+void game_record_index_free(Game_Record_Index *index) {
+    free(index->entries);
+    free(index->game_offsets);
+    memset(index, 0, sizeof(*index));
+}
+
+struct Game_Record_File {
+    const uint8_t *map;
+    size_t size;
+    Game_Record_File_Header header;
+    Game_Record_Trailer trailer;
+    const Game_Record_Block_Entry *entries;
+    const uint32_t *game_offsets;
+    uint64_t *first_game;       // per block, for the binary search; blocks + 1 entries
+    const char **time_controls;
+    ZSTD_DCtx *dctx;
+    char *block;                // the last block decompressed, compressed files only
+    size_t block_capacity;
+    size_t block_index;         // SIZE_MAX if none
+};
+
+// Checks the block index and the game offsets against the file, so that
+// seeks need no bounds checks beyond a game's own size
+static bool validate(Game_Record_File *file) {
+    const Game_Record_File_Header *header = &file->header;
+    const Game_Record_Trailer *trailer = &file->trailer;
+    if (!fen_record_read_frame(file->map, file->size, &file->header, sizeof(file->header), GAME_RECORD_MAGIC,
+                               &file->trailer, sizeof(file->trailer), GAME_RECORD_TRAILER_MAGIC) ||
+        header->version != GAME_RECORD_VERSION || header->compression > GAME_RECORD_COMPRESSION_ZSTD) {
+        return false;
+    }
+    uint64_t footer_end = file->size - sizeof(*trailer);
+    if (trailer->index_offset % 8 != 0 || trailer->index_offset < sizeof(*header) ||
+        trailer->index_offset > footer_end ||
+        (footer_end - trailer->index_offset) / sizeof(Game_Record_Block_Entry) < trailer->blocks ||
+        (footer_end - trailer->index_offset - (uint64_t)trailer->blocks * sizeof(Game_Record_Block_Entry)) /
+                sizeof(uint32_t) < trailer->games ||
+        trailer->time_control_offset != trailer->index_offset +
+                                            (uint64_t)trailer->blocks * sizeof(Game_Record_Block_Entry) +
+                                            trailer->games * sizeof(uint32_t)) {
+        return false;
+    }
+    file->entries = (const Game_Record_Block_Entry *)(file->map + trailer->index_offset);
+    file->game_offsets = (const uint32_t *)(file->entries + trailer->blocks);
+
+    file->first_game = (uint64_t *)malloc(((size_t)trailer->blocks + 1) * sizeof(uint64_t));
+    if (file->first_game == NULL) {
+        return false;
+    }
+    uint64_t offset = sizeof(*header);
+    uint64_t games = 0, plies = 0;
+    for (uint32_t i = 0; i < trailer->blocks; i++) {
+        const Game_Record_Block_Entry *entry = &file->entries[i];
+        if (entry->offset != offset || entry->stored_size > trailer->index_offset - offset ||
+            (header->compression == GAME_RECORD_COMPRESSION_NONE && entry->stored_size != entry->raw_size) ||
+            entry->games > trailer->games - games) {
+            return false;
+        }
+        // Offsets rise within a block and leave room for a game record
+        for (uint32_t g = 0; g < entry->games; g++) {
+            uint32_t at = file->game_offsets[games + g];
+            if ((g == 0 ? at != 0 : at <= file->game_offsets[games + g - 1]) ||
+                (uint64_t)at + sizeof(Game_Record) > entry->raw_size) {
+                return false;
+            }
+        }
+        file->first_game[i] = games;
+        offset += entry->stored_size;
+        games += entry->games;
+        plies += entry->plies;
+    }
+    file->first_game[trailer->blocks] = games;
+    if (games != trailer->games || plies != trailer->plies || trailer->index_offset - offset >= 8) {
+        return false;
+    }
+
+    file->time_controls = fen_record_read_time_controls((const char *)file->map + trailer->time_control_offset,
+                                                        (const char *)file->map + footer_end,
+                                                        trailer->time_controls);
+    return file->time_controls != NULL;
+}
+
+/**
+ * @brief Opens a game file written by the pipeline.
+ *
+ * The file is mapped, so opening costs no reads beyond the footer.
+ *
+ * @return NULL if the file cannot be read or is not a valid game file.
+ */
+Game_Record_File *game_record_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    Game_Record_File *file = (Game_Record_File *)calloc(1, sizeof(Game_Record_File));
+    if (file == NULL || fstat(fd, &st) != 0 || st.st_size == 0) {
+        free(file);
+        close(fd);
+        return NULL;
+    }
+    file->size = (size_t)st.st_size;
+    file->block_index = SIZE_MAX;
+    void *map = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        free(file);
+        return NULL;
+    }
+    file->map = (const uint8_t *)map;
+    if (!validate(file)) {
+        game_record_close(file);
+        return NULL;
+    }
+    return file;
+}
+
+uint64_t game_record_count(const Game_Record_File *file) {
+    return file->trailer.games;
+}
+
+uint64_t game_record_plies(const Game_Record_File *file) {
+    return file->trailer.plies;
+}
+
+// The uncompressed bytes of a block: the mapping itself for raw files,
+// otherwise the block decompressed into file->block, kept for the next call
+static const char *block_data(Game_Record_File *file, size_t block) {
+    const Game_Record_Block_Entry *entry = &file->entries[block];
+    const char *stored = (const char *)file->map + entry->offset;
+    if (file->header.compression == GAME_RECORD_COMPRESSION_NONE) {
+        return stored;
+    }
+    if (file->block_index == block) {
+        return file->block;
+    }
+    if (file->dctx == NULL && (file->dctx = ZSTD_createDCtx()) == NULL) {
+        return NULL;
+    }
+    if (entry->raw_size > file->block_capacity) {
+        char *buffer = (char *)realloc(file->block, entry->raw_size);
+        if (buffer == NULL) {
+            return NULL;
+        }
+        file->block = buffer;
+        file->block_capacity = entry->raw_size;
+    }
+    file->block_index = SIZE_MAX;
+    size_t size = ZSTD_decompressDCtx(file->dctx, file->block, entry->raw_size, stored, entry->stored_size);
+    if (ZSTD_isError(size) || size != entry->raw_size) {
+        return NULL;
+    }
+    file->block_index = block;
+    return file->block;
+}
+
+/**
+ * @brief Points cursor at ply of game (0-based, in file order), replaying
+ *        that game's first ply moves and nothing else.
+ *
+ * The cursor reads the moves in place: for compressed files it stays valid
+ * until a seek lands in another block. Seeking games in order decompresses
+ * every block once.
+ *
+ * @return false if game or ply is out of range, or the block is corrupt;
+ *         cursor->corrupt tells a stored move that is not legal where it
+ *         is played.
+ */
+bool game_record_seek(Game_Record_File *file, uint64_t game, uint32_t ply, Game_Record_Cursor *cursor) {
+    if (game >= file->trailer.games) {
+        return false;
+    }
+    // Last block starting at or before the game
+    size_t low = 0, high = file->trailer.blocks;
+    while (high - low > 1) {
+        size_t mid = (low + high) / 2;
+        if (file->first_game[mid] <= game) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    const char *data = block_data(file, low);
+    if (data == NULL) {
+        return false;
+    }
+    uint32_t raw_size = file->entries[low].raw_size;
+    uint32_t at = file->game_offsets[game];
+    memcpy(&cursor->info, data + at, sizeof(cursor->info));
+    if (ply > cursor->info.plies || game_size(&cursor->info) > raw_size - at) {
+        return false;
+    }
+    const char *p = data + at + sizeof(Game_Record);
+    if (cursor->info.flags & GAME_RECORD_CUSTOM_START) {
+        FEN_Record start;
+        memcpy(&start, p, sizeof(start));
+        if (!fen_record_to_position(&start, &cursor->pos)) {
+            return false;
+        }
+        p += sizeof(start);
+    } else {
+        position_set_start(&cursor->pos);
+    }
+    cursor->moves = (const ChessMove *)p;
+    cursor->corrupt = false;
+    for (cursor->ply = 0; cursor->ply < ply; cursor->ply++) {
+        ChessMove move = cursor->moves[cursor->ply];
+        if (!position_is_legal_move(&cursor->pos, move)) {
+            cursor->corrupt = true;
+            return false;
+        }
+        position_make_move(&cursor->pos, move);
+    }
+    return true;
+}
+
+/**
+ * @brief Fills record with the row of the cursor's ply, as a record file
+ *        holds it, and advances to the next ply.
+ *
+ * @return false once every ply of the game has been returned, or with
+ *         cursor->corrupt set if the next stored move is not legal.
+ */
+bool game_record_next(Game_Record_Cursor *cursor, FEN_Record *record) {
+    if (cursor->ply >= cursor->info.plies) {
+        return false;
+    }
+    ChessMove move = cursor->moves[cursor->ply];
+    if (!position_is_legal_move(&cursor->pos, move)) {
+        cursor->corrupt = true;
+        return false;
+    }
+    cursor->ply++;
+    fen_record_from_position(&cursor->pos, move, cursor->info.elo[cursor->pos.side_to_move],
+                             cursor->info.time_control, cursor->info.game, record);
+    position_make_move(&cursor->pos, move);
+    return true;
+}
+
+const char *game_record_file_time_control(const Game_Record_File *file, uint16_t id, size_t *length_out) {
+    if (id >= file->trailer.time_controls) {
+        return NULL;
+    }
+    *length_out = (uint8_t)file->time_controls[id][0];
+    return file->time_controls[id] + 1;
+}
+
+void game_record_close(Game_Record_File *file) {
+    if (file == NULL) {
+        return;
+    }
+    munmap((void *)file->map, file->size);
+    free(file->first_game);
+    free(file->time_controls);
+    free(file->block);
+    ZSTD_freeDCtx(file->dctx);
+    free(file);
+}
@@ -0,0 +1,257 @@
+#include "movegen.h"
+#include "attacks.h"
+
+static inline void add_move(Move_List *list, int from, int to, int flags) {
+    list->moves[list->count++] = move_encode(from, to, flags);
+}
+
+static void add_pawn_moves(Move_List *list, int from, Bitboard targets, Bitboard enemies, int promotion_rank) {
+    while (targets) {
+        int to = bitboard_pop_lsb(&targets);
+        bool capture = (enemies & square_bit(to)) != 0;
+        if (SQUARE_RANK(to) == promotion_rank) {
+            int flags = capture ? MOVE_PROMOTION_CAPTURE : MOVE_PROMOTION;
+            for (int type = QUEEN; type >= KNIGHT; type--) {
+                add_move(list, from, to, flags + (type - KNIGHT));
+            }
+        } else if (to - from == 16 || from - to == 16) {
+            add_move(list, from, to, MOVE_DOUBLE_PUSH);
+        } else {
+            add_move(list, from, to, capture ? MOVE_CAPTURE : MOVE_QUIET);
+        }
+    }
+}
+
+static void add_piece_moves(Move_List *list, int from, Bitboard targets, Bitboard enemies) {
+    while (targets) {
+        int to = bitboard_pop_lsb(&targets);
+        add_move(list, from, to, (enemies & square_bit(to)) ? MOVE_CAPTURE : MOVE_QUIET);
+    }
+}
+
+// Pieces of the side to move that shield their king from an enemy slider
+static Bitboard pinned_pieces(const Position *pos, int king) {
+    int us = pos->side_to_move;
+    int them = us ^ 1;
+    const Bitboard *p = pos->pieces;
+    Bitboard occupied = position_occupied(pos);
+    Bitboard queens = p[MAKE_PIECE(them, QUEEN)];
+    Bitboard snipers = (rook_attacks(king, pos->occupancy[them]) & (p[MAKE_PIECE(them, ROOK)] | queens)) |
+                       (bishop_attacks(king, pos->occupancy[them]) & (p[MAKE_PIECE(them, BISHOP)] | queens));
+    Bitboard pinned = 0;
+    while (snipers) {
+        Bitboard blockers = BETWEEN_BB[king][bitboard_pop_lsb(&snipers)] & occupied;
+        if (blockers && !(blockers & (blockers - 1))) {
+            pinned |= blockers & pos->occupancy[us];
+        }
+    }
+    return pinned;
+}
+
+static void add_castling(const Position *pos, Move_List *list, int king) {
+    int us = pos->side_to_move;
+    int them = us ^ 1;
+    Bitboard occupied = position_occupied(pos);
+    Bitboard rooks = pos->pieces[MAKE_PIECE(us, ROOK)];
+    int king_side = us == WHITE ? CASTLE_WHITE_KING : CASTLE_BLACK_KING;
+    int queen_side = us == WHITE ? CASTLE_WHITE_QUEEN : CASTLE_BLACK_QUEEN;
+    if (king != (us == WHITE ? SQUARE(4, 0) : SQUARE(4, 7))) {
+        return;
+    }
+
+    if ((pos->castling & king_side) && (rooks & square_bit(king + 3)) &&
+        !(occupied & (square_bit(king + 1) | square_bit(king + 2))) &&
+        !position_square_attacked(pos, king + 1, them) && !position_square_attacked(pos, king + 2, them)) {
+        add_move(list, king, king + 2, MOVE_KING_CASTLE);
+    }
+    if ((pos->castling & queen_side) && (rooks & square_bit(king - 4)) &&
+        !(occupied & (square_bit(king - 1) | square_bit(king - 2) | square_bit(king - 3))) &&
+        !position_square_attacked(pos, king - 1, them) && !position_square_attacked(pos, king - 2, them)) {
+        add_move(list, king, king - 2, MOVE_QUEEN_CASTLE);
+    }
+}
+
+/**
+ * @brief Fills list with every legal move of the side to move.
+ *
+ * Moves are legal by construction: check evasions are limited to capturing
+ * or blocking the checker, pinned pieces stay on the line to their king and
+ * king moves avoid attacked squares. Only en passant, where two pieces
+ * leave the same rank, is tested by playing it out on occupancy masks.
+ *
+ * @return Number of moves, also stored in list->count.
+ */
+int generate_legal_moves(const Position *pos, Move_List *list) {
+    int us = pos->side_to_move;
+    int them = us ^ 1;
+    const Bitboard *p = pos->pieces;
+    Bitboard own = pos->occupancy[us];
+    Bitboard enemies = pos->occupancy[them];
+    Bitboard occupied = own | enemies;
+    int king = bitboard_lsb(p[MAKE_PIECE(us, KING)]);
+    list->count = 0;
+
+    // The king may not step onto an attacked square, nor stay on the line
+    // of a slider it is moving away from, hence the occupancy without it
+    Bitboard without_king = occupied ^ square_bit(king);
+    Bitboard king_targets = KING_ATTACKS[king] & ~own;
+    while (king_targets) {
+        int to = bitboard_pop_lsb(&king_targets);
+        if (!(attackers_to(pos, to, without_king) & enemies)) {
+            add_move(list, king, to, (enemies & square_bit(to)) ? MOVE_CAPTURE : MOVE_QUIET);
+        }
+    }
+
+    Bitboard checkers = attackers_to(pos, king, occupied) & enemies;
+    if (checkers & (checkers - 1)) {
+        return list->count;  // double check: only the king can move
+    }
+    // Squares a non-king move must land on: anywhere, or onto the checker
+    // or between it and the king
+    Bitboard evasions = ~(Bitboard)0;
+    if (checkers) {
+        evasions = checkers | BETWEEN_BB[king][bitboard_lsb(checkers)];
+    } else {
+        add_castling(pos, list, king);
+    }
+    Bitboard pinned = pinned_pieces(pos, king);
+
+    // Pawns
+    int forward = us == WHITE ? 8 : -8;
+    int promotion_rank = us == WHITE ? 7 : 0;
+    Bitboard start_rank = us == WHITE ? RANK_1_BB << 8 : RANK_1_BB << 48;
+    Bitboard pawns = p[MAKE_PIECE(us, PAWN)];
+    while (pawns) {
+        int from = bitboard_pop_lsb(&pawns);
+        Bitboard targets = PAWN_ATTACKS[us][from] & enemies;
+        Bitboard push = square_bit(from + forward) & ~occupied;
+        targets |= push;
+        if (push && (square_bit(from) & start_rank)) {
+            targets |= square_bit(from + 2 * forward) & ~occupied;
+        }
+        targets &= evasions;
+        if (pinned & square_bit(from)) {
+            targets &= LINE_BB[king][from];
+        }
+        add_pawn_moves(list, from, targets, enemies, promotion_rank);
+
+        if (pos->en_passant != NO_SQUARE && (PAWN_ATTACKS[us][from] & square_bit(pos->en_passant))) {
+            ChessMove move = move_encode(from, pos->en_passant, MOVE_EN_PASSANT);
+            if (position_leaves_king_safe(pos, move)) {
+                list->moves[list->count++] = move;
+            }
+        }
+    }
+
+    // Knights, bishops, rooks and queens. A pinned knight can never stay on
+    // its line, which the LINE_BB mask takes care of.
+    for (int type = KNIGHT; type <= QUEEN; type++) {
+        Bitboard pieces = p[MAKE_PIECE(us, type)];
+        while (pieces) {
+            int from = bitboard_pop_lsb(&pieces);
+            Bitboard targets = piece_attacks(type, from, occupied) & ~own & evasions;
+            if (pinned & square_bit(from)) {
+                targets &= LINE_BB[king][from];
+            }
+            add_piece_moves(list, from, targets, enemies);
+        }
+    }
+    return list->count;
+}
+
+/**
+ * @brief Tells whether move, with the flags make_move expects, is one of the
+ *        legal moves of the position.
+ *
+ * Answers the way a search of generate_legal_moves would, without building
+ * the list: the piece must reach the target by its own rules, the flags
+ * must be the ones the generator gives, and the king must be safe after it.
+ * Only castling, which is rare, goes through the generator's own rules.
+ */
+bool position_is_legal_move(const Position *pos, ChessMove move) {
+    int us = pos->side_to_move;
+    int from = move_from(move);
+    int to = move_to(move);
+    int flags = move_flags(move);
+    Bitboard to_bit = square_bit(to);
+    Bitboard occupied = position_occupied(pos);
+    int piece = position_piece_at(pos, from);
+    if (piece == NO_PIECE || PIECE_COLOR(piece) != us || (pos->occupancy[us] & to_bit) ||
+        !pos->pieces[MAKE_PIECE(us, KING)]) {
+        return false;
+    }
+    int type = PIECE_TYPE(piece);
+
+    if (flags == MOVE_KING_CASTLE || flags == MOVE_QUEEN_CASTLE) {
+        if (type != KING || position_in_check(pos)) {
+            return false;
+        }
+        Move_List list;
+        list.count = 0;
+        add_castling(pos, &list, from);
+        for (int i = 0; i < list.count; i++) {
+            if (list.moves[i] == move) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool capture = (pos->occupancy[us ^ 1] & to_bit) != 0;
+    int expected = capture ? MOVE_CAPTURE : MOVE_QUIET;
+    if (type == PAWN) {
+        int forward = us == WHITE ? 8 : -8;
+        Bitboard start_rank = us == WHITE ? RANK_1_BB << 8 : RANK_1_BB << 48;
+        if (PAWN_ATTACKS[us][from] & to_bit) {
+            if (flags == MOVE_EN_PASSANT) {
+                expected = to == pos->en_passant ? MOVE_EN_PASSANT : -1;
+            } else if (!capture) {
+                return false;
+            }
+        } else if (to == from + forward) {
+            if (capture) {
+                return false;
+            }
+        } else if (to == from + 2 * forward && (square_bit(from) & start_rank)) {
+            if (occupied & (to_bit | square_bit(from + forward))) {
+                return false;
+            }
+            expected = MOVE_DOUBLE_PUSH;
+        } else {
+            return false;
+        }
+        if (expected != MOVE_EN_PASSANT && SQUARE_RANK(to) == (us == WHITE ? 7 : 0)) {
+            // Any of the four promotion pieces
+            expected = capture ? MOVE_PROMOTION_CAPTURE : MOVE_PROMOTION;
+            flags &= ~3;
+        }
+    } else if (!(piece_attacks(type, from, occupied) & to_bit)) {
+        return false;
+    }
+    return flags == expected && position_leaves_king_safe(pos, move);
+}
+
+/**
+ * @brief Counts the leaf nodes of the legal move tree to the given depth.
+ *
+ * The last ply is counted from the move list without being played (bulk
+ * counting), so the result is exact but the nodes per second it implies
+ * are those of the generator rather than of make_move.
+ */
+uint64_t perft(const Position *pos, int depth) {
+    if (depth <= 0) {
+        return 1;
+    }
+    Move_List list;
+    generate_legal_moves(pos, &list);
+    if (depth == 1) {
+        return (uint64_t)list.count;
+    }
+    uint64_t nodes = 0;
+    for (int i = 0; i < list.count; i++) {
+        Position child = *pos;
+        position_make_move(&child, list.moves[i]);
+        nodes += perft(&child, depth - 1);
+    }
+    return nodes;
+}
@@ -0,0 +1,852 @@
+#define _POSIX_C_SOURCE 200809L
+#include "opening_book.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "file_io.h"
+#include "game_filter.h"
+#include "radix_sort.h"
+
+typedef char opening_book_entry_is_16_bytes[sizeof(Opening_Book_Entry) == 16 ? 1 : -1];
+typedef char opening_book_move_is_8_bytes[sizeof(Opening_Book_Move) == 8 ? 1 : -1];
+typedef char opening_book_header_is_32_bytes[sizeof(Opening_Book_File_Header) == 32 ? 1 : -1];
+typedef char opening_book_trailer_is_64_bytes[sizeof(Opening_Book_Trailer) == 64 ? 1 : -1];
+
+// Smallest map, whatever the memory: 16 KB per worker
+#define MIN_MAP_SLOTS 1024
+// Key ranges merged per merge thread, so that one slow range does not hold up the rest
+#define PARTITIONS_PER_THREAD 4
+#define MAX_PARTITION_BITS 12
+#define COPY_BYTES (1u << 20)
+
+// A sorted run in a worker's run file, in entries
+typedef struct {
+    uint64_t offset;
+    uint64_t count;
+} Book_Run;
+
+// One worker's map, the plies of the game it is counting and its runs
+typedef struct {
+    Opening_Book_Entry *slots;
+    size_t mask;
+    int shift;                  // 64 - log2(slots)
+    size_t used;
+    size_t limit;               // spill once this many slots are taken
+    Opening_Book_Entry *plies;  // the current game, counted once all its moves resolve
+    size_t ply_capacity;
+    int fd;                     // run file, -1 until the first spill
+    uint64_t entries;           // in the run file
+    Book_Run *runs;
+    size_t run_count;
+    size_t run_capacity;
+    const Opening_Book_Entry *map;  // the run file, mapped for the merge
+    double spill_seconds;
+} Book_Worker;
+
+// A merged key range, held in two files until the book is assembled
+typedef struct {
+    int positions_fd;
+    int moves_fd;
+    uint64_t positions;
+    uint64_t moves;
+    uint64_t total_count;
+    uint64_t pruned;
+} Book_Part;
+
+typedef struct {
+    const Opening_Book_Entry *at;
+    const Opening_Book_Entry *end;
+} Run_Cursor;
+
+// State of one merge thread
+typedef struct {
+    Run_Cursor *heap;
+    Opening_Book_Move *moves;   // of the position being merged
+    size_t move_count;
+    size_t move_capacity;
+    uint64_t position_total;
+    Output_Writer positions;
+    Output_Writer move_writer;
+} Merger;
+
+struct Opening_Book_Builder {
+    Opening_Book_Options options;
+    int workers;
+    Book_Worker *w;
+    size_t total_runs;
+    int partition_bits;
+    size_t partition_count;
+    Book_Part *parts;
+    size_t next_task;           // claimed atomically by the finishing threads
+    size_t task_count;
+    bool (*task)(Opening_Book_Builder *b, Merger *m, size_t task);
+    pthread_mutex_t lock;
+    bool failed;
+    char error[256];
+};
+
+struct Opening_Book {
+    const uint8_t *map;
+    size_t size;
+    Opening_Book_File_Header header;
+    Opening_Book_Trailer trailer;
+    const Opening_Book_Position *positions;
+    const Opening_Book_Move *moves;
+    const uint64_t *index;
+};
+
+// The message opening_book_builder_error returns
+static void fail(Opening_Book_Builder *b, const char *format, ...) {
+    pthread_mutex_lock(&b->lock);
+    va_list args;
+    va_start(args, format);
+    file_io_first_error(&b->failed, b->error, sizeof(b->error), format, args);
+    va_end(args);
+    pthread_mutex_unlock(&b->lock);
+}
+
+static bool failed(Opening_Book_Builder *b) {
+    return __atomic_load_n(&b->failed, __ATOMIC_ACQUIRE);
+}
+
+static int open_temp(Opening_Book_Builder *b) {
+    int fd = file_io_open_temp(b->options.temp_dir, "book");
+    if (fd < 0) {
+        fail(b, "cannot create a temporary file in %s: %s", b->options.temp_dir, strerror(errno));
+    }
+    return fd;
+}
+
+// Order within a key: move, then band, then speed
+static inline uint32_t entry_tail(const Opening_Book_Entry *entry) {
+    return (uint32_t)entry->move << 16 | (uint32_t)entry->elo_band << 8 | entry->speed;
+}
+
+static inline bool entry_before(const Opening_Book_Entry *a, const Opening_Book_Entry *b) {
+    return a->key < b->key || (a->key == b->key && entry_tail(a) < entry_tail(b));
+}
+
+// Zobrist keys are uniform, so the radix levels cut the ranges evenly; what
+// is left once the key is used up is one position's moves
+RADIX_SORT_DEFINE(sort_entries, Opening_Book_Entry, entry_before)
+
+void opening_book_default_options(Opening_Book_Options *options) {
+    options->memory = OPENING_BOOK_DEFAULT_MEMORY;
+    options->elo_band = OPENING_BOOK_DEFAULT_ELO_BAND;
+    options->min_count = 1;
+    options->temp_dir = NULL;
+}
+
+/**
+ * @brief Band of an Elo rating: elo / band_width, at most 254.
+ *
+ * @return OPENING_BOOK_UNKNOWN for a missing rating (0).
+ */
+int opening_book_elo_band(uint32_t band_width, int elo) {
+    if (elo <= 0 || band_width == 0) {
+        return OPENING_BOOK_UNKNOWN;
+    }
+    uint32_t band = (uint32_t)elo / band_width;
+    return band < OPENING_BOOK_UNKNOWN ? (int)band : OPENING_BOOK_UNKNOWN - 1;
+}
+
+/**
+ * @brief Sets up one map per worker, each a power-of-two share of
+ *        options->memory.
+ *
+ * @return NULL with error set if the options are unusable or memory runs out.
+ */
+Opening_Book_Builder *opening_book_builder_create(const Opening_Book_Options *options, int workers,
+                                                  char *error, size_t error_size) {
+    if (options->elo_band == 0) {
+        snprintf(error, error_size, "the Elo band width must be at least 1");
+        return NULL;
+    }
+    Opening_Book_Builder *b = (Opening_Book_Builder *)calloc(1, sizeof(Opening_Book_Builder));
+    if (b == NULL) {
+        snprintf(error, error_size, "out of memory");
+        return NULL;
+    }
+    b->options = *options;
+    if (b->options.temp_dir == NULL) {
+        const char *tmp = getenv("TMPDIR");
+        b->options.temp_dir = tmp != NULL && tmp[0] != '\0' ? tmp : "/tmp";
+    }
+    pthread_mutex_init(&b->lock, NULL);
+    b->workers = workers > 0 ? workers : 1;
+    b->w = (Book_Worker *)calloc((size_t)b->workers, sizeof(Book_Worker));
+    size_t slots = MIN_MAP_SLOTS;
+    while (slots * 2 * sizeof(Opening_Book_Entry) <= options->memory / (size_t)b->workers) {
+        slots *= 2;
+    }
+    int bits = __builtin_ctzll(slots);
+    bool ok = b->w != NULL;
+    for (int i = 0; ok && i < b->workers; i++) {
+        Book_Worker *w = &b->w[i];
+        w->fd = -1;
+        w->slots = (Opening_Book_Entry *)calloc(slots, sizeof(Opening_Book_Entry));
+        w->mask = slots - 1;
+        w->shift = 64 - bits;
+        // Linear probing stays short below three quarters full
+        w->limit = slots / 4 * 3;
+        ok = w->slots != NULL;
+    }
+    if (!ok) {
+        opening_book_builder_free(b);
+        snprintf(error, error_size, "out of memory");
+        return NULL;
+    }
+    return b;
+}
+
+// Sorts the map into a run at the end of the worker's run file, emptying it
+// for more counts if reuse is set
+static bool spill(Opening_Book_Builder *b, Book_Worker *w, bool reuse) {
+    double start = file_io_seconds();
+    size_t count = 0;
+    for (size_t i = 0; i <= w->mask; i++) {
+        if (w->slots[i].count > 0) {
+            w->slots[count++] = w->slots[i];
+        }
+    }
+    if (count == 0) {
+        return true;
+    }
+    sort_entries(w->slots, count, 56);
+    if (w->run_count == w->run_capacity) {
+        size_t capacity = w->run_capacity ? w->run_capacity * 2 : 16;
+        Book_Run *runs = (Book_Run *)realloc(w->runs, capacity * sizeof(Book_Run));
+        if (runs == NULL) {
+            fail(b, "out of memory");
+            return false;
+        }
+        w->runs = runs;
+        w->run_capacity = capacity;
+    }
+    if (w->fd < 0 && (w->fd = open_temp(b)) < 0) {
+        return false;
+    }
+    if (!file_io_write_at(w->fd, w->slots, count * sizeof(Opening_Book_Entry), w->entries * sizeof(Opening_Book_Entry))) {
+        fail(b, "cannot write a run file in %s: %s", b->options.temp_dir, strerror(errno));
+        return false;
+    }
+    w->runs[w->run_count].offset = w->entries;
+    w->runs[w->run_count].count = count;
+    w->run_count++;
+    w->entries += count;
+    if (reuse) {
+        memset(w->slots, 0, (w->mask + 1) * sizeof(Opening_Book_Entry));
+        w->used = 0;
+    }
+    w->spill_seconds += file_io_seconds() - start;
+    return true;
+}
+
+static bool count_entry(Opening_Book_Builder *b, Book_Worker *w, const Opening_Book_Entry *entry) {
+    uint32_t tail = entry_tail(entry);
+    size_t slot = (size_t)((entry->key ^ (uint64_t)tail * 0x9E3779B97F4A7C15ULL) >> w->shift);
+    for (;;) {
+        Opening_Book_Entry *s = &w->slots[slot];
+        if (s->count == 0) {
+            *s = *entry;
+            return ++w->used < w->limit || spill(b, w, true);
+        }
+        if (s->key == entry->key && entry_tail(s) == tail) {
+            s->count += s->count < UINT32_MAX;
+            return true;
+        }
+        slot = (slot + 1) & w->mask;
+    }
+}
+
+// The game being counted, for emit_ply
+typedef struct {
+    Opening_Book_Builder *b;
+    Book_Worker *w;
+    uint8_t bands[2];           // by color
+    uint8_t speed;
+} Book_Game;
+
+static enum FEN_Plus_Replay_Status emit_ply(void *context, const FEN_Plus_Replay *replay, ChessMove move) {
+    Book_Game *g = (Book_Game *)context;
+    Book_Worker *w = g->w;
+    if (replay->ply == w->ply_capacity) {
+        size_t capacity = w->ply_capacity ? w->ply_capacity * 2 : 256;
+        Opening_Book_Entry *grown = (Opening_Book_Entry *)realloc(w->plies, capacity * sizeof(Opening_Book_Entry));
+        if (grown == NULL) {
+            fail(g->b, "out of memory");
+            return FEN_PLUS_REPLAY_FAILED;
+        }
+        w->plies = grown;
+        w->ply_capacity = capacity;
+    }
+    Opening_Book_Entry *ply = &w->plies[replay->ply];
+    ply->key = replay->pos.key;
+    ply->move = move;
+    ply->elo_band = g->bands[replay->pos.side_to_move];
+    ply->speed = g->speed;
+    ply->count = 1;
+    return FEN_PLUS_REPLAY_OK;
+}
+
+/**
+ * @brief Counts every move of a game in the map of worker, which only that
+ *        worker's thread may use.
+ *
+ * Moves are counted under the mover's Elo band and the game's speed. A game
+ * with a move that does not resolve counts as rejected and adds nothing.
+ *
+ * @return false if a spill failed or memory ran out; see
+ *         opening_book_builder_error.
+ */
+bool opening_book_add_game(Opening_Book_Builder *b, int worker, const PGN_Game *game, FEN_Plus_Stats *stats) {
+    // A map whose spill failed stays full; nothing more goes in
+    if (failed(b)) {
+        return false;
+    }
+    FEN_Plus_Replay replay;
+    if (!fen_plus_replay_start(&replay, game, stats)) {
+        return true;
+    }
+    Book_Game g;
+    g.b = b;
+    g.w = &b->w[worker];
+    PGN_Tag time_control = {replay.info.time_control, replay.info.time_control_len};
+    int speed = game_filter_time_control_speed(&time_control);
+    g.speed = speed >= 0 ? (uint8_t)speed : OPENING_BOOK_UNKNOWN;
+    for (int color = WHITE; color <= BLACK; color++) {
+        g.bands[color] = (uint8_t)opening_book_elo_band(b->options.elo_band, replay.info.elo[color]);
+    }
+    enum FEN_Plus_Replay_Status status = fen_plus_replay_moves(&replay, NULL, stats, emit_ply, &g);
+    if (status != FEN_PLUS_REPLAY_OK) {
+        return status != FEN_PLUS_REPLAY_FAILED;
+    }
+    // Only games whose every move resolved are counted
+    for (size_t i = 0; i < replay.ply; i++) {
+        if (!count_entry(b, g.w, &g.w->plies[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief The first error of a failed opening_book_add_game or
+ *        opening_book_finish, NULL if there was none.
+ */
+const char *opening_book_builder_error(Opening_Book_Builder *b) {
+    return failed(b) ? b->error : NULL;
+}
+
+// First entry of [begin, end) whose key is at least key
+static const Opening_Book_Entry *lower_bound(const Opening_Book_Entry *begin, const Opening_Book_Entry *end,
+                                             uint64_t key) {
+    size_t count = (size_t)(end - begin);
+    while (count > 0) {
+        size_t half = count / 2;
+        if (begin[half].key < key) {
+            begin += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    return begin;
+}
+
+static void sift_down(Run_Cursor *heap, size_t size, size_t i) {
+    Run_Cursor item = heap[i];
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && entry_before(heap[child + 1].at, heap[child].at)) {
+            child++;
+        }
+        if (!entry_before(heap[child].at, item.at)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = item;
+}
+
+// Writes the merged position unless it falls below min_count
+static bool emit_position(Opening_Book_Builder *b, Merger *m, Book_Part *part, uint64_t key) {
+    bool ok = true;
+    if (m->position_total < b->options.min_count) {
+        part->pruned++;
+    } else {
+        Opening_Book_Position position = {key, part->moves};
+        ok = output_writer_write(&m->positions, (const char *)&position, sizeof(position)) &&
+             output_writer_write(&m->move_writer, (const char *)m->moves, m->move_count * sizeof(Opening_Book_Move));
+        part->positions++;
+        part->moves += m->move_count;
+        part->total_count += m->position_total;
+    }
+    m->move_count = 0;
+    m->position_total = 0;
+    return ok;
+}
+
+// Merges the entries of every run whose keys have the partition's top bits
+static bool merge_partition(Opening_Book_Builder *b, Merger *m, size_t partition) {
+    Book_Part *part = &b->parts[partition];
+    int shift = 64 - b->partition_bits;
+    uint64_t low = (uint64_t)partition << shift;
+    bool last = partition + 1 == b->partition_count;
+    uint64_t high = last ? 0 : low + ((uint64_t)1 << shift);
+    size_t heap_size = 0;
+    for (int i = 0; i < b->workers; i++) {
+        const Book_Worker *w = &b->w[i];
+        for (size_t r = 0; r < w->run_count; r++) {
+            const Opening_Book_Entry *begin = w->map + w->runs[r].offset;
+            const Opening_Book_Entry *end = begin + w->runs[r].count;
+            const Opening_Book_Entry *from = lower_bound(begin, end, low);
+            const Opening_Book_Entry *to = last ? end : lower_bound(from, end, high);
+            if (from < to) {
+                m->heap[heap_size].at = from;
+                m->heap[heap_size].end = to;
+                heap_size++;
+            }
+        }
+    }
+    for (size_t i = heap_size / 2; i-- > 0;) {
+        sift_down(m->heap, heap_size, i);
+    }
+
+    if ((part->positions_fd = open_temp(b)) < 0 || (part->moves_fd = open_temp(b)) < 0) {
+        return false;
+    }
+    if (!output_writer_init(&m->positions, part->positions_fd) ||
+        !output_writer_init(&m->move_writer, part->moves_fd)) {
+        output_writer_free(&m->positions);
+        fail(b, "out of memory");
+        return false;
+    }
+    bool ok = true;
+    uint64_t key = 0;
+    m->move_count = 0;
+    m->position_total = 0;
+    while (heap_size > 0 && ok) {
+        const Opening_Book_Entry *entry = m->heap[0].at;
+        if (m->move_count > 0 && entry->key != key) {
+            ok = emit_position(b, m, part, key);
+        }
+        key = entry->key;
+        Opening_Book_Move *previous = m->move_count > 0 ? &m->moves[m->move_count - 1] : NULL;
+        if (previous != NULL && previous->move == entry->move && previous->elo_band == entry->elo_band &&
+            previous->speed == entry->speed) {
+            previous->count = entry->count > UINT32_MAX - previous->count ? UINT32_MAX
+                                                                           : previous->count + entry->count;
+        } else {
+            if (m->move_count == m->move_capacity) {
+                size_t capacity = m->move_capacity ? m->move_capacity * 2 : 256;
+                Opening_Book_Move *moves = (Opening_Book_Move *)realloc(m->moves, capacity * sizeof(Opening_Book_Move));
+                if (moves == NULL) {
+                    fail(b, "out of memory");
+                    ok = false;
+                    break;
+                }
+                m->moves = moves;
+                m->move_capacity = capacity;
+            }
+            Opening_Book_Move *move = &m->moves[m->move_count++];
+            move->move = entry->move;
+            move->elo_band = entry->elo_band;
+            move->speed = entry->speed;
+            move->count = entry->count;
+        }
+        m->position_total += entry->count;
+        if (++m->heap[0].at == m->heap[0].end) {
+            m->heap[0] = m->heap[--heap_size];
+        }
+        sift_down(m->heap, heap_size, 0);
+    }
+    if (ok && m->move_count > 0) {
+        ok = emit_position(b, m, part, key);
+    }
+    if (!ok || !output_writer_flush(&m->positions) || !output_writer_flush(&m->move_writer)) {
+        int error = m->positions.error ? m->positions.error : m->move_writer.error;
+        fail(b, "cannot write a merged range to %s: %s", b->options.temp_dir, strerror(error ? error : ENOMEM));
+        ok = false;
+    }
+    output_writer_free(&m->positions);
+    output_writer_free(&m->move_writer);
+    return ok;
+}
+
+static bool spill_worker(Opening_Book_Builder *b, Merger *m, size_t worker) {
+    (void)m;
+    Book_Worker *w = &b->w[worker];
+    if (!spill(b, w, false)) {
+        return false;
+    }
+    free(w->slots);
+    w->slots = NULL;
+    return true;
+}
+
+static void *finish_main(void *arg) {
+    Opening_Book_Builder *b = (Opening_Book_Builder *)arg;
+    Merger m;
+    memset(&m, 0, sizeof(m));
+    m.heap = (Run_Cursor *)malloc((b->total_runs + 1) * sizeof(Run_Cursor));
+    if (m.heap == NULL) {
+        fail(b, "out of memory");
+        return NULL;
+    }
+    while (!failed(b)) {
+        size_t task = __atomic_fetch_add(&b->next_task, 1, __ATOMIC_RELAXED);
+        if (task >= b->task_count || !b->task(b, &m, task)) {
+            break;
+        }
+    }
+    free(m.heap);
+    free(m.moves);
+    return NULL;
+}
+
+// Runs task for 0 .. count-1 on threads threads, the calling one included
+static bool run_tasks(Opening_Book_Builder *b, int threads, size_t count,
+                      bool (*task)(Opening_Book_Builder *b, Merger *m, size_t task)) {
+    b->task = task;
+    b->task_count = count;
+    b->next_task = 0;
+    if ((size_t)threads > count) {
+        threads = (int)count;
+    }
+    pthread_t *ids = (pthread_t *)calloc(threads > 1 ? (size_t)threads : 1, sizeof(pthread_t));
+    int started = 0;
+    for (; ids != NULL && started < threads - 1; started++) {
+        if (pthread_create(&ids[started], NULL, finish_main, b) != 0) {
+            break;
+        }
+    }
+    finish_main(b);
+    for (int i = 0; i < started; i++) {
+        pthread_join(ids[i], NULL);
+    }
+    free(ids);
+    return !failed(b);
+}
+
+// Copies length bytes of fd from its start to writer
+static bool copy_file(Opening_Book_Builder *b, int fd, uint64_t length, char *buffer, Output_Writer *writer) {
+    for (uint64_t at = 0; at < length;) {
+        size_t n = length - at < COPY_BYTES ? (size_t)(length - at) : COPY_BYTES;
+        if (!file_io_read_at(fd, buffer, n, at)) {
+            fail(b, "cannot read back a merged range: %s", strerror(errno));
+            return false;
+        }
+        if (!output_writer_write(writer, buffer, n)) {
+            fail(b, "write error: %s", strerror(writer->error));
+            return false;
+        }
+        at += n;
+    }
+    return true;
+}
+
+// Concatenates the merged ranges into the book: positions with their move
+// indexes shifted to the whole file, the moves, then the sparse key index
+static bool assemble(Opening_Book_Builder *b, Output_Writer *writer, Opening_Book_Stats *stats) {
+    Opening_Book_File_Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, OPENING_BOOK_MAGIC, 8);
+    header.version = OPENING_BOOK_VERSION;
+    header.elo_band = b->options.elo_band;
+    header.min_count = b->options.min_count;
+    header.index_stride = OPENING_BOOK_INDEX_STRIDE;
+    Opening_Book_Trailer trailer;
+    memset(&trailer, 0, sizeof(trailer));
+    for (size_t i = 0; i < b->partition_count; i++) {
+        trailer.positions += b->parts[i].positions;
+        trailer.moves += b->parts[i].moves;
+        trailer.total_count += b->parts[i].total_count;
+        stats->pruned += b->parts[i].pruned;
+    }
+    trailer.index_entries = (trailer.positions + OPENING_BOOK_INDEX_STRIDE - 1) / OPENING_BOOK_INDEX_STRIDE;
+    trailer.moves_offset = sizeof(header) + trailer.positions * sizeof(Opening_Book_Position);
+    trailer.index_offset = trailer.moves_offset + trailer.moves * sizeof(Opening_Book_Move);
+    memcpy(trailer.magic, OPENING_BOOK_TRAILER_MAGIC, 8);
+
+    char *buffer = (char *)malloc(COPY_BYTES);
+    uint64_t *index = (uint64_t *)malloc((trailer.index_entries + 1) * sizeof(uint64_t));
+    if (buffer == NULL || index == NULL) {
+        free(buffer);
+        free(index);
+        fail(b, "out of memory");
+        return false;
+    }
+    bool ok = output_writer_write(writer, (const char *)&header, sizeof(header));
+    uint64_t position = 0;
+    uint64_t move_base = 0;
+    for (size_t i = 0; ok && i < b->partition_count; i++) {
+        const Book_Part *part = &b->parts[i];
+        Opening_Book_Position *positions = (Opening_Book_Position *)buffer;
+        size_t chunk = COPY_BYTES / sizeof(Opening_Book_Position);
+        for (uint64_t at = 0; ok && at < part->positions;) {
+            size_t n = part->positions - at < chunk ? (size_t)(part->positions - at) : chunk;
+            if (!file_io_read_at(part->positions_fd, positions, n * sizeof(Opening_Book_Position),
+                         at * sizeof(Opening_Book_Position))) {
+                fail(b, "cannot read back a merged range: %s", strerror(errno));
+                ok = false;
+                break;
+            }
+            for (size_t j = 0; j < n; j++, position++) {
+                positions[j].first_move += move_base;
+                if (position % OPENING_BOOK_INDEX_STRIDE == 0) {
+                    index[position / OPENING_BOOK_INDEX_STRIDE] = positions[j].key;
+                }
+            }
+            ok = output_writer_write(writer, buffer, n * sizeof(Opening_Book_Position));
+            at += n;
+        }
+        move_base += part->moves;
+    }
+    for (size_t i = 0; ok && i < b->partition_count; i++) {
+        ok = copy_file(b, b->parts[i].moves_fd, b->parts[i].moves * sizeof(Opening_Book_Move), buffer, writer);
+    }
+    ok = ok && output_writer_write(writer, (const char *)index, trailer.index_entries * sizeof(uint64_t)) &&
+         output_writer_write(writer, (const char *)&trailer, sizeof(trailer));
+    if (!ok && !failed(b)) {
+        fail(b, "write error: %s", strerror(writer->error));
+    }
+    free(buffer);
+    free(index);
+    stats->positions = trailer.positions;
+    stats->moves = trailer.moves;
+    return ok;
+}
+
+/**
+ * @brief Spills what is left in the maps, merges all runs and writes the
+ *        book to writer.
+ *
+ * Every worker must be done adding games. The key space is cut into a power
+ * of two ranges by the high key bits; threads merge whole ranges from all
+ * runs into temporary files, which are then concatenated in key order.
+ *
+ * @param threads Threads for the final spills and the merge, at least 1.
+ * @return false with stats->error set on failure.
+ */
+bool opening_book_finish(Opening_Book_Builder *b, Output_Writer *writer, int threads, Opening_Book_Stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    double start = file_io_seconds();
+    threads = threads > 0 ? threads : 1;
+    bool ok = !failed(b) && run_tasks(b, threads, (size_t)b->workers, spill_worker);
+    for (int i = 0; ok && i < b->workers; i++) {
+        Book_Worker *w = &b->w[i];
+        b->total_runs += w->run_count;
+        stats->runs += w->run_count;
+        stats->run_entries += w->entries;
+        stats->spill_seconds += w->spill_seconds;
+        if (w->entries == 0) {
+            continue;
+        }
+        void *map = mmap(NULL, w->entries * sizeof(Opening_Book_Entry), PROT_READ, MAP_SHARED, w->fd, 0);
+        if (map == MAP_FAILED) {
+            fail(b, "cannot map a run file: %s", strerror(errno));
+            ok = false;
+            break;
+        }
+        w->map = (const Opening_Book_Entry *)map;
+    }
+    stats->run_bytes = stats->run_entries * sizeof(Opening_Book_Entry);
+    if (ok) {
+        b->partition_bits = 1;
+        while ((1 << b->partition_bits) < threads * PARTITIONS_PER_THREAD && b->partition_bits < MAX_PARTITION_BITS) {
+            b->partition_bits++;
+        }
+        b->partition_count = (size_t)1 << b->partition_bits;
+        b->parts = (Book_Part *)calloc(b->partition_count, sizeof(Book_Part));
+        ok = b->parts != NULL;
+        for (size_t i = 0; ok && i < b->partition_count; i++) {
+            b->parts[i].positions_fd = -1;
+            b->parts[i].moves_fd = -1;
+        }
+        if (!ok) {
+            fail(b, "out of memory");
+        }
+        stats->partitions = b->partition_count;
+    }
+    ok = ok && run_tasks(b, threads, b->partition_count, merge_partition);
+    ok = ok && assemble(b, writer, stats);
+    if (!ok) {
+        snprintf(stats->error, sizeof(stats->error), "%s", b->error);
+    }
+    stats->merge_seconds = file_io_seconds() - start;
+    return ok;
+}
+
+void opening_book_builder_free(Opening_Book_Builder *b) {
+    if (b == NULL) {
+        return;
+    }
+    for (int i = 0; b->w != NULL && i < b->workers; i++) {
+        Book_Worker *w = &b->w[i];
+        if (w->map != NULL) {
+            munmap((void *)w->map, w->entries * sizeof(Opening_Book_Entry));
+        }
+        if (w->fd >= 0) {
+            close(w->fd);
+        }
+        free(w->slots);
+        free(w->plies);
+        free(w->runs);
+    }
+    for (size_t i = 0; b->parts != NULL && i < b->partition_count; i++) {
+        if (b->parts[i].positions_fd >= 0) {
+            close(b->parts[i].positions_fd);
+        }
+        if (b->parts[i].moves_fd >= 0) {
+            close(b->parts[i].moves_fd);
+        }
+    }
+    free(b->parts);
+    free(b->w);
+    pthread_mutex_destroy(&b->lock);
+    free(b);
+}
+
+static bool validate(Opening_Book *book) {
+    if (book->size < sizeof(Opening_Book_File_Header) + sizeof(Opening_Book_Trailer)) {
+        return false;
+    }
+    memcpy(&book->header, book->map, sizeof(book->header));
+    memcpy(&book->trailer, book->map + book->size - sizeof(book->trailer), sizeof(book->trailer));
+    const Opening_Book_File_Header *header = &book->header;
+    const Opening_Book_Trailer *trailer = &book->trailer;
+    if (memcmp(header->magic, OPENING_BOOK_MAGIC, 8) != 0 || header->version != OPENING_BOOK_VERSION ||
+        header->index_stride == 0 || memcmp(trailer->magic, OPENING_BOOK_TRAILER_MAGIC, 8) != 0) {
+        return false;
+    }
+    // Every section in place, computed so that no product can overflow
+    uint64_t space = book->size - sizeof(Opening_Book_File_Header) - sizeof(Opening_Book_Trailer);
+    if (trailer->positions > space / sizeof(Opening_Book_Position) ||
+        trailer->moves > space / sizeof(Opening_Book_Move) ||
+        trailer->index_entries != (trailer->positions + header->index_stride - 1) / header->index_stride) {
+        return false;
+    }
+    uint64_t moves_offset = sizeof(Opening_Book_File_Header) + trailer->positions * sizeof(Opening_Book_Position);
+    uint64_t index_offset = moves_offset + trailer->moves * sizeof(Opening_Book_Move);
+    if (trailer->moves_offset != moves_offset || trailer->index_offset != index_offset ||
+        index_offset + trailer->index_entries * sizeof(uint64_t) + sizeof(Opening_Book_Trailer) != book->size) {
+        return false;
+    }
+    book->positions = (const Opening_Book_Position *)(book->map + sizeof(Opening_Book_File_Header));
+    book->moves = (const Opening_Book_Move *)(book->map + moves_offset);
+    book->index = (const uint64_t *)(book->map + index_offset);
+    return true;
+}
+
+/**
+ * @brief Maps a book file for lookups.
+ *
+ * @return NULL if the file cannot be read or is not a whole book.
+ */
+Opening_Book *opening_book_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    Opening_Book *book = (Opening_Book *)calloc(1, sizeof(Opening_Book));
+    if (book == NULL || fstat(fd, &st) != 0 || st.st_size == 0) {
+        free(book);
+        close(fd);
+        return NULL;
+    }
+    book->size = (size_t)st.st_size;
+    void *map = mmap(NULL, book->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        free(book);
+        return NULL;
+    }
+    book->map = (const uint8_t *)map;
+    if (!validate(book)) {
+        opening_book_close(book);
+        return NULL;
+    }
+    return book;
+}
+
+/**
+ * @brief Finds the moves played from the position with Zobrist key key.
+ *
+ * The sparse index narrows the search to index_stride positions, which are
+ * then binary searched, so a lookup touches a handful of pages.
+ *
+ * @param moves_out Receives the position's moves, sorted by move, band and
+ *        speed; they point into the mapping.
+ * @return The number of moves, 0 if the position is not in the book.
+ */
+size_t opening_book_lookup(const Opening_Book *book, uint64_t key, const Opening_Book_Move **moves_out) {
+    const Opening_Book_Trailer *trailer = &book->trailer;
+    // Last index entry whose key is at most key
+    size_t low = 0;
+    size_t high = (size_t)trailer->index_entries;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (book->index[mid] <= key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    *moves_out = NULL;
+    if (low == 0) {
+        return 0;
+    }
+    uint64_t stride = book->header.index_stride;
+    size_t first = (size_t)((low - 1) * stride);
+    size_t end = first + stride < trailer->positions ? first + stride : (size_t)trailer->positions;
+    while (first < end) {
+        size_t mid = first + (end - first) / 2;
+        if (book->positions[mid].key < key) {
+            first = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+    if (first == trailer->positions || book->positions[first].key != key) {
+        return 0;
+    }
+    uint64_t begin = book->positions[first].first_move;
+    uint64_t stop = first + 1 < trailer->positions ? book->positions[first + 1].first_move : trailer->moves;
+    if (begin > stop || stop > trailer->moves) {
+        return 0;
+    }
+    *moves_out = book->moves + begin;
+    return (size_t)(stop - begin);
+}
+
+const Opening_Book_File_Header *opening_book_header(const Opening_Book *book) {
+    return &book->header;
+}
+
+const Opening_Book_Trailer *opening_book_trailer(const Opening_Book *book) {
+    return &book->trailer;
+}
+
+void opening_book_close(Opening_Book *book) {
+    if (book == NULL) {
+        return;
+    }
+    if (book->map != NULL) {
+        munmap((void *)book->map, book->size);
+    }
+    free(book);
+}
@@ -0,0 +1,102 @@
+#define _POSIX_C_SOURCE 200809L
+#include "output_writer.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static bool write_all(Output_Writer *writer, const char *data, size_t length) {
+    if (writer->error != 0) {
+        return false;
+    }
+    while (length > 0) {
+        ssize_t written = write(writer->fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            writer->error = errno;
+            return false;
+        }
+        writer->write_calls++;
+        writer->bytes_written += (uint64_t)written;
+        data += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+/**
+ * @brief Sets up a writer for fd. The writer does not own or close fd.
+ *
+ * @return false if the buffer cannot be allocated.
+ */
+bool output_writer_init(Output_Writer *writer, int fd) {
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = fd;
+    void *buffer = NULL;
+    if (posix_memalign(&buffer, 4096, OUTPUT_WRITER_BLOCK) != 0) {
+        return false;
+    }
+    writer->buffer = (char *)buffer;
+    return true;
+}
+
+/**
+ * @brief Queues data for writing.
+ *
+ * Data fills the block buffer, which is written out whenever it is full.
+ * When the buffer is empty, whole blocks are written straight from data
+ * without a copy.
+ *
+ * @return false if a write failed (see writer->error); later calls keep
+ *         failing.
+ */
+bool output_writer_write(Output_Writer *writer, const char *data, size_t length) {
+    if (writer->length > 0) {
+        size_t room = OUTPUT_WRITER_BLOCK - writer->length;
+        size_t n = length < room ? length : room;
+        memcpy(writer->buffer + writer->length, data, n);
+        writer->length += n;
+        data += n;
+        length -= n;
+        if (writer->length < OUTPUT_WRITER_BLOCK) {
+            return writer->error == 0;
+        }
+        if (!write_all(writer, writer->buffer, writer->length)) {
+            return false;
+        }
+        writer->length = 0;
+    }
+    size_t direct = length - length % OUTPUT_WRITER_BLOCK;
+    if (direct > 0) {
+        if (!write_all(writer, data, direct)) {
+            return false;
+        }
+        data += direct;
+        length -= direct;
+    }
+    memcpy(writer->buffer, data, length);
+    writer->length = length;
+    return writer->error == 0;
+}
+
+/**
+ * @brief Writes out whatever is buffered (the only unaligned write).
+ */
+bool output_writer_flush(Output_Writer *writer) {
+    if (writer->length > 0) {
+        if (!write_all(writer, writer->buffer, writer->length)) {
+            return false;
+        }
+        writer->length = 0;
+    }
+    return writer->error == 0;
+}
+
+void output_writer_free(Output_Writer *writer) {
+    free(writer->buffer);
+    writer->buffer = NULL;
+    writer->length = 0;
+}
@@ -0,0 +1,134 @@
+#define _POSIX_C_SOURCE 200809L
+#include "perf_counters.h"
+
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+static const char *const STAGE_NAMES[PERF_STAGE_COUNT] = {
+    "decompress", "scan", "san", "format", "compress", "write",
+};
+
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void perf_clock_start(Perf_Clock *clock) {
+    clock->start_seconds = monotonic_seconds();
+    clock->start_ticks = perf_ticks();
+}
+
+/**
+ * @brief Tick rate measured against the monotonic clock since
+ *        perf_clock_start; on a run shorter than 10 ms it waits out the rest
+ *        so the rate is not dominated by rounding.
+ */
+double perf_ticks_per_second(const Perf_Clock *clock) {
+#if defined(__x86_64__) || defined(__i386__)
+    double elapsed = monotonic_seconds() - clock->start_seconds;
+    while (elapsed < 0.01) {
+        elapsed = monotonic_seconds() - clock->start_seconds;
+    }
+    return (double)(perf_ticks() - clock->start_ticks) / elapsed;
+#else
+    (void)clock;
+    return 1e9;
+#endif
+}
+
+/**
+ * @brief Adds up the counters of all threads into total.
+ *
+ * Safe to call while the threads are still counting: each field is read
+ * once, so a running total may trail by the last few updates.
+ */
+void perf_counters_sum(const Perf_Counters *counters, size_t count, Perf_Counters *total) {
+    memset(total, 0, sizeof(*total));
+    for (size_t i = 0; i < count; i++) {
+        const Perf_Counters *c = &counters[i];
+        for (int stage = 0; stage < PERF_STAGE_COUNT; stage++) {
+            total->ticks[stage] += __atomic_load_n(&c->ticks[stage], __ATOMIC_RELAXED);
+            total->bytes[stage] += __atomic_load_n(&c->bytes[stage], __ATOMIC_RELAXED);
+        }
+        total->games += __atomic_load_n(&c->games, __ATOMIC_RELAXED);
+        total->plies += __atomic_load_n(&c->plies, __ATOMIC_RELAXED);
+        total->sampled_games += __atomic_load_n(&c->sampled_games, __ATOMIC_RELAXED);
+        for (int i = 0; i < 2; i++) {
+            total->san_cache_ticks[i] += __atomic_load_n(&c->san_cache_ticks[i], __ATOMIC_RELAXED);
+            total->san_cache_plies[i] += __atomic_load_n(&c->san_cache_plies[i], __ATOMIC_RELAXED);
+        }
+        for (int b = 0; b < PERF_LATENCY_BUCKETS; b++) {
+            total->latency[b] += __atomic_load_n(&c->latency[b], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+uint64_t perf_peak_rss_bytes(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return (uint64_t)usage.ru_maxrss * 1024;  // kilobytes on Linux
+}
+
+// Upper bound of the latency bucket that holds the given fraction of games
+static double latency_quantile_us(const Perf_Counters *total, double fraction, double us_per_tick) {
+    uint64_t target = (uint64_t)(fraction * (double)total->games);
+    uint64_t seen = 0;
+    for (int b = 0; b < PERF_LATENCY_BUCKETS; b++) {
+        seen += total->latency[b];
+        if (seen > target || (seen == total->games && seen > 0)) {
+            return (double)(2ull << b) * us_per_tick;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes the "counters", "stages" and "game_latency_us" members of a
+ *        JSON object (no enclosing braces) from the summed counters.
+ *
+ * SAN and format time come from the sampled games and are scaled up to all
+ * games, so they estimate what the two stages cost over the whole run.
+ */
+void perf_write_json(const Perf_Counters *total, double ticks_per_second, FILE *out) {
+    double sample_scale = total->sampled_games > 0 ? (double)total->games / total->sampled_games : 0;
+    fprintf(out, "  \"counters\": %s,\n", PERF_COUNTERS ? "true" : "false");
+    fprintf(out, "  \"sample_every\": %d,\n", PERF_SAMPLE_EVERY);
+    fprintf(out, "  \"sampled_games\": %llu,\n", (unsigned long long)total->sampled_games);
+    fprintf(out, "  \"stages\": {\n");
+    for (int stage = 0; stage < PERF_STAGE_COUNT; stage++) {
+        double seconds = ticks_per_second > 0 ? total->ticks[stage] / ticks_per_second : 0;
+        bool sampled = stage == PERF_SAN || stage == PERF_FORMAT;
+        if (sampled) {
+            seconds *= sample_scale;
+        }
+        fprintf(out, "    \"%s\": {\"seconds\": %.6f", STAGE_NAMES[stage], seconds);
+        if (sampled) {
+            fprintf(out, ", \"plies_per_second\": %.1f", seconds > 0 ? total->plies / seconds : 0.0);
+        } else {
+            fprintf(out, ", \"bytes\": %llu, \"mb_per_second\": %.2f", (unsigned long long)total->bytes[stage],
+                    seconds > 0 ? total->bytes[stage] / seconds / (1024.0 * 1024.0) : 0.0);
+        }
+        fprintf(out, "}%s\n", stage + 1 < PERF_STAGE_COUNT ? "," : "");
+    }
+    fprintf(out, "  },\n");
+
+    double us_per_tick = ticks_per_second > 0 ? 1e6 / ticks_per_second : 0;
+    fprintf(out, "  \"game_latency_us\": {\"games\": %llu, \"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f, "
+                 "\"histogram\": [",
+            (unsigned long long)total->games,
+            latency_quantile_us(total, 0.5, us_per_tick), latency_quantile_us(total, 0.9, us_per_tick),
+            latency_quantile_us(total, 0.99, us_per_tick));
+    bool first = true;
+    for (int b = 0; b < PERF_LATENCY_BUCKETS; b++) {
+        if (total->latency[b] > 0) {
+            fprintf(out, "%s{\"le\": %.3f, \"games\": %llu}", first ? "" : ", ",
+                    (double)(2ull << b) * us_per_tick, (unsigned long long)total->latency[b]);
+            first = false;
+        }
+    }
+    fprintf(out, "]}");
+}
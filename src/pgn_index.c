@@ -0,0 +1,404 @@
+#define _POSIX_C_SOURCE 200809L
+#include "pgn_index.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+#include "pgn_scan.h"
+
+#define SKIPPABLE_MASK 0xFFFFFFF0u
+#define SKIPPABLE_START 0x184D2A50u
+#define SEEK_TABLE_FOOTER 9
+
+// The seekable format and zstd frame headers are little-endian
+static uint32_t read_le32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void write_le32(unsigned char *p, uint32_t value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+}
+
+static bool index_add(PGN_Index *index, uint64_t offset, uint64_t compressed, uint64_t decompressed) {
+    if (index->count == index->capacity) {
+        size_t capacity = index->capacity ? index->capacity * 2 : 64;
+        PGN_Index_Frame *frames = (PGN_Index_Frame *)realloc(index->frames, capacity * sizeof(PGN_Index_Frame));
+        if (frames == NULL) {
+            return false;
+        }
+        index->frames = frames;
+        index->capacity = capacity;
+    }
+    PGN_Index_Frame *frame = &index->frames[index->count++];
+    frame->offset = offset;
+    frame->compressed_size = compressed;
+    frame->decompressed_size = decompressed;
+    return true;
+}
+
+void pgn_index_sidecar_path(const char *path, char *out, size_t out_size) {
+    snprintf(out, out_size, "%s.idx", path);
+}
+
+/**
+ * @brief Lists the frames of a .zst file by walking the frame and block
+ *        headers; nothing is decompressed.
+ *
+ * @return false if the file cannot be mapped or is not a sequence of zstd
+ *         frames (plain PGN, truncated or corrupt input).
+ */
+bool pgn_index_build(const char *path, PGN_Index *index) {
+    memset(index, 0, sizeof(*index));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    const unsigned char *data = (const unsigned char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == (const unsigned char *)MAP_FAILED) {
+        return false;
+    }
+    posix_madvise((void *)data, size, POSIX_MADV_SEQUENTIAL);
+    index->file_size = size;
+
+    bool ok = true;
+    size_t pos = 0;
+    while (ok && pos < size) {
+        if (size - pos < 8) {
+            ok = false;
+            break;
+        }
+        size_t frame = ZSTD_findFrameCompressedSize(data + pos, size - pos);
+        if (ZSTD_isError(frame) || frame > size - pos) {
+            ok = false;
+            break;
+        }
+        if ((read_le32(data + pos) & SKIPPABLE_MASK) != SKIPPABLE_START) {
+            unsigned long long content = ZSTD_getFrameContentSize(data + pos, size - pos);
+            if (content == ZSTD_CONTENTSIZE_ERROR || content == ZSTD_CONTENTSIZE_UNKNOWN) {
+                content = 0;
+            }
+            ok = index_add(index, pos, frame, content);
+        }
+        pos += frame;
+    }
+    munmap((void *)data, size);
+    if (!ok || index->count == 0) {
+        pgn_index_free(index);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes the index as a sidecar file: magic, input size, frame count
+ *        and one (offset, compressed, decompressed) triple per frame.
+ */
+bool pgn_index_save(const PGN_Index *index, const char *index_path) {
+    FILE *f = fopen(index_path, "wb");
+    if (f == NULL) {
+        return false;
+    }
+    uint64_t count = index->count;
+    bool ok = fwrite(PGN_INDEX_MAGIC, 1, 8, f) == 8 &&
+              fwrite(&index->file_size, sizeof(uint64_t), 1, f) == 1 &&
+              fwrite(&count, sizeof(uint64_t), 1, f) == 1 &&
+              fwrite(index->frames, sizeof(PGN_Index_Frame), index->count, f) == index->count;
+    return fclose(f) == 0 && ok;
+}
+
+static bool load_sidecar(const char *path, uint64_t file_size, PGN_Index *index) {
+    char index_path[4096];
+    pgn_index_sidecar_path(path, index_path, sizeof(index_path));
+    FILE *f = fopen(index_path, "rb");
+    if (f == NULL) {
+        return false;
+    }
+    char magic[8];
+    uint64_t indexed_size, count;
+    bool ok = fread(magic, 1, 8, f) == 8 && memcmp(magic, PGN_INDEX_MAGIC, 8) == 0 &&
+              fread(&indexed_size, sizeof(uint64_t), 1, f) == 1 && indexed_size == file_size &&
+              fread(&count, sizeof(uint64_t), 1, f) == 1 && count > 0 && count < (1ULL << 32);
+    if (ok) {
+        index->frames = (PGN_Index_Frame *)malloc((size_t)count * sizeof(PGN_Index_Frame));
+        ok = index->frames != NULL &&
+             fread(index->frames, sizeof(PGN_Index_Frame), (size_t)count, f) == (size_t)count;
+        index->count = index->capacity = (size_t)count;
+        index->file_size = file_size;
+    }
+    fclose(f);
+    // A stale sidecar of a file that was rewritten in place must not be used
+    for (size_t i = 0; ok && i < index->count; i++) {
+        const PGN_Index_Frame *frame = &index->frames[i];
+        ok = frame->compressed_size > 0 && frame->offset + frame->compressed_size <= file_size &&
+             (i == 0 || frame->offset >= index->frames[i - 1].offset + index->frames[i - 1].compressed_size);
+    }
+    if (!ok) {
+        pgn_index_free(index);
+    }
+    return ok;
+}
+
+static bool load_seek_table(const char *path, uint64_t file_size, PGN_Index *index) {
+    if (file_size < 8 + SEEK_TABLE_FOOTER) {
+        return false;
+    }
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return false;
+    }
+    unsigned char footer[SEEK_TABLE_FOOTER];
+    bool ok = fseek(f, (long)(file_size - SEEK_TABLE_FOOTER), SEEK_SET) == 0 &&
+              fread(footer, 1, sizeof(footer), f) == sizeof(footer) &&
+              read_le32(footer + 5) == PGN_INDEX_SEEKABLE_MAGIC;
+    uint64_t count = ok ? read_le32(footer) : 0;
+    size_t entry_size = ok && (footer[4] & 0x80) ? 12 : 8;
+    uint64_t table_size = count * entry_size + SEEK_TABLE_FOOTER;
+    ok = ok && count > 0 && table_size + 8 <= file_size;
+    unsigned char *table = ok ? (unsigned char *)malloc((size_t)table_size + 8) : NULL;
+    ok = ok && table != NULL && fseek(f, (long)(file_size - table_size - 8), SEEK_SET) == 0 &&
+         fread(table, 1, (size_t)table_size + 8, f) == (size_t)table_size + 8 &&
+         read_le32(table) == PGN_INDEX_SEEK_TABLE_MAGIC && read_le32(table + 4) == table_size;
+    fclose(f);
+
+    uint64_t offset = 0;
+    for (uint64_t i = 0; ok && i < count; i++) {
+        const unsigned char *entry = table + 8 + i * entry_size;
+        uint32_t compressed = read_le32(entry);
+        ok = compressed > 0 && index_add(index, offset, compressed, read_le32(entry + 4));
+        offset += compressed;
+    }
+    // The frames must tile the file up to the seek table
+    ok = ok && offset == file_size - table_size - 8;
+    free(table);
+    if (!ok) {
+        pgn_index_free(index);
+    } else {
+        index->file_size = file_size;
+    }
+    return ok;
+}
+
+/**
+ * @brief Loads the frame index of a .zst file without decompressing it.
+ *
+ * Uses the sidecar written by pgn_index_save if it matches the file's size,
+ * otherwise the seek table of a file in the zstd seekable format.
+ *
+ * @return false if neither exists; run pgn_index_build (or re-encode) first.
+ */
+bool pgn_index_load(const char *path, PGN_Index *index) {
+    memset(index, 0, sizeof(*index));
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return false;
+    }
+    return load_sidecar(path, (uint64_t)st.st_size, index) ||
+           load_seek_table(path, (uint64_t)st.st_size, index);
+}
+
+void pgn_index_free(PGN_Index *index) {
+    free(index->frames);
+    memset(index, 0, sizeof(*index));
+}
+
+// Sequential source of decoded text for the re-encoder: plain or zstd input
+typedef struct {
+    FILE *file;
+    bool compressed;
+    ZSTD_DCtx *dctx;
+    unsigned char *in_buffer;
+    size_t in_capacity;
+    ZSTD_inBuffer input;
+    bool input_done;
+    bool frame_open;
+    const char *error;
+} Text_Source;
+
+// Decodes up to capacity bytes; returns 0 at the end of the input or on error
+static size_t source_read(Text_Source *source, char *out, size_t capacity) {
+    if (!source->compressed) {
+        size_t n = fread(out, 1, capacity, source->file);
+        if (n == 0 && ferror(source->file)) {
+            source->error = "read error";
+        }
+        return n;
+    }
+    ZSTD_outBuffer output = {out, capacity, 0};
+    while (output.pos == 0) {
+        if (source->input.pos == source->input.size && !source->input_done) {
+            source->input.size = fread(source->in_buffer, 1, source->in_capacity, source->file);
+            source->input.pos = 0;
+            source->input_done = source->input.size == 0;
+        }
+        bool input_empty = source->input.pos == source->input.size;
+        if (input_empty && source->input_done && !source->frame_open) {
+            break;
+        }
+        size_t ret = ZSTD_decompressStream(source->dctx, &output, &source->input);
+        if (ZSTD_isError(ret)) {
+            source->error = ZSTD_getErrorName(ret);
+            return 0;
+        }
+        source->frame_open = ret != 0;
+        if (output.pos == 0 && input_empty && source->input_done) {
+            if (source->frame_open) {
+                source->error = "truncated zstd frame";
+            }
+            break;
+        }
+    }
+    return output.pos;
+}
+
+static size_t count_games(const char *text, size_t length) {
+    size_t games = length >= 6 && memcmp(text, "[Event", 6) == 0;
+    for (size_t at = pgn_scan_find_game(text, length, 0); at < length;
+         at = pgn_scan_find_game(text, length, at)) {
+        games++;
+    }
+    return games;
+}
+
+/**
+ * @brief Rewrites a .pgn or .pgn.zst file in the zstd seekable format.
+ *
+ * The decoded text is unchanged. It is cut into independent frames of about
+ * frame_bytes each, always just before an "[Event" line, so every frame
+ * holds whole games. A seek table (a skippable frame that ordinary zstd
+ * readers ignore) at the end lets pgn_index_load find the frames without a
+ * sidecar.
+ *
+ * @param games_out Optional; receives the number of games written.
+ */
+bool pgn_index_reencode(const char *input_path, const char *output_path, size_t frame_bytes, int level,
+                        uint64_t *games_out) {
+    if (frame_bytes == 0 || frame_bytes > (1u << 30)) {
+        return false;
+    }
+    Text_Source source;
+    memset(&source, 0, sizeof(source));
+    source.file = fopen(input_path, "rb");
+    FILE *out = fopen(output_path, "wb");
+    ZSTD_CCtx *cctx = ZSTD_createCCtx();
+    size_t capacity = frame_bytes * 2 < 65536 ? 65536 : frame_bytes * 2;
+    char *text = (char *)malloc(capacity);
+    size_t frame_capacity = ZSTD_compressBound(capacity);
+    char *frame = (char *)malloc(frame_capacity);
+    unsigned char *table = NULL;
+    size_t table_length = 0, table_capacity = 0;
+    uint32_t frames = 0;
+    uint64_t games = 0;
+    bool ok = source.file != NULL && out != NULL && cctx != NULL && text != NULL && frame != NULL;
+
+    if (ok) {
+        unsigned char magic[4];
+        size_t n = fread(magic, 1, sizeof(magic), source.file);
+        source.compressed = n == 4 && read_le32(magic) == 0xFD2FB528u;
+        ok = fseek(source.file, 0, SEEK_SET) == 0;
+        if (source.compressed) {
+            source.dctx = ZSTD_createDCtx();
+            source.in_capacity = ZSTD_DStreamInSize();
+            source.in_buffer = (unsigned char *)malloc(source.in_capacity);
+            source.input.src = source.in_buffer;
+            ok = ok && source.dctx != NULL && source.in_buffer != NULL;
+        }
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+    }
+
+    size_t length = 0;
+    bool input_done = false;
+    while (ok) {
+        while (!input_done && length < capacity) {
+            size_t n = source_read(&source, text + length, capacity - length);
+            input_done = n == 0;
+            length += n;
+        }
+        if (source.error != NULL) {
+            ok = false;
+            break;
+        }
+        // Cut after frame_bytes at the next game; a game longer than the
+        // buffer grows it instead of being split
+        size_t cut = length;
+        if (length > frame_bytes) {
+            cut = pgn_scan_find_game(text, length, frame_bytes);
+        }
+        if (cut == length && !input_done) {
+            char *grown = (char *)realloc(text, capacity * 2);
+            char *grown_frame = grown ? (char *)realloc(frame, ZSTD_compressBound(capacity * 2)) : NULL;
+            ok = grown != NULL && grown_frame != NULL;
+            text = grown ? grown : text;
+            frame = grown_frame ? grown_frame : frame;
+            capacity *= 2;
+            continue;
+        }
+        if (cut == 0) {
+            break;
+        }
+        size_t stored = ZSTD_compress2(cctx, frame, ZSTD_compressBound(cut), text, cut);
+        if (ZSTD_isError(stored) || fwrite(frame, 1, stored, out) != stored) {
+            ok = false;
+            break;
+        }
+        if (table_length + 8 > table_capacity) {
+            table_capacity = table_capacity ? table_capacity * 2 : 4096;
+            unsigned char *grown = (unsigned char *)realloc(table, table_capacity);
+            if (grown == NULL) {
+                ok = false;
+                break;
+            }
+            table = grown;
+        }
+        write_le32(table + table_length, (uint32_t)stored);
+        write_le32(table + table_length + 4, (uint32_t)cut);
+        table_length += 8;
+        frames++;
+        games += count_games(text, cut);
+        memmove(text, text + cut, length - cut);
+        length -= cut;
+    }
+
+    if (ok) {
+        unsigned char header[8], footer[SEEK_TABLE_FOOTER];
+        write_le32(header, PGN_INDEX_SEEK_TABLE_MAGIC);
+        write_le32(header + 4, (uint32_t)(table_length + SEEK_TABLE_FOOTER));
+        write_le32(footer, frames);
+        footer[4] = 0;      // no per-frame checksums in the table; frames carry their own
+        write_le32(footer + 5, PGN_INDEX_SEEKABLE_MAGIC);
+        ok = fwrite(header, 1, sizeof(header), out) == sizeof(header) &&
+             fwrite(table, 1, table_length, out) == table_length &&
+             fwrite(footer, 1, sizeof(footer), out) == sizeof(footer);
+    }
+    if (out != NULL && fclose(out) != 0) {
+        ok = false;
+    }
+    if (source.file != NULL) {
+        fclose(source.file);
+    }
+    ZSTD_freeDCtx(source.dctx);
+    ZSTD_freeCCtx(cctx);
+    free(source.in_buffer);
+    free(text);
+    free(frame);
+    free(table);
+    if (ok && games_out != NULL) {
+        *games_out = games;
+    }
+    return ok;
+}
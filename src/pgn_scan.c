@@ -0,0 +1,307 @@
+#include "pgn_scan.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PGN_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// One implementation of the two kernels. block classifies 64 bytes;
+// tag_starts reads 65 bytes and sets bit i when byte i is '\n' and byte i + 1
+// is '[', i.e. where a header tag line (or the next game) starts.
+typedef struct {
+    void (*block)(const char *block, PGN_Scan_Masks *masks);
+    uint64_t (*tag_starts)(const char *block);
+    const char *name;
+} Scan_Impl;
+
+enum {
+    CLASS_NEWLINE = 1,
+    CLASS_OPEN_BRACKET = 2,
+    CLASS_CLOSE_BRACKET = 4,
+    CLASS_QUOTE = 8,
+    CLASS_OPEN_BRACE = 16,
+    CLASS_CLOSE_BRACE = 32
+};
+
+static unsigned char char_class(unsigned char c) {
+    switch (c) {
+        case '\n': return CLASS_NEWLINE;
+        case '[': return CLASS_OPEN_BRACKET;
+        case ']': return CLASS_CLOSE_BRACKET;
+        case '"': return CLASS_QUOTE;
+        case '{': return CLASS_OPEN_BRACE;
+        case '}': return CLASS_CLOSE_BRACE;
+        default: return 0;
+    }
+}
+
+static void scan_block_scalar(const char *block, PGN_Scan_Masks *masks) {
+    uint64_t newline = 0, open_bracket = 0, close_bracket = 0;
+    uint64_t quote = 0, open_brace = 0, close_brace = 0;
+    for (int i = 0; i < 64; i++) {
+        unsigned char cls = char_class((unsigned char)block[i]);
+        if (cls == 0) {
+            continue;
+        }
+        uint64_t bit = 1ULL << i;
+        newline |= (cls & CLASS_NEWLINE) ? bit : 0;
+        open_bracket |= (cls & CLASS_OPEN_BRACKET) ? bit : 0;
+        close_bracket |= (cls & CLASS_CLOSE_BRACKET) ? bit : 0;
+        quote |= (cls & CLASS_QUOTE) ? bit : 0;
+        open_brace |= (cls & CLASS_OPEN_BRACE) ? bit : 0;
+        close_brace |= (cls & CLASS_CLOSE_BRACE) ? bit : 0;
+    }
+    masks->newline = newline;
+    masks->open_bracket = open_bracket;
+    masks->close_bracket = close_bracket;
+    masks->quote = quote;
+    masks->open_brace = open_brace;
+    masks->close_brace = close_brace;
+}
+
+static uint64_t tag_starts_scalar(const char *block) {
+    uint64_t starts = 0;
+    for (int i = 0; i < 64; i++) {
+        if (block[i] == '\n' && block[i + 1] == '[') {
+            starts |= 1ULL << i;
+        }
+    }
+    return starts;
+}
+
+static const Scan_Impl SCALAR_IMPL = {scan_block_scalar, tag_starts_scalar, "scalar"};
+
+#ifdef PGN_SCAN_X86
+__attribute__((target("sse2")))
+static void scan_block_sse2(const char *block, PGN_Scan_Masks *masks) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i open_bracket = _mm_set1_epi8('[');
+    const __m128i close_bracket = _mm_set1_epi8(']');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i open_brace = _mm_set1_epi8('{');
+    const __m128i close_brace = _mm_set1_epi8('}');
+    memset(masks, 0, sizeof(*masks));
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(block + 16 * i));
+        int shift = 16 * i;
+        masks->newline |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)) << shift;
+        masks->open_bracket |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, open_bracket)) << shift;
+        masks->close_bracket |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, close_bracket)) << shift;
+        masks->quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << shift;
+        masks->open_brace |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, open_brace)) << shift;
+        masks->close_brace |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, close_brace)) << shift;
+    }
+}
+
+__attribute__((target("sse2")))
+static uint64_t tag_starts_sse2(const char *block) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i open_bracket = _mm_set1_epi8('[');
+    uint64_t starts = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(block + 16 * i));
+        __m128i next = _mm_loadu_si128((const __m128i *)(block + 16 * i + 1));
+        __m128i hit = _mm_and_si128(_mm_cmpeq_epi8(v, newline), _mm_cmpeq_epi8(next, open_bracket));
+        starts |= (uint64_t)(uint16_t)_mm_movemask_epi8(hit) << (16 * i);
+    }
+    return starts;
+}
+
+static const Scan_Impl SSE2_IMPL = {scan_block_sse2, tag_starts_sse2, "sse2"};
+
+__attribute__((target("avx2")))
+static void scan_block_avx2(const char *block, PGN_Scan_Masks *masks) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i open_bracket = _mm256_set1_epi8('[');
+    const __m256i close_bracket = _mm256_set1_epi8(']');
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i open_brace = _mm256_set1_epi8('{');
+    const __m256i close_brace = _mm256_set1_epi8('}');
+    __m256i lo = _mm256_loadu_si256((const __m256i *)block);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(block + 32));
+#define AVX2_MASK(target) \
+    ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, target)) | \
+     (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, target)) << 32)
+    masks->newline = AVX2_MASK(newline);
+    masks->open_bracket = AVX2_MASK(open_bracket);
+    masks->close_bracket = AVX2_MASK(close_bracket);
+    masks->quote = AVX2_MASK(quote);
+    masks->open_brace = AVX2_MASK(open_brace);
+    masks->close_brace = AVX2_MASK(close_brace);
+#undef AVX2_MASK
+}
+
+__attribute__((target("avx2")))
+static uint64_t tag_starts_avx2(const char *block) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i open_bracket = _mm256_set1_epi8('[');
+    __m256i lo = _mm256_loadu_si256((const __m256i *)block);
+    __m256i lo_next = _mm256_loadu_si256((const __m256i *)(block + 1));
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(block + 32));
+    __m256i hi_next = _mm256_loadu_si256((const __m256i *)(block + 33));
+    __m256i lo_hit = _mm256_and_si256(_mm256_cmpeq_epi8(lo, newline), _mm256_cmpeq_epi8(lo_next, open_bracket));
+    __m256i hi_hit = _mm256_and_si256(_mm256_cmpeq_epi8(hi, newline), _mm256_cmpeq_epi8(hi_next, open_bracket));
+    return (uint64_t)(uint32_t)_mm256_movemask_epi8(lo_hit) |
+           (uint64_t)(uint32_t)_mm256_movemask_epi8(hi_hit) << 32;
+}
+
+static const Scan_Impl AVX2_IMPL = {scan_block_avx2, tag_starts_avx2, "avx2"};
+#endif
+
+static const Scan_Impl *scan_impl = NULL;
+
+/**
+ * @brief Chooses the scanner implementation.
+ *
+ * PGN_SCAN_AUTO picks AVX2, then SSE2, then scalar, based on CPUID. The
+ * others force one implementation, e.g. for benchmarks and tests. Call it
+ * before starting threads; otherwise the first scan picks automatically.
+ *
+ * @return false if the CPU does not support the requested implementation.
+ */
+bool pgn_scan_select(PGN_Scan_Impl impl) {
+    const Scan_Impl *chosen = &SCALAR_IMPL;
+#ifdef PGN_SCAN_X86
+    __builtin_cpu_init();
+    bool has_avx2 = __builtin_cpu_supports("avx2");
+    bool has_sse2 = __builtin_cpu_supports("sse2");
+    if ((impl == PGN_SCAN_AVX2 && !has_avx2) || (impl == PGN_SCAN_SSE2 && !has_sse2)) {
+        return false;
+    }
+    if (impl == PGN_SCAN_AVX2 || (impl == PGN_SCAN_AUTO && has_avx2)) {
+        chosen = &AVX2_IMPL;
+    } else if (impl == PGN_SCAN_SSE2 || (impl == PGN_SCAN_AUTO && has_sse2)) {
+        chosen = &SSE2_IMPL;
+    }
+#else
+    if (impl == PGN_SCAN_SSE2 || impl == PGN_SCAN_AVX2) {
+        return false;
+    }
+#endif
+    __atomic_store_n(&scan_impl, chosen, __ATOMIC_RELEASE);
+    return true;
+}
+
+static const Scan_Impl *scanner(void) {
+    const Scan_Impl *impl = __atomic_load_n(&scan_impl, __ATOMIC_ACQUIRE);
+    if (impl == NULL) {
+        pgn_scan_select(PGN_SCAN_AUTO);
+        impl = __atomic_load_n(&scan_impl, __ATOMIC_ACQUIRE);
+    }
+    return impl;
+}
+
+const char *pgn_scan_impl_name(void) {
+    return scanner()->name;
+}
+
+/**
+ * @brief Builds the structural character masks of one 64-byte block.
+ */
+void pgn_scan_block(const char *block, PGN_Scan_Masks *masks) {
+    scanner()->block(block, masks);
+}
+
+// Tag starts of the block at data + pos. A short tail is copied into a
+// zero-padded block so the kernels can always read 65 bytes.
+static uint64_t tag_starts_at(const Scan_Impl *impl, const char *data, size_t length, size_t pos) {
+    size_t n = length - pos;
+    if (n > 64) {
+        return impl->tag_starts(data + pos);
+    }
+    char block[65];
+    memcpy(block, data + pos, n);
+    memset(block + n, 0, sizeof(block) - n);
+    return impl->tag_starts(block);
+}
+
+// Reads the tag whose '[' is at header + at, if it is one the pipeline uses
+static void read_tag(const char *header, size_t length, size_t at, PGN_Header_Tags *tags) {
+    const char *name = header + at + 1;
+    size_t room = length - at - 1;
+    const char *expected;
+    PGN_Tag *tag;
+    switch (room > 1 ? name[0] : '\0') {
+        case 'W': expected = "WhiteElo"; tag = &tags->white_elo; break;
+        case 'B': expected = "BlackElo"; tag = &tags->black_elo; break;
+        case 'R': expected = "Result"; tag = &tags->result; break;
+        case 'F': expected = "FEN"; tag = &tags->fen; break;
+        case 'T':
+            if (name[1] == 'i') {
+                expected = "TimeControl";
+                tag = &tags->time_control;
+            } else {
+                expected = "Termination";
+                tag = &tags->termination;
+            }
+            break;
+        default:
+            return;
+    }
+    size_t name_length = strlen(expected);
+    if (room < name_length + 2 || memcmp(name, expected, name_length) != 0 ||
+        name[name_length] != ' ' || name[name_length + 1] != '"') {
+        return;
+    }
+    const char *value = name + name_length + 2;
+    const char *close = memchr(value, '"', (size_t)(header + length - value));
+    if (close != NULL) {
+        tag->value = value;
+        tag->length = (size_t)(close - value);
+    }
+}
+
+/**
+ * @brief Extracts the tags the pipeline needs from a header block in one pass.
+ *
+ * Tag lines are found from the '\n' + '[' masks, so only the ~20 line starts
+ * are looked at, and each is matched on its first letter before comparing the
+ * name. Brackets inside values are not at a line start and are ignored. Tags
+ * that are not present are left with a NULL value.
+ */
+void pgn_scan_headers(const char *header, size_t length, PGN_Header_Tags *tags) {
+    memset(tags, 0, sizeof(*tags));
+    const Scan_Impl *impl = scanner();
+    if (length > 0 && header[0] == '[') {
+        read_tag(header, length, 0, tags);
+    }
+    for (size_t pos = 0; pos < length; pos += 64) {
+        uint64_t starts = tag_starts_at(impl, header, length, pos);
+        while (starts) {
+            size_t at = pos + (size_t)__builtin_ctzll(starts) + 1;
+            starts &= starts - 1;
+            read_tag(header, length, at, tags);
+        }
+    }
+}
+
+/**
+ * @brief Finds the next game boundary: a line starting with "[Event".
+ *
+ * Candidates come from the '\n' + '[' masks, so long movetext lines are
+ * skipped 64 bytes at a time.
+ *
+ * @param from Offset to start at; a boundary needs its newline at or after it.
+ * @return Offset of the '[' that starts the next game, or length if there is
+ *         none. A boundary cut off by the end of data is reported as none;
+ *         search again from length - 6 once more data is available.
+ */
+size_t pgn_scan_find_game(const char *data, size_t length, size_t from) {
+    const Scan_Impl *impl = scanner();
+    for (size_t pos = from; pos < length; pos += 64) {
+        uint64_t starts = tag_starts_at(impl, data, length, pos);
+        while (starts) {
+            size_t at = pos + (size_t)__builtin_ctzll(starts) + 1;
+            starts &= starts - 1;
+            if (at + 6 > length) {
+                return length;
+            }
+            if (memcmp(data + at, "[Event", 6) == 0) {
+                return at;
+            }
+        }
+    }
+    return length;
+}
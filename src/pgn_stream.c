@@ -0,0 +1,926 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE     // madvise and the Linux MADV_* hints
+#include "pgn_stream.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+#include "pgn_scan.h"
+
+static const unsigned char ZSTD_MAGIC[4] = {0x28, 0xB5, 0x2F, 0xFD};
+
+// Decoded bytes a decoder adds per step while it looks past the end of its
+// own frames for the next game
+#define SEGMENT_EXTEND_BYTES (64u << 10)
+#define SEGMENT_MAX_BYTES (1u << 30)
+
+// Text of one run of frames, cut down to the games that start in it
+typedef struct {
+    char *data;
+    size_t capacity;
+    size_t first;           // owned text is data[first, first + length)
+    size_t length;
+    uint64_t compressed;    // bytes of the segment's own frames
+    const char *error;
+    bool frame_open;        // the decoder stopped inside a frame
+    bool done;              // decoded and waiting for the reader
+} Stream_Segment;
+
+// Parallel mode. Segment k is a run of consecutive frames; a decoder owns
+// the games whose "\n[Event" newline lies in the segment's decoded text,
+// skipping the tail of the game before them and decoding into the next
+// frames to finish its last one. Segments are handed out in order, so the
+// games come out exactly as a sequential read would return them.
+typedef struct {
+    const unsigned char *map;
+    size_t map_size;
+    PGN_Index_Frame *frames;
+    size_t *segment_frames;     // segment k is frames [segment_frames[k], segment_frames[k + 1])
+    size_t segment_count;
+    Stream_Segment *slots;      // segment k decodes into slot k % window
+    size_t window;
+    pthread_t *threads;
+    int thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        // a segment was decoded or released
+    size_t next_claim;          // next segment a decoder takes
+    size_t released;            // segments the reader is done with
+    size_t taken;               // segments handed to the reader
+    bool stop;
+} Stream_Decoders;
+
+struct PGN_Stream {
+    FILE *file;
+    bool owns_file;
+    bool compressed;
+
+    // zstd input side: compressed bytes read from the file
+    ZSTD_DCtx *dctx;
+    unsigned char *in_buffer;
+    size_t in_capacity;
+    ZSTD_inBuffer input;
+    bool frame_open;        // last ZSTD_decompressStream call did not end a frame
+
+    // Decoded text. [start, end) is unread; everything before start belongs
+    // to games already handed out and is reclaimed on the next refill.
+    char *buffer;
+    size_t capacity;
+    size_t start;
+    size_t end;
+    bool input_done;        // the file hit EOF
+    bool eof;               // no more decoded bytes will ever arrive
+
+    Stream_Decoders *decoders;  // parallel mode, NULL when reading sequentially
+
+    // Mapped mode: buffer is the read-only mapping of the whole file, so
+    // start and end are file offsets and games point straight into it
+    const char *map;
+    size_t map_size;
+    int map_fd;
+    size_t map_released;        // pages before this offset were given back
+    uint64_t range_end;         // stop at the first game starting here; 0 = no limit
+
+    uint64_t games;
+    uint64_t bytes_read;
+    uint64_t bytes_decoded;
+    const char *error;
+    Perf_Counters *counters;    // refill time is charged to PERF_DECOMPRESS
+};
+
+static bool is_event_line(const char *line, size_t line_len) {
+    return line_len >= 6 && memcmp(line, "[Event", 6) == 0;
+}
+
+static bool is_space_char(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Decodes from input into the segment until the input is used up and its
+// last frame is complete, or until at least want bytes were added (want 0:
+// no limit). Returns the number of bytes added; 0 once nothing is left.
+static size_t segment_decode(Stream_Segment *segment, ZSTD_DCtx *dctx, ZSTD_inBuffer *input, size_t want) {
+    size_t before = segment->length;
+    while (want == 0 || segment->length - before < want) {
+        if (input->pos == input->size && !segment->frame_open) {
+            break;
+        }
+        if (segment->length == segment->capacity) {
+            size_t capacity = segment->capacity ? segment->capacity * 2 : PGN_STREAM_SEGMENT_BYTES;
+            char *grown = capacity <= SEGMENT_MAX_BYTES ? (char *)realloc(segment->data, capacity) : NULL;
+            if (grown == NULL) {
+                segment->error = "out of memory decoding a segment";
+                return 0;
+            }
+            segment->data = grown;
+            segment->capacity = capacity;
+        }
+        size_t room = segment->capacity - segment->length;
+        if (want > 0 && room > want) {
+            room = want;
+        }
+        ZSTD_outBuffer output = {segment->data + segment->length, room, 0};
+        size_t ret = ZSTD_decompressStream(dctx, &output, input);
+        if (ZSTD_isError(ret)) {
+            segment->error = ZSTD_getErrorName(ret);
+            return 0;
+        }
+        segment->length += output.pos;
+        segment->frame_open = ret != 0;
+        if (input->pos == input->size && output.pos < output.size) {
+            if (segment->frame_open) {
+                segment->error = "truncated zstd frame";
+                return 0;
+            }
+            break;
+        }
+    }
+    return segment->length - before;
+}
+
+// Finds the next game whose newline is at or after from, decoding further
+// frames while the search runs into the end of the text. Returns the offset
+// of its '[', or the text length if the input ends first.
+static size_t segment_find_game(Stream_Segment *segment, ZSTD_DCtx *dctx, ZSTD_inBuffer *rest, size_t from) {
+    for (;;) {
+        size_t at = pgn_scan_find_game(segment->data, segment->length, from);
+        if (at < segment->length) {
+            return at;
+        }
+        size_t searched = segment->length;
+        if (segment_decode(segment, dctx, rest, SEGMENT_EXTEND_BYTES) == 0) {
+            return segment->length;
+        }
+        if (searched > from + 6) {
+            from = searched - 6;
+        }
+    }
+}
+
+static void decode_segment(Stream_Decoders *decoders, ZSTD_DCtx *dctx, size_t k, Stream_Segment *segment) {
+    const PGN_Index_Frame *first_frame = &decoders->frames[decoders->segment_frames[k]];
+    const PGN_Index_Frame *last_frame = &decoders->frames[decoders->segment_frames[k + 1] - 1];
+    const PGN_Index_Frame *end_frame = &decoders->frames[decoders->segment_frames[decoders->segment_count] - 1];
+    size_t own_end = (size_t)(last_frame->offset + last_frame->compressed_size);
+    ZSTD_inBuffer own = {decoders->map + first_frame->offset, own_end - (size_t)first_frame->offset, 0};
+    ZSTD_inBuffer rest = {decoders->map + own_end,
+                          (size_t)(end_frame->offset + end_frame->compressed_size) - own_end, 0};
+    segment->first = 0;
+    segment->length = 0;
+    segment->compressed = own.size;
+    segment->error = NULL;
+    segment->frame_open = false;
+
+    ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only);
+    segment_decode(segment, dctx, &own, 0);
+    size_t own_length = segment->length;
+    size_t first = 0;
+    bool owns = segment->error == NULL;
+    if (owns && k > 0) {
+        // Skip the end of the previous segment's last game. A boundary
+        // belongs here if its newline is inside this segment's own text.
+        first = segment_find_game(segment, dctx, &rest, 0);
+        owns = first <= own_length && first < segment->length;
+    }
+    size_t cut = first;
+    if (owns) {
+        cut = segment_find_game(segment, dctx, &rest, own_length);
+    }
+    segment->first = first;
+    segment->length = cut - first;
+}
+
+static void *decoder_main(void *arg) {
+    Stream_Decoders *decoders = (Stream_Decoders *)arg;
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    for (;;) {
+        pthread_mutex_lock(&decoders->lock);
+        while (!decoders->stop && decoders->next_claim < decoders->segment_count &&
+               decoders->next_claim >= decoders->released + decoders->window) {
+            pthread_cond_wait(&decoders->cond, &decoders->lock);
+        }
+        if (decoders->stop || decoders->next_claim >= decoders->segment_count) {
+            pthread_mutex_unlock(&decoders->lock);
+            break;
+        }
+        size_t k = decoders->next_claim++;
+        pthread_mutex_unlock(&decoders->lock);
+
+        Stream_Segment *segment = &decoders->slots[k % decoders->window];
+        if (dctx == NULL) {
+            segment->error = "out of memory";
+        } else {
+            decode_segment(decoders, dctx, k, segment);
+        }
+        pthread_mutex_lock(&decoders->lock);
+        segment->done = true;
+        pthread_cond_broadcast(&decoders->cond);
+        pthread_mutex_unlock(&decoders->lock);
+    }
+    ZSTD_freeDCtx(dctx);
+    return NULL;
+}
+
+// Parallel mode refill: releases the segment just read and switches the
+// stream buffer to the next non-empty one, in segment order
+static size_t stream_next_segment(PGN_Stream *stream) {
+    Stream_Decoders *decoders = stream->decoders;
+    for (;;) {
+        pthread_mutex_lock(&decoders->lock);
+        if (decoders->taken > decoders->released) {
+            decoders->slots[decoders->released % decoders->window].done = false;
+            decoders->released++;
+            pthread_cond_broadcast(&decoders->cond);
+        }
+        if (decoders->taken == decoders->segment_count) {
+            pthread_mutex_unlock(&decoders->lock);
+            stream->eof = true;
+            return 0;
+        }
+        Stream_Segment *segment = &decoders->slots[decoders->taken % decoders->window];
+        while (!segment->done) {
+            pthread_cond_wait(&decoders->cond, &decoders->lock);
+        }
+        decoders->taken++;
+        pthread_mutex_unlock(&decoders->lock);
+
+        if (segment->error != NULL) {
+            stream->error = segment->error;
+            return 0;
+        }
+        stream->buffer = segment->data + segment->first;
+        stream->capacity = segment->length;
+        stream->start = 0;
+        stream->end = segment->length;
+        stream->bytes_read += segment->compressed;
+        stream->bytes_decoded += segment->length;
+        if (segment->length > 0) {
+            return segment->length;
+        }
+    }
+}
+
+/**
+ * @brief Mapped mode refill: exposes the next PGN_STREAM_MAP_WINDOW bytes of
+ *        the mapping and gives back the pages of games already handed out.
+ *
+ * Nothing is copied. Pages before the unread text are dropped from the
+ * process (MADV_DONTNEED) and from the page cache (POSIX_FADV_DONTNEED) a
+ * window at a time, so a pass over a file larger than memory leaves about
+ * two windows resident instead of the whole file.
+ */
+static size_t stream_map_advance(PGN_Stream *stream) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t done = stream->start & ~(page - 1);
+    if (done >= stream->map_released + PGN_STREAM_MAP_WINDOW) {
+        size_t length = done - stream->map_released;
+        madvise((void *)(stream->map + stream->map_released), length, MADV_DONTNEED);
+        posix_fadvise(stream->map_fd, (off_t)stream->map_released, (off_t)length, POSIX_FADV_DONTNEED);
+        stream->map_released = done;
+    }
+
+    size_t before = stream->end;
+    size_t end = stream->map_size - before > PGN_STREAM_MAP_WINDOW ? before + PGN_STREAM_MAP_WINDOW
+                                                                    : stream->map_size;
+    if (end > before) {
+        size_t from = before & ~(page - 1);
+        madvise((void *)(stream->map + from), end - from, MADV_WILLNEED);
+    }
+    stream->end = end;
+    stream->bytes_read += end - before;
+    stream->bytes_decoded += end - before;
+    if (end == before) {
+        stream->eof = true;
+    }
+    return end - before;
+}
+
+/**
+ * @brief Makes room for more decoded text and fills it.
+ *
+ * Moves the unread tail [start, end) to the front of the buffer (it is at most
+ * one partial game), grows the buffer only if that tail already fills it, then
+ * reads or decompresses until the buffer is full or the input ends.
+ *
+ * @return Number of bytes appended; 0 at end of input or on error.
+ */
+static size_t stream_fill(PGN_Stream *stream) {
+    if (stream->eof || stream->error) {
+        return 0;
+    }
+    if (stream->decoders != NULL) {
+        return stream_next_segment(stream);
+    }
+    if (stream->map != NULL) {
+        return stream_map_advance(stream);
+    }
+
+    if (stream->start > 0) {
+        size_t unread = stream->end - stream->start;
+        memmove(stream->buffer, stream->buffer + stream->start, unread);
+        stream->start = 0;
+        stream->end = unread;
+    }
+
+    if (stream->end == stream->capacity) {
+        if (stream->capacity >= PGN_STREAM_MAX_BUFFER) {
+            stream->error = "game exceeds the maximum stream buffer size";
+            return 0;
+        }
+        size_t new_capacity = stream->capacity * 2;
+        if (new_capacity > PGN_STREAM_MAX_BUFFER) {
+            new_capacity = PGN_STREAM_MAX_BUFFER;
+        }
+        char *grown = (char *)realloc(stream->buffer, new_capacity);
+        if (grown == NULL) {
+            stream->error = "out of memory growing the stream buffer";
+            return 0;
+        }
+        stream->buffer = grown;
+        stream->capacity = new_capacity;
+    }
+
+    size_t before = stream->end;
+
+    if (!stream->compressed) {
+        while (stream->end < stream->capacity && !stream->input_done) {
+            size_t n = fread(stream->buffer + stream->end, 1,
+                             stream->capacity - stream->end, stream->file);
+            if (n == 0) {
+                if (ferror(stream->file)) {
+                    stream->error = "read error";
+                }
+                stream->input_done = true;
+            }
+            stream->end += n;
+            stream->bytes_read += n;
+        }
+        stream->bytes_decoded += stream->end - before;
+        if (stream->end == before) {
+            stream->eof = true;
+        }
+        return stream->end - before;
+    }
+
+    while (stream->end < stream->capacity) {
+        if (stream->input.pos == stream->input.size && !stream->input_done) {
+            size_t n = fread(stream->in_buffer, 1, stream->in_capacity, stream->file);
+            if (n == 0) {
+                if (ferror(stream->file)) {
+                    stream->error = "read error";
+                    return 0;
+                }
+                stream->input_done = true;
+            }
+            stream->input.size = n;
+            stream->input.pos = 0;
+            stream->bytes_read += n;
+        }
+
+        // With the input exhausted, keep calling only while zstd may still
+        // hold decoded bytes that did not fit into the previous output window.
+        bool input_empty = stream->input.pos == stream->input.size;
+        if (input_empty && stream->input_done && !stream->frame_open) {
+            break;
+        }
+
+        ZSTD_outBuffer output = {stream->buffer + stream->end,
+                                 stream->capacity - stream->end, 0};
+        size_t ret = ZSTD_decompressStream(stream->dctx, &output, &stream->input);
+        if (ZSTD_isError(ret)) {
+            stream->error = ZSTD_getErrorName(ret);
+            return 0;
+        }
+        stream->frame_open = ret != 0;
+        stream->end += output.pos;
+
+        if (output.pos == 0 && input_empty && stream->input_done) {
+            if (stream->frame_open) {
+                stream->error = "truncated zstd frame";
+                return 0;
+            }
+            break;
+        }
+    }
+
+    stream->bytes_decoded += stream->end - before;
+    if (stream->end == before) {
+        stream->eof = true;
+    }
+    return stream->end - before;
+}
+
+static size_t stream_refill(PGN_Stream *stream) {
+    PERF_START(start);
+    size_t added = stream_fill(stream);
+    PERF_STOP(stream->counters, PERF_DECOMPRESS, start);
+    PERF_BYTES(stream->counters, PERF_DECOMPRESS, added);
+    return added;
+}
+
+/**
+ * @brief Makes sure the whole line starting at start + offset is buffered.
+ *
+ * @param line_len_out Receives the line length including its '\n' (the last
+ *                     line of the input may have none).
+ * @return false if there is no data at offset (end of input) or on error.
+ */
+static bool stream_line(PGN_Stream *stream, size_t offset, size_t *line_len_out) {
+    for (;;) {
+        size_t available = stream->end - stream->start;
+        if (offset < available) {
+            const char *line = stream->buffer + stream->start + offset;
+            const char *newline = memchr(line, '\n', available - offset);
+            if (newline != NULL) {
+                *line_len_out = (size_t)(newline - line) + 1;
+                return true;
+            }
+            // A segment holds whole games, so its end ends the line
+            if (stream->eof || stream->decoders != NULL) {
+                *line_len_out = available - offset;
+                return true;
+            }
+        } else if (stream->eof || (stream->decoders != NULL && offset > 0)) {
+            return false;
+        }
+        if (stream_refill(stream) == 0 && stream->error) {
+            return false;
+        }
+    }
+}
+
+static PGN_Stream *stream_create(FILE *file, bool owns_file, size_t buffer_capacity) {
+    PGN_Stream *stream = (PGN_Stream *)calloc(1, sizeof(PGN_Stream));
+    if (stream == NULL) {
+        return NULL;
+    }
+    stream->file = file;
+    stream->owns_file = owns_file;
+    stream->capacity = buffer_capacity;
+    stream->buffer = (char *)malloc(buffer_capacity);
+    stream->in_capacity = ZSTD_DStreamInSize();
+    stream->in_buffer = (unsigned char *)malloc(stream->in_capacity);
+    if (stream->buffer == NULL || stream->in_buffer == NULL) {
+        pgn_stream_close(stream);
+        return NULL;
+    }
+
+    // Sniff the zstd magic number to pick plain or compressed input
+    size_t n = fread(stream->in_buffer, 1, sizeof(ZSTD_MAGIC), file);
+    stream->bytes_read = n;
+    if (n == sizeof(ZSTD_MAGIC) && memcmp(stream->in_buffer, ZSTD_MAGIC, n) == 0) {
+        stream->compressed = true;
+        stream->dctx = ZSTD_createDCtx();
+        if (stream->dctx == NULL) {
+            pgn_stream_close(stream);
+            return NULL;
+        }
+        stream->input.src = stream->in_buffer;
+        stream->input.size = n;
+        stream->input.pos = 0;
+    } else {
+        memcpy(stream->buffer, stream->in_buffer, n);
+        stream->end = n;
+        stream->bytes_decoded = n;
+        if (n < sizeof(ZSTD_MAGIC)) {
+            stream->input_done = true;
+        }
+    }
+    return stream;
+}
+
+PGN_Stream *pgn_stream_open(const char *path) {
+    return pgn_stream_open_with_buffer(path, PGN_STREAM_DEFAULT_BUFFER);
+}
+
+/**
+ * @brief Opens a .pgn or .pgn.zst file for game-by-game streaming.
+ *
+ * The format is detected from the zstd magic number, so plain PGN works too.
+ * Memory use is bounded by buffer_capacity plus the zstd window, independent
+ * of the file size.
+ *
+ * @param path File path, or "-" for stdin.
+ * @param buffer_capacity Initial size of the decoded text buffer in bytes.
+ * @return A new stream, or NULL if the file cannot be opened.
+ */
+PGN_Stream *pgn_stream_open_with_buffer(const char *path, size_t buffer_capacity) {
+    if (path == NULL || buffer_capacity < 64 || buffer_capacity > PGN_STREAM_MAX_BUFFER) {
+        return NULL;
+    }
+    bool use_stdin = strcmp(path, "-") == 0;
+    FILE *file = use_stdin ? stdin : fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    PGN_Stream *stream = stream_create(file, !use_stdin, buffer_capacity);
+    if (stream == NULL && !use_stdin) {
+        fclose(file);
+    }
+    return stream;
+}
+
+/**
+ * @brief Opens a plain .pgn file as a read-only memory mapping.
+ *
+ * Games are sliced straight out of the mapping: no read() copies and no
+ * buffer to grow, so a game of any size fits. The kernel is told the access
+ * is sequential (and may back the mapping with huge pages where the file
+ * system supports it), and pages behind the reader are released as it goes,
+ * so page cache use stays at a few PGN_STREAM_MAP_WINDOW regardless of the
+ * file size.
+ *
+ * The stream returns the games whose "[Event" line starts in
+ * [range_start, range_end), with the same boundary rule as pgn_stream_seek.
+ * Several streams over ranges that split the file at arbitrary offsets thus
+ * return every game exactly once between them, and can run on separate
+ * threads. Game indexes count from 0 within the range; offsets are file
+ * offsets.
+ *
+ * @param range_end End of the range, or 0 for the end of the file.
+ * @return A new stream, or NULL if path is not a non-empty regular file
+ *         that can be mapped, or is zstd-compressed (use pgn_stream_open).
+ */
+PGN_Stream *pgn_stream_open_mapped(const char *path, uint64_t range_start, uint64_t range_end) {
+    if (path == NULL || strcmp(path, "-") == 0) {
+        return NULL;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    PGN_Stream *stream = (PGN_Stream *)calloc(1, sizeof(PGN_Stream));
+    if (stream == NULL || (size >= sizeof(ZSTD_MAGIC) && memcmp(map, ZSTD_MAGIC, sizeof(ZSTD_MAGIC)) == 0)) {
+        munmap(map, size);
+        close(fd);
+        free(stream);
+        return NULL;
+    }
+    stream->map = (const char *)map;
+    stream->map_size = size;
+    stream->map_fd = fd;
+    stream->buffer = (char *)map;
+    stream->capacity = size;
+    stream->range_end = range_end;
+
+    // Hints only: failures just cost speed
+    posix_madvise(map, size, POSIX_MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(map, size, MADV_HUGEPAGE);
+#endif
+    if (!pgn_stream_seek(stream, range_start, 0, NULL) && stream->error == NULL) {
+        // The range starts past the last game
+        stream->start = stream->end = size;
+        stream->eof = true;
+    }
+    return stream;
+}
+
+// Stops the decoder threads and frees everything parallel mode allocated
+static void decoders_free(Stream_Decoders *decoders) {
+    pthread_mutex_lock(&decoders->lock);
+    decoders->stop = true;
+    pthread_cond_broadcast(&decoders->cond);
+    pthread_mutex_unlock(&decoders->lock);
+    for (int i = 0; i < decoders->thread_count; i++) {
+        pthread_join(decoders->threads[i], NULL);
+    }
+    for (size_t i = 0; decoders->slots != NULL && i < decoders->window; i++) {
+        free(decoders->slots[i].data);
+    }
+    if (decoders->map != NULL) {
+        munmap((void *)decoders->map, decoders->map_size);
+    }
+    pthread_cond_destroy(&decoders->cond);
+    pthread_mutex_destroy(&decoders->lock);
+    free(decoders->slots);
+    free(decoders->threads);
+    free(decoders->segment_frames);
+    free(decoders->frames);
+    free(decoders);
+}
+
+/**
+ * @brief Opens a multi-frame .pgn.zst file for decompression on several threads.
+ *
+ * Frames are grouped into segments of about segment_bytes compressed bytes.
+ * Each decoder thread decompresses whole segments on its own, using the
+ * frame offsets from index. Games come out in file order and are
+ * identical to what pgn_stream_open returns; only the decoding is spread
+ * over the threads. Memory use is about 2 * threads decoded segments.
+ *
+ * @param index Frames of the file, from pgn_index_load or pgn_index_build.
+ * @return A new stream, or NULL if the file cannot be mapped, does not
+ *         match the index, or threads cannot start.
+ */
+PGN_Stream *pgn_stream_open_parallel(const char *path, const PGN_Index *index, int threads,
+                                     size_t segment_bytes) {
+    if (path == NULL || index == NULL || index->count == 0 || threads < 1 || segment_bytes == 0) {
+        return NULL;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    const PGN_Index_Frame *last = &index->frames[index->count - 1];
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size != index->file_size ||
+        last->offset + last->compressed_size > index->file_size) {
+        close(fd);
+        return NULL;
+    }
+    PGN_Stream *stream = (PGN_Stream *)calloc(1, sizeof(PGN_Stream));
+    Stream_Decoders *decoders = (Stream_Decoders *)calloc(1, sizeof(Stream_Decoders));
+    if (stream == NULL || decoders == NULL) {
+        close(fd);
+        free(stream);
+        free(decoders);
+        return NULL;
+    }
+    pthread_mutex_init(&decoders->lock, NULL);
+    pthread_cond_init(&decoders->cond, NULL);
+    stream->decoders = decoders;
+    stream->compressed = true;
+
+    decoders->map_size = (size_t)st.st_size;
+    void *map = mmap(NULL, decoders->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    decoders->map = map == MAP_FAILED ? NULL : (const unsigned char *)map;
+    decoders->frames = (PGN_Index_Frame *)malloc(index->count * sizeof(PGN_Index_Frame));
+    decoders->segment_frames = (size_t *)malloc((index->count + 1) * sizeof(size_t));
+    decoders->window = 2 * (size_t)threads;
+    decoders->slots = (Stream_Segment *)calloc(decoders->window, sizeof(Stream_Segment));
+    decoders->threads = (pthread_t *)calloc((size_t)threads, sizeof(pthread_t));
+    if (decoders->map == NULL || decoders->frames == NULL || decoders->segment_frames == NULL ||
+        decoders->slots == NULL || decoders->threads == NULL) {
+        pgn_stream_close(stream);
+        return NULL;
+    }
+    memcpy(decoders->frames, index->frames, index->count * sizeof(PGN_Index_Frame));
+    uint64_t grouped = 0;
+    decoders->segment_frames[0] = 0;
+    for (size_t i = 0; i < index->count; i++) {
+        grouped += index->frames[i].compressed_size;
+        if (grouped >= segment_bytes || i + 1 == index->count) {
+            decoders->segment_frames[++decoders->segment_count] = i + 1;
+            grouped = 0;
+        }
+    }
+
+    for (; decoders->thread_count < threads; decoders->thread_count++) {
+        if (pthread_create(&decoders->threads[decoders->thread_count], NULL, decoder_main, decoders) != 0) {
+            pgn_stream_close(stream);
+            return NULL;
+        }
+    }
+    return stream;
+}
+
+// Restarts a compressed stream at the frame holding target. Returns false if
+// the index does not cover target or lacks decoded frame sizes.
+static bool stream_seek_frame(PGN_Stream *stream, uint64_t target, const PGN_Index *index) {
+    struct stat st;
+    if (index == NULL || fstat(fileno(stream->file), &st) != 0 || (uint64_t)st.st_size != index->file_size) {
+        return false;
+    }
+    uint64_t decoded = 0;
+    for (size_t i = 0; i < index->count && index->frames[i].decompressed_size > 0; i++) {
+        const PGN_Index_Frame *frame = &index->frames[i];
+        if (target < decoded + frame->decompressed_size) {
+            if (fseeko(stream->file, (off_t)frame->offset, SEEK_SET) != 0) {
+                return false;
+            }
+            ZSTD_DCtx_reset(stream->dctx, ZSTD_reset_session_only);
+            stream->input.size = 0;
+            stream->input.pos = 0;
+            stream->frame_open = false;
+            stream->start = 0;
+            stream->end = 0;
+            stream->bytes_read = frame->offset;
+            stream->bytes_decoded = decoded;
+            return true;
+        }
+        decoded += frame->decompressed_size;
+    }
+    return false;
+}
+
+/**
+ * @brief Moves a freshly opened sequential stream to a decoded offset.
+ *
+ * The next game returned is the first whose "[Event" line starts at or after
+ * offset, so runs that split the input at the same offsets convert every game
+ * exactly once between them. Plain and mapped files are seeked directly. A .zst file
+ * starts decoding at the frame holding offset when index has the decoded
+ * frame sizes (as re-encoded files do); otherwise the text before offset is
+ * decoded and thrown away.
+ *
+ * @param first_index Index of the next game returned; later ones count up.
+ * @param index Frames of a .zst input, or NULL.
+ * @return false for a parallel stream, one that was already read from, or
+ *         if the input ends or fails before offset.
+ */
+bool pgn_stream_seek(PGN_Stream *stream, uint64_t offset, uint64_t first_index, const PGN_Index *index) {
+    if (stream == NULL || stream->decoders != NULL || stream->games > 0 || stream->error) {
+        return false;
+    }
+    stream->games = first_index;
+    if (offset == 0) {
+        return true;
+    }
+    // Stop one byte short: that byte tells whether offset starts a line
+    uint64_t target = offset - 1;
+    if (stream->map != NULL) {
+        size_t at = target < stream->map_size ? (size_t)target : stream->map_size;
+        stream->start = at;
+        stream->end = at;
+        stream->eof = false;
+        stream->bytes_read = at;
+        stream->bytes_decoded = at;
+    } else if (!stream->compressed && fseeko(stream->file, (off_t)target, SEEK_SET) == 0) {
+        stream->start = 0;
+        stream->end = 0;
+        stream->input_done = false;
+        stream->eof = false;
+        stream->bytes_read = target;
+        stream->bytes_decoded = target;
+    } else if (stream->compressed) {
+        stream_seek_frame(stream, target, index);
+    }
+    for (;;) {
+        uint64_t position = stream->bytes_decoded - (stream->end - stream->start);
+        if (position == target) {
+            break;
+        }
+        if (stream->start == stream->end && stream_refill(stream) == 0) {
+            return false;
+        }
+        size_t available = stream->end - stream->start;
+        stream->start += target - position < available ? (size_t)(target - position) : available;
+    }
+    if (stream->start == stream->end && stream_refill(stream) == 0) {
+        return false;
+    }
+    size_t line_len;
+    if (stream->buffer[stream->start++] != '\n' && stream_line(stream, 0, &line_len)) {
+        stream->start += line_len;
+    }
+    return stream->error == NULL;
+}
+
+/**
+ * @brief Returns the next whole game of the stream.
+ *
+ * A game starts at a line beginning with "[Event" and runs up to the next such
+ * line. Anything before the first "[Event" line is skipped. The returned
+ * slices point into the stream buffer and are invalidated by the next call.
+ *
+ * @return true if a game was returned, false at end of input or on error
+ *         (check pgn_stream_error to tell them apart).
+ */
+bool pgn_stream_next_game(PGN_Stream *stream, PGN_Game *game_out) {
+    if (stream == NULL || game_out == NULL || stream->error) {
+        return false;
+    }
+
+    size_t line_len;
+    for (;;) {
+        if (!stream_line(stream, 0, &line_len)) {
+            return false;
+        }
+        if (is_event_line(stream->buffer + stream->start, line_len)) {
+            break;
+        }
+        stream->start += line_len;
+    }
+    if (stream->range_end > 0 && pgn_stream_offset(stream) >= stream->range_end) {
+        return false;
+    }
+
+    // Walk the tag lines one by one. Offsets are relative to stream->start
+    // because a refill may move the buffer contents.
+    size_t offset = line_len;
+    bool in_movetext = false;
+    while (stream_line(stream, offset, &line_len)) {
+        const char *line = stream->buffer + stream->start + offset;
+        if (line[0] != '[' || is_event_line(line, line_len)) {
+            in_movetext = line[0] != '[';
+            break;
+        }
+        offset += line_len;
+    }
+    if (stream->error) {
+        return false;
+    }
+    size_t header_end = offset;
+
+    // The movetext is mostly one long line: jump straight to the next
+    // "[Event" line with the block scanner.
+    size_t from = header_end - 1;
+    while (in_movetext) {
+        size_t available = stream->end - stream->start;
+        offset = pgn_scan_find_game(stream->buffer + stream->start, available, from);
+        if (offset < available || stream->eof || stream->decoders != NULL) {
+            break;
+        }
+        if (available > from + 6) {
+            from = available - 6;
+        }
+        if (stream_refill(stream) == 0 && stream->error) {
+            return false;
+        }
+    }
+
+    const char *game = stream->buffer + stream->start;
+    size_t header_len = header_end;
+    while (header_len > 0 && is_space_char(game[header_len - 1])) {
+        header_len--;
+    }
+    size_t movetext_start = header_end;
+    while (movetext_start < offset && is_space_char(game[movetext_start])) {
+        movetext_start++;
+    }
+    size_t movetext_end = offset;
+    while (movetext_end > movetext_start && is_space_char(game[movetext_end - 1])) {
+        movetext_end--;
+    }
+
+    game_out->header = game;
+    game_out->header_len = header_len;
+    game_out->movetext = game + movetext_start;
+    game_out->movetext_len = movetext_end - movetext_start;
+    game_out->index = stream->games++;
+    game_out->offset = stream->bytes_decoded - (stream->end - stream->start);
+
+    stream->start += offset;
+    return true;
+}
+
+const char *pgn_stream_error(const PGN_Stream *stream) {
+    return stream != NULL ? stream->error : NULL;
+}
+
+/**
+ * @brief Decoded offset of the first unread byte: after pgn_stream_next_game,
+ *        where the next game starts.
+ */
+uint64_t pgn_stream_offset(const PGN_Stream *stream) {
+    return stream != NULL ? stream->bytes_decoded - (stream->end - stream->start) : 0;
+}
+
+uint64_t pgn_stream_bytes_read(const PGN_Stream *stream) {
+    return stream != NULL ? stream->bytes_read : 0;
+}
+
+uint64_t pgn_stream_bytes_decoded(const PGN_Stream *stream) {
+    return stream != NULL ? stream->bytes_decoded : 0;
+}
+
+/**
+ * @brief Charges the time spent reading and decompressing to counters, which
+ *        belong to the thread calling pgn_stream_next_game. NULL stops timing.
+ */
+void pgn_stream_set_counters(PGN_Stream *stream, Perf_Counters *counters) {
+    stream->counters = counters;
+}
+
+size_t pgn_stream_buffer_capacity(const PGN_Stream *stream) {
+    return stream != NULL ? stream->capacity : 0;
+}
+
+void pgn_stream_close(PGN_Stream *stream) {
+    if (stream == NULL) {
+        return;
+    }
+    if (stream->owns_file && stream->file != NULL) {
+        fclose(stream->file);
+    }
+    ZSTD_freeDCtx(stream->dctx);
+    free(stream->in_buffer);
+    if (stream->map != NULL) {
+        munmap((void *)stream->map, stream->map_size);
+        close(stream->map_fd);
+    } else if (stream->decoders != NULL) {
+        // The buffer points into a segment
+        decoders_free(stream->decoders);
+    } else {
+        free(stream->buffer);
+    }
+    free(stream);
+}
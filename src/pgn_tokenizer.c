@@ -0,0 +1,136 @@
+#include "pgn_tokenizer.h"
+
+#include <string.h>
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static bool is_token_delimiter(char c) {
+    return is_space(c) || c == '{' || c == '}' || c == '(' || c == ')' || c == ';';
+}
+
+static bool is_result_token(const char *token, size_t length) {
+    return (length == 1 && token[0] == '*') ||
+           (length == 3 && (memcmp(token, "1-0", 3) == 0 || memcmp(token, "0-1", 3) == 0)) ||
+           (length == 7 && memcmp(token, "1/2-1/2", 7) == 0);
+}
+
+static const char *skip_comment(const char *p, const char *end) {
+    const char *close = memchr(p, '}', (size_t)(end - p));
+    return close ? close + 1 : end;
+}
+
+void pgn_tokenizer_init(PGN_Tokenizer *tokenizer, const char *movetext, size_t length) {
+    tokenizer->cursor = movetext;
+    tokenizer->end = movetext + length;
+    tokenizer->finished = false;
+}
+
+/**
+ * @brief Returns the next SAN token of a movetext.
+ *
+ * Skips move numbers ("12." and the black-move marker "12..."), {comments}
+ * including Lichess [%clk]/[%eval] annotations, ; line comments, nested
+ * (variations), $NAGs, and stops at the result ("1-0", "0-1", "1/2-1/2",
+ * "*"). Check and annotation suffixes stay on the token ("Nf3+", "e4!?");
+ * san_to_move accepts them.
+ *
+ * @param token_out Receives a pointer into the movetext.
+ * @param length_out Receives the token length.
+ * @return true if a token was returned, false when no moves are left.
+ */
+bool pgn_tokenizer_next(PGN_Tokenizer *tokenizer, const char **token_out, size_t *length_out) {
+    const char *p = tokenizer->cursor;
+    const char *end = tokenizer->end;
+    while (!tokenizer->finished && p < end) {
+        char c = *p;
+        if (is_space(c) || c == ')' || c == '}') {
+            p++;
+        } else if (c == '{') {
+            p = skip_comment(p, end);
+        } else if (c == ';') {
+            const char *newline = memchr(p, '\n', (size_t)(end - p));
+            p = newline ? newline + 1 : end;
+        } else if (c == '(') {
+            int depth = 0;
+            while (p < end) {
+                if (*p == '{') {
+                    p = skip_comment(p, end);
+                    continue;
+                }
+                if (*p == '(') {
+                    depth++;
+                } else if (*p == ')' && --depth == 0) {
+                    p++;
+                    break;
+                }
+                p++;
+            }
+        } else if (c == '$') {
+            p++;
+            while (p < end && *p >= '0' && *p <= '9') {
+                p++;
+            }
+        } else {
+            const char *start = p;
+            while (p < end && !is_token_delimiter(*p)) {
+                p++;
+            }
+            const char *s = start;
+            while (s < p && *s >= '0' && *s <= '9') {
+                s++;
+            }
+            if (s > start && s < p && *s == '.') {
+                // Move number, possibly glued to the move ("12.e4")
+                while (s < p && *s == '.') {
+                    s++;
+                }
+                if (s == p) {
+                    continue;
+                }
+                start = s;
+            } else if (is_result_token(start, (size_t)(p - start))) {
+                tokenizer->finished = true;
+                break;
+            } else if (s == p) {
+                continue; // bare number
+            }
+            tokenizer->cursor = p;
+            *token_out = start;
+            *length_out = (size_t)(p - start);
+            return true;
+        }
+    }
+    tokenizer->cursor = p;
+    return false;
+}
+
+/**
+ * @brief Tokenizes a whole movetext into a caller-provided array.
+ *
+ * Tokens longer than a san_move holds are truncated. Nothing is allocated,
+ * so the same array can be reused for every game.
+ *
+ * @param moves Output array; may be NULL when capacity is 0 to just count.
+ * @param capacity Number of entries in moves.
+ * @return Number of SAN tokens in the movetext. If this exceeds capacity,
+ *         only the first capacity tokens were written.
+ */
+int pgn_tokenize_moves(const char *movetext, size_t length, san_move *moves, int capacity) {
+    PGN_Tokenizer tokenizer;
+    pgn_tokenizer_init(&tokenizer, movetext, length);
+    const char *token;
+    size_t token_length;
+    int count = 0;
+    while (pgn_tokenizer_next(&tokenizer, &token, &token_length)) {
+        if (count < capacity) {
+            size_t n = token_length < sizeof(moves[count].notation) - 1
+                           ? token_length : sizeof(moves[count].notation) - 1;
+            memcpy(moves[count].notation, token, n);
+            moves[count].notation[n] = '\0';
+        }
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,1196 @@
+#define _POSIX_C_SOURCE 200809L
+#include "pipeline.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "arrow_ipc.h"
+#include "attacks.h"
+#include "fen_plus.h"
+#include "fen_record.h"
+#include "game_record.h"
+#include "output_writer.h"
+#include "perf_counters.h"
+#include "pgn_scan.h"
+#include "pgn_stream.h"
+#include "san_cache.h"
+#include "shard_writer.h"
+
+// A game copied into a batch, as offsets into the batch's input text
+typedef struct {
+    size_t header_offset;
+    size_t header_len;
+    size_t movetext_offset;
+    size_t movetext_len;
+    uint64_t index;
+    uint16_t time_control;  // table id, assigned by the reader for record output
+} Batch_Game;
+
+// Unit of work: a run of consecutive games and the CSV rows they produce.
+// Batches live in a fixed ring indexed by sequence number, so their buffers
+// are reused and stop growing once they have seen the largest batch.
+typedef struct {
+    uint64_t seq;
+    Text_Buffer input;
+    Batch_Game *games;
+    size_t game_count;
+    size_t game_capacity;
+    Text_Buffer output;
+    Text_Buffer records;    // uncompressed records before they become a block
+    Text_Buffer column;     // Arrow output: one column of the record batch at a time
+    Text_Buffer time_control_names; // table entries the reader added while filling it
+    void *compressor;       // zstd context for record blocks
+    FEN_Plus_Stats stats;
+    uint64_t next_game;     // index of the first game after this batch
+    uint64_t end_offset;    // decoded input offset where that game starts
+    bool failed;        // out of memory while filling or converting
+    bool ready;         // converted and waiting for the writer
+} Batch;
+
+// Work-stealing deque. The owner takes its oldest batch from the front so
+// output drains in order; thieves take the newest from the back.
+typedef struct {
+    pthread_mutex_t lock;
+    Batch **items;
+    size_t head;
+    size_t count;
+    size_t capacity;
+} Batch_Deque;
+
+// Padded to a cache line so workers do not share one while counting
+typedef struct {
+    double busy_seconds;
+    uint64_t steals;
+    char padding[48];
+} Worker_Counters;
+
+// Owners of the Perf_Counters slots; workers follow the writer
+enum {
+    PERF_SLOT_READER,
+    PERF_SLOT_WRITER,
+    PERF_SLOT_WORKERS
+};
+
+// Set from a signal handler through pipeline_request_report
+static volatile sig_atomic_t report_requested;
+
+typedef struct Pipeline Pipeline;
+
+typedef struct {
+    Pipeline *pipeline;
+    int id;
+} Worker;
+
+struct Pipeline {
+    const Pipeline_Options *options;
+    PGN_Stream *stream;
+    Batch *batches;
+    size_t window;              // batches in flight between reader and writer
+    int workers;
+    Batch_Deque *deques;
+    Worker_Counters *counters;
+    sem_t tasks;                // one post per queued batch, plus one stop per worker
+    sem_t free_slots;           // batches the reader may fill ahead of the writer
+    pthread_mutex_t ready_lock;
+    pthread_cond_t ready_cond;  // a batch became ready or the input ended
+    uint64_t batch_total;       // set with input_done, under ready_lock
+    bool input_done;
+    bool stopping;              // a batch or write failed: the reader and workers wind down
+    double read_seconds;
+    uint64_t filtered_games;                // reader only
+    uint64_t filtered_bytes;
+    uint64_t next_game;                     // reader only: input position after the last game read
+    uint64_t next_offset;
+    uint64_t range_end;                     // stop at the first game starting here; 0 = no limit
+    FEN_Record_Time_Controls time_controls; // record output: filled by the reader
+    FEN_Record_Index index;                 // record output: blocks written so far
+    Arrow_IPC_Index arrow_index;            // Arrow output: record batches written so far
+    Game_Record_Index game_index;           // game output: blocks and games written so far
+    Dedup_Table dedup;                      // shared by all workers
+    bool dedup_enabled;
+    San_Cache *san_caches;                  // one per worker, NULL if disabled
+    Opening_Book_Builder *book;             // book output: a map per worker
+    bool sharded;                           // output goes to options->output_dir
+    Shard_Writer shards;                    // writer thread only
+    Shard_Checkpoint checkpoint;            // totals of the shards written before this run, and
+                                            // the writer's copy of the time-control table
+    size_t written_time_controls;           // entries in that copy
+    void *header_compressor;                // zstd context for the CSV header frame of a shard
+    Text_Buffer header_block;
+    Perf_Counters *perf;                    // one per thread, see PERF_SLOT_*
+    size_t perf_count;
+    Perf_Clock clock;
+    double start_seconds;
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void deque_push_back(Batch_Deque *deque, Batch *batch) {
+    pthread_mutex_lock(&deque->lock);
+    deque->items[(deque->head + deque->count) % deque->capacity] = batch;
+    deque->count++;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static Batch *deque_pop_front(Batch_Deque *deque) {
+    Batch *batch = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        batch = deque->items[deque->head];
+        deque->head = (deque->head + 1) % deque->capacity;
+        deque->count--;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return batch;
+}
+
+static Batch *deque_pop_back(Batch_Deque *deque) {
+    Batch *batch = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        deque->count--;
+        batch = deque->items[(deque->head + deque->count) % deque->capacity];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return batch;
+}
+
+/**
+ * @brief Copies games from the stream into batch until it holds batch_bytes.
+ *
+ * @return false once the stream is exhausted (or failed), true if more games
+ *         may follow.
+ */
+static bool fill_batch(Pipeline *p, Batch *batch) {
+    bool records = p->options->format != PIPELINE_FORMAT_CSV && p->options->format != PIPELINE_FORMAT_BOOK;
+    bool filter = game_filter_active(&p->options->filter);
+    batch->input.length = 0;
+    batch->game_count = 0;
+    batch->failed = false;
+    batch->next_game = p->next_game;
+    batch->end_offset = p->next_offset;
+    batch->time_control_names.length = 0;
+    PGN_Game game;
+    while (batch->input.length < p->options->batch_bytes) {
+        if (!pgn_stream_next_game(p->stream, &game)) {
+            return false;
+        }
+        // The game belongs to the next range; the input position stays at its start
+        if (p->range_end > 0 && game.offset >= p->range_end) {
+            return false;
+        }
+        p->next_game = batch->next_game = game.index + 1;
+        p->next_offset = batch->end_offset = pgn_stream_offset(p->stream);
+        PGN_Header_Tags tags;
+        if (records || filter) {
+            pgn_scan_headers(game.header, game.header_len, &tags);
+        }
+        // Games the filter rejects are never copied, tokenized or replayed
+        if (filter && !game_filter_matches(&p->options->filter, &tags)) {
+            p->filtered_games++;
+            p->filtered_bytes += game.header_len + game.movetext_len;
+            continue;
+        }
+        if (batch->game_count == batch->game_capacity) {
+            size_t capacity = batch->game_capacity ? batch->game_capacity * 2 : 256;
+            Batch_Game *games = (Batch_Game *)realloc(batch->games, capacity * sizeof(Batch_Game));
+            if (games == NULL) {
+                batch->failed = true;
+                return false;
+            }
+            batch->games = games;
+            batch->game_capacity = capacity;
+        }
+        Batch_Game *slot = &batch->games[batch->game_count];
+        slot->header_offset = batch->input.length;
+        slot->header_len = game.header_len;
+        slot->movetext_offset = batch->input.length + game.header_len;
+        slot->movetext_len = game.movetext_len;
+        slot->index = game.index;
+        if (records) {
+            // Ids are given out here, in input order, so that they do not
+            // depend on which worker converts the game first
+            const char *name = tags.time_control.value ? tags.time_control.value : "-";
+            size_t length = tags.time_control.value ? tags.time_control.length : 1;
+            size_t known = p->time_controls.count;
+            slot->time_control = fen_record_time_control_id(&p->time_controls, name,
+                                                            length > 32 ? 32 : length);
+            // New entries travel with the batch, so the writer can keep its
+            // own copy of the table for shard footers without sharing this one
+            if (p->time_controls.count > known) {
+                const char *entry = p->time_controls.names.data + p->time_controls.offsets[known];
+                if (!text_buffer_append(&batch->time_control_names, entry, 1 + (uint8_t)entry[0])) {
+                    batch->failed = true;
+                    return false;
+                }
+            }
+        }
+        if (!text_buffer_append(&batch->input, game.header, game.header_len) ||
+            !text_buffer_append(&batch->input, game.movetext, game.movetext_len)) {
+            batch->failed = true;
+            return false;
+        }
+        batch->game_count++;
+    }
+    return true;
+}
+
+// fill_batch with its time charged to PERF_SCAN, less the decompression
+// time the stream charged to PERF_DECOMPRESS meanwhile
+static bool fill_batch_timed(Pipeline *p, Batch *batch) {
+#if PERF_COUNTERS
+    Perf_Counters *perf = &p->perf[PERF_SLOT_READER];
+    uint64_t start = perf_ticks();
+    uint64_t decompress = perf->ticks[PERF_DECOMPRESS];
+    uint64_t filtered = p->filtered_bytes;
+    bool more = fill_batch(p, batch);
+    perf_add(&perf->ticks[PERF_SCAN], perf_ticks() - start - (perf->ticks[PERF_DECOMPRESS] - decompress));
+    perf_add(&perf->bytes[PERF_SCAN], batch->input.length + (p->filtered_bytes - filtered));
+    return more;
+#else
+    return fill_batch(p, batch);
+#endif
+}
+
+static void convert_batch(Pipeline *p, Batch *batch, int worker) {
+    const Pipeline_Options *options = p->options;
+    Perf_Counters *perf = &p->perf[PERF_SLOT_WORKERS + worker];
+    Dedup_Table *dedup = p->dedup_enabled ? &p->dedup : NULL;
+    bool arrow = options->format == PIPELINE_FORMAT_ARROW;
+    bool games = options->format == PIPELINE_FORMAT_GAMES;
+    bool book = options->format == PIPELINE_FORMAT_BOOK;
+    bool records = options->format == PIPELINE_FORMAT_RECORDS || arrow;
+    bool compress = (records || games || p->sharded) && options->compression_level > 0;
+    Text_Buffer *out = compress || arrow ? &batch->records : &batch->output;
+    batch->output.length = 0;
+    out->length = 0;
+    memset(&batch->stats, 0, sizeof(batch->stats));
+    batch->stats.perf = perf;
+    batch->stats.san_cache = p->san_caches != NULL ? &p->san_caches[worker] : NULL;
+    for (size_t i = 0; i < batch->game_count && !batch->failed; i++) {
+        const Batch_Game *slot = &batch->games[i];
+        PGN_Game game;
+        game.header = batch->input.data + slot->header_offset;
+        game.header_len = slot->header_len;
+        game.movetext = batch->input.data + slot->movetext_offset;
+        game.movetext_len = slot->movetext_len;
+        game.index = slot->index;
+        PERF_START(game_start);
+        bool ok = book      ? opening_book_add_game(p->book, worker, &game, &batch->stats)
+                  : games   ? game_record_append_game(&game, slot->time_control, out, &batch->stats)
+                  : records ? fen_record_append_game(&game, slot->time_control, dedup, out, &batch->stats)
+                            : fen_plus_append_game(&game, dedup, out, &batch->stats);
+        PERF_GAME(perf, game_start);
+        if (!ok) {
+            batch->failed = true;
+        }
+    }
+    PERF_PLIES(perf, batch->stats.plies);
+    // Each batch of records or games becomes one block or one Arrow record batch,
+    // compressed here so that the work is spread over the workers. CSV
+    // shards are concatenated frames.
+    if (arrow && !batch->failed && out->length > 0) {
+        PERF_START(compress_start);
+        if (!arrow_ipc_encode_batch((const FEN_Record *)out->data, out->length / sizeof(FEN_Record),
+                                    options->compression_level, &batch->compressor, &batch->column,
+                                    &batch->output)) {
+            batch->failed = true;
+        }
+        PERF_STOP(perf, PERF_COMPRESS, compress_start);
+        PERF_BYTES(perf, PERF_COMPRESS, out->length);
+    } else if (compress && !batch->failed && out->length > 0) {
+        PERF_START(compress_start);
+        if (!fen_record_compress_block(out->data, out->length, options->compression_level, &batch->compressor,
+                                       &batch->output)) {
+            batch->failed = true;
+        }
+        PERF_STOP(perf, PERF_COMPRESS, compress_start);
+        PERF_BYTES(perf, PERF_COMPRESS, out->length);
+    }
+}
+
+static void *reader_main(void *arg) {
+    Pipeline *p = (Pipeline *)arg;
+    uint64_t seq = 0;
+    bool more = true;
+    while (more) {
+        sem_wait(&p->free_slots);
+        if (__atomic_load_n(&p->stopping, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        double start = now_seconds();
+        Batch *batch = &p->batches[seq % p->window];
+        more = fill_batch_timed(p, batch);
+        p->read_seconds += now_seconds() - start;
+        if (batch->game_count == 0 && !batch->failed) {
+            break;
+        }
+        batch->seq = seq;
+        deque_push_back(&p->deques[seq % (uint64_t)p->workers], batch);
+        sem_post(&p->tasks);
+        seq++;
+    }
+
+    pthread_mutex_lock(&p->ready_lock);
+    p->batch_total = seq;
+    __atomic_store_n(&p->input_done, true, __ATOMIC_RELEASE);
+    pthread_cond_signal(&p->ready_cond);
+    pthread_mutex_unlock(&p->ready_lock);
+    for (int i = 0; i < p->workers; i++) {
+        sem_post(&p->tasks);
+    }
+    return NULL;
+}
+
+static void *worker_main(void *arg) {
+    Worker *worker = (Worker *)arg;
+    Pipeline *p = worker->pipeline;
+    Worker_Counters *counters = &p->counters[worker->id];
+    for (;;) {
+        sem_wait(&p->tasks);
+        // Every post before the stop tokens matches a queued batch, but the
+        // batch this post stands for may already have been stolen while
+        // another is still on its way into a deque we scanned; rescan until
+        // the input is done.
+        Batch *batch = NULL;
+        for (;;) {
+            batch = deque_pop_front(&p->deques[worker->id]);
+            for (int i = 1; batch == NULL && i < p->workers; i++) {
+                batch = deque_pop_back(&p->deques[(worker->id + i) % p->workers]);
+                if (batch != NULL) {
+                    counters->steals++;
+                }
+            }
+            if (batch != NULL || __atomic_load_n(&p->input_done, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+            sched_yield();
+        }
+        if (batch == NULL) {
+            break;
+        }
+
+        // The writer throws away everything after a failure, so queued
+        // batches are only handed back
+        if (__atomic_load_n(&p->stopping, __ATOMIC_ACQUIRE)) {
+            batch->failed = true;
+        } else {
+            double start = now_seconds();
+            convert_batch(p, batch, worker->id);
+            counters->busy_seconds += now_seconds() - start;
+        }
+
+        pthread_mutex_lock(&p->ready_lock);
+        batch->ready = true;
+        pthread_cond_signal(&p->ready_cond);
+        pthread_mutex_unlock(&p->ready_lock);
+    }
+    return NULL;
+}
+
+// Starts the next shard with the record file header or the CSV header line
+static bool begin_shard(Pipeline *p, Pipeline_Stats *stats) {
+    const Pipeline_Options *options = p->options;
+    if (!shard_writer_open(&p->shards)) {
+        snprintf(stats->error, sizeof(stats->error), "cannot create a shard in %s: %s", options->output_dir,
+                 strerror(errno));
+        return false;
+    }
+    Output_Writer *writer = &p->shards.writer;
+    if (options->format == PIPELINE_FORMAT_RECORDS) {
+        fen_record_index_free(&p->index);
+        return fen_record_write_header(writer, options->compression_level, &p->index);
+    }
+    if (options->format == PIPELINE_FORMAT_ARROW) {
+        arrow_ipc_index_free(&p->arrow_index);
+        return arrow_ipc_write_header(writer, &p->arrow_index);
+    }
+    if (options->format == PIPELINE_FORMAT_GAMES) {
+        game_record_index_free(&p->game_index);
+        return game_record_write_header(writer, options->compression_level, &p->game_index);
+    }
+    if (!options->write_header) {
+        return true;
+    }
+    if (options->compression_level == 0) {
+        return output_writer_write(writer, FEN_PLUS_CSV_HEADER, strlen(FEN_PLUS_CSV_HEADER));
+    }
+    // A frame of its own, so that every shard is a complete .csv.zst file
+    if (!fen_record_compress_block(FEN_PLUS_CSV_HEADER, strlen(FEN_PLUS_CSV_HEADER), options->compression_level,
+                                   &p->header_compressor, &p->header_block)) {
+        snprintf(stats->error, sizeof(stats->error), "out of memory");
+        return false;
+    }
+    return output_writer_write(writer, p->header_block.data, p->header_block.length);
+}
+
+// Finishes the open shard, if any, and records in the checkpoint that the
+// input is converted up to game next_game at decoded offset offset
+static bool end_shard(Pipeline *p, uint64_t next_game, uint64_t offset, bool complete, Pipeline_Stats *stats) {
+    if (p->shards.fd >= 0) {
+        double start = now_seconds();
+        FEN_Record_Time_Controls written;
+        memset(&written, 0, sizeof(written));
+        written.names = p->checkpoint.time_controls;
+        written.count = p->written_time_controls;
+        int format = p->options->format;
+        bool ok = format == PIPELINE_FORMAT_CSV ||
+                  (format == PIPELINE_FORMAT_RECORDS && fen_record_write_footer(&p->shards.writer, &p->index, &written)) ||
+                  (format == PIPELINE_FORMAT_ARROW &&
+                   arrow_ipc_write_footer(&p->shards.writer, &p->arrow_index, &written)) ||
+                  (format == PIPELINE_FORMAT_GAMES &&
+                   game_record_write_footer(&p->shards.writer, &p->game_index, &written));
+        ok = ok && shard_writer_close(&p->shards);
+        stats->write_seconds += now_seconds() - start;
+        if (!ok) {
+            snprintf(stats->error, sizeof(stats->error), "cannot finish shard %llu: %s",
+                     (unsigned long long)p->shards.shard, strerror(errno));
+            return false;
+        }
+        stats->shards++;
+    }
+    Shard_Checkpoint checkpoint = p->checkpoint;
+    checkpoint.next_game = next_game;
+    checkpoint.offset = offset;
+    checkpoint.shard = p->shards.shard;
+    checkpoint.games += stats->games;
+    checkpoint.rejected += stats->rejected;
+    checkpoint.plies += stats->plies;
+    checkpoint.duplicates += stats->duplicates;
+    checkpoint.bytes_written += p->shards.bytes_written;
+    checkpoint.complete = complete;
+    if (!shard_checkpoint_save(p->options->output_dir, &checkpoint)) {
+        snprintf(stats->error, sizeof(stats->error), "cannot write the checkpoint in %s: %s",
+                 p->options->output_dir, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+// A header or footer that did not go out: the writer keeps write errors,
+// anything else ran out of memory
+static void output_error(const Output_Writer *writer, Pipeline_Stats *stats) {
+    if (writer->error != 0) {
+        snprintf(stats->error, sizeof(stats->error), "write error: %s", strerror(writer->error));
+    } else {
+        snprintf(stats->error, sizeof(stats->error), "out of memory");
+    }
+}
+
+// Starts the single output file: the format's header, or the CSV header line
+static bool write_file_header(Pipeline *p, Output_Writer *writer, Pipeline_Stats *stats) {
+    const Pipeline_Options *options = p->options;
+    bool ok = true;
+    switch (options->format) {
+        case PIPELINE_FORMAT_RECORDS:
+            ok = fen_record_write_header(writer, options->compression_level, &p->index);
+            break;
+        case PIPELINE_FORMAT_ARROW:
+            ok = arrow_ipc_write_header(writer, &p->arrow_index);
+            break;
+        case PIPELINE_FORMAT_GAMES:
+            ok = game_record_write_header(writer, options->compression_level, &p->game_index);
+            break;
+        case PIPELINE_FORMAT_BOOK:
+            break;
+        default:
+            ok = !options->write_header ||
+                 output_writer_write(writer, FEN_PLUS_CSV_HEADER, strlen(FEN_PLUS_CSV_HEADER));
+            break;
+    }
+    if (!ok) {
+        output_error(writer, stats);
+    }
+    return ok;
+}
+
+// Ends the single output file with the format's footer; a book is written
+// whole here, its runs merged on the worker threads
+static bool write_file_footer(Pipeline *p, Output_Writer *writer, Pipeline_Stats *stats) {
+    bool ok = true;
+    switch (p->options->format) {
+        case PIPELINE_FORMAT_RECORDS:
+            ok = fen_record_write_footer(writer, &p->index, &p->time_controls);
+            break;
+        case PIPELINE_FORMAT_ARROW:
+            ok = arrow_ipc_write_footer(writer, &p->arrow_index, &p->time_controls);
+            break;
+        case PIPELINE_FORMAT_GAMES:
+            ok = game_record_write_footer(writer, &p->game_index, &p->time_controls);
+            break;
+        case PIPELINE_FORMAT_BOOK:
+            if (!opening_book_finish(p->book, writer, p->workers, &stats->book)) {
+                snprintf(stats->error, sizeof(stats->error), "%s", stats->book.error);
+                return false;
+            }
+            break;
+        default:
+            break;
+    }
+    if (!ok) {
+        output_error(writer, stats);
+    }
+    return ok;
+}
+
+// Adds a converted batch to the totals and queues its rows on the writer.
+// Returns false on a failed batch or write; the threaded run then stops
+// reading and converting, and the batches in flight are drained unwritten.
+// Sharded output rotates here, between batches, so shards and checkpoints
+// always end at a game boundary.
+static bool finish_batch(Pipeline *p, Batch *batch, Output_Writer *writer, bool ok,
+                         Pipeline_Stats *stats) {
+    if (batch->failed) {
+        if (ok) {
+            const char *error = p->book != NULL ? opening_book_builder_error(p->book) : NULL;
+            snprintf(stats->error, sizeof(stats->error), "%s", error != NULL ? error : "out of memory");
+        }
+        return false;
+    }
+    stats->games += batch->stats.games;
+    stats->rejected += batch->stats.rejected;
+    stats->plies += batch->stats.plies;
+    stats->duplicates += batch->stats.duplicates;
+    stats->untracked += batch->stats.untracked;
+    stats->san_cache_hits += batch->stats.san_cache_hits;
+    stats->san_cache_misses += batch->stats.san_cache_misses;
+    stats->batches++;
+    if (!ok) {
+        return false;
+    }
+    if (p->sharded && batch->time_control_names.length > 0) {
+        const Text_Buffer *names = &batch->time_control_names;
+        for (size_t at = 0; at < names->length; at += 1 + (uint8_t)names->data[at]) {
+            p->written_time_controls++;
+        }
+        if (!text_buffer_append(&p->checkpoint.time_controls, names->data, names->length)) {
+            snprintf(stats->error, sizeof(stats->error), "out of memory");
+            return false;
+        }
+    }
+    if (p->sharded && p->shards.fd < 0 && !begin_shard(p, stats)) {
+        if (stats->error[0] == '\0') {
+            snprintf(stats->error, sizeof(stats->error), "write error: %s", strerror(writer->error));
+        }
+        return false;
+    }
+    if (p->options->format == PIPELINE_FORMAT_RECORDS && batch->output.length > 0 &&
+        !fen_record_add_block(&p->index, batch->output.length, (size_t)batch->stats.plies)) {
+        snprintf(stats->error, sizeof(stats->error), "out of memory");
+        return false;
+    }
+    // The writer walks the uncompressed games for the offset index
+    const Text_Buffer *games = p->options->compression_level > 0 ? &batch->records : &batch->output;
+    if (p->options->format == PIPELINE_FORMAT_GAMES && batch->output.length > 0 &&
+        !game_record_add_block(&p->game_index, games->data, games->length, batch->output.length)) {
+        snprintf(stats->error, sizeof(stats->error), "out of memory");
+        return false;
+    }
+    if (p->options->format == PIPELINE_FORMAT_ARROW && batch->output.length > 0 &&
+        !arrow_ipc_add_batch(&p->arrow_index, batch->output.data, batch->output.length,
+                             (size_t)batch->stats.plies)) {
+        snprintf(stats->error, sizeof(stats->error), "out of memory");
+        return false;
+    }
+    double start = now_seconds();
+    PERF_START(write_start);
+    ok = output_writer_write(writer, batch->output.data, batch->output.length);
+    PERF_STOP(&p->perf[PERF_SLOT_WRITER], PERF_WRITE, write_start);
+    PERF_BYTES(&p->perf[PERF_SLOT_WRITER], PERF_WRITE, batch->output.length);
+    stats->write_seconds += now_seconds() - start;
+    if (!ok) {
+        snprintf(stats->error, sizeof(stats->error), "write error: %s", strerror(writer->error));
+    } else if (p->sharded && writer->bytes_written + writer->length >= p->options->shard_bytes) {
+        ok = end_shard(p, batch->next_game, batch->end_offset, false, stats);
+    }
+    return ok;
+}
+
+/**
+ * @brief Writes the JSON run report to options->report_path, through a
+ *        temporary file so a reader never sees half a report.
+ *
+ * A partial report (complete false) is taken by the writer while the other
+ * threads keep converting; its byte counts then come from the counters, and
+ * bytes_read is null because only the reader knows it.
+ */
+static bool write_report(Pipeline *p, const Pipeline_Stats *stats, bool complete) {
+    const char *path = p->options->report_path;
+    char temp_path[4096];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) {
+        return false;
+    }
+    FILE *out = fopen(temp_path, "w");
+    if (out == NULL) {
+        return false;
+    }
+    Perf_Counters total;
+    perf_counters_sum(p->perf, p->perf_count, &total);
+    double wall = complete ? stats->wall_seconds : now_seconds() - p->start_seconds;
+    double ticks_per_second = perf_ticks_per_second(&p->clock);
+    fprintf(out, "{\n");
+    fprintf(out, "  \"complete\": %s,\n", complete ? "true" : "false");
+    fprintf(out, "  \"wall_seconds\": %.6f,\n", wall);
+    fprintf(out, "  \"threads\": %d,\n", stats->threads);
+    fprintf(out, "  \"decode_threads\": %d,\n", stats->decode_threads);
+    fprintf(out, "  \"mapped_input\": %s,\n", stats->mapped_input ? "true" : "false");
+    fprintf(out, "  \"games\": %llu,\n", (unsigned long long)stats->games);
+    fprintf(out, "  \"rejected\": %llu,\n", (unsigned long long)stats->rejected);
+    fprintf(out, "  \"plies\": %llu,\n", (unsigned long long)stats->plies);
+    fprintf(out, "  \"filtered_games\": %llu,\n", (unsigned long long)stats->filtered_games);
+    fprintf(out, "  \"duplicates\": %llu,\n", (unsigned long long)stats->duplicates);
+    // Plies resolved by a hit take hit_ns on average and by a miss miss_ns;
+    // the difference is what san_to_move costs, saved on every hit
+    double ns_per_tick = 1e9 / ticks_per_second;
+    double hit_ns = total.san_cache_plies[0] ? ns_per_tick * total.san_cache_ticks[0] / total.san_cache_plies[0] : 0;
+    double miss_ns =
+        total.san_cache_plies[1] ? ns_per_tick * total.san_cache_ticks[1] / total.san_cache_plies[1] : 0;
+    uint64_t lookups = stats->san_cache_hits + stats->san_cache_misses;
+    fprintf(out, "  \"san_cache\": {\"memory\": %llu, \"hits\": %llu, \"misses\": %llu, \"hit_rate\": %.4f, "
+                 "\"hit_ns\": %.1f, \"miss_ns\": %.1f, \"seconds_saved\": %.6f},\n",
+            (unsigned long long)stats->san_cache_memory, (unsigned long long)stats->san_cache_hits,
+            (unsigned long long)stats->san_cache_misses, lookups ? (double)stats->san_cache_hits / lookups : 0.0,
+            hit_ns, miss_ns,
+            hit_ns > 0 && miss_ns > hit_ns ? stats->san_cache_hits * (miss_ns - hit_ns) * 1e-9 : 0.0);
+    if (complete) {
+        fprintf(out, "  \"bytes_read\": %llu,\n", (unsigned long long)stats->bytes_read);
+        fprintf(out, "  \"bytes_decoded\": %llu,\n", (unsigned long long)stats->bytes_decoded);
+        fprintf(out, "  \"bytes_written\": %llu,\n", (unsigned long long)stats->bytes_written);
+    } else {
+        fprintf(out, "  \"bytes_read\": null,\n");
+        fprintf(out, "  \"bytes_decoded\": %llu,\n", (unsigned long long)total.bytes[PERF_DECOMPRESS]);
+        fprintf(out, "  \"bytes_written\": %llu,\n", (unsigned long long)total.bytes[PERF_WRITE]);
+    }
+    fprintf(out, "  \"games_per_second\": %.1f,\n", wall > 0 ? stats->games / wall : 0.0);
+    fprintf(out, "  \"peak_rss_bytes\": %llu,\n", (unsigned long long)perf_peak_rss_bytes());
+    perf_write_json(&total, ticks_per_second, out);
+    fprintf(out, "\n}\n");
+    bool ok = !ferror(out);
+    ok = fclose(out) == 0 && ok;
+    if (!ok || rename(temp_path, path) != 0) {
+        remove(temp_path);
+        return false;
+    }
+    return true;
+}
+
+// Writes a partial report if one was asked for since the last batch. Called
+// by the writer between batches; a failed write only loses that snapshot.
+static void check_report_request(Pipeline *p, const Pipeline_Stats *stats) {
+    if (report_requested && p->options->report_path != NULL) {
+        report_requested = 0;
+        write_report(p, stats, false);
+    }
+}
+
+/**
+ * @brief Asks the running pipeline for a partial report at the next batch
+ *        boundary. Safe to call from a signal handler.
+ */
+void pipeline_request_report(void) {
+    report_requested = 1;
+}
+
+// Reads, converts and writes one batch at a time on the calling thread
+static bool run_inline(Pipeline *p, Output_Writer *writer, Pipeline_Stats *stats) {
+    Batch *batch = &p->batches[0];
+    bool ok = true;
+    bool more = true;
+    while (more && ok) {
+        double start = now_seconds();
+        more = fill_batch_timed(p, batch);
+        p->read_seconds += now_seconds() - start;
+        if (batch->game_count == 0 && !batch->failed) {
+            break;
+        }
+        start = now_seconds();
+        convert_batch(p, batch, 0);
+        p->counters[0].busy_seconds += now_seconds() - start;
+        ok = finish_batch(p, batch, writer, ok, stats);
+        check_report_request(p, stats);
+    }
+    return ok;
+}
+
+static bool run_threaded(Pipeline *p, Output_Writer *writer, Pipeline_Stats *stats) {
+    sem_init(&p->tasks, 0, 0);
+    sem_init(&p->free_slots, 0, (unsigned)p->window);
+    pthread_mutex_init(&p->ready_lock, NULL);
+    pthread_cond_init(&p->ready_cond, NULL);
+
+    Worker *workers = (Worker *)calloc((size_t)p->workers, sizeof(Worker));
+    pthread_t *threads = (pthread_t *)calloc((size_t)p->workers, sizeof(pthread_t));
+    pthread_t reader;
+    bool ok = workers != NULL && threads != NULL;
+    int started = 0;
+    if (ok) {
+        for (; started < p->workers; started++) {
+            workers[started].pipeline = p;
+            workers[started].id = started;
+            if (pthread_create(&threads[started], NULL, worker_main, &workers[started]) != 0) {
+                break;
+            }
+        }
+        ok = started == p->workers && pthread_create(&reader, NULL, reader_main, p) == 0;
+    }
+    if (!ok) {
+        snprintf(stats->error, sizeof(stats->error), "cannot start pipeline threads");
+        // Release whatever started: no input will arrive, so post the stops
+        __atomic_store_n(&p->input_done, true, __ATOMIC_RELEASE);
+        for (int i = 0; i < started; i++) {
+            sem_post(&p->tasks);
+        }
+    } else {
+        // The calling thread is the writer: it takes batches strictly in
+        // sequence order, which keeps the output identical to a serial run.
+        for (uint64_t next = 0;; next++) {
+            Batch *batch = &p->batches[next % p->window];
+            pthread_mutex_lock(&p->ready_lock);
+            while (!batch->ready && !(p->input_done && next >= p->batch_total)) {
+                pthread_cond_wait(&p->ready_cond, &p->ready_lock);
+            }
+            bool have_batch = batch->ready;
+            pthread_mutex_unlock(&p->ready_lock);
+            if (!have_batch) {
+                break;
+            }
+            ok = finish_batch(p, batch, writer, ok, stats);
+            if (!ok) {
+                __atomic_store_n(&p->stopping, true, __ATOMIC_RELEASE);
+            }
+            batch->ready = false;
+            sem_post(&p->free_slots);
+            check_report_request(p, stats);
+        }
+        pthread_join(reader, NULL);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    for (int i = 0; i < p->workers; i++) {
+        stats->steals += p->counters[i].steals;
+    }
+
+    free(workers);
+    free(threads);
+    pthread_cond_destroy(&p->ready_cond);
+    pthread_mutex_destroy(&p->ready_lock);
+    sem_destroy(&p->free_slots);
+    sem_destroy(&p->tasks);
+    return ok;
+}
+
+void pipeline_default_options(Pipeline_Options *options) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    options->threads = cpus > 0 ? (int)cpus : 1;
+    options->decode_threads = 0;
+    options->map_input = true;
+    options->batch_bytes = PIPELINE_DEFAULT_BATCH_BYTES;
+    options->write_header = true;
+    options->format = PIPELINE_FORMAT_CSV;
+    options->compression_level = PIPELINE_DEFAULT_COMPRESSION_LEVEL;
+    options->dedup_max_count = 0;
+    options->dedup_keep_every = 0;
+    options->dedup_memory = DEDUP_DEFAULT_MEMORY;
+    options->san_cache_memory = SAN_CACHE_DEFAULT_MEMORY;
+    game_filter_init(&options->filter);
+    opening_book_default_options(&options->book);
+    options->output_dir = NULL;
+    options->shard_bytes = PIPELINE_DEFAULT_SHARD_BYTES;
+    options->resume = false;
+    options->range_start = 0;
+    options->range_end = 0;
+    options->report_path = NULL;
+}
+
+// Sharded output: reads the checkpoint when resuming and sets up the shard
+// writer. Sets *start_offset and *first_game to where the input continues
+// and *complete if a previous run already finished.
+static bool setup_shards(Pipeline *p, const char *input_path, uint64_t *start_offset, uint64_t *first_game,
+                         bool *complete, Pipeline_Stats *stats) {
+    const Pipeline_Options *options = p->options;
+    struct stat st;
+    uint64_t input_size = strcmp(input_path, "-") != 0 && stat(input_path, &st) == 0 ? (uint64_t)st.st_size : 0;
+    if (options->resume && input_size == 0) {
+        snprintf(stats->error, sizeof(stats->error), "cannot resume reading from %s", input_path);
+        return false;
+    }
+    if (options->resume && shard_checkpoint_load(options->output_dir, &p->checkpoint)) {
+        if (p->checkpoint.input_size != input_size || p->checkpoint.range_end != options->range_end) {
+            snprintf(stats->error, sizeof(stats->error), "the checkpoint in %s is for another input or range",
+                     options->output_dir);
+            return false;
+        }
+        *start_offset = p->checkpoint.offset;
+        *first_game = p->checkpoint.next_game;
+        *complete = p->checkpoint.complete;
+        // Same ids as the interrupted run gave out, in the same order
+        const Text_Buffer *names = &p->checkpoint.time_controls;
+        for (size_t at = 0; at < names->length; at += 1 + (uint8_t)names->data[at]) {
+            fen_record_time_control_id(&p->time_controls, names->data + at + 1, (uint8_t)names->data[at]);
+            p->written_time_controls++;
+        }
+    } else if (options->resume && errno != ENOENT) {
+        snprintf(stats->error, sizeof(stats->error), "cannot read the checkpoint in %s: %s", options->output_dir,
+                 strerror(errno));
+        return false;
+    } else {
+        memset(&p->checkpoint, 0, sizeof(p->checkpoint));
+    }
+    p->checkpoint.input_size = input_size;
+    p->checkpoint.range_end = options->range_end;
+    const char *extension = options->format == PIPELINE_FORMAT_RECORDS ? ".fenrec"
+                            : options->format == PIPELINE_FORMAT_ARROW ? ".arrow"
+                            : options->format == PIPELINE_FORMAT_GAMES ? ".fengame"
+                            : options->compression_level > 0          ? ".csv.zst"
+                                                                      : ".csv";
+    if (!shard_writer_init(&p->shards, options->output_dir, extension, p->checkpoint.shard)) {
+        snprintf(stats->error, sizeof(stats->error), "cannot write shards to %s: %s", options->output_dir,
+                 strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+// Opens the input, positioned at start_offset. Decoder threads only start at
+// the beginning of the input; a resumed or ranged run decodes on the reader.
+// Plain files are mapped when allowed; pipes and .zst inputs are read.
+static PGN_Stream *open_input(const char *input_path, uint64_t start_offset, uint64_t first_game,
+                              const Pipeline_Options *options, Pipeline_Stats *stats) {
+    PGN_Stream *stream = NULL;
+    PGN_Index index;
+    bool have_index = (options->decode_threads > 0 || start_offset > 0) && pgn_index_load(input_path, &index);
+    // With a frame index (sidecar or seek table) and more than one frame,
+    // several threads can decompress; otherwise the reader does it alone
+    if (have_index && options->decode_threads > 0 && start_offset == 0 && first_game == 0 && index.count > 1) {
+        stream = pgn_stream_open_parallel(input_path, &index, options->decode_threads, PGN_STREAM_SEGMENT_BYTES);
+        stats->decode_threads = stream != NULL ? options->decode_threads : 0;
+    }
+    if (stream == NULL && options->map_input) {
+        stream = pgn_stream_open_mapped(input_path, 0, 0);
+        stats->mapped_input = stream != NULL;
+    }
+    if (stream != NULL && stats->mapped_input) {
+        if (!pgn_stream_seek(stream, start_offset, first_game, NULL)) {
+            snprintf(stats->error, sizeof(stats->error), "cannot seek %s to offset %llu", input_path,
+                     (unsigned long long)start_offset);
+            pgn_stream_close(stream);
+            stream = NULL;
+        }
+    } else if (stream == NULL) {
+        stream = pgn_stream_open(input_path);
+        if (stream != NULL && !pgn_stream_seek(stream, start_offset, first_game, have_index ? &index : NULL)) {
+            snprintf(stats->error, sizeof(stats->error), "cannot seek %s to offset %llu%s%s", input_path,
+                     (unsigned long long)start_offset, pgn_stream_error(stream) ? ": " : "",
+                     pgn_stream_error(stream) ? pgn_stream_error(stream) : "");
+            pgn_stream_close(stream);
+            stream = NULL;
+        }
+    }
+    if (have_index) {
+        pgn_index_free(&index);
+    }
+    return stream;
+}
+
+/**
+ * @brief Converts a .pgn or .pgn.zst file to FEN+ CSV rows, binary records,
+ *        an Arrow IPC file, a game file or an opening book.
+ *
+ * One reader thread decompresses and splits the input into batches of whole
+ * games, worker threads convert batches (stealing from each other when their
+ * own deque runs dry), and the calling thread writes results in input order.
+ * The output is byte-identical for any number of threads. For a book the
+ * workers count moves instead, and the merge of their runs at the end is
+ * what gets written.
+ *
+ * With options->output_dir set, the output is split into shards of about
+ * shard_bytes instead, each a complete CSV (.csv.zst unless the level is 0)
+ * record, Arrow or game file, and a checkpoint is written after every finished shard.
+ * A run with options->resume continues after the last finished shard; the
+ * shards come out the same as from an uninterrupted run.
+ *
+ * @param input_path Input file, "-" for stdin.
+ * @param output_fd File descriptor receiving the CSV, record, Arrow or game file; unused
+ *        with options->output_dir.
+ * @param options Thread count, batch size and output format; see
+ *        pipeline_default_options. Record, Arrow and game files always
+ *        get their header.
+ * @param stats Filled with counters and per-stage timings.
+ * @return true on success; on failure stats->error says why.
+ */
+bool pipeline_run(const char *input_path, int output_fd, const Pipeline_Options *options,
+                  Pipeline_Stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    double start = now_seconds();
+    attacks_init();
+    if (options->format == PIPELINE_FORMAT_GAMES && options->dedup_max_count > 0) {
+        snprintf(stats->error, sizeof(stats->error), "dedup drops rows, so it does not apply to game output");
+        return false;
+    }
+    if (options->format == PIPELINE_FORMAT_BOOK && (options->dedup_max_count > 0 || options->output_dir != NULL)) {
+        snprintf(stats->error, sizeof(stats->error), "a book is one file of counts; dedup and shards do not apply");
+        return false;
+    }
+    if (options->resume && options->dedup_max_count > 0) {
+        snprintf(stats->error, sizeof(stats->error),
+                 "the dedup table is not in the checkpoint, so a resumed run cannot dedup");
+        return false;
+    }
+
+    Pipeline p;
+    memset(&p, 0, sizeof(p));
+    p.options = options;
+    p.start_seconds = start;
+    perf_clock_start(&p.clock);
+    p.workers = options->threads > 0 ? options->threads : 1;
+    p.window = options->threads > 0 ? 2 * (size_t)p.workers + 2 : 1;
+    stats->threads = options->threads;
+    p.sharded = options->output_dir != NULL;
+    p.shards.fd = -1;
+    p.range_end = options->range_end;
+
+    uint64_t start_offset = options->range_start;
+    uint64_t first_game = 0;
+    bool complete = false;
+    if (p.sharded && !setup_shards(&p, input_path, &start_offset, &first_game, &complete, stats)) {
+        shard_writer_free(&p.shards);
+        shard_checkpoint_free(&p.checkpoint);
+        fen_record_time_controls_free(&p.time_controls);
+        return false;
+    }
+    stats->start_offset = start_offset;
+    stats->first_shard = p.shards.shard;
+    if (complete) {
+        shard_writer_free(&p.shards);
+        shard_checkpoint_free(&p.checkpoint);
+        fen_record_time_controls_free(&p.time_controls);
+        stats->wall_seconds = now_seconds() - start;
+        return true;
+    }
+    p.stream = open_input(input_path, start_offset, first_game, options, stats);
+    if (p.stream == NULL) {
+        if (stats->error[0] == '\0') {
+            snprintf(stats->error, sizeof(stats->error), "cannot open %s", input_path);
+        }
+        if (p.sharded) {
+            shard_writer_free(&p.shards);
+            shard_checkpoint_free(&p.checkpoint);
+        }
+        fen_record_time_controls_free(&p.time_controls);
+        return false;
+    }
+    p.next_game = first_game;
+    p.next_offset = pgn_stream_offset(p.stream);
+    p.batches = (Batch *)calloc(p.window, sizeof(Batch));
+    p.deques = (Batch_Deque *)calloc((size_t)p.workers, sizeof(Batch_Deque));
+    p.counters = (Worker_Counters *)calloc((size_t)p.workers, sizeof(Worker_Counters));
+    // Cache-line aligned, so no two threads count on the same line
+    p.perf_count = PERF_SLOT_WORKERS + (size_t)p.workers;
+    void *perf = NULL;
+    if (posix_memalign(&perf, 64, p.perf_count * sizeof(Perf_Counters)) == 0) {
+        p.perf = (Perf_Counters *)perf;
+        memset(p.perf, 0, p.perf_count * sizeof(Perf_Counters));
+        pgn_stream_set_counters(p.stream, &p.perf[PERF_SLOT_READER]);
+    }
+    bool ok = p.batches != NULL && p.deques != NULL && p.counters != NULL && p.perf != NULL;
+    for (int i = 0; ok && i < p.workers; i++) {
+        p.deques[i].capacity = p.window;
+        p.deques[i].items = (Batch **)calloc(p.window, sizeof(Batch *));
+        ok = p.deques[i].items != NULL;
+        if (ok) {
+            pthread_mutex_init(&p.deques[i].lock, NULL);
+        }
+    }
+    if (ok && options->dedup_max_count > 0) {
+        ok = p.dedup_enabled = dedup_table_init(&p.dedup, options->dedup_memory, options->dedup_max_count,
+                                                options->dedup_keep_every);
+    }
+    if (ok && options->san_cache_memory > 0) {
+        p.san_caches = (San_Cache *)calloc((size_t)p.workers, sizeof(San_Cache));
+        ok = p.san_caches != NULL;
+        for (int i = 0; ok && i < p.workers; i++) {
+            ok = san_cache_init(&p.san_caches[i], options->san_cache_memory);
+        }
+    }
+    if (ok && options->format == PIPELINE_FORMAT_BOOK) {
+        p.book = opening_book_builder_create(&options->book, p.workers, stats->error, sizeof(stats->error));
+        ok = p.book != NULL;
+    }
+    Output_Writer writer;
+    bool have_writer = ok && !p.sharded && output_writer_init(&writer, output_fd);
+    if (!ok || (!p.sharded && !have_writer)) {
+        if (stats->error[0] == '\0') {
+            snprintf(stats->error, sizeof(stats->error), "out of memory");
+        }
+        ok = false;
+    }
+
+    if (ok && have_writer) {
+        ok = write_file_header(&p, &writer, stats);
+    }
+    if (ok) {
+        Output_Writer *out = p.sharded ? &p.shards.writer : &writer;
+        ok = options->threads > 0 ? run_threaded(&p, out, stats) : run_inline(&p, out, stats);
+    }
+    if (ok && pgn_stream_error(p.stream) != NULL) {
+        snprintf(stats->error, sizeof(stats->error), "%s: %s", input_path, pgn_stream_error(p.stream));
+        ok = false;
+    }
+    if (ok && have_writer) {
+        ok = write_file_footer(&p, &writer, stats);
+    }
+    if (p.sharded) {
+        // The reader is done, so its position is the end of the input or range
+        ok = ok && end_shard(&p, p.next_game, p.next_offset, true, stats);
+        stats->bytes_written = p.shards.bytes_written;
+        shard_writer_free(&p.shards);
+        shard_checkpoint_free(&p.checkpoint);
+        fen_record_free_context(p.header_compressor);
+        text_buffer_free(&p.header_block);
+    }
+    if (have_writer) {
+        double write_start = now_seconds();
+        if (ok && !output_writer_flush(&writer)) {
+            snprintf(stats->error, sizeof(stats->error), "write error: %s", strerror(writer.error));
+            ok = false;
+        }
+        stats->write_seconds += now_seconds() - write_start;
+        stats->bytes_written = writer.bytes_written;
+        output_writer_free(&writer);
+    }
+
+    if (p.dedup_enabled) {
+        stats->dedup_pairs = dedup_table_used(&p.dedup);
+        stats->dedup_memory = dedup_table_memory(&p.dedup);
+        dedup_table_free(&p.dedup);
+    }
+    for (int i = 0; p.san_caches != NULL && i < p.workers; i++) {
+        stats->san_cache_memory = san_cache_memory(&p.san_caches[i]);
+        san_cache_free(&p.san_caches[i]);
+    }
+    free(p.san_caches);
+    opening_book_builder_free(p.book);
+    stats->bytes_read = pgn_stream_bytes_read(p.stream);
+    stats->bytes_decoded = pgn_stream_bytes_decoded(p.stream);
+    stats->read_seconds = p.read_seconds;
+    stats->filtered_games = p.filtered_games;
+    stats->filtered_bytes = p.filtered_bytes;
+    for (int i = 0; p.counters != NULL && i < p.workers; i++) {
+        stats->convert_seconds += p.counters[i].busy_seconds;
+    }
+
+    for (size_t i = 0; p.batches != NULL && i < p.window; i++) {
+        text_buffer_free(&p.batches[i].input);
+        text_buffer_free(&p.batches[i].output);
+        text_buffer_free(&p.batches[i].records);
+        text_buffer_free(&p.batches[i].column);
+        text_buffer_free(&p.batches[i].time_control_names);
+        fen_record_free_context(p.batches[i].compressor);
+        free(p.batches[i].games);
+    }
+    fen_record_time_controls_free(&p.time_controls);
+    fen_record_index_free(&p.index);
+    arrow_ipc_index_free(&p.arrow_index);
+    game_record_index_free(&p.game_index);
+    for (int i = 0; p.deques != NULL && i < p.workers; i++) {
+        if (p.deques[i].items != NULL) {
+            pthread_mutex_destroy(&p.deques[i].lock);
+            free(p.deques[i].items);
+        }
+    }
+    free(p.batches);
+    free(p.deques);
+    free(p.counters);
+    pgn_stream_close(p.stream);
+    stats->wall_seconds = now_seconds() - start;
+    if (options->report_path != NULL && p.perf != NULL && !write_report(&p, stats, ok)) {
+        if (ok) {
+            snprintf(stats->error, sizeof(stats->error), "cannot write the report %s: %s", options->report_path,
+                     strerror(errno));
+        }
+        ok = false;
+    }
+    free(p.perf);
+    return ok;
+}
+
+static double per_second(double amount, double seconds) {
+    return seconds > 0 ? amount / seconds : 0;
+}
+
+/**
+ * @brief Prints per-stage throughput: busy time and rate of each stage.
+ */
+void pipeline_print_report(const Pipeline_Stats *stats, FILE *out) {
+    double mb = 1024.0 * 1024.0;
+    int workers = stats->threads > 0 ? stats->threads : 1;
+    fprintf(out, "games %llu (rejected %llu), rows %llu, batches %llu, steals %llu, threads %d\n",
+            (unsigned long long)stats->games, (unsigned long long)stats->rejected,
+            (unsigned long long)stats->plies, (unsigned long long)stats->batches,
+            (unsigned long long)stats->steals, stats->threads);
+    fprintf(out, "read     %8.3f s busy  %9.1f MB/s in  %9.1f MB/s decoded", stats->read_seconds,
+            per_second(stats->bytes_read / mb, stats->read_seconds),
+            per_second(stats->bytes_decoded / mb, stats->read_seconds));
+    if (stats->decode_threads > 0) {
+        fprintf(out, "  (%d decoder threads)", stats->decode_threads);
+    }
+    if (stats->mapped_input) {
+        fprintf(out, "  (mapped)");
+    }
+    fprintf(out, "\n");
+    // Busy time is summed over workers, so games / busy is the per-worker rate
+    fprintf(out, "convert  %8.3f s busy  %9.0f games/s  %9.0f rows/s per worker (%d workers)\n",
+            stats->convert_seconds, per_second((double)stats->games, stats->convert_seconds),
+            per_second((double)stats->plies, stats->convert_seconds), workers);
+    fprintf(out, "write    %8.3f s busy  %9.1f MB/s\n", stats->write_seconds,
+            per_second(stats->bytes_written / mb, stats->write_seconds));
+    fprintf(out, "total    %8.3f s wall  %9.0f games/s  %9.0f rows/s  %9.1f MB/s decoded\n",
+            stats->wall_seconds, per_second((double)stats->games, stats->wall_seconds),
+            per_second((double)stats->plies, stats->wall_seconds),
+            per_second(stats->bytes_decoded / mb, stats->wall_seconds));
+    if (stats->shards > 0 || stats->start_offset > 0) {
+        fprintf(out, "shards   %llu finished from part-%05llu, input from decoded offset %llu\n",
+                (unsigned long long)stats->shards, (unsigned long long)stats->first_shard,
+                (unsigned long long)stats->start_offset);
+    }
+    if (stats->filtered_games > 0) {
+        uint64_t seen = stats->games + stats->rejected + stats->filtered_games;
+        fprintf(out, "filter   %8.1f MB skipped  %5.1f%% of decoded input  %llu of %llu games\n",
+                stats->filtered_bytes / mb,
+                stats->bytes_decoded ? 100.0 * stats->filtered_bytes / stats->bytes_decoded : 0.0,
+                (unsigned long long)stats->filtered_games, (unsigned long long)seen);
+    }
+    if (stats->san_cache_memory > 0) {
+        uint64_t lookups = stats->san_cache_hits + stats->san_cache_misses;
+        fprintf(out, "san      %8.1f MB cache per worker  %5.1f%% of %llu opening lookups hit\n",
+                stats->san_cache_memory / mb, lookups ? 100.0 * stats->san_cache_hits / lookups : 0.0,
+                (unsigned long long)lookups);
+    }
+    if (stats->book.partitions > 0) {
+        fprintf(out, "book     %8.3f s merge  %llu positions, %llu moves from %llu runs (%.1f MB spilled, "
+                "%.3f s sorting)  %llu positions pruned\n",
+                stats->book.merge_seconds, (unsigned long long)stats->book.positions,
+                (unsigned long long)stats->book.moves, (unsigned long long)stats->book.runs,
+                stats->book.run_bytes / mb, stats->book.spill_seconds, (unsigned long long)stats->book.pruned);
+    }
+    if (stats->dedup_memory > 0) {
+        uint64_t seen = stats->plies + stats->duplicates;
+        fprintf(out, "dedup    %8.1f MB table  %5.1f%% full  %5.1f%% of rows dropped (%llu of %llu)  "
+                "%llu untracked\n",
+                stats->dedup_memory / mb, 100.0 * stats->dedup_pairs / (stats->dedup_memory / sizeof(uint64_t)),
+                seen ? 100.0 * stats->duplicates / seen : 0.0, (unsigned long long)stats->duplicates,
+                (unsigned long long)seen, (unsigned long long)stats->untracked);
+    }
+}
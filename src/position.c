@@ -0,0 +1,469 @@
+#include "position.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include "format.h"
+
+static const char PIECE_CHARS[] = "PNBRQKpnbrqk";
+
+// Home squares of kings and rooks. A move from or to one of them can cost
+// castling rights.
+static const Bitboard CASTLING_SQUARES = 0x9100000000000091ULL;
+
+static uint8_t castling_mask(int square) {
+    switch (square) {
+        case SQUARE(0, 0): return 0xF & ~CASTLE_WHITE_QUEEN;
+        case SQUARE(4, 0): return 0xF & ~(CASTLE_WHITE_KING | CASTLE_WHITE_QUEEN);
+        case SQUARE(7, 0): return 0xF & ~CASTLE_WHITE_KING;
+        case SQUARE(0, 7): return 0xF & ~CASTLE_BLACK_QUEEN;
+        case SQUARE(4, 7): return 0xF & ~(CASTLE_BLACK_KING | CASTLE_BLACK_QUEEN);
+        case SQUARE(7, 7): return 0xF & ~CASTLE_BLACK_KING;
+        default: return 0xF;
+    }
+}
+
+// Zobrist keys: one per piece on each square, per castling-rights set, per
+// en passant file, and one for black to move
+static uint64_t ZOBRIST_PIECES[NO_PIECE][64];
+static uint64_t ZOBRIST_CASTLING[16];
+static uint64_t ZOBRIST_EN_PASSANT[8];
+static uint64_t ZOBRIST_BLACK;
+static pthread_once_t zobrist_once = PTHREAD_ONCE_INIT;
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Fixed seed, so keys are the same in every run and can be stored
+static void zobrist_init(void) {
+    uint64_t state = 0x5A0B1C2D3E4F6071ULL;
+    for (int piece = 0; piece < NO_PIECE; piece++) {
+        for (int square = 0; square < 64; square++) {
+            ZOBRIST_PIECES[piece][square] = splitmix64(&state);
+        }
+    }
+    // Rights combine by XOR, so removing one right is one XOR as well
+    uint64_t rights[4];
+    for (int i = 0; i < 4; i++) {
+        rights[i] = splitmix64(&state);
+    }
+    for (int castling = 0; castling < 16; castling++) {
+        ZOBRIST_CASTLING[castling] = 0;
+        for (int i = 0; i < 4; i++) {
+            if (castling & (1 << i)) {
+                ZOBRIST_CASTLING[castling] ^= rights[i];
+            }
+        }
+    }
+    for (int file = 0; file < 8; file++) {
+        ZOBRIST_EN_PASSANT[file] = splitmix64(&state);
+    }
+    ZOBRIST_BLACK = splitmix64(&state);
+}
+
+/**
+ * @brief Computes the Zobrist key of a position from scratch.
+ *
+ * Covers pieces, side to move, castling rights and the en passant square;
+ * not the move clocks. Every function that builds a Position sets pos->key
+ * with this, and position_make_move updates it incrementally.
+ */
+uint64_t position_compute_key(const Position *pos) {
+    pthread_once(&zobrist_once, zobrist_init);
+    uint64_t key = 0;
+    for (int piece = 0; piece < NO_PIECE; piece++) {
+        Bitboard pieces = pos->pieces[piece];
+        while (pieces) {
+            key ^= ZOBRIST_PIECES[piece][bitboard_pop_lsb(&pieces)];
+        }
+    }
+    key ^= ZOBRIST_CASTLING[pos->castling & 15];
+    if (pos->en_passant != NO_SQUARE) {
+        key ^= ZOBRIST_EN_PASSANT[SQUARE_FILE(pos->en_passant)];
+    }
+    if (pos->side_to_move == BLACK) {
+        key ^= ZOBRIST_BLACK;
+    }
+    return key;
+}
+
+int square_from_string(const char *square) {
+    if (square == NULL || square[0] < 'a' || square[0] > 'h' ||
+        square[1] < '1' || square[1] > '8') {
+        return NO_SQUARE;
+    }
+    return SQUARE(square[0] - 'a', square[1] - '1');
+}
+
+void square_to_string(int square, char out[3]) {
+    out[0] = (char)('a' + SQUARE_FILE(square));
+    out[1] = (char)('1' + SQUARE_RANK(square));
+    out[2] = '\0';
+}
+
+char piece_to_char(int piece) {
+    return (piece >= 0 && piece < NO_PIECE) ? PIECE_CHARS[piece] : ' ';
+}
+
+int piece_from_char(char c) {
+    for (int piece = 0; piece < NO_PIECE; piece++) {
+        if (PIECE_CHARS[piece] == c) {
+            return piece;
+        }
+    }
+    return NO_PIECE;
+}
+
+void position_clear(Position *pos) {
+    memset(pos, 0, sizeof(*pos));
+    pos->en_passant = NO_SQUARE;
+    pos->fullmove_number = 1;
+}
+
+static void put_piece(Position *pos, int piece, int square) {
+    Bitboard bit = square_bit(square);
+    pos->pieces[piece] |= bit;
+    pos->occupancy[PIECE_COLOR(piece)] |= bit;
+}
+
+/**
+ * @brief Converts a FEN_Board into a bitboard Position.
+ *
+ * @param board Board to convert.
+ * @param pos Position to fill.
+ * @return false if the board contains characters that are not pieces or
+ *         castling rights, true otherwise.
+ */
+bool position_from_fen_board(const FEN_Board *board, Position *pos) {
+    if (board == NULL || pos == NULL) {
+        return false;
+    }
+    position_clear(pos);
+
+    for (int rank = 0; rank < 8; rank++) {
+        for (int file = 0; file < 8; file++) {
+            char c = board->board[rank][file];
+            if (c == ' ') {
+                continue;
+            }
+            int piece = piece_from_char(c);
+            if (piece == NO_PIECE) {
+                return false;
+            }
+            put_piece(pos, piece, SQUARE(file, rank));
+        }
+    }
+
+    pos->side_to_move = board->side_to_move == 0 ? WHITE : BLACK;
+
+    for (const char *c = board->castling_rights; *c != '\0'; c++) {
+        switch (*c) {
+            case 'K': pos->castling |= CASTLE_WHITE_KING; break;
+            case 'Q': pos->castling |= CASTLE_WHITE_QUEEN; break;
+            case 'k': pos->castling |= CASTLE_BLACK_KING; break;
+            case 'q': pos->castling |= CASTLE_BLACK_QUEEN; break;
+            case '-': break;
+            default: return false;
+        }
+    }
+
+    if (board->en_passant_square_file >= 0 && board->en_passant_square_file < 8 &&
+        board->en_passant_square_rank >= 0 && board->en_passant_square_rank < 8) {
+        pos->en_passant = SQUARE(board->en_passant_square_file, board->en_passant_square_rank);
+    }
+
+    pos->halfmove_clock = (uint16_t)board->halfmove_clock;
+    pos->fullmove_number = (uint16_t)board->fullmove_number;
+    pos->key = position_compute_key(pos);
+    return true;
+}
+
+/**
+ * @brief Converts a bitboard Position back into a FEN_Board.
+ *
+ * @param pos Position to convert.
+ * @param board Board to fill.
+ * @return true on success, false on NULL arguments.
+ */
+bool position_to_fen_board(const Position *pos, FEN_Board *board) {
+    if (pos == NULL || board == NULL) {
+        return false;
+    }
+    for (int square = 0; square < 64; square++) {
+        board->board[SQUARE_RANK(square)][SQUARE_FILE(square)] =
+            piece_to_char(position_piece_at(pos, square));
+    }
+
+    board->side_to_move = pos->side_to_move;
+
+    int n = 0;
+    if (pos->castling & CASTLE_WHITE_KING) board->castling_rights[n++] = 'K';
+    if (pos->castling & CASTLE_WHITE_QUEEN) board->castling_rights[n++] = 'Q';
+    if (pos->castling & CASTLE_BLACK_KING) board->castling_rights[n++] = 'k';
+    if (pos->castling & CASTLE_BLACK_QUEEN) board->castling_rights[n++] = 'q';
+    if (n == 0) board->castling_rights[n++] = '-';
+    board->castling_rights[n] = '\0';
+
+    if (pos->en_passant != NO_SQUARE) {
+        board->en_passant_square_file = SQUARE_FILE(pos->en_passant);
+        board->en_passant_square_rank = SQUARE_RANK(pos->en_passant);
+    } else {
+        board->en_passant_square_file = -1;
+        board->en_passant_square_rank = -1;
+    }
+
+    board->halfmove_clock = pos->halfmove_clock;
+    board->fullmove_number = pos->fullmove_number;
+    board->move_number = pos->fullmove_number;
+    return true;
+}
+
+bool position_from_fen(const char *fen_string, Position *pos) {
+    FEN_Board *board = create_fen_board((char *)fen_string);
+    if (board == NULL) {
+        return false;
+    }
+    bool ok = position_from_fen_board(board, pos);
+    free(board);
+    return ok;
+}
+
+bool position_to_fen(const Position *pos, char *fen_string_out) {
+    if (pos == NULL || fen_string_out == NULL) {
+        return false;
+    }
+    fen_string_out[position_write_fen(pos, fen_string_out)] = '\0';
+    return true;
+}
+
+/**
+ * @brief Encodes the position as FEN straight from the bitboards.
+ *
+ * Places the (at most 32) pieces on a mailbox, then run-length encodes the
+ * ranks in one pass. No formatting functions and no intermediate FEN_Board.
+ *
+ * @param out Buffer with room for FEN_MAX_LENGTH bytes; not terminated.
+ * @return Number of bytes written.
+ */
+size_t position_write_fen(const Position *pos, char *out) {
+    char board[64];
+    memset(board, 0, sizeof(board));
+    for (int piece = 0; piece < NO_PIECE; piece++) {
+        Bitboard pieces = pos->pieces[piece];
+        while (pieces) {
+            board[bitboard_pop_lsb(&pieces)] = PIECE_CHARS[piece];
+        }
+    }
+
+    char *p = out;
+    for (int rank = 7; rank >= 0; rank--) {
+        int empty = 0;
+        for (int file = 0; file < 8; file++) {
+            char c = board[SQUARE(file, rank)];
+            if (c == 0) {
+                empty++;
+                continue;
+            }
+            if (empty > 0) {
+                *p++ = (char)('0' + empty);
+                empty = 0;
+            }
+            *p++ = c;
+        }
+        if (empty > 0) {
+            *p++ = (char)('0' + empty);
+        }
+        if (rank > 0) {
+            *p++ = '/';
+        }
+    }
+
+    *p++ = ' ';
+    *p++ = pos->side_to_move == WHITE ? 'w' : 'b';
+    *p++ = ' ';
+    if (pos->castling == 0) {
+        *p++ = '-';
+    } else {
+        if (pos->castling & CASTLE_WHITE_KING) *p++ = 'K';
+        if (pos->castling & CASTLE_WHITE_QUEEN) *p++ = 'Q';
+        if (pos->castling & CASTLE_BLACK_KING) *p++ = 'k';
+        if (pos->castling & CASTLE_BLACK_QUEEN) *p++ = 'q';
+    }
+    *p++ = ' ';
+    if (pos->en_passant != NO_SQUARE) {
+        *p++ = (char)('a' + SQUARE_FILE(pos->en_passant));
+        *p++ = (char)('1' + SQUARE_RANK(pos->en_passant));
+    } else {
+        *p++ = '-';
+    }
+    *p++ = ' ';
+    p = format_uint(p, pos->halfmove_clock);
+    *p++ = ' ';
+    p = format_uint(p, pos->fullmove_number);
+    return (size_t)(p - out);
+}
+
+void position_set_start(Position *pos) {
+    position_clear(pos);
+    pos->pieces[WHITE_PAWN] = 0x000000000000FF00ULL;
+    pos->pieces[WHITE_KNIGHT] = square_bit(SQUARE(1, 0)) | square_bit(SQUARE(6, 0));
+    pos->pieces[WHITE_BISHOP] = square_bit(SQUARE(2, 0)) | square_bit(SQUARE(5, 0));
+    pos->pieces[WHITE_ROOK] = square_bit(SQUARE(0, 0)) | square_bit(SQUARE(7, 0));
+    pos->pieces[WHITE_QUEEN] = square_bit(SQUARE(3, 0));
+    pos->pieces[WHITE_KING] = square_bit(SQUARE(4, 0));
+    for (int type = PAWN; type <= KING; type++) {
+        // Black mirrors white: rank r maps to rank 7 - r
+        pos->pieces[MAKE_PIECE(BLACK, type)] = __builtin_bswap64(pos->pieces[type]);
+        pos->occupancy[WHITE] |= pos->pieces[type];
+        pos->occupancy[BLACK] |= pos->pieces[MAKE_PIECE(BLACK, type)];
+    }
+    pos->castling = CASTLE_WHITE_KING | CASTLE_WHITE_QUEEN | CASTLE_BLACK_KING | CASTLE_BLACK_QUEEN;
+    pos->key = position_compute_key(pos);
+}
+
+int position_piece_at(const Position *pos, int square) {
+    Bitboard bit = square_bit(square);
+    int color;
+    if (pos->occupancy[WHITE] & bit) {
+        color = WHITE;
+    } else if (pos->occupancy[BLACK] & bit) {
+        color = BLACK;
+    } else {
+        return NO_PIECE;
+    }
+    for (int type = PAWN; type <= KING; type++) {
+        if (pos->pieces[MAKE_PIECE(color, type)] & bit) {
+            return MAKE_PIECE(color, type);
+        }
+    }
+    return NO_PIECE;
+}
+
+/**
+ * @brief Builds a ChessMove with the right flags from bare squares.
+ *
+ * Looks at the position to tell captures, double pushes, en passant and
+ * castling apart. The move itself is not checked for legality.
+ *
+ * @param promotion_type KNIGHT..QUEEN for promotions, anything else otherwise.
+ * @return The encoded move, or NULL_MOVE if there is no piece of the side to
+ *         move on from.
+ */
+ChessMove position_encode_move(const Position *pos, int from, int to, int promotion_type) {
+    int piece = position_piece_at(pos, from);
+    if (piece == NO_PIECE || PIECE_COLOR(piece) != pos->side_to_move) {
+        return NULL_MOVE;
+    }
+    int type = PIECE_TYPE(piece);
+    bool capture = (pos->occupancy[pos->side_to_move ^ 1] & square_bit(to)) != 0;
+
+    if (type == KING && (to - from == 2 || from - to == 2)) {
+        return move_encode(from, to, to > from ? MOVE_KING_CASTLE : MOVE_QUEEN_CASTLE);
+    }
+    if (type == PAWN) {
+        if (to == pos->en_passant && !capture && SQUARE_FILE(to) != SQUARE_FILE(from)) {
+            return move_encode(from, to, MOVE_EN_PASSANT);
+        }
+        if (to - from == 16 || from - to == 16) {
+            return move_encode(from, to, MOVE_DOUBLE_PUSH);
+        }
+        if (SQUARE_RANK(to) == 0 || SQUARE_RANK(to) == 7) {
+            if (promotion_type < KNIGHT || promotion_type > QUEEN) {
+                promotion_type = QUEEN;
+            }
+            int flags = (capture ? MOVE_PROMOTION_CAPTURE : MOVE_PROMOTION) + (promotion_type - KNIGHT);
+            return move_encode(from, to, flags);
+        }
+    }
+    return move_encode(from, to, capture ? MOVE_CAPTURE : MOVE_QUIET);
+}
+
+/**
+ * @brief Applies a move to the position in place.
+ *
+ * Updates the piece and occupancy bitboards, castling rights, en passant
+ * square and both clocks. The move must be pseudo-legal and carry the flags
+ * position_encode_move would give it.
+ */
+void position_make_move(Position *pos, ChessMove move) {
+    int us = pos->side_to_move;
+    int them = us ^ 1;
+    int from = move_from(move);
+    int to = move_to(move);
+    int flags = move_flags(move);
+    Bitboard from_bit = square_bit(from);
+    Bitboard to_bit = square_bit(to);
+    uint64_t key = pos->key ^ ZOBRIST_BLACK;
+    if (pos->en_passant != NO_SQUARE) {
+        key ^= ZOBRIST_EN_PASSANT[SQUARE_FILE(pos->en_passant)];
+    }
+
+    // Branch-free lookup of the moving piece: exactly one bitboard has it
+    int piece = MAKE_PIECE(us, PAWN);
+    for (int type = KNIGHT; type <= KING; type++) {
+        piece += type * (int)((pos->pieces[MAKE_PIECE(us, type)] >> from) & 1);
+    }
+
+    if (flags == MOVE_EN_PASSANT) {
+        // The captured pawn sits behind the target square
+        Bitboard victim = square_bit(to ^ 8);
+        pos->pieces[MAKE_PIECE(them, PAWN)] ^= victim;
+        pos->occupancy[them] ^= victim;
+        key ^= ZOBRIST_PIECES[MAKE_PIECE(them, PAWN)][to ^ 8];
+    } else if (flags & MOVE_CAPTURE) {
+        for (int victim = MAKE_PIECE(them, PAWN); victim <= MAKE_PIECE(them, QUEEN); victim++) {
+            // All ones if the victim is this piece, else zero
+            uint64_t hit = 0 - ((pos->pieces[victim] >> to) & 1);
+            key ^= ZOBRIST_PIECES[victim][to] & hit;
+            pos->pieces[victim] &= ~to_bit;
+        }
+        pos->occupancy[them] ^= to_bit;
+    }
+
+    pos->pieces[piece] ^= from_bit | to_bit;
+    pos->occupancy[us] ^= from_bit | to_bit;
+    key ^= ZOBRIST_PIECES[piece][from];
+
+    if (flags & MOVE_PROMOTION) {
+        int promoted = MAKE_PIECE(us, move_promotion_type(move));
+        pos->pieces[piece] ^= to_bit;
+        pos->pieces[promoted] |= to_bit;
+        key ^= ZOBRIST_PIECES[promoted][to];
+    } else {
+        key ^= ZOBRIST_PIECES[piece][to];
+        if (flags == MOVE_KING_CASTLE || flags == MOVE_QUEEN_CASTLE) {
+            int rook_from = flags == MOVE_KING_CASTLE ? from + 3 : from - 4;
+            int rook_to = flags == MOVE_KING_CASTLE ? from + 1 : from - 1;
+            Bitboard rook_bits = square_bit(rook_from) | square_bit(rook_to);
+            pos->pieces[MAKE_PIECE(us, ROOK)] ^= rook_bits;
+            pos->occupancy[us] ^= rook_bits;
+            key ^= ZOBRIST_PIECES[MAKE_PIECE(us, ROOK)][rook_from] ^ ZOBRIST_PIECES[MAKE_PIECE(us, ROOK)][rook_to];
+        }
+    }
+
+    if ((from_bit | to_bit) & CASTLING_SQUARES) {
+        key ^= ZOBRIST_CASTLING[pos->castling];
+        pos->castling &= castling_mask(from) & castling_mask(to);
+        key ^= ZOBRIST_CASTLING[pos->castling];
+    }
+    pos->en_passant = NO_SQUARE;
+    if (flags == MOVE_DOUBLE_PUSH) {
+        pos->en_passant = (uint8_t)((from + to) / 2);
+        key ^= ZOBRIST_EN_PASSANT[SQUARE_FILE(from)];
+    }
+
+    if (PIECE_TYPE(piece) == PAWN || (flags & MOVE_CAPTURE)) {
+        pos->halfmove_clock = 0;
+    } else {
+        pos->halfmove_clock++;
+    }
+    if (us == BLACK) {
+        pos->fullmove_number++;
+    }
+    pos->side_to_move = (uint8_t)them;
+    pos->key = key;
+    assert(key == position_compute_key(pos));
+}
@@ -0,0 +1,672 @@
+#define _POSIX_C_SOURCE 200809L
+#include "record_shuffle.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "fen_plus.h"
+#include "fen_record.h"
+#include "file_io.h"
+#include "output_writer.h"
+#include "radix_sort.h"
+
+// A record in a bucket file, behind its sort key
+typedef struct {
+    uint64_t key;
+    FEN_Record record;
+} Shuffle_Entry;
+
+typedef char shuffle_entry_is_56_bytes[sizeof(Shuffle_Entry) == 56 ? 1 : -1];
+
+// Buckets are sized for this much more than their expected share, so that
+// hashing noise does not push one past the memory ceiling
+#define BUCKET_SLACK 1.25
+// Scatter buffers never get smaller than this, whatever the ceiling
+#define MIN_BUFFER_ENTRIES 64
+#define SHUFFLE_PATH_MAX 4096
+#define SPLIT_SALT 0x73706C6974ULL
+#define KEY_SALT 0x73687566666C65ULL
+
+const char *const RECORD_SHUFFLE_SPLIT_NAMES[RECORD_SHUFFLE_SPLITS] = {"train", "val", "test"};
+
+typedef struct {
+    int fd;
+    uint64_t size;              // bytes, grown atomically by the scatter workers
+} Shuffle_Bucket;
+
+// One input block, numbered from the first record of the block
+typedef struct {
+    uint32_t input;
+    uint32_t block;
+    uint64_t first;
+} Scatter_Unit;
+
+typedef struct {
+    const Record_Shuffle_Options *options;
+    const char *const *inputs;
+    uint64_t key_seed;
+    uint64_t split_seed;
+    uint16_t **time_control_maps;       // per input: its ids -> ids of the merged table
+    FEN_Record_Time_Controls time_controls;
+    Scatter_Unit *units;
+    size_t unit_count;
+    size_t next_unit;                   // claimed atomically
+    size_t max_block_records;
+    Shuffle_Bucket *buckets;            // split-major
+    uint32_t bucket_start[RECORD_SHUFFLE_SPLITS + 1];
+    int bucket_bits[RECORD_SHUFFLE_SPLITS];     // a split has 1 << bits buckets
+    size_t buffer_entries;              // per worker and bucket in pass one
+    // Pass two: buckets are claimed in order and written in order
+    size_t next_bucket;
+    size_t turn;                        // the bucket whose blocks go out next
+    Output_Writer writers[RECORD_SHUFFLE_SPLITS];
+    FEN_Record_Index indexes[RECORD_SHUFFLE_SPLITS];
+    pthread_mutex_t lock;
+    pthread_cond_t turn_changed;
+    bool failed;
+    char error[256];
+} Shuffle;
+
+typedef struct {
+    Shuffle *s;
+    int input;                          // open input, -1 if none
+    FEN_Record_File *file;
+    FEN_Record *block;
+    Shuffle_Entry *buffers;             // buffer_entries per bucket
+    uint32_t *fill;
+    Shuffle_Entry *entries;             // the loaded bucket
+    size_t entry_capacity;
+    Text_Buffer blocks;                 // compressed blocks of the loaded bucket
+    Text_Buffer frame;
+    uint32_t *block_sizes;
+    size_t block_capacity;
+    void *context;
+    uint64_t records[RECORD_SHUFFLE_SPLITS];
+    uint64_t largest_bucket;
+} Shuffle_Worker;
+
+static double per_second(double amount, double seconds) {
+    return seconds > 0 ? amount / seconds : 0;
+}
+
+// splitmix64 finalizer: a bijection, so distinct positions get distinct keys
+static uint64_t mix64(uint64_t z) {
+    z += 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static int split_of(uint64_t split_seed, uint64_t game, double val_fraction, double test_fraction) {
+    // 53 bits of the hash as a fraction in [0, 1)
+    double u = (double)(mix64(split_seed ^ game) >> 11) * (1.0 / 9007199254740992.0);
+    if (u < val_fraction) {
+        return RECORD_SHUFFLE_VAL;
+    }
+    return u < val_fraction + test_fraction ? RECORD_SHUFFLE_TEST : RECORD_SHUFFLE_TRAIN;
+}
+
+// Records the first failure; later ones only stop the run
+static void fail(Shuffle *s, const char *format, ...) {
+    pthread_mutex_lock(&s->lock);
+    va_list args;
+    va_start(args, format);
+    file_io_first_error(&s->failed, s->error, sizeof(s->error), format, args);
+    va_end(args);
+    pthread_cond_broadcast(&s->turn_changed);
+    pthread_mutex_unlock(&s->lock);
+}
+
+static bool failed(Shuffle *s) {
+    return __atomic_load_n(&s->failed, __ATOMIC_ACQUIRE);
+}
+
+void record_shuffle_default_options(Record_Shuffle_Options *options) {
+    memset(options, 0, sizeof(*options));
+    options->seed = 1;
+    options->val_fraction = 0.01;
+    options->test_fraction = 0.01;
+    options->memory = (size_t)1 << 30;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    options->threads = cpus > 0 ? (int)cpus : 1;
+    // Shuffled records compress about as well at level 1 as at 3, in half the time
+    options->compression_level = 1;
+    options->block_records = 16384;
+}
+
+/**
+ * @brief The split every record of a game goes to, for a seed and split
+ *        fractions.
+ *
+ * @param game Game index as stored in FEN_Record.game.
+ * @return enum Record_Shuffle_Split.
+ */
+int record_shuffle_split(uint64_t game, const Record_Shuffle_Options *options) {
+    return split_of(mix64(options->seed ^ SPLIT_SALT), game, options->val_fraction, options->test_fraction);
+}
+
+// Appends count entries to a bucket file; workers reserve disjoint ranges
+static bool flush_buffer(Shuffle *s, size_t bucket, const Shuffle_Entry *entries, size_t count) {
+    size_t bytes = count * sizeof(Shuffle_Entry);
+    uint64_t offset = __atomic_fetch_add(&s->buckets[bucket].size, (uint64_t)bytes, __ATOMIC_RELAXED);
+    if (!file_io_write_at(s->buckets[bucket].fd, entries, bytes, offset)) {
+        fail(s, "cannot write a bucket file: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static bool scatter_unit(Shuffle_Worker *w, const Scatter_Unit *unit) {
+    Shuffle *s = w->s;
+    if (w->input != (int)unit->input) {
+        fen_record_close(w->file);
+        w->input = (int)unit->input;
+        w->file = fen_record_open(s->inputs[unit->input]);
+        if (w->file == NULL) {
+            fail(s, "cannot read %s", s->inputs[unit->input]);
+            return false;
+        }
+    }
+    size_t count = fen_record_read_block(w->file, unit->block, w->block);
+    if (count != fen_record_block_records(w->file, unit->block)) {
+        fail(s, "%s: block %u is corrupt", s->inputs[unit->input], unit->block);
+        return false;
+    }
+    const uint16_t *time_controls = s->time_control_maps[unit->input];
+    double val_fraction = s->options->val_fraction;
+    double test_fraction = s->options->test_fraction;
+    for (size_t i = 0; i < count; i++) {
+        FEN_Record *record = &w->block[i];
+        if (record->time_control != FEN_RECORD_TIME_CONTROL_OTHER) {
+            record->time_control = time_controls[record->time_control];
+        }
+        int split = split_of(s->split_seed, record->game, val_fraction, test_fraction);
+        uint64_t key = mix64(s->key_seed ^ (unit->first + i));
+        // High key bits pick the bucket, so buckets hold consecutive key ranges
+        int bits = s->bucket_bits[split];
+        size_t bucket = s->bucket_start[split] + (bits > 0 ? (size_t)(key >> (64 - bits)) : 0);
+        Shuffle_Entry *entry = &w->buffers[bucket * s->buffer_entries + w->fill[bucket]];
+        entry->key = key;
+        entry->record = *record;
+        w->records[split]++;
+        if (++w->fill[bucket] == s->buffer_entries) {
+            if (!flush_buffer(s, bucket, &w->buffers[bucket * s->buffer_entries], s->buffer_entries)) {
+                return false;
+            }
+            w->fill[bucket] = 0;
+        }
+    }
+    return true;
+}
+
+static void scatter(Shuffle_Worker *w) {
+    Shuffle *s = w->s;
+    size_t bucket_count = s->bucket_start[RECORD_SHUFFLE_SPLITS];
+    while (!failed(s)) {
+        size_t u = __atomic_fetch_add(&s->next_unit, 1, __ATOMIC_RELAXED);
+        if (u >= s->unit_count || !scatter_unit(w, &s->units[u])) {
+            break;
+        }
+    }
+    for (size_t b = 0; b < bucket_count && !failed(s); b++) {
+        if (w->fill[b] > 0 && flush_buffer(s, b, &w->buffers[b * s->buffer_entries], w->fill[b])) {
+            w->fill[b] = 0;
+        }
+    }
+    fen_record_close(w->file);
+    w->file = NULL;
+    w->input = -1;
+}
+
+static inline bool entry_before(const Shuffle_Entry *a, const Shuffle_Entry *b) {
+    return a->key < b->key;
+}
+
+RADIX_SORT_DEFINE(sort_entries, Shuffle_Entry, entry_before)
+
+static int split_of_bucket(const Shuffle *s, size_t bucket) {
+    int split = 0;
+    while (bucket >= s->bucket_start[split + 1]) {
+        split++;
+    }
+    return split;
+}
+
+// Loads and sorts one bucket, compresses its blocks, then waits for its turn
+// to append them to the split file
+static bool shuffle_bucket(Shuffle_Worker *w, size_t bucket) {
+    Shuffle *s = w->s;
+    const Record_Shuffle_Options *options = s->options;
+    int split = split_of_bucket(s, bucket);
+    uint64_t bytes = s->buckets[bucket].size;
+    size_t count = (size_t)(bytes / sizeof(Shuffle_Entry));
+    if (count > w->entry_capacity) {
+        free(w->entries);
+        w->entries = (Shuffle_Entry *)malloc(count * sizeof(Shuffle_Entry));
+        w->entry_capacity = w->entries != NULL ? count : 0;
+        if (w->entries == NULL) {
+            fail(s, "out of memory for a bucket of %zu records", count);
+            return false;
+        }
+    }
+    if (!file_io_read_at(s->buckets[bucket].fd, w->entries, (size_t)bytes, 0)) {
+        fail(s, "cannot read a bucket file: %s", errno != 0 ? strerror(errno) : "short read");
+        return false;
+    }
+    close(s->buckets[bucket].fd);
+    s->buckets[bucket].fd = -1;
+    if (count > w->largest_bucket) {
+        w->largest_bucket = count;
+    }
+    // The bucket's entries share their top bucket_bits key bits
+    sort_entries(w->entries, count, 64 - s->bucket_bits[split] - 8);
+    // Drop the keys in place: record i never overlaps an entry after i
+    FEN_Record *records = (FEN_Record *)w->entries;
+    for (size_t i = 0; i < count; i++) {
+        memmove(&records[i], &w->entries[i].record, sizeof(FEN_Record));
+    }
+
+    size_t block_count = (count + options->block_records - 1) / options->block_records;
+    if (block_count > w->block_capacity) {
+        free(w->block_sizes);
+        w->block_sizes = (uint32_t *)malloc(block_count * sizeof(uint32_t));
+        w->block_capacity = w->block_sizes != NULL ? block_count : 0;
+        if (w->block_sizes == NULL) {
+            fail(s, "out of memory");
+            return false;
+        }
+    }
+    const char *data = (const char *)records;
+    if (options->compression_level > 0) {
+        w->blocks.length = 0;
+        for (size_t b = 0; b < block_count; b++) {
+            size_t first = b * options->block_records;
+            size_t n = count - first < options->block_records ? count - first : options->block_records;
+            if (!fen_record_compress_block((const char *)&records[first], n * sizeof(FEN_Record),
+                                           options->compression_level, &w->context, &w->frame) ||
+                !text_buffer_append(&w->blocks, w->frame.data, w->frame.length)) {
+                fail(s, "cannot compress a block");
+                return false;
+            }
+            w->block_sizes[b] = (uint32_t)w->frame.length;
+        }
+        data = w->blocks.data;
+    } else {
+        for (size_t b = 0; b < block_count; b++) {
+            size_t first = b * options->block_records;
+            size_t n = count - first < options->block_records ? count - first : options->block_records;
+            w->block_sizes[b] = (uint32_t)(n * sizeof(FEN_Record));
+        }
+    }
+
+    pthread_mutex_lock(&s->lock);
+    while (s->turn != bucket && !s->failed) {
+        pthread_cond_wait(&s->turn_changed, &s->lock);
+    }
+    bool ok = !s->failed;
+    bool write_failed = false;
+    for (size_t b = 0; ok && b < block_count; b++) {
+        size_t first = b * options->block_records;
+        size_t n = count - first < options->block_records ? count - first : options->block_records;
+        ok = output_writer_write(&s->writers[split], data, w->block_sizes[b]) &&
+             fen_record_add_block(&s->indexes[split], w->block_sizes[b], n);
+        write_failed = !ok;
+        data += w->block_sizes[b];
+    }
+    if (ok) {
+        s->turn++;
+    }
+    pthread_cond_broadcast(&s->turn_changed);
+    pthread_mutex_unlock(&s->lock);
+    // The turn stays here, so no other thread touches this split's writer
+    if (write_failed) {
+        int error = s->writers[split].error;
+        fail(s, "cannot write the %s split: %s", RECORD_SHUFFLE_SPLIT_NAMES[split],
+             error != 0 ? strerror(error) : "out of memory");
+    }
+    return ok;
+}
+
+static void shuffle(Shuffle_Worker *w) {
+    Shuffle *s = w->s;
+    size_t bucket_count = s->bucket_start[RECORD_SHUFFLE_SPLITS];
+    while (!failed(s)) {
+        size_t b = __atomic_fetch_add(&s->next_bucket, 1, __ATOMIC_RELAXED);
+        if (b >= bucket_count || !shuffle_bucket(w, b)) {
+            break;
+        }
+    }
+}
+
+typedef struct {
+    Shuffle_Worker *worker;
+    void (*pass)(Shuffle_Worker *);
+} Pass_Thread;
+
+static void *pass_main(void *arg) {
+    Pass_Thread *t = (Pass_Thread *)arg;
+    t->pass(t->worker);
+    return NULL;
+}
+
+// Runs one pass on every worker, on the calling thread with one worker
+static void run_pass(Shuffle_Worker *workers, int count, void (*pass)(Shuffle_Worker *)) {
+    if (count == 1) {
+        pass(&workers[0]);
+        return;
+    }
+    pthread_t *threads = (pthread_t *)malloc(count * sizeof(pthread_t));
+    Pass_Thread *args = (Pass_Thread *)malloc(count * sizeof(Pass_Thread));
+    int started = 0;
+    if (threads != NULL && args != NULL) {
+        for (; started < count; started++) {
+            args[started].worker = &workers[started];
+            args[started].pass = pass;
+            if (pthread_create(&threads[started], NULL, pass_main, &args[started]) != 0) {
+                break;
+            }
+        }
+    }
+    if (started < count) {
+        fail(workers[0].s, "cannot start threads");
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    free(args);
+}
+
+// Opens every input once: checks it, numbers its blocks and maps its
+// time-control ids into the merged table
+static bool plan_inputs(Shuffle *s, int input_count, Record_Shuffle_Stats *stats) {
+    size_t unit_capacity = 0;
+    s->time_control_maps = (uint16_t **)calloc((size_t)input_count, sizeof(uint16_t *));
+    if (s->time_control_maps == NULL) {
+        snprintf(stats->error, sizeof(stats->error), "out of memory");
+        return false;
+    }
+    for (int i = 0; i < input_count; i++) {
+        FEN_Record_File *file = fen_record_open(s->inputs[i]);
+        if (file == NULL) {
+            snprintf(stats->error, sizeof(stats->error), "%s: not a readable record file", s->inputs[i]);
+            return false;
+        }
+        size_t blocks = fen_record_block_count(file);
+        bool ok = true;
+        if (s->unit_count + blocks > unit_capacity) {
+            unit_capacity = (s->unit_count + blocks) * 2;
+            Scatter_Unit *units = (Scatter_Unit *)realloc(s->units, unit_capacity * sizeof(Scatter_Unit));
+            ok = units != NULL;
+            s->units = ok ? units : s->units;
+        }
+        for (size_t b = 0; ok && b < blocks; b++) {
+            Scatter_Unit *unit = &s->units[s->unit_count++];
+            unit->input = (uint32_t)i;
+            unit->block = (uint32_t)b;
+            unit->first = stats->input_records;
+            size_t records = fen_record_block_records(file, b);
+            stats->input_records += records;
+            if (records > s->max_block_records) {
+                s->max_block_records = records;
+            }
+        }
+        // Ids the merged table has no room for become FEN_RECORD_TIME_CONTROL_OTHER
+        uint16_t *map = (uint16_t *)malloc((FEN_RECORD_MAX_TIME_CONTROLS + 1) * sizeof(uint16_t));
+        ok = ok && map != NULL;
+        for (uint32_t id = 0; ok && id <= FEN_RECORD_MAX_TIME_CONTROLS; id++) {
+            size_t length;
+            const char *name = fen_record_file_time_control(file, (uint16_t)id, &length);
+            map[id] = name != NULL ? fen_record_time_control_id(&s->time_controls, name, length)
+                                   : FEN_RECORD_TIME_CONTROL_OTHER;
+        }
+        s->time_control_maps[i] = map;
+        fen_record_close(file);
+        if (!ok) {
+            snprintf(stats->error, sizeof(stats->error), "out of memory");
+            return false;
+        }
+    }
+    return true;
+}
+
+// Splits the memory ceiling: pass two holds one bucket per worker, pass one
+// a buffer per worker and bucket
+static bool plan_buckets(Shuffle *s, int workers, const char *temp_dir, Record_Shuffle_Stats *stats) {
+    const Record_Shuffle_Options *options = s->options;
+    double per_worker = (double)options->memory / workers;
+    double fractions[RECORD_SHUFFLE_SPLITS] = {1.0 - options->val_fraction - options->test_fraction,
+                                               options->val_fraction, options->test_fraction};
+    s->bucket_start[0] = 0;
+    for (int split = 0; split < RECORD_SHUFFLE_SPLITS; split++) {
+        double bytes = stats->input_records * fractions[split] * sizeof(Shuffle_Entry) * BUCKET_SLACK;
+        double wanted = options->buckets > 0 ? options->buckets : bytes / per_worker;
+        int bits = 0;
+        while ((double)(1u << bits) < wanted && bits < 20) {
+            bits++;
+        }
+        if ((double)(1u << bits) < wanted) {
+            snprintf(stats->error, sizeof(stats->error), "the memory ceiling is too small for the input");
+            return false;
+        }
+        s->bucket_bits[split] = bits;
+        s->bucket_start[split + 1] = s->bucket_start[split] + (1u << bits);
+    }
+    size_t bucket_count = s->bucket_start[RECORD_SHUFFLE_SPLITS];
+    stats->buckets = (uint32_t)bucket_count;
+    // Fewer buckets would overflow pass two, so buffers below the floor mean
+    // the ceiling cannot hold both passes
+    s->buffer_entries = options->memory / workers / bucket_count / sizeof(Shuffle_Entry);
+    if (s->buffer_entries < MIN_BUFFER_ENTRIES) {
+        snprintf(stats->error, sizeof(stats->error),
+                 "the memory ceiling is too small for %zu buckets on %d threads (needs %zu bytes)", bucket_count,
+                 workers, bucket_count * workers * MIN_BUFFER_ENTRIES * sizeof(Shuffle_Entry));
+        return false;
+    }
+
+    s->buckets = (Shuffle_Bucket *)malloc(bucket_count * sizeof(Shuffle_Bucket));
+    if (s->buckets == NULL) {
+        snprintf(stats->error, sizeof(stats->error), "out of memory");
+        return false;
+    }
+    for (size_t b = 0; b < bucket_count; b++) {
+        s->buckets[b].fd = -1;
+        s->buckets[b].size = 0;
+    }
+    for (size_t b = 0; b < bucket_count; b++) {
+        s->buckets[b].fd = file_io_open_temp(temp_dir, "shuffle");
+        if (s->buckets[b].fd < 0) {
+            snprintf(stats->error, sizeof(stats->error), "cannot create %zu bucket files in %s: %s%s",
+                     bucket_count, temp_dir, strerror(errno),
+                     errno == EMFILE ? " (raise ulimit -n or the memory ceiling)" : "");
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool init_worker(Shuffle *s, Shuffle_Worker *w) {
+    size_t bucket_count = s->bucket_start[RECORD_SHUFFLE_SPLITS];
+    memset(w, 0, sizeof(*w));
+    w->s = s;
+    w->input = -1;
+    w->block = (FEN_Record *)malloc((s->max_block_records + 1) * sizeof(FEN_Record));
+    w->buffers = (Shuffle_Entry *)malloc(bucket_count * s->buffer_entries * sizeof(Shuffle_Entry));
+    w->fill = (uint32_t *)calloc(bucket_count, sizeof(uint32_t));
+    return w->block != NULL && w->buffers != NULL && w->fill != NULL;
+}
+
+// Pass one is over once scatter returns, so its buffers can go
+static void free_scatter_buffers(Shuffle_Worker *w) {
+    free(w->block);
+    free(w->buffers);
+    free(w->fill);
+    w->block = NULL;
+    w->buffers = NULL;
+    w->fill = NULL;
+}
+
+static void free_worker(Shuffle_Worker *w) {
+    free_scatter_buffers(w);
+    fen_record_close(w->file);
+    free(w->entries);
+    free(w->block_sizes);
+    text_buffer_free(&w->blocks);
+    text_buffer_free(&w->frame);
+    fen_record_free_context(w->context);
+}
+
+/**
+ * @brief Shuffles record files globally into output_dir/train.fenrec,
+ *        val.fenrec and test.fenrec.
+ *
+ * Pass one reads the inputs block by block on all threads and scatters the
+ * records into bucket files; pass two sorts one bucket per thread at a time
+ * and appends them in key order. Time-control ids are remapped into one
+ * table over all inputs. Every split file is written, empty or not, as
+ * <name>.tmp and renamed once complete.
+ *
+ * @param inputs Record files, e.g. the shards of one pipeline run; their
+ *        records are numbered in this order to seed the keys.
+ * @param output_dir Existing directory for the split files.
+ * @param options Seed, split fractions, memory ceiling and threads; see
+ *        record_shuffle_default_options.
+ * @return true on success; on failure stats->error says why.
+ */
+bool record_shuffle_run(const char *const *inputs, int input_count, const char *output_dir,
+                        const Record_Shuffle_Options *options, Record_Shuffle_Stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    double start = file_io_seconds();
+    if (options->val_fraction < 0 || options->test_fraction < 0 ||
+        options->val_fraction + options->test_fraction > 1 || options->block_records == 0 ||
+        options->memory == 0) {
+        snprintf(stats->error, sizeof(stats->error),
+                 "split fractions must be in [0, 1] and add up to at most 1; memory and block size non-zero");
+        return false;
+    }
+
+    Shuffle s;
+    memset(&s, 0, sizeof(s));
+    s.options = options;
+    s.inputs = inputs;
+    s.key_seed = mix64(options->seed ^ KEY_SALT);
+    s.split_seed = mix64(options->seed ^ SPLIT_SALT);
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.turn_changed, NULL);
+    int workers = options->threads > 0 ? options->threads : 1;
+    stats->threads = options->threads;
+    const char *temp_dir = options->temp_dir != NULL ? options->temp_dir : output_dir;
+    Shuffle_Worker *w = NULL;
+    int fds[RECORD_SHUFFLE_SPLITS] = {-1, -1, -1};
+    char paths[RECORD_SHUFFLE_SPLITS][SHUFFLE_PATH_MAX];
+    char temps[RECORD_SHUFFLE_SPLITS][SHUFFLE_PATH_MAX + 8];
+
+    bool ok = plan_inputs(&s, input_count, stats) && plan_buckets(&s, workers, temp_dir, stats);
+    if (ok) {
+        w = (Shuffle_Worker *)calloc((size_t)workers, sizeof(Shuffle_Worker));
+        ok = w != NULL;
+        for (int i = 0; ok && i < workers; i++) {
+            ok = init_worker(&s, &w[i]);
+        }
+        if (!ok) {
+            snprintf(stats->error, sizeof(stats->error), "out of memory for the scatter buffers");
+        }
+    }
+    for (int split = 0; ok && split < RECORD_SHUFFLE_SPLITS; split++) {
+        const char *name = RECORD_SHUFFLE_SPLIT_NAMES[split];
+        snprintf(paths[split], sizeof(paths[split]), "%s/%s.fenrec", output_dir, name);
+        snprintf(temps[split], sizeof(temps[split]), "%s/%s.fenrec.tmp", output_dir, name);
+        fds[split] = open(temps[split], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ok = fds[split] >= 0 && output_writer_init(&s.writers[split], fds[split]) &&
+             fen_record_write_header(&s.writers[split], options->compression_level, &s.indexes[split]);
+        if (!ok) {
+            snprintf(stats->error, sizeof(stats->error), "cannot create %s.fenrec in %s: %s", name, output_dir,
+                     strerror(errno));
+        }
+    }
+
+    if (ok) {
+        run_pass(w, workers, scatter);
+        double scattered = file_io_seconds();
+        stats->scatter_seconds = scattered - start;
+        for (int i = 0; i < workers; i++) {
+            free_scatter_buffers(&w[i]);
+        }
+        if (!s.failed) {
+            run_pass(w, workers, shuffle);
+        }
+        stats->shuffle_seconds = file_io_seconds() - scattered;
+        ok = !s.failed;
+        if (!ok) {
+            snprintf(stats->error, sizeof(stats->error), "%s", s.error);
+        }
+    }
+    for (int split = 0; ok && split < RECORD_SHUFFLE_SPLITS; split++) {
+        ok = fen_record_write_footer(&s.writers[split], &s.indexes[split], &s.time_controls) &&
+             output_writer_flush(&s.writers[split]);
+        ok = ok && close(fds[split]) == 0 && rename(temps[split], paths[split]) == 0;
+        fds[split] = -1;
+        if (!ok) {
+            snprintf(stats->error, sizeof(stats->error), "cannot write %s.fenrec in %s: %s",
+                     RECORD_SHUFFLE_SPLIT_NAMES[split], output_dir, strerror(errno));
+        }
+        stats->bytes_written += s.writers[split].bytes_written;
+    }
+    for (int split = 0; split < RECORD_SHUFFLE_SPLITS; split++) {
+        if (fds[split] >= 0) {
+            close(fds[split]);
+            unlink(temps[split]);
+        }
+        output_writer_free(&s.writers[split]);
+        fen_record_index_free(&s.indexes[split]);
+    }
+
+    for (int i = 0; w != NULL && i < workers; i++) {
+        for (int split = 0; split < RECORD_SHUFFLE_SPLITS; split++) {
+            stats->records[split] += w[i].records[split];
+        }
+        if (w[i].largest_bucket > stats->largest_bucket) {
+            stats->largest_bucket = w[i].largest_bucket;
+        }
+        free_worker(&w[i]);
+    }
+    free(w);
+    for (size_t b = 0; s.buckets != NULL && b < s.bucket_start[RECORD_SHUFFLE_SPLITS]; b++) {
+        stats->temp_bytes += s.buckets[b].size;
+        if (s.buckets[b].fd >= 0) {
+            close(s.buckets[b].fd);
+        }
+    }
+    free(s.buckets);
+    for (int i = 0; s.time_control_maps != NULL && i < input_count; i++) {
+        free(s.time_control_maps[i]);
+    }
+    free(s.time_control_maps);
+    free(s.units);
+    fen_record_time_controls_free(&s.time_controls);
+    pthread_mutex_destroy(&s.lock);
+    pthread_cond_destroy(&s.turn_changed);
+    stats->wall_seconds = file_io_seconds() - start;
+    return ok;
+}
+
+void record_shuffle_print_report(const Record_Shuffle_Stats *stats, FILE *out) {
+    double mb = 1024.0 * 1024.0;
+    fprintf(out, "records %llu: train %llu, val %llu, test %llu; %u buckets (largest %llu records), threads %d\n",
+            (unsigned long long)stats->input_records, (unsigned long long)stats->records[RECORD_SHUFFLE_TRAIN],
+            (unsigned long long)stats->records[RECORD_SHUFFLE_VAL],
+            (unsigned long long)stats->records[RECORD_SHUFFLE_TEST], stats->buckets,
+            (unsigned long long)stats->largest_bucket, stats->threads);
+    fprintf(out, "scatter  %8.3f s wall  %9.0f records/s  %9.1f MB/s to bucket files\n", stats->scatter_seconds,
+            per_second((double)stats->input_records, stats->scatter_seconds),
+            per_second(stats->temp_bytes / mb, stats->scatter_seconds));
+    fprintf(out, "shuffle  %8.3f s wall  %9.0f records/s  %9.1f MB/s written\n", stats->shuffle_seconds,
+            per_second((double)stats->input_records, stats->shuffle_seconds),
+            per_second(stats->bytes_written / mb, stats->shuffle_seconds));
+    fprintf(out, "total    %8.3f s wall  %9.0f records/s\n", stats->wall_seconds,
+            per_second((double)stats->input_records, stats->wall_seconds));
+}
@@ -0,0 +1,319 @@
+#include "san.h"
+#include "attacks.h"
+
+static const char PROMOTION_CHARS[] = "nbrq";
+static const char SAN_PIECE_CHARS[] = "PNBRQK";
+
+static int san_piece_type(char c) {
+    switch (c) {
+        case 'N': return KNIGHT;
+        case 'B': return BISHOP;
+        case 'R': return ROOK;
+        case 'Q': return QUEEN;
+        case 'K': return KING;
+        default: return -1;
+    }
+}
+
+static bool is_suffix_char(char c) {
+    return c == '+' || c == '#' || c == '!' || c == '?';
+}
+
+// Flags for a move of a piece of the given type, as make_move expects them
+static int move_flags_for(const Position *pos, int piece_type, int from, int to,
+                          int promotion_type) {
+    bool capture = (pos->occupancy[pos->side_to_move ^ 1] & square_bit(to)) != 0;
+    if (piece_type == PAWN) {
+        if (promotion_type >= KNIGHT) {
+            return (capture ? MOVE_PROMOTION_CAPTURE : MOVE_PROMOTION) + (promotion_type - KNIGHT);
+        }
+        if (to == pos->en_passant && SQUARE_FILE(to) != SQUARE_FILE(from)) {
+            return MOVE_EN_PASSANT;
+        }
+        if (to - from == 16 || from - to == 16) {
+            return MOVE_DOUBLE_PUSH;
+        }
+    }
+    return capture ? MOVE_CAPTURE : MOVE_QUIET;
+}
+
+/**
+ * @brief Finds the square a piece of the side to move starts from.
+ *
+ * Candidates come from the attack tables (looking backwards from the target
+ * square), narrowed by from_mask. Only when that leaves more than one piece
+ * are pins checked, to drop pieces that may not legally move.
+ *
+ * @param piece_type PAWN..KING.
+ * @param to Target square.
+ * @param from_mask Squares the origin may be on (SAN disambiguation), or ~0.
+ * @param capture For pawns: diagonal capture instead of a push.
+ * @param from_out Receives the origin square on SAN_OK.
+ */
+enum SanStatus san_find_origin(const Position *pos, int piece_type, int to,
+                               Bitboard from_mask, bool capture, int *from_out) {
+    int us = pos->side_to_move;
+    Bitboard to_bit = square_bit(to);
+    Bitboard occupied = position_occupied(pos);
+    Bitboard ours = pos->pieces[MAKE_PIECE(us, piece_type)];
+    Bitboard candidates;
+
+    if (pos->occupancy[us] & to_bit) {
+        return SAN_NO_PIECE;
+    }
+
+    if (piece_type == PAWN) {
+        if (capture) {
+            candidates = PAWN_ATTACKS[us ^ 1][to] & ours;
+        } else {
+            int back = us == WHITE ? -8 : 8;
+            int one = to + back;
+            if (occupied & to_bit) {
+                candidates = 0;
+            } else if (one >= 0 && one < 64 && (ours & square_bit(one))) {
+                candidates = square_bit(one);
+            } else if (SQUARE_RANK(to) == (us == WHITE ? 3 : 4) && !(occupied & square_bit(one)) &&
+                       (ours & square_bit(one + back))) {
+                candidates = square_bit(one + back);
+            } else {
+                candidates = 0;
+            }
+        }
+    } else {
+        candidates = piece_attacks(piece_type, to, occupied) & ours;
+    }
+    candidates &= from_mask;
+
+    if (candidates == 0) {
+        return SAN_NO_PIECE;
+    }
+    if ((candidates & (candidates - 1)) == 0) {
+        *from_out = bitboard_lsb(candidates);
+        return SAN_OK;
+    }
+
+    // Several pieces see the target; the pinned ones cannot go there
+    int found = NO_SQUARE;
+    while (candidates) {
+        int from = bitboard_pop_lsb(&candidates);
+        ChessMove move = move_encode(from, to, move_flags_for(pos, piece_type, from, to, -1));
+        if (position_leaves_king_safe(pos, move)) {
+            if (found != NO_SQUARE) {
+                return SAN_AMBIGUOUS;
+            }
+            found = from;
+        }
+    }
+    if (found == NO_SQUARE) {
+        return SAN_NO_PIECE;
+    }
+    *from_out = found;
+    return SAN_OK;
+}
+
+/**
+ * @brief Resolves a SAN token to a move in the given position.
+ *
+ * Handles piece moves with file, rank or square disambiguation (Nbd7, R1e2,
+ * Qh4e1), captures, pawn promotions (e8=Q, exd8Q), castling with O or 0, and
+ * ignores check and annotation suffixes (+, #, !, ?).
+ *
+ * @param san Token, not necessarily null-terminated.
+ * @param len Length of the token.
+ * @param move_out Receives the move on SAN_OK.
+ */
+enum SanStatus san_to_move(const Position *pos, const char *san, size_t len, ChessMove *move_out) {
+    while (len > 0 && is_suffix_char(san[len - 1])) {
+        len--;
+    }
+    if (len < 2) {
+        return SAN_SYNTAX_ERROR;
+    }
+
+    int us = pos->side_to_move;
+
+    if (san[0] == 'O' || san[0] == '0') {
+        char c = san[0];
+        bool king_side = len == 3 && san[1] == '-' && san[2] == c;
+        bool queen_side = len == 5 && san[1] == '-' && san[2] == c && san[3] == '-' && san[4] == c;
+        if (!king_side && !queen_side) {
+            return SAN_SYNTAX_ERROR;
+        }
+        int from = us == WHITE ? SQUARE(4, 0) : SQUARE(4, 7);
+        int right = us == WHITE ? (king_side ? CASTLE_WHITE_KING : CASTLE_WHITE_QUEEN)
+                                : (king_side ? CASTLE_BLACK_KING : CASTLE_BLACK_QUEEN);
+        if (!(pos->castling & right) || !(pos->pieces[MAKE_PIECE(us, KING)] & square_bit(from))) {
+            return SAN_NO_PIECE;
+        }
+        *move_out = king_side ? move_encode(from, from + 2, MOVE_KING_CASTLE)
+                              : move_encode(from, from - 2, MOVE_QUEEN_CASTLE);
+        return SAN_OK;
+    }
+
+    size_t i = 0;
+    int piece_type = san_piece_type(san[0]);
+    if (piece_type >= 0) {
+        i = 1;
+    } else {
+        piece_type = PAWN;
+    }
+
+    int promotion_type = -1;
+    if (piece_type == PAWN && len >= 3) {
+        int type = san_piece_type(san[len - 1]);
+        if (type >= KNIGHT && type <= QUEEN) {
+            promotion_type = type;
+            len--;
+            if (san[len - 1] == '=') {
+                len--;
+            }
+        }
+    }
+
+    if (len < i + 2) {
+        return SAN_SYNTAX_ERROR;
+    }
+    char to_file = san[len - 2];
+    char to_rank = san[len - 1];
+    if (to_file < 'a' || to_file > 'h' || to_rank < '1' || to_rank > '8') {
+        return SAN_SYNTAX_ERROR;
+    }
+    int to = SQUARE(to_file - 'a', to_rank - '1');
+
+    Bitboard from_mask = ~(Bitboard)0;
+    bool capture = false;
+    for (size_t j = i; j < len - 2; j++) {
+        char c = san[j];
+        if (c >= 'a' && c <= 'h') {
+            from_mask &= FILE_A_BB << (c - 'a');
+        } else if (c >= '1' && c <= '8') {
+            from_mask &= RANK_1_BB << (8 * (c - '1'));
+        } else if (c == 'x' || c == ':') {
+            capture = true;
+        } else if (c != '-') {
+            return SAN_SYNTAX_ERROR;
+        }
+    }
+
+    bool last_rank = to_rank == (us == WHITE ? '8' : '1');
+    if (piece_type == PAWN) {
+        if (last_rank != (promotion_type >= 0)) {
+            return SAN_SYNTAX_ERROR;
+        }
+        // A pawn moving to another file is a capture even without the 'x'
+        capture = capture || (from_mask & FILE_A_BB << (to_file - 'a')) == 0;
+    }
+
+    int from;
+    enum SanStatus status = san_find_origin(pos, piece_type, to, from_mask, capture, &from);
+    if (status != SAN_OK) {
+        return status;
+    }
+    *move_out = move_encode(from, to, move_flags_for(pos, piece_type, from, to, promotion_type));
+    return SAN_OK;
+}
+
+size_t move_to_uci(ChessMove move, char *uci_out) {
+    int from = move_from(move);
+    int to = move_to(move);
+    uci_out[0] = (char)('a' + SQUARE_FILE(from));
+    uci_out[1] = (char)('1' + SQUARE_RANK(from));
+    uci_out[2] = (char)('a' + SQUARE_FILE(to));
+    uci_out[3] = (char)('1' + SQUARE_RANK(to));
+    if (move_is_promotion(move)) {
+        uci_out[4] = PROMOTION_CHARS[move_promotion_type(move) - KNIGHT];
+        uci_out[5] = '\0';
+        return 5;
+    }
+    uci_out[4] = '\0';
+    return 4;
+}
+
+/**
+ * @brief Formats a move of the side to move as SAN.
+ *
+ * Adds the minimal disambiguation SAN requires and a '+' when the move gives
+ * check. Mate is also written as '+', since telling it apart needs a full
+ * move generator.
+ *
+ * @param san_out Buffer of at least 8 bytes.
+ * @return Length of the written string.
+ */
+size_t san_from_move(const Position *pos, ChessMove move, char *san_out) {
+    int from = move_from(move);
+    int to = move_to(move);
+    int flags = move_flags(move);
+    int piece_type = PIECE_TYPE(position_piece_at(pos, from));
+    size_t n = 0;
+
+    if (flags == MOVE_KING_CASTLE) {
+        memcpy(san_out, "O-O", 3);
+        n = 3;
+    } else if (flags == MOVE_QUEEN_CASTLE) {
+        memcpy(san_out, "O-O-O", 5);
+        n = 5;
+    } else if (piece_type == PAWN) {
+        if (move_is_capture(move)) {
+            san_out[n++] = (char)('a' + SQUARE_FILE(from));
+            san_out[n++] = 'x';
+        }
+        san_out[n++] = (char)('a' + SQUARE_FILE(to));
+        san_out[n++] = (char)('1' + SQUARE_RANK(to));
+        if (move_is_promotion(move)) {
+            san_out[n++] = '=';
+            san_out[n++] = SAN_PIECE_CHARS[move_promotion_type(move)];
+        }
+    } else {
+        san_out[n++] = SAN_PIECE_CHARS[piece_type];
+        Bitboard others = piece_attacks(piece_type, to, position_occupied(pos)) &
+                          pos->pieces[MAKE_PIECE(pos->side_to_move, piece_type)] &
+                          ~square_bit(from);
+        Bitboard rivals = 0;
+        while (others) {
+            int other = bitboard_pop_lsb(&others);
+            if (position_leaves_king_safe(pos, move_encode(other, to, flags))) {
+                rivals |= square_bit(other);
+            }
+        }
+        if (rivals) {
+            bool file_unique = (rivals & (FILE_A_BB << SQUARE_FILE(from))) == 0;
+            bool rank_unique = (rivals & (RANK_1_BB << (8 * SQUARE_RANK(from)))) == 0;
+            if (file_unique) {
+                san_out[n++] = (char)('a' + SQUARE_FILE(from));
+            } else if (rank_unique) {
+                san_out[n++] = (char)('1' + SQUARE_RANK(from));
+            } else {
+                san_out[n++] = (char)('a' + SQUARE_FILE(from));
+                san_out[n++] = (char)('1' + SQUARE_RANK(from));
+            }
+        }
+        if (move_is_capture(move)) {
+            san_out[n++] = 'x';
+        }
+        san_out[n++] = (char)('a' + SQUARE_FILE(to));
+        san_out[n++] = (char)('1' + SQUARE_RANK(to));
+    }
+
+    Position after = *pos;
+    position_make_move(&after, move);
+    if (position_in_check(&after)) {
+        san_out[n++] = '+';
+    }
+    san_out[n] = '\0';
+    return n;
+}
+
+const char *san_status_string(enum SanStatus status) {
+    switch (status) {
+        case SAN_OK:
+            return "ok";
+        case SAN_SYNTAX_ERROR:
+            return "syntax error";
+        case SAN_NO_PIECE:
+            return "no piece can make the move";
+        case SAN_AMBIGUOUS:
+            return "ambiguous move";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,92 @@
+#include "san_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Longest token, suffixes stripped, that fits next to the move in one word.
+// Enough for any SAN move: the longest, such as Qh4xe1 and exd8=Q, are 6.
+#define SAN_CACHE_MAX_TOKEN 6
+
+/**
+ * @brief Allocates a cache of the largest power-of-two entry count that
+ *        fits in memory_bytes.
+ *
+ * @return false if memory_bytes holds fewer than two entries or allocation
+ *         fails.
+ */
+bool san_cache_init(San_Cache *cache, size_t memory_bytes) {
+    memset(cache, 0, sizeof(*cache));
+    size_t entries = 1;
+    int bits = 0;
+    while (entries * 2 * sizeof(San_Cache_Entry) <= memory_bytes) {
+        entries *= 2;
+        bits++;
+    }
+    if (bits == 0) {
+        return false;
+    }
+    cache->entries = (San_Cache_Entry *)calloc(entries, sizeof(San_Cache_Entry));
+    if (cache->entries == NULL) {
+        return false;
+    }
+    cache->shift = 64 - bits;
+    return true;
+}
+
+/**
+ * @brief Resolves a SAN token like san_to_move, from the cache when the
+ *        same token was resolved in the same position before.
+ *
+ * Check and annotation suffixes are not part of the key, so "Nf3" and
+ * "Nf3+" share an entry. Only tokens that resolve are stored; errors are
+ * worked out again each time.
+ *
+ * @param cache Cache of the calling thread, or NULL to always call san_to_move.
+ * @param lookup_out Receives whether the cache was used, and how it went.
+ */
+enum SanStatus san_cache_resolve(San_Cache *cache, const Position *pos, const char *san, size_t len,
+                                 ChessMove *move_out, enum San_Cache_Lookup *lookup_out) {
+    size_t key_len = len;
+    while (key_len > 0 && (san[key_len - 1] == '+' || san[key_len - 1] == '#' || san[key_len - 1] == '!' ||
+                           san[key_len - 1] == '?')) {
+        key_len--;
+    }
+    if (cache == NULL || pos->fullmove_number > SAN_CACHE_MAX_MOVE || key_len < 2 ||
+        key_len > SAN_CACHE_MAX_TOKEN) {
+        *lookup_out = SAN_CACHE_BYPASS;
+        return san_to_move(pos, san, len, move_out);
+    }
+
+    // A token is at least 2 nonzero bytes, so it never matches an empty entry
+    uint64_t token = 0;
+    memcpy(&token, san, key_len);
+    size_t slot = (size_t)(((pos->key ^ token) * 0x9E3779B97F4A7C15ULL) >> cache->shift);
+    San_Cache_Entry *entry = &cache->entries[slot];
+    if (entry->position_key == pos->key && entry->token_move >> 16 == token) {
+        ChessMove move = (ChessMove)entry->token_move;
+        // Cheap guard against a Zobrist collision: the move starts from one
+        // of our pieces
+        if (pos->occupancy[pos->side_to_move] & square_bit(move_from(move))) {
+            *lookup_out = SAN_CACHE_HIT;
+            *move_out = move;
+            return SAN_OK;
+        }
+    }
+
+    *lookup_out = SAN_CACHE_MISS;
+    enum SanStatus status = san_to_move(pos, san, len, move_out);
+    if (status == SAN_OK) {
+        entry->position_key = pos->key;
+        entry->token_move = token << 16 | *move_out;
+    }
+    return status;
+}
+
+size_t san_cache_memory(const San_Cache *cache) {
+    return cache->entries != NULL ? ((size_t)1 << (64 - cache->shift)) * sizeof(San_Cache_Entry) : 0;
+}
+
+void san_cache_free(San_Cache *cache) {
+    free(cache->entries);
+    cache->entries = NULL;
+}
@@ -0,0 +1,224 @@
+#define _POSIX_C_SOURCE 200809L
+#include "shard_writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Makes a rename in dir durable
+static bool sync_dir(const char *dir) {
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return ok;
+}
+
+void shard_path(const char *dir, uint64_t shard, const char *extension, char *out, size_t out_size) {
+    snprintf(out, out_size, "%s/part-%05llu%s", dir, (unsigned long long)shard, extension);
+}
+
+/**
+ * @brief Sets up a shard writer; no file is created until shard_writer_open.
+ *
+ * @param dir Existing output directory.
+ * @param extension Appended to each shard name, e.g. ".csv.zst".
+ * @param first_shard Number of the first shard, non-zero when resuming.
+ * @return false if the path does not fit or the buffer cannot be allocated.
+ */
+bool shard_writer_init(Shard_Writer *shards, const char *dir, const char *extension, uint64_t first_shard) {
+    memset(shards, 0, sizeof(*shards));
+    shards->fd = -1;
+    if (strlen(dir) >= sizeof(shards->dir) ||
+        strlen(extension) >= sizeof(shards->extension)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    strcpy(shards->dir, dir);
+    strcpy(shards->extension, extension);
+    shards->shard = first_shard;
+    return output_writer_init(&shards->writer, -1);
+}
+
+/**
+ * @brief Starts the next shard as a temporary file.
+ *
+ * A temporary file left behind by an interrupted run is overwritten.
+ *
+ * @return false if the file cannot be created (see errno).
+ */
+bool shard_writer_open(Shard_Writer *shards) {
+    char path[SHARD_PATH_MAX + 8];
+    shard_path(shards->dir, shards->shard, shards->extension, path, sizeof(path));
+    strcat(path, ".tmp");
+    shards->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (shards->fd < 0) {
+        return false;
+    }
+    shards->writer.fd = shards->fd;
+    shards->writer.length = 0;
+    shards->writer.bytes_written = 0;
+    shards->writer.error = 0;
+    return true;
+}
+
+/**
+ * @brief Completes the open shard: flushes and syncs it, then renames it to
+ *        its final name.
+ *
+ * @return false on a failed write, sync or rename (see errno).
+ */
+bool shard_writer_close(Shard_Writer *shards) {
+    char path[SHARD_PATH_MAX];
+    char temp[SHARD_PATH_MAX + 8];
+    shard_path(shards->dir, shards->shard, shards->extension, path, sizeof(path));
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+
+    bool ok = output_writer_flush(&shards->writer);
+    if (!ok) {
+        errno = shards->writer.error;
+    }
+    ok = ok && fsync(shards->fd) == 0;
+    int saved = errno;
+    if (close(shards->fd) != 0 && ok) {
+        ok = false;
+        saved = errno;
+    }
+    shards->fd = -1;
+    errno = saved;
+    ok = ok && rename(temp, path) == 0 && sync_dir(shards->dir);
+    if (ok) {
+        shards->bytes_written += shards->writer.bytes_written;
+        shards->shard++;
+    }
+    return ok;
+}
+
+/**
+ * @brief Frees the writer. A shard that is still open is abandoned: its
+ *        temporary file stays behind and is rewritten on resume.
+ */
+void shard_writer_free(Shard_Writer *shards) {
+    if (shards->fd >= 0) {
+        close(shards->fd);
+        shards->fd = -1;
+    }
+    output_writer_free(&shards->writer);
+}
+
+/**
+ * @brief Writes dir/checkpoint atomically (temporary file, sync, rename).
+ *
+ * The checkpoint is plain "key value" text so it can be read and, for
+ * splitting work by hand, edited. Time controls follow as one
+ * "time_control NAME" line per id, in id order.
+ *
+ * @return false if it cannot be written (see errno).
+ */
+bool shard_checkpoint_save(const char *dir, const Shard_Checkpoint *checkpoint) {
+    char path[SHARD_PATH_MAX];
+    char temp[SHARD_PATH_MAX + 8];
+    snprintf(path, sizeof(path), "%s/" SHARD_CHECKPOINT_NAME, dir);
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    FILE *file = fopen(temp, "w");
+    if (file == NULL) {
+        return false;
+    }
+    fprintf(file, SHARD_CHECKPOINT_MAGIC "\n");
+    fprintf(file, "input_size %llu\n", (unsigned long long)checkpoint->input_size);
+    fprintf(file, "range_end %llu\n", (unsigned long long)checkpoint->range_end);
+    fprintf(file, "next_game %llu\n", (unsigned long long)checkpoint->next_game);
+    fprintf(file, "offset %llu\n", (unsigned long long)checkpoint->offset);
+    fprintf(file, "shard %llu\n", (unsigned long long)checkpoint->shard);
+    fprintf(file, "games %llu\n", (unsigned long long)checkpoint->games);
+    fprintf(file, "rejected %llu\n", (unsigned long long)checkpoint->rejected);
+    fprintf(file, "plies %llu\n", (unsigned long long)checkpoint->plies);
+    fprintf(file, "duplicates %llu\n", (unsigned long long)checkpoint->duplicates);
+    fprintf(file, "bytes_written %llu\n", (unsigned long long)checkpoint->bytes_written);
+    fprintf(file, "complete %d\n", checkpoint->complete ? 1 : 0);
+    const Text_Buffer *names = &checkpoint->time_controls;
+    for (size_t at = 0; at < names->length; at += 1 + (uint8_t)names->data[at]) {
+        fprintf(file, "time_control %.*s\n", (int)(uint8_t)names->data[at], names->data + at + 1);
+    }
+    bool ok = fflush(file) == 0 && fsync(fileno(file)) == 0;
+    int saved = errno;
+    if (fclose(file) != 0 && ok) {
+        ok = false;
+        saved = errno;
+    }
+    errno = saved;
+    return ok && rename(temp, path) == 0 && sync_dir(dir);
+}
+
+/**
+ * @brief Reads dir/checkpoint.
+ *
+ * @return false if there is none (errno ENOENT) or it is malformed (EINVAL).
+ */
+bool shard_checkpoint_load(const char *dir, Shard_Checkpoint *checkpoint) {
+    char path[SHARD_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/" SHARD_CHECKPOINT_NAME, dir);
+    memset(checkpoint, 0, sizeof(*checkpoint));
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+    struct {
+        const char *key;
+        uint64_t *value;
+    } fields[] = {
+        {"input_size", &checkpoint->input_size}, {"range_end", &checkpoint->range_end},
+        {"next_game", &checkpoint->next_game},   {"offset", &checkpoint->offset},
+        {"shard", &checkpoint->shard},           {"games", &checkpoint->games},
+        {"rejected", &checkpoint->rejected},     {"plies", &checkpoint->plies},
+        {"duplicates", &checkpoint->duplicates}, {"bytes_written", &checkpoint->bytes_written},
+    };
+    size_t field_count = sizeof(fields) / sizeof(fields[0]);
+    unsigned found = 0;
+    bool ok = false;
+    char line[320];
+    if (fgets(line, sizeof(line), file) != NULL && strcmp(line, SHARD_CHECKPOINT_MAGIC "\n") == 0) {
+        ok = true;
+        while (ok && fgets(line, sizeof(line), file) != NULL) {
+            if (strncmp(line, "time_control ", 13) == 0) {
+                size_t length = strcspn(line + 13, "\n");
+                char length_byte = (char)length;
+                ok = length <= 255 && text_buffer_append(&checkpoint->time_controls, &length_byte, 1) &&
+                     text_buffer_append(&checkpoint->time_controls, line + 13, length);
+                continue;
+            }
+            char key[64];
+            unsigned long long value;
+            ok = sscanf(line, "%63s %llu", key, &value) == 2;
+            if (ok && strcmp(key, "complete") == 0) {
+                checkpoint->complete = value != 0;
+                found |= 1u << field_count;
+                continue;
+            }
+            for (size_t i = 0; ok && i < field_count; i++) {
+                if (strcmp(key, fields[i].key) == 0) {
+                    *fields[i].value = value;
+                    found |= 1u << i;
+                }
+            }
+        }
+    }
+    fclose(file);
+    if (!ok || found != (2u << field_count) - 1) {
+        shard_checkpoint_free(checkpoint);
+        errno = EINVAL;
+        return false;
+    }
+    return true;
+}
+
+void shard_checkpoint_free(Shard_Checkpoint *checkpoint) {
+    text_buffer_free(&checkpoint->time_controls);
+}
@@ -0,0 +1,371 @@
+// CPython extension over the C reader: PGN games in, FEN+ records out in
+// batches that numpy maps without copying. Build with `make python`; the
+// module lands next to this file as src_python.chess_native.
+//
+//   reader = chess_native.Reader("games.pgn.zst", batch_rows=65536)
+//   for batch in reader:
+//       records = np.asarray(batch)     # structured, fen_record.RECORD_DTYPE
+//   reader.time_controls                # names of the time_control ids
+//
+// A batch is one malloc'd array of FEN_Record (include/fen_record.h) exposed
+// through the buffer protocol. Decoding, SAN resolution and record building
+// run with the GIL released, so other Python threads keep going meanwhile.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "attacks.h"
+#include "fen_plus.h"
+#include "fen_record.h"
+#include "pgn_scan.h"
+#include "pgn_stream.h"
+#include "san_cache.h"
+
+#define READER_DEFAULT_BATCH_ROWS 65536
+
+// PEP 3118 layout of FEN_Record, field names as in fen_record.RECORD_DTYPE
+static const char RECORD_FORMAT[] =
+    "<T{(32)B:board:B:flags:B:en_passant:H:halfmove_clock:H:fullmove_number:"
+    "H:move:H:elo:H:time_control:I:game:}";
+
+// Records of one batch, owned by the batch and freed with it
+typedef struct {
+    PyObject_HEAD
+    char *data;
+    Py_ssize_t rows;
+    Py_ssize_t record_size;     // shape and stride of the exported buffer
+} Batch_Object;
+
+typedef struct {
+    PyObject_HEAD
+    PGN_Stream *stream;         // NULL once closed
+    FEN_Record_Time_Controls time_controls;
+    San_Cache san_cache;
+    FEN_Plus_Stats stats;
+    size_t batch_rows;
+    bool busy;                  // a batch is being read with the GIL released
+    bool done;
+    bool failed;                // the stream failed after the last batch; the next call raises
+} Reader_Object;
+
+enum Read_Status {
+    READ_OK,
+    READ_END,                   // the input is exhausted; the batch may still hold records
+    READ_NO_MEMORY,
+    READ_STREAM_ERROR
+};
+
+static PyTypeObject Batch_Type;
+
+static void batch_dealloc(Batch_Object *self) {
+    free(self->data);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static Py_ssize_t batch_length(Batch_Object *self) {
+    return self->rows;
+}
+
+static int batch_getbuffer(Batch_Object *self, Py_buffer *view, int flags) {
+    view->obj = (PyObject *)self;
+    Py_INCREF(self);
+    view->buf = self->data;
+    view->len = self->rows * self->record_size;
+    view->readonly = 0;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    view->ndim = 1;
+    // Without PyBUF_ND the consumer sees plain bytes
+    if ((flags & PyBUF_ND) == PyBUF_ND) {
+        view->itemsize = self->record_size;
+        view->format = (flags & PyBUF_FORMAT) ? (char *)RECORD_FORMAT : NULL;
+        view->shape = &self->rows;
+        view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &self->record_size : NULL;
+    } else {
+        view->itemsize = 1;
+        view->format = (flags & PyBUF_FORMAT) ? "B" : NULL;
+        view->shape = NULL;
+        view->strides = NULL;
+    }
+    return 0;
+}
+
+static PySequenceMethods batch_as_sequence = {
+    .sq_length = (lenfunc)batch_length,
+};
+
+static PyBufferProcs batch_as_buffer = {
+    .bf_getbuffer = (getbufferproc)batch_getbuffer,
+};
+
+static PyTypeObject Batch_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "chess_native.Batch",
+    .tp_doc = "FEN+ records of consecutive games, one per ply; np.asarray(batch) maps them.",
+    .tp_basicsize = sizeof(Batch_Object),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor)batch_dealloc,
+    .tp_as_sequence = &batch_as_sequence,
+    .tp_as_buffer = &batch_as_buffer,
+};
+
+/**
+ * @brief Converts games into out until it holds batch_rows records or the
+ *        input ends. Runs without the GIL: touches only the reader's own
+ *        C state.
+ */
+static enum Read_Status read_batch(Reader_Object *self, Text_Buffer *out) {
+    size_t target = self->batch_rows * sizeof(FEN_Record);
+    if (!text_buffer_reserve(out, target)) {
+        return READ_NO_MEMORY;
+    }
+    PGN_Game game;
+    while (out->length < target) {
+        if (!pgn_stream_next_game(self->stream, &game)) {
+            return pgn_stream_error(self->stream) != NULL ? READ_STREAM_ERROR : READ_END;
+        }
+        PGN_Header_Tags tags;
+        pgn_scan_headers(game.header, game.header_len, &tags);
+        const char *name = tags.time_control.value ? tags.time_control.value : "-";
+        size_t length = tags.time_control.value ? tags.time_control.length : 1;
+        uint16_t time_control = fen_record_time_control_id(&self->time_controls, name,
+                                                           length > 32 ? 32 : length);
+        if (!fen_record_append_game(&game, time_control, NULL, out, &self->stats)) {
+            return READ_NO_MEMORY;
+        }
+    }
+    return READ_OK;
+}
+
+static void reader_close_stream(Reader_Object *self) {
+    if (self->stream != NULL) {
+        pgn_stream_close(self->stream);
+        self->stream = NULL;
+    }
+}
+
+static int reader_init(Reader_Object *self, PyObject *args, PyObject *kwargs) {
+    static char *keywords[] = {"path", "batch_rows", "san_cache_kb", NULL};
+    PyObject *path_object;
+    Py_ssize_t batch_rows = READER_DEFAULT_BATCH_ROWS;
+    Py_ssize_t san_cache_kb = SAN_CACHE_DEFAULT_MEMORY / 1024;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O&|nn", keywords, PyUnicode_FSConverter, &path_object,
+                                     &batch_rows, &san_cache_kb)) {
+        return -1;
+    }
+    if (batch_rows < 1 || san_cache_kb < 0) {
+        Py_DECREF(path_object);
+        PyErr_SetString(PyExc_ValueError, "batch_rows must be positive and san_cache_kb not negative");
+        return -1;
+    }
+    if (self->stream != NULL || self->busy) {
+        Py_DECREF(path_object);
+        PyErr_SetString(PyExc_RuntimeError, "Reader is already open");
+        return -1;
+    }
+    // __init__ again on a closed reader starts over
+    san_cache_free(&self->san_cache);
+    fen_record_time_controls_free(&self->time_controls);
+    memset(&self->stats, 0, sizeof(self->stats));
+    self->done = false;
+    self->failed = false;
+    const char *path = PyBytes_AS_STRING(path_object);
+    PGN_Stream *stream;
+    Py_BEGIN_ALLOW_THREADS
+    // Plain files are mapped; pipes and .zst inputs are read
+    stream = pgn_stream_open_mapped(path, 0, 0);
+    if (stream == NULL) {
+        stream = pgn_stream_open(path);
+    }
+    Py_END_ALLOW_THREADS
+    if (stream == NULL) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+        Py_DECREF(path_object);
+        return -1;
+    }
+    Py_DECREF(path_object);
+
+    self->stream = stream;
+    self->batch_rows = (size_t)batch_rows;
+    if (san_cache_kb > 0 && !san_cache_init(&self->san_cache, (size_t)san_cache_kb * 1024)) {
+        reader_close_stream(self);
+        PyErr_SetString(PyExc_ValueError, "san_cache_kb too small for a SAN cache");
+        return -1;
+    }
+    self->stats.san_cache = self->san_cache.entries != NULL ? &self->san_cache : NULL;
+    return 0;
+}
+
+static void reader_dealloc(Reader_Object *self) {
+    reader_close_stream(self);
+    san_cache_free(&self->san_cache);
+    fen_record_time_controls_free(&self->time_controls);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *reader_iternext(Reader_Object *self) {
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "Reader is in use by another thread");
+        return NULL;
+    }
+    if (self->stream == NULL) {
+        if (!self->done) {
+            PyErr_SetString(PyExc_ValueError, "Reader is closed");
+        }
+        return NULL;
+    }
+    if (self->failed) {
+        self->failed = false;
+        PyErr_SetString(PyExc_OSError, pgn_stream_error(self->stream));
+        return NULL;
+    }
+    Batch_Object *batch = PyObject_New(Batch_Object, &Batch_Type);
+    if (batch == NULL) {
+        return NULL;
+    }
+    batch->data = NULL;
+    batch->rows = 0;
+    batch->record_size = sizeof(FEN_Record);
+
+    Text_Buffer out = {0};
+    enum Read_Status status;
+    self->busy = true;
+    Py_BEGIN_ALLOW_THREADS
+    status = read_batch(self, &out);
+    Py_END_ALLOW_THREADS
+    self->busy = false;
+
+    batch->data = out.data;
+    batch->rows = (Py_ssize_t)(out.length / sizeof(FEN_Record));
+    if (status == READ_NO_MEMORY) {
+        Py_DECREF(batch);
+        return PyErr_NoMemory();
+    }
+    // The games read before the error are whole; they come first
+    if (status == READ_STREAM_ERROR && batch->rows > 0) {
+        self->failed = true;
+    } else if (status == READ_STREAM_ERROR) {
+        PyErr_SetString(PyExc_OSError, pgn_stream_error(self->stream));
+        Py_DECREF(batch);
+        return NULL;
+    }
+    if (status == READ_END) {
+        self->done = true;
+        reader_close_stream(self);
+    }
+    if (batch->rows == 0) {
+        Py_DECREF(batch);
+        return NULL;
+    }
+    return (PyObject *)batch;
+}
+
+static PyObject *reader_close(Reader_Object *self, PyObject *Py_UNUSED(ignored)) {
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "Reader is in use by another thread");
+        return NULL;
+    }
+    reader_close_stream(self);
+    Py_RETURN_NONE;
+}
+
+static PyObject *reader_enter(Reader_Object *self, PyObject *Py_UNUSED(ignored)) {
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+static PyObject *reader_exit(Reader_Object *self, PyObject *Py_UNUSED(args)) {
+    return reader_close(self, NULL);
+}
+
+static PyObject *reader_get_time_controls(Reader_Object *self, void *Py_UNUSED(closure)) {
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "Reader is in use by another thread");
+        return NULL;
+    }
+    PyObject *names = PyList_New((Py_ssize_t)self->time_controls.count);
+    if (names == NULL) {
+        return NULL;
+    }
+    for (size_t id = 0; id < self->time_controls.count; id++) {
+        size_t length;
+        const char *name = fen_record_time_control_name(&self->time_controls, (uint16_t)id, &length);
+        PyObject *text = PyUnicode_DecodeUTF8(name, (Py_ssize_t)length, "replace");
+        if (text == NULL) {
+            Py_DECREF(names);
+            return NULL;
+        }
+        PyList_SET_ITEM(names, (Py_ssize_t)id, text);
+    }
+    return names;
+}
+
+static PyObject *reader_get_stats(Reader_Object *self, void *Py_UNUSED(closure)) {
+    const FEN_Plus_Stats *s = &self->stats;
+    return Py_BuildValue("{s:K,s:K,s:K,s:K,s:K}", "games", (unsigned long long)s->games, "rejected",
+                         (unsigned long long)s->rejected, "plies", (unsigned long long)s->plies,
+                         "san_cache_hits", (unsigned long long)s->san_cache_hits, "san_cache_misses",
+                         (unsigned long long)s->san_cache_misses);
+}
+
+static PyMethodDef reader_methods[] = {
+    {"close", (PyCFunction)reader_close, METH_NOARGS, "Closes the input; iterating afterwards raises ValueError."},
+    {"__enter__", (PyCFunction)reader_enter, METH_NOARGS, NULL},
+    {"__exit__", (PyCFunction)reader_exit, METH_VARARGS, NULL},
+    {NULL, NULL, 0, NULL},
+};
+
+static PyGetSetDef reader_getset[] = {
+    {"time_controls", (getter)reader_get_time_controls, NULL,
+     "Time-control names, indexed by the time_control field of the records read so far.", NULL},
+    {"stats", (getter)reader_get_stats, NULL, "Games converted and rejected, plies, SAN cache hits.", NULL},
+    {NULL, NULL, NULL, NULL, NULL},
+};
+
+static PyTypeObject Reader_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "chess_native.Reader",
+    .tp_doc = "Reader(path, batch_rows=65536, san_cache_kb=1024)\n\n"
+              "Iterates over a .pgn or .pgn.zst file in batches of FEN+ records. A batch holds\n"
+              "whole games, at least batch_rows records except for the last. If the input\n"
+              "breaks off, the games before the break come in a last batch and the next\n"
+              "call raises OSError.",
+    .tp_basicsize = sizeof(Reader_Object),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)reader_init,
+    .tp_dealloc = (destructor)reader_dealloc,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc)reader_iternext,
+    .tp_methods = reader_methods,
+    .tp_getset = reader_getset,
+};
+
+static struct PyModuleDef chess_native_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "chess_native",
+    .m_doc = "PGN to FEN+ records in C, as numpy-compatible batches.",
+    .m_size = -1,
+};
+
+PyMODINIT_FUNC PyInit_chess_native(void) {
+    attacks_init();
+    if (PyType_Ready(&Batch_Type) < 0 || PyType_Ready(&Reader_Type) < 0) {
+        return NULL;
+    }
+    PyObject *module = PyModule_Create(&chess_native_module);
+    if (module == NULL) {
+        return NULL;
+    }
+    Py_INCREF(&Reader_Type);
+    Py_INCREF(&Batch_Type);
+    if (PyModule_AddObject(module, "Reader", (PyObject *)&Reader_Type) < 0 ||
+        PyModule_AddObject(module, "Batch", (PyObject *)&Batch_Type) < 0 ||
+        PyModule_AddIntConstant(module, "RECORD_SIZE", (long)sizeof(FEN_Record)) < 0) {
+        Py_DECREF(module);
+        return NULL;
+    }
+    return module;
+}
@@ -0,0 +1,86 @@
+"""
+numpy view of the binary FEN+ record files written by `chess_pipeline --format records`.
+
+The layout mirrors include/fen_record.h. Uncompressed files (`--level 0`) are
+mapped straight into a structured array; compressed files are read one block
+(one zstd frame) at a time and need the `zstandard` package.
+"""
+import struct
+
+import numpy as np
+
+MAGIC = b"FENREC01"
+TRAILER_MAGIC = b"FENRIDX1"
+DATA_OFFSET = 32
+COMPRESSION_NONE = 0
+COMPRESSION_ZSTD = 1
+TIME_CONTROL_OTHER = 0xFFFF
+
+# Piece codes in `board` are enum Piece + 1, 0 for an empty square
+PIECE_CHARS = ".PNBRQKpnbrqk"
+
+RECORD_DTYPE = np.dtype([
+    ("board", "u1", (32,)),         # 4 bits per square, a1 in the low nibble of byte 0
+    ("flags", "u1"),                # bit 0: black to move, bits 4-7: castling rights KQkq
+    ("en_passant", "u1"),           # target square (a1 = 0), 64 if none
+    ("halfmove_clock", "<u2"),
+    ("fullmove_number", "<u2"),
+    ("move", "<u2"),                # from | to << 6 | flags << 12
+    ("elo", "<u2"),                 # Elo of the side to move, 0 if unknown
+    ("time_control", "<u2"),        # index into RecordFile.time_controls
+    ("game", "<u4"),                # index of the game in the input
+])
+assert RECORD_DTYPE.itemsize == 48
+
+_HEADER = struct.Struct("<8sIII12x")
+_BLOCK_ENTRY = np.dtype([("offset", "<u8"), ("stored_size", "<u4"), ("records", "<u4")])
+_TRAILER = struct.Struct("<QQQII8s")
+
+
+class RecordFile:
+    def __init__(self, path: str):
+        self.path = path
+        self._bytes = np.memmap(path, dtype=np.uint8, mode="r")
+        magic, version, record_size, self.compression = _HEADER.unpack_from(self._bytes, 0)
+        if magic != MAGIC or version != 1 or record_size != RECORD_DTYPE.itemsize:
+            raise ValueError(f"{path}: not a FEN record file")
+        (index_offset, time_control_offset, self.record_count, block_count, time_control_count,
+         trailer_magic) = _TRAILER.unpack_from(self._bytes, len(self._bytes) - _TRAILER.size)
+        if trailer_magic != TRAILER_MAGIC:
+            raise ValueError(f"{path}: missing footer, file is truncated")
+        self.blocks = np.frombuffer(self._bytes, dtype=_BLOCK_ENTRY, count=block_count,
+                                    offset=index_offset)
+        self.time_controls = []
+        position = time_control_offset
+        for _ in range(time_control_count):
+            length = int(self._bytes[position])
+            self.time_controls.append(bytes(self._bytes[position + 1:position + 1 + length]).decode())
+            position += 1 + length
+
+    def records(self) -> np.ndarray:
+        """
+        All records of an uncompressed file, mapped without copying.
+        """
+        if self.compression != COMPRESSION_NONE:
+            raise ValueError("compressed file: use read_block")
+        return np.frombuffer(self._bytes, dtype=RECORD_DTYPE, count=self.record_count,
+                             offset=DATA_OFFSET)
+
+    def read_block(self, block: int) -> np.ndarray:
+        entry = self.blocks[block]
+        start = int(entry["offset"])
+        stored = self._bytes[start:start + int(entry["stored_size"])]
+        if self.compression == COMPRESSION_NONE:
+            return np.frombuffer(stored, dtype=RECORD_DTYPE)
+        import zstandard
+        size = int(entry["records"]) * RECORD_DTYPE.itemsize
+        raw = zstandard.ZstdDecompressor().decompress(bytes(stored), max_output_size=size)
+        return np.frombuffer(raw, dtype=RECORD_DTYPE)
+
+
+def unpack_board(records: np.ndarray) -> np.ndarray:
+    """
+    Piece codes per square, shape (n, 64), index 0 = a1.
+    """
+    board = records["board"]
+    return np.stack([board & 15, board >> 4], axis=-1).reshape(len(records), 64)
@@ -0,0 +1,113 @@
+import os
+import shutil
+import subprocess
+import tempfile
+import threading
+import unittest
+
+import numpy as np
+
+import src_python.test.test_artifacts as test_artifacts
+from src_python.fen_record import RECORD_DTYPE, unpack_board
+
+try:
+    from src_python import chess_native
+except ImportError:
+    chess_native = None
+
+ARTIFACT_PLIES = 61 + 108 + 37
+
+
+@unittest.skipIf(chess_native is None, "extension not built, run make python")
+class TestChessNative(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        games = []
+        for name in ("game_1.pgn", "game_2.pgn", "game_3.pgn"):
+            with open(os.path.join(test_artifacts.__path__[0], name)) as file:
+                games.append(file.read())
+        cls.games = games
+        with tempfile.NamedTemporaryFile("w", suffix=".pgn", delete=False) as file:
+            file.write("\n\n".join(games * 10) + "\n")
+        cls.path = file.name
+
+    @classmethod
+    def tearDownClass(cls):
+        os.unlink(cls.path)
+
+    def test_batches_are_structured_records(self):
+        reader = chess_native.Reader(self.path, batch_rows=500)
+        batches = [np.asarray(batch) for batch in reader]
+        self.assertGreater(len(batches), 1)
+        self.assertEqual(batches[0].dtype, RECORD_DTYPE)
+        records = np.concatenate(batches)
+        self.assertEqual(len(records), ARTIFACT_PLIES * 10)
+        self.assertEqual(reader.stats["games"], 30)
+        self.assertEqual(reader.stats["rejected"], 0)
+        # Games are never split across batches
+        for before, after in zip(batches, batches[1:]):
+            self.assertLess(before["game"][-1], after["game"][0])
+        self.assertEqual(reader.time_controls, ["180+0", "600+0"])
+        self.assertEqual(set(records["time_control"]), {0, 1})
+        self.assertEqual(records["fullmove_number"][0], 1)
+        self.assertEqual(unpack_board(records[:1])[0, 4], 6)   # white king on e1
+
+    def test_buffer_is_shared_not_copied(self):
+        batch = next(iter(chess_native.Reader(self.path)))
+        first = np.frombuffer(batch, dtype=RECORD_DTYPE)
+        second = np.asarray(batch)
+        self.assertEqual(len(batch), len(first))
+        self.assertTrue(np.shares_memory(first, second))
+        self.assertEqual(memoryview(batch).nbytes, len(batch) * chess_native.RECORD_SIZE)
+
+    def test_same_records_without_san_cache(self):
+        cached = np.concatenate([np.asarray(b) for b in chess_native.Reader(self.path)])
+        uncached = np.concatenate([np.asarray(b) for b in chess_native.Reader(self.path, san_cache_kb=0)])
+        self.assertEqual(cached.tobytes(), uncached.tobytes())
+
+    def test_reads_from_another_thread(self):
+        reader = chess_native.Reader(self.path, batch_rows=10 ** 6)
+        results = []
+        thread = threading.Thread(target=lambda: results.append(len(next(reader))))
+        thread.start()
+        thread.join()
+        self.assertEqual(results, [ARTIFACT_PLIES * 10])
+
+    def test_init_again_starts_over(self):
+        reader = chess_native.Reader(self.path, batch_rows=500)
+        first = sum(len(batch) for batch in reader)
+        reader.__init__(self.path)
+        self.assertEqual(sum(len(batch) for batch in reader), first)
+        self.assertEqual(reader.stats["games"], 30)
+        self.assertEqual(reader.time_controls, ["180+0", "600+0"])
+
+    @unittest.skipIf(shutil.which("zstd") is None, "needs the zstd command")
+    def test_truncated_input_yields_games_then_raises(self):
+        # A whole frame larger than the stream buffer, then one cut short
+        text = ("\n\n".join(self.games * 2000) + "\n").encode()
+        compressed = subprocess.run(["zstd", "-c"], input=text, capture_output=True, check=True).stdout
+        with tempfile.NamedTemporaryFile(suffix=".pgn.zst", delete=False) as file:
+            file.write(compressed + compressed[: len(compressed) // 2])
+        try:
+            reader = chess_native.Reader(file.name, batch_rows=10 ** 7)
+            batch = next(reader)
+            self.assertGreater(len(batch), 0)
+            self.assertEqual(len(batch), reader.stats["plies"])
+            with self.assertRaises(OSError):
+                next(reader)
+        finally:
+            os.unlink(file.name)
+
+    def test_errors(self):
+        with self.assertRaises(OSError):
+            chess_native.Reader(os.path.join(tempfile.gettempdir(), "does_not_exist.pgn"))
+        with self.assertRaises(ValueError):
+            chess_native.Reader(self.path, batch_rows=0)
+        with chess_native.Reader(self.path) as reader:
+            pass
+        with self.assertRaises(ValueError):
+            next(reader)
+
+
+if __name__ == "__main__":
+    unittest.main()
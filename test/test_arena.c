@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../include/arena.h"
+#include "../include/fen_utils.h"
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+// Allocations are aligned, distinct and writable; a reset hands the same
+// memory out again without growing the arena
+void test_arena_reset_reuses_chunks() {
+    printf("Testing arena reset...\n");
+    Arena arena;
+    assert(arena_init(&arena, 1024));
+    assert(arena.reserved == 0);
+
+    char *first = NULL;
+    char *previous = NULL;
+    for (int i = 0; i < 200; i++) {
+        char *object = (char *)arena_alloc(&arena, 24);
+        assert(object != NULL);
+        assert((uintptr_t)object % ARENA_ALIGN == 0);
+        assert(object != previous);
+        memset(object, i, 24);
+        if (first == NULL) {
+            first = object;
+        }
+        previous = object;
+    }
+    size_t reserved = arena.reserved;
+    assert(reserved >= 200 * 32);
+
+    for (int round = 0; round < 10; round++) {
+        arena_reset(&arena);
+        assert(arena_alloc(&arena, 24) == first);
+        for (int i = 1; i < 200; i++) {
+            assert(arena_alloc(&arena, 24) != NULL);
+        }
+        assert(arena.reserved == reserved);
+    }
+    assert(arena.allocations == 11 * 200);
+
+    arena_free(&arena);
+    assert(arena.first == NULL && arena.reserved == 0);
+    printf("✓ Reset reuses chunks, %zu bytes reserved\n", reserved);
+}
+
+// Requests larger than a chunk get a chunk of their own, and the arena keeps
+// bumping small objects afterwards
+void test_arena_large_allocations() {
+    printf("Testing large arena allocations...\n");
+    Arena arena;
+    assert(arena_init(&arena, 256));
+    char *small = (char *)arena_alloc(&arena, 16);
+    char *large = (char *)arena_alloc(&arena, 10000);
+    assert(small != NULL && large != NULL);
+    memset(large, 'x', 10000);
+    char *after = (char *)arena_alloc(&arena, 16);
+    assert(after != NULL);
+    assert(after < large || after >= large + 10000);
+    assert(arena.reserved >= 10000 + 256);
+
+    // After a reset the large chunk is reused rather than allocated again
+    size_t reserved = arena.reserved;
+    arena_reset(&arena);
+    assert(arena_alloc(&arena, 16) == small);
+    assert(arena_alloc(&arena, 10000) == large);
+    assert(arena.reserved == reserved);
+
+    assert(arena_alloc(&arena, SIZE_MAX - 64) == NULL);
+    arena_free(&arena);
+    printf("✓ Large allocations get their own chunk\n");
+}
+
+void test_pool_reuse() {
+    printf("Testing pool...\n");
+    Pool pool;
+    assert(!pool_init(&pool, 0, 8));
+    assert(pool_init(&pool, 40, 8));
+    assert(pool.object_size % ARENA_ALIGN == 0 && pool.object_size >= 40);
+
+    void *objects[20];
+    for (int i = 0; i < 20; i++) {
+        objects[i] = pool_alloc(&pool);
+        assert(objects[i] != NULL);
+        assert((uintptr_t)objects[i] % ARENA_ALIGN == 0);
+        memset(objects[i], i, 40);
+        for (int j = 0; j < i; j++) {
+            assert(objects[i] != objects[j]);
+        }
+    }
+    assert(pool.live == 20);
+    assert(pool.capacity == 24);
+
+    // Released objects come back most recent first, without new slabs
+    pool_release(&pool, objects[3]);
+    pool_release(&pool, objects[11]);
+    assert(pool.live == 18);
+    assert(pool_alloc(&pool) == objects[11]);
+    assert(pool_alloc(&pool) == objects[3]);
+    assert(pool.capacity == 24);
+
+    pool_release(&pool, NULL);
+    assert(pool.live == 20);
+    pool_free(&pool);
+    assert(pool.live == 0 && pool.capacity == 0);
+    printf("✓ Pool recycles released objects\n");
+}
+
+// The arena variants give the same results as the malloc'd originals
+void test_fen_utils_arena_variants() {
+    printf("Testing fen_utils arena variants...\n");
+    Arena arena;
+    assert(arena_init(&arena, 0));
+    const char *pgn = "1. e4 e5 2. Nf3 Nc6 3. Bb5 a6 4. O-O Nf6 5. Re1 b5 1-0";
+
+    for (int round = 0; round < 3; round++) {
+        Move **moves = get_moves_from_pgn_string_arena(pgn, &arena);
+        Move **expected = get_moves_from_pgn_string(pgn);
+        assert(moves != NULL && expected != NULL);
+        int count = get_move_numbers_from_pgn_string(pgn);
+        assert(count == 10);
+        for (int i = 0; i < count; i++) {
+            assert(move_tag(moves[i]) == MOVE_TAG_SAN);
+            assert(moves[i]->bits == expected[i]->bits);
+            free(expected[i]);
+        }
+        free(expected);
+
+        Move *uci = get_move_from_uci_arena("e7e8q", &arena);
+        assert(uci != NULL);
+        char text[MOVE_TEXT_MAX];
+        assert(move_format_uci(uci, text) == 5);
+        assert(strcmp(text, "e7e8q") == 0);
+        assert(get_move_from_uci_arena("e7", &arena) == NULL);
+
+        FEN_Board *board = create_fen_board_arena(START_FEN, &arena);
+        assert(board != NULL);
+        char fen[100];
+        assert(fen_board_to_fen_string(board, fen));
+        assert(strcmp(fen, START_FEN) == 0);
+        assert(create_fen_board_arena("8/8/8 w", &arena) == NULL);
+
+        arena_reset(&arena);
+    }
+    assert(arena.reserved == ARENA_DEFAULT_CHUNK_BYTES);
+    arena_free(&arena);
+    printf("✓ Arena variants match the malloc'd functions\n");
+}
+
+void test_fen_plus_pool() {
+    printf("Testing pooled FEN_Plus...\n");
+    Pool pool;
+    assert(fen_plus_pool_init(&pool));
+
+    FEN_Plus *a = create_fen_plus_pooled(&pool);
+    FEN_Plus *b = create_fen_plus_pooled(&pool);
+    assert(a != NULL && b != NULL && a != b);
+    assert(a->board != NULL && a->move != NULL);
+    assert(a->elo == 0 && a->time_control[0] == '\0');
+
+    FEN_Board *board = create_fen_board(START_FEN);
+    *a->board = *board;
+    free(board);
+    a->elo = 1500;
+    strcpy(a->time_control, "600+0");
+    char fen[100];
+    assert(fen_board_to_fen_string(a->board, fen));
+    assert(strcmp(fen, START_FEN) == 0);
+
+    assert(free_fen_plus_pooled(a, &pool));
+    assert(!free_fen_plus_pooled(NULL, &pool));
+    FEN_Plus *c = create_fen_plus_pooled(&pool);
+    assert(c == a);
+    assert(c->elo == 0 && c->board == a->board);
+    assert(pool.live == 2);
+
+    pool_free(&pool);
+    printf("✓ Pooled FEN_Plus carries its board and move\n");
+}
+
+int main() {
+    printf("=== Arena and Pool Test Suite ===\n\n");
+
+    test_arena_reset_reuses_chunks();
+    test_arena_large_allocations();
+    test_pool_reuse();
+    test_fen_utils_arena_variants();
+    test_fen_plus_pool();
+
+    printf("\n🎉 All tests passed successfully!\n");
+    return 0;
+}
@@ -0,0 +1,265 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zstd.h>
+#include "../include/arrow_ipc.h"
+#include "../include/attacks.h"
+#include "../include/fen_record.h"
+#include "../include/pipeline.h"
+#include "test_util.h"
+
+#define CORPUS_PATH "obj/test_arrow_ipc.pgn"
+#define ARROW_PATH "obj/test_arrow_ipc.arrow"
+#define RECORD_PATH "obj/test_arrow_ipc.bin"
+
+#define COPIES 40
+
+static uint32_t read_u32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static int64_t read_i64(const char *p) {
+    int64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Flatbuffer field of the table at position table, NULL if left at its default
+static const char *flat_field(const char *table, int field) {
+    int32_t vtable_offset;
+    memcpy(&vtable_offset, table, sizeof(vtable_offset));
+    const char *vtable = table - vtable_offset;
+    uint16_t vtable_size, field_offset;
+    memcpy(&vtable_size, vtable, 2);
+    if (4 + 2 * field >= vtable_size) {
+        return NULL;
+    }
+    memcpy(&field_offset, vtable + 4 + 2 * field, 2);
+    return field_offset ? table + field_offset : NULL;
+}
+
+static const char *flat_follow(const char *offset) {
+    return offset + read_u32(offset);
+}
+
+// Header table of the message at p, and its header type and body length
+static const char *message_header(const char *p, int *type_out, int64_t *body_out) {
+    assert(read_u32(p) == 0xFFFFFFFFu);
+    assert((8 + read_u32(p + 4)) % 8 == 0);
+    const char *message = flat_follow(p + 8);
+    *type_out = *(const uint8_t *)flat_field(message, 1);
+    const char *body = flat_field(message, 3);
+    *body_out = body ? read_i64(body) : 0;
+    return flat_follow(flat_field(message, 2));
+}
+
+void test_uci_moves() {
+    printf("Testing the uci_move dictionary...\n");
+    char seen[ARROW_IPC_UCI_MOVES] = {0};
+    int moves = 0;
+    for (int from = 0; from < 64; from++) {
+        for (int to = 0; to < 64; to++) {
+            int id = arrow_ipc_uci_move_id(move_encode(from, to, MOVE_QUIET));
+            if (id < 0) {
+                continue;
+            }
+            assert(id < ARROW_IPC_UCI_MOVES && !seen[id]);
+            seen[id] = 1;
+            moves++;
+            char uci[8];
+            move_to_uci(move_encode(from, to, MOVE_QUIET), uci);
+            assert(strcmp(arrow_ipc_uci_move_name(id), uci) == 0);
+            // Captures share the id of the quiet move
+            assert(arrow_ipc_uci_move_id(move_encode(from, to, MOVE_CAPTURE)) == id);
+        }
+    }
+    assert(moves == 1792);
+    assert(arrow_ipc_uci_move_id(move_encode(0, 10, MOVE_QUIET)) >= 0);   // a1c2
+    assert(arrow_ipc_uci_move_id(move_encode(0, 11, MOVE_QUIET)) == -1);  // a1d2
+
+    int e7 = 52, d8 = 59, a2 = 8, a1 = 0;
+    for (int type = KNIGHT; type <= QUEEN; type++) {
+        int capture = arrow_ipc_uci_move_id(move_encode(e7, d8, MOVE_PROMOTION | MOVE_CAPTURE | (type - KNIGHT)));
+        int push = arrow_ipc_uci_move_id(move_encode(a2, a1, MOVE_PROMOTION | (type - KNIGHT)));
+        assert(capture >= 0 && !seen[capture]);
+        assert(push >= 0 && !seen[push]);
+        seen[capture] = seen[push] = 1;
+    }
+    assert(strcmp(arrow_ipc_uci_move_name(arrow_ipc_uci_move_id(move_encode(e7, d8, MOVE_PROMOTION | 3))),
+                  "e7d8q") == 0);
+    assert(strcmp(arrow_ipc_uci_move_name(arrow_ipc_uci_move_id(move_encode(a2, a1, MOVE_PROMOTION))), "a2a1n") == 0);
+    assert(arrow_ipc_uci_move_name(ARROW_IPC_UCI_MOVES) == NULL);
+    printf("✓ %d distinct moves, names as move_to_uci writes them\n", ARROW_IPC_UCI_MOVES);
+}
+
+static void make_records(FEN_Record *records, size_t count) {
+    Position pos;
+    position_set_start(&pos);
+    for (size_t i = 0; i < count; i++) {
+        ChessMove move = move_encode(12, 28, MOVE_QUIET);   // e2e4
+        fen_record_from_position(&pos, move, (int)(1500 + i), (uint16_t)(i % 3), i / 10, &records[i]);
+        records[i].halfmove_clock = (uint16_t)i;
+    }
+}
+
+void test_record_batch() {
+    printf("Testing record batch messages...\n");
+    enum { ROWS = 37 };
+    FEN_Record records[ROWS];
+    make_records(records, ROWS);
+    Text_Buffer scratch = {0}, message = {0};
+    void *context = NULL;
+
+    // Uncompressed: the body is every column, padded to 8 bytes, in order
+    assert(arrow_ipc_encode_batch(records, ROWS, 0, &context, &scratch, &message));
+    int type;
+    int64_t body_length;
+    const char *batch = message_header(message.data, &type, &body_length);
+    assert(type == 3);
+    assert(read_i64(flat_field(batch, 0)) == ROWS);
+    assert(flat_field(batch, 3) == NULL);   // no compression
+    size_t metadata_length = 8 + read_u32(message.data + 4);
+    assert(metadata_length + (size_t)body_length == message.length);
+    const char *body = message.data + metadata_length;
+    int widths[9] = {32, 1, 1, 2, 2, 2, 2, 4, 4};
+    size_t at = 0;
+    for (int column = 0; column < 9; column++) {
+        for (size_t i = 0; i < ROWS; i++) {
+            const char *value = body + at + i * (size_t)widths[column];
+            switch (column) {
+                case 0: assert(memcmp(value, records[i].board, 32) == 0); break;
+                case 3: assert(*(const uint16_t *)value == records[i].halfmove_clock); break;
+                case 5: assert(*(const uint16_t *)value == records[i].elo); break;
+                case 6: assert(strcmp(arrow_ipc_uci_move_name(*(const int16_t *)value), "e2e4") == 0); break;
+                case 7: assert(*(const int32_t *)value == records[i].time_control); break;
+                case 8: assert(*(const uint32_t *)value == records[i].game); break;
+            }
+        }
+        at += (ROWS * (size_t)widths[column] + 7) & ~(size_t)7;
+    }
+    assert(at == (size_t)body_length);
+
+    // Compressed: each buffer is its uncompressed length and a zstd frame
+    assert(arrow_ipc_encode_batch(records, ROWS, 3, &context, &scratch, &message));
+    batch = message_header(message.data, &type, &body_length);
+    assert(flat_field(batch, 3) != NULL);
+    body = message.data + 8 + read_u32(message.data + 4);
+    assert(read_i64(body) == ROWS * 32);
+    char boards[ROWS * 32];
+    size_t frame = ZSTD_findFrameCompressedSize(body + 8, (size_t)body_length - 8);
+    assert(!ZSTD_isError(frame));
+    assert(ZSTD_decompress(boards, sizeof(boards), body + 8, frame) == sizeof(boards));
+    for (size_t i = 0; i < ROWS; i++) {
+        assert(memcmp(boards + 32 * i, records[i].board, 32) == 0);
+    }
+    fen_record_free_context(context);
+    text_buffer_free(&scratch);
+    text_buffer_free(&message);
+    printf("✓ %d rows: columns in schema order, raw and zstd buffers\n", ROWS);
+}
+
+static void run_pipeline(int format, int level, int threads, const char *path) {
+    Pipeline_Options options;
+    format_options(&options, format, level, threads);
+    Pipeline_Stats stats = run_pipeline_ok(CORPUS_PATH, path, &options);
+    assert(stats.plies == (uint64_t)ARTIFACT_PLIES * COPIES);
+}
+
+void test_pipeline_arrow() {
+    printf("Testing Arrow files from the pipeline...\n");
+    write_artifact_corpus(CORPUS_PATH, COPIES);
+    run_pipeline(PIPELINE_FORMAT_RECORDS, 0, 0, RECORD_PATH);
+    FEN_Record_File *records = fen_record_open(RECORD_PATH);
+    assert(records != NULL);
+    const FEN_Record *expected = fen_record_mapped(records);
+    assert(expected != NULL);
+
+    char *reference = NULL;
+    size_t reference_len = 0;
+    int threads[3] = {0, 1, 3};
+    for (int t = 0; t < 3; t++) {
+        run_pipeline(PIPELINE_FORMAT_ARROW, 0, threads[t], ARROW_PATH);
+        size_t len;
+        char *bytes = read_file(ARROW_PATH, &len);
+        if (t > 0) {
+            assert(len == reference_len && memcmp(bytes, reference, len) == 0);
+            free(bytes);
+            continue;
+        }
+        reference = bytes;
+        reference_len = len;
+    }
+
+    // Magic at both ends, the footer just before the trailing one
+    const char *file = reference;
+    assert(memcmp(file, ARROW_IPC_MAGIC "\0\0", 8) == 0);
+    assert(memcmp(file + reference_len - 6, ARROW_IPC_MAGIC, 6) == 0);
+    uint32_t footer_length = read_u32(file + reference_len - 10);
+    const char *footer = file + reference_len - 10 - footer_length;
+    assert((footer - file) % 8 == 0);
+    assert(read_u32(footer - 8) == 0xFFFFFFFFu && read_u32(footer - 4) == 0);
+    const char *root = flat_follow(footer);
+
+    // Every record batch holds the rows of the record file, in order
+    const char *batches = flat_follow(flat_field(root, 3));
+    uint32_t batch_count = read_u32(batches);
+    assert(batch_count > 1);
+    uint64_t row = 0;
+    for (uint32_t b = 0; b < batch_count; b++) {
+        const char *block = batches + 4 + 24 * b;
+        const char *message = file + read_i64(block);
+        int type;
+        int64_t body_length;
+        const char *batch = message_header(message, &type, &body_length);
+        assert(type == 3);
+        assert((int64_t)read_u32(block + 8) == 8 + (int64_t)read_u32(message + 4));
+        assert(read_i64(block + 16) == body_length);
+        int64_t rows = read_i64(flat_field(batch, 0));
+        const char *body = message + read_u32(block + 8);
+        for (int64_t i = 0; i < rows; i++) {
+            assert(memcmp(body + 32 * i, expected[row + (uint64_t)i].board, 32) == 0);
+        }
+        row += (uint64_t)rows;
+    }
+    assert(row == fen_record_count(records));
+
+    // Two dictionaries: every move, then the time controls
+    const char *dictionaries = flat_follow(flat_field(root, 2));
+    assert(read_u32(dictionaries) == 2);
+    for (int d = 0; d < 2; d++) {
+        int type;
+        int64_t body_length;
+        const char *header = message_header(file + read_i64(dictionaries + 4 + 24 * d), &type, &body_length);
+        assert(type == 2);
+        assert(read_i64(flat_field(header, 0)) == d);
+        int64_t values = read_i64(flat_field(flat_follow(flat_field(header, 1)), 0));
+        assert(d == 0 ? values == ARROW_IPC_UCI_MOVES : values >= 1);
+    }
+    printf("✓ %u record batches, %llu rows as in the record file, identical bytes for 0/1/3 threads\n",
+           batch_count, (unsigned long long)row);
+    free(reference);
+    fen_record_close(records);
+}
+
+int main() {
+    printf("=== Arrow IPC Test Suite ===\n\n");
+    attacks_init();
+
+    test_uci_moves();
+    test_record_batch();
+    test_pipeline_arrow();
+
+    remove(CORPUS_PATH);
+    remove(ARROW_PATH);
+    remove(RECORD_PATH);
+    printf("🎉 All tests passed successfully!\n");
+    return 0;
+}
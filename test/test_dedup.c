@@ -0,0 +1,198 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "../include/attacks.h"
+#include "../include/dedup.h"
+#include "../include/fen_plus.h"
+#include "../include/pipeline.h"
+#include "test_util.h"
+
+#define CORPUS_PATH "obj/test_dedup.pgn"
+#define OUTPUT_PATH "obj/test_dedup.csv"
+
+#define COPIES 40
+#define THREADS 4
+#define KEYS 1000
+#define ROUNDS 50
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+void test_keep_and_sample() {
+    printf("Testing dedup limits...\n");
+    Dedup_Table table;
+    assert(!dedup_table_init(&table, 4, 1, 0));
+    assert(!dedup_table_init(&table, 4096, 0, 0));
+
+    assert(dedup_table_init(&table, 4096, 2, 0));
+    assert(dedup_table_memory(&table) == 4096);
+    uint64_t key = rng_next();
+    assert(dedup_check(&table, key) == DEDUP_KEEP);
+    assert(dedup_check(&table, key) == DEDUP_KEEP);
+    assert(dedup_check(&table, key) == DEDUP_DROP);
+    assert(dedup_check(&table, key) == DEDUP_DROP);
+    assert(dedup_check(&table, key ^ 1) == DEDUP_KEEP);
+    assert(dedup_table_used(&table) == 1 || dedup_table_used(&table) == 2);
+    dedup_table_free(&table);
+
+    // Keep 3, then one in 4: occurrences 7, 11, 15, ...
+    assert(dedup_table_init(&table, 4096, 3, 4));
+    int kept = 0;
+    for (int i = 1; i <= 23; i++) {
+        enum Dedup_Result result = dedup_check(&table, key);
+        bool expected = i <= 3 || (i - 3) % 4 == 0;
+        assert((result == DEDUP_KEEP) == expected);
+        kept += result == DEDUP_KEEP;
+    }
+    assert(kept == 3 + 5);
+    dedup_table_free(&table);
+
+    // Keys with the same low bits compete for the same slots
+    assert(dedup_table_init(&table, 64 * sizeof(uint64_t), 1, 0));
+    int untracked = 0;
+    for (uint64_t i = 1; i <= DEDUP_MAX_PROBES + 5; i++) {
+        untracked += dedup_check(&table, i << 40) == DEDUP_UNTRACKED;
+    }
+    assert(untracked == 5);
+    assert(dedup_table_used(&table) == DEDUP_MAX_PROBES);
+    dedup_table_free(&table);
+    printf("✓ First N kept, then every Kth; full neighbourhoods report untracked\n");
+}
+
+typedef struct {
+    Dedup_Table *table;
+    const uint64_t *keys;
+    int kept;
+} Hammer;
+
+static void *hammer_main(void *arg) {
+    Hammer *h = (Hammer *)arg;
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int i = 0; i < KEYS; i++) {
+            h->kept += dedup_check(h->table, h->keys[i]) == DEDUP_KEEP;
+        }
+    }
+    return NULL;
+}
+
+void test_concurrent_counts() {
+    printf("Testing concurrent dedup...\n");
+    uint64_t keys[KEYS];
+    for (int i = 0; i < KEYS; i++) {
+        keys[i] = rng_next();
+    }
+    Dedup_Table table;
+    assert(dedup_table_init(&table, 1 << 16, 3, 10));
+    pthread_t threads[THREADS];
+    Hammer hammers[THREADS];
+    for (int t = 0; t < THREADS; t++) {
+        hammers[t].table = &table;
+        hammers[t].keys = keys;
+        hammers[t].kept = 0;
+        assert(pthread_create(&threads[t], NULL, hammer_main, &hammers[t]) == 0);
+    }
+    int kept = 0;
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        kept += hammers[t].kept;
+    }
+    // Each key is seen THREADS * ROUNDS = 200 times: 3 kept, then 197 / 10
+    assert(kept == KEYS * (3 + (THREADS * ROUNDS - 3) / 10));
+    assert(dedup_table_used(&table) == KEYS);
+    dedup_table_free(&table);
+    printf("✓ %d threads keep exactly the allowed number of each pair\n", THREADS);
+}
+
+static Pipeline_Stats run_pipeline(int threads, uint32_t max_count, uint32_t keep_every) {
+    Pipeline_Options options;
+    pipeline_default_options(&options);
+    options.threads = threads;
+    options.batch_bytes = 8 * 1024;
+    options.write_header = false;
+    options.dedup_max_count = max_count;
+    options.dedup_keep_every = keep_every;
+    options.dedup_memory = 1 << 20;
+    return run_pipeline_ok(CORPUS_PATH, OUTPUT_PATH, &options);
+}
+
+void test_pipeline_dedup() {
+    printf("Testing dedup in the pipeline...\n");
+    write_artifact_corpus(CORPUS_PATH, COPIES);
+    // Distinct (position, move) pairs of one copy of the corpus
+    Dedup_Table table;
+    assert(dedup_table_init(&table, 1 << 20, 1, 0));
+    FEN_Plus_Stats counted = {0};
+    Text_Buffer rows = {0};
+    for (int i = 0; i < 3; i++) {
+        size_t len;
+        char *text = read_artifact(i, &len);
+        PGN_Game game = {0};
+        game.header = text;
+        game.header_len = (size_t)(strstr(text, "\n\n") - text);
+        game.movetext = text + game.header_len + 2;
+        game.movetext_len = len - game.header_len - 2;
+        assert(fen_plus_append_game(&game, &table, &rows, &counted));
+        free(text);
+    }
+    dedup_table_free(&table);
+    text_buffer_free(&rows);
+    uint64_t distinct = counted.plies;
+    assert(distinct + counted.duplicates == ARTIFACT_PLIES);
+
+    int threads[3] = {0, 1, 3};
+    uint64_t sampled = 0;
+    for (int t = 0; t < 3; t++) {
+        Pipeline_Stats stats = run_pipeline(threads[t], 1, 0);
+        assert(stats.plies == distinct);
+        assert(stats.plies + stats.duplicates == (uint64_t)ARTIFACT_PLIES * COPIES);
+        assert(stats.dedup_pairs == distinct && stats.untracked == 0);
+        assert(stats.dedup_memory == 1 << 20);
+
+        // Down-sampling keeps the same number of each pair whatever the
+        // thread count; a pair seen once per copy keeps occurrences 1, 2, 7, ...
+        stats = run_pipeline(threads[t], 2, 5);
+        assert(stats.plies + stats.duplicates == (uint64_t)ARTIFACT_PLIES * COPIES);
+        assert(stats.plies >= distinct * (2 + (COPIES - 2) / 5));
+        if (t == 0) {
+            sampled = stats.plies;
+        }
+        assert(stats.plies == sampled);
+    }
+    Pipeline_Stats stats = run_pipeline(0, 1, 0);
+    size_t len;
+    char *output = read_file(OUTPUT_PATH, &len);
+    int lines = 0;
+    for (size_t i = 0; i < len; i++) {
+        lines += output[i] == '\n';
+    }
+    assert((uint64_t)lines == stats.plies);
+    free(output);
+    printf("✓ %llu distinct pairs out of %d rows kept for 0/1/3 threads\n",
+           (unsigned long long)distinct, ARTIFACT_PLIES * COPIES);
+}
+
+int main() {
+    printf("=== Dedup Test Suite ===\n\n");
+    attacks_init();
+
+    test_keep_and_sample();
+    test_concurrent_counts();
+    test_pipeline_dedup();
+
+    remove(CORPUS_PATH);
+    remove(OUTPUT_PATH);
+    printf("🎉 All tests passed successfully!\n");
+    return 0;
+}
@@ -200,6 +200,66 @@ void test_fen_conversion() {
     print_fen_board(board);
 }
 
+void test_parse_validation() {
+    printf("Testing FEN validation...\n");
+    struct {
+        const char *fen;
+        enum Fen_Status status;
+    } cases[] = {
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", FEN_OK},
+        {"4k3/8/8/8/8/8/8/4K3  b   -  -  99 120 \r\n", FEN_OK},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0", FEN_SYNTAX_ERROR},
+        {"4k3/8/8/8/8/8/8/4K3 w - - 0 1 extra", FEN_SYNTAX_ERROR},
+        {"4k3/8/8/8/8/8/8 w - - 0 1", FEN_BAD_BOARD},
+        {"4k3/8/8/8/8/8/8/4K3/8 w - - 0 1", FEN_BAD_BOARD},
+        {"4k4/8/8/8/8/8/8/4K3 w - - 0 1", FEN_BAD_BOARD},
+        {"4k2/8/8/8/8/8/8/4K3 w - - 0 1", FEN_BAD_BOARD},
+        {"44/4k3/8/8/8/8/8/4K3 w - - 0 1", FEN_BAD_BOARD},
+        {"4k3/8/8/8/8/8/8/4X3 w - - 0 1", FEN_BAD_BOARD},
+        {"8/8/8/8/8/8/8/4K3 w - - 0 1", FEN_BAD_PIECES},
+        {"4k3/8/8/8/8/8/8/3KK3 w - - 0 1", FEN_BAD_PIECES},
+        {"4k2P/8/8/8/8/8/8/4K3 w - - 0 1", FEN_BAD_PIECES},
+        {"4k3/8/8/8/8/8/PPPPPPPP/QQQQK3 w - - 0 1", FEN_BAD_PIECES},
+        {"4k3/8/8/8/8/8/8/4K3 x - - 0 1", FEN_BAD_SIDE},
+        {"4k3/8/8/8/8/8/8/4K3 wb - - 0 1", FEN_BAD_SIDE},
+        {"r3k2r/8/8/8/8/8/8/R3K2R w QK - 0 1", FEN_BAD_CASTLING},
+        {"r3k2r/8/8/8/8/8/8/R3K2R w KKq - 0 1", FEN_BAD_CASTLING},
+        {"r3k2r/8/8/8/8/8/8/R3K1R1 w K - 0 1", FEN_BAD_CASTLING},
+        {"r3k2r/8/8/8/8/8/8/R4K1R w Q - 0 1", FEN_BAD_CASTLING},
+        {"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e", FEN_BAD_EN_PASSANT},
+        {"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e 0 1", FEN_BAD_EN_PASSANT},
+        {"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e6 0 1", FEN_BAD_EN_PASSANT},
+        {"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq d3 0 1", FEN_BAD_EN_PASSANT},
+        {"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", FEN_OK},
+        {"4k3/8/8/8/8/8/8/4K3 w - - -1 1", FEN_BAD_CLOCK},
+        {"4k3/8/8/8/8/8/8/4K3 w - - 0 0", FEN_BAD_CLOCK},
+        {"4k3/8/8/8/8/8/8/4K3 w - - 0 99999999999", FEN_BAD_CLOCK},
+        {"4k3/8/8/8/8/8/8/4K3 w - - 0x 1", FEN_BAD_CLOCK},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        FEN_Board board;
+        enum Fen_Status status = fen_board_parse(cases[i].fen, strlen(cases[i].fen), &board);
+        if (status != cases[i].status) {
+            printf("  %s: %s, expected %s\n", cases[i].fen, fen_status_string(status),
+                   fen_status_string(cases[i].status));
+        }
+        assert(status == cases[i].status);
+        FEN_Board *created = create_fen_board((char *)cases[i].fen);
+        assert((created != NULL) == (status == FEN_OK));
+        free(created);
+    }
+    printf("✓ %zu well-formed and malformed FENs classified\n", sizeof(cases) / sizeof(cases[0]));
+
+    // Only length bytes are read: the FEN may sit inside a larger buffer
+    const char *line = "4k3/8/8/8/8/8/8/4K3 b - - 3 20|trailing bytes";
+    FEN_Board board;
+    assert(fen_board_parse(line, strchr(line, '|') - line, &board) == FEN_OK);
+    assert(board.side_to_move == 1 && board.halfmove_clock == 3 && board.fullmove_number == 20);
+    assert(board.move_number == 20 && board.en_passant_square_file == -1);
+    assert(fen_board_parse(line, strlen(line), &board) == FEN_BAD_CLOCK);
+    printf("✓ Parses a slice of a larger buffer\n");
+}
+
 int main() {
     printf("=== FEN Board Structure Test Suite ===\n\n");
     
@@ -207,6 +267,7 @@ int main() {
     test_en_passant_position();
     test_castling_rights();
     test_fen_conversion();
+    test_parse_validation();
     
     printf("🎉 All tests passed successfully!\n");
     return 0;
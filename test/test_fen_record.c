@@ -0,0 +1,262 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../include/attacks.h"
+#include "../include/fen_plus.h"
+#include "../include/fen_record.h"
+#include "../include/pipeline.h"
+#include "test_util.h"
+
+#define CORPUS_PATH "obj/test_fen_record.pgn"
+#define CSV_PATH "obj/test_fen_record.csv"
+#define RECORD_PATH "obj/test_fen_record.bin"
+
+#define COPIES 60
+
+static const char *TIME_CONTROLS[4] = {"60+0", "180+2", "600+0", "15+0"};
+
+void test_record_layout() {
+    printf("Testing record layout...\n");
+    assert(sizeof(FEN_Record) == 48);
+    assert(offsetof(FEN_Record, flags) == 32);
+    assert(offsetof(FEN_Record, en_passant) == 33);
+    assert(offsetof(FEN_Record, halfmove_clock) == 34);
+    assert(offsetof(FEN_Record, fullmove_number) == 36);
+    assert(offsetof(FEN_Record, move) == 38);
+    assert(offsetof(FEN_Record, elo) == 40);
+    assert(offsetof(FEN_Record, time_control) == 42);
+    assert(offsetof(FEN_Record, game) == 44);
+    assert(sizeof(FEN_Record_File_Header) == FEN_RECORD_DATA_OFFSET);
+    assert(sizeof(FEN_Record_Block_Entry) == 16);
+    assert(sizeof(FEN_Record_Trailer) == 40);
+    printf("✓ 48-byte records, no padding\n");
+}
+
+void test_position_round_trip() {
+    printf("Testing Position <-> record round trip...\n");
+    const char *fens[3] = {
+        "rnbqkbnr/pppp1p2/7p/4pPp1/4P3/8/PPPP2PP/RNBQKBNR w KQkq g6 0 4",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b Kq - 7 31",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 99 120",
+    };
+    for (int i = 0; i < 3; i++) {
+        Position pos;
+        assert(position_from_fen(fens[i], &pos));
+        FEN_Record record;
+        fen_record_from_position(&pos, move_encode(1, 18, MOVE_QUIET), 2100, 7, 0x100000005ULL, &record);
+        assert(record.move == move_encode(1, 18, MOVE_QUIET));
+        assert(record.elo == 2100 && record.time_control == 7 && record.game == 5);
+
+        Position back;
+        assert(fen_record_to_position(&record, &back));
+        char fen[FEN_MAX_LENGTH + 1];
+        assert(position_to_fen(&back, fen));
+        assert(strcmp(fen, fens[i]) == 0);
+        assert(memcmp(back.occupancy, pos.occupancy, sizeof(pos.occupancy)) == 0);
+    }
+    // a1 is the low nibble of the first byte, b1 the high one
+    Position start;
+    position_set_start(&start);
+    FEN_Record record;
+    fen_record_from_position(&start, NULL_MOVE, 0, 0, 0, &record);
+    assert(record.board[0] == ((WHITE_KNIGHT + 1) << 4 | (WHITE_ROOK + 1)));
+    assert(record.board[31] == ((BLACK_ROOK + 1) << 4 | (BLACK_KNIGHT + 1)));
+    assert(record.flags == (0xF << 4) && record.en_passant == NO_SQUARE);
+
+    record.board[10] = 0xD0;
+    Position back;
+    assert(!fen_record_to_position(&record, &back));
+    printf("✓ Board, flags and clocks survive the round trip\n");
+}
+
+void test_time_control_table() {
+    printf("Testing time-control table...\n");
+    FEN_Record_Time_Controls table;
+    memset(&table, 0, sizeof(table));
+    assert(fen_record_time_control_id(&table, "180+0", 5) == 0);
+    assert(fen_record_time_control_id(&table, "600+0", 5) == 1);
+    assert(fen_record_time_control_id(&table, "180+0", 5) == 0);
+    assert(fen_record_time_control_id(&table, "180+", 4) == 2);
+
+    // Enough names to grow the hash table several times
+    for (int i = 0; i < 5000; i++) {
+        char name[16];
+        int length = snprintf(name, sizeof(name), "%d+%d", i, i % 7);
+        uint16_t id = fen_record_time_control_id(&table, name, (size_t)length);
+        assert(fen_record_time_control_id(&table, name, (size_t)length) == id);
+        size_t name_len;
+        const char *stored = fen_record_time_control_name(&table, id, &name_len);
+        assert(name_len == (size_t)length && memcmp(stored, name, name_len) == 0);
+    }
+    assert(table.count == 5000 + 3);
+    size_t length;
+    assert(fen_record_time_control_name(&table, 1, &length) != NULL && length == 5);
+    assert(fen_record_time_control_name(&table, 6000, &length) == NULL);
+    fen_record_time_controls_free(&table);
+    printf("✓ Ids in first-seen order and stable across lookups\n");
+}
+
+// Artifact games with the time control rotated per copy, plus one game
+// without a TimeControl tag
+static void write_corpus(void) {
+    FILE *out = fopen(CORPUS_PATH, "wb");
+    assert(out != NULL);
+    for (int c = 0; c < COPIES; c++) {
+        for (int i = 0; i < 3; i++) {
+            size_t len;
+            char *game = read_artifact(i, &len);
+            char *tag = strstr(game, "[TimeControl \"");
+            assert(tag != NULL);
+            char *tag_end = strchr(tag, '\n') + 1;
+            fwrite(game, 1, (size_t)(tag - game), out);
+            if (c != 7) {
+                fprintf(out, "[TimeControl \"%s\"]\n", TIME_CONTROLS[(c + i) % 4]);
+            }
+            fwrite(tag_end, 1, len - (size_t)(tag_end - game), out);
+            fputs("\n\n", out);
+            free(game);
+        }
+    }
+    fclose(out);
+}
+
+static void run_pipeline(int format, int level, int threads, const char *path) {
+    Pipeline_Options options;
+    format_options(&options, format, level, threads);
+    Pipeline_Stats stats = run_pipeline_ok(CORPUS_PATH, path, &options);
+    assert(stats.plies == (uint64_t)ARTIFACT_PLIES * COPIES);
+}
+
+// Formats records back into CSV rows through the file's time-control table
+static void append_rows(const FEN_Record_File *file, const FEN_Record *records, size_t count,
+                        Text_Buffer *out) {
+    for (size_t i = 0; i < count; i++) {
+        Position pos;
+        assert(fen_record_to_position(&records[i], &pos));
+        size_t tc_len;
+        const char *tc = fen_record_file_time_control(file, records[i].time_control, &tc_len);
+        assert(tc != NULL);
+        assert(text_buffer_reserve(out, FEN_PLUS_MAX_ROW));
+        out->length += fen_plus_write_row(out->data + out->length, tc, tc_len, &pos, records[i].elo,
+                                          records[i].move);
+    }
+}
+
+void test_pipeline_records() {
+    printf("Testing record files against CSV output...\n");
+    write_corpus();
+    run_pipeline(PIPELINE_FORMAT_CSV, 0, 0, CSV_PATH);
+    size_t csv_len;
+    char *csv = read_file(CSV_PATH, &csv_len);
+    size_t header_len = strlen(FEN_PLUS_CSV_HEADER);
+
+    char *reference = NULL;
+    size_t reference_len = 0;
+    int levels[2] = {0, 3};
+    int threads[3] = {0, 1, 3};
+    for (int l = 0; l < 2; l++) {
+        for (int t = 0; t < 3; t++) {
+            run_pipeline(PIPELINE_FORMAT_RECORDS, levels[l], threads[t], RECORD_PATH);
+            size_t len;
+            char *bytes = read_file(RECORD_PATH, &len);
+            if (t == 0) {
+                free(reference);
+                reference = bytes;
+                reference_len = len;
+            } else {
+                assert(len == reference_len && memcmp(bytes, reference, len) == 0);
+                free(bytes);
+            }
+        }
+
+        FEN_Record_File *file = fen_record_open(RECORD_PATH);
+        assert(file != NULL);
+        assert(fen_record_count(file) == (uint64_t)ARTIFACT_PLIES * COPIES);
+        assert(fen_record_block_count(file) > 1);
+        assert((fen_record_mapped(file) != NULL) == (levels[l] == 0));
+
+        Text_Buffer rows = {0};
+        FEN_Record *block = NULL;
+        uint32_t last_game = 0;
+        for (size_t b = 0; b < fen_record_block_count(file); b++) {
+            size_t count = fen_record_block_records(file, b);
+            block = realloc(block, count * sizeof(FEN_Record));
+            assert(block != NULL);
+            assert(fen_record_read_block(file, b, block) == count);
+            assert(block[0].game >= last_game);
+            last_game = block[count - 1].game;
+            append_rows(file, block, count, &rows);
+        }
+        assert(last_game == 3 * COPIES - 1);
+        assert(rows.length == csv_len - header_len);
+        assert(memcmp(rows.data, csv + header_len, rows.length) == 0);
+        if (levels[l] == 0) {
+            Text_Buffer mapped_rows = {0};
+            append_rows(file, fen_record_mapped(file), (size_t)fen_record_count(file), &mapped_rows);
+            assert(mapped_rows.length == rows.length);
+            assert(memcmp(mapped_rows.data, rows.data, rows.length) == 0);
+            text_buffer_free(&mapped_rows);
+        }
+        size_t tc_len;
+        const char *tc = fen_record_file_time_control(file, 0, &tc_len);
+        assert(tc != NULL && tc_len == 4 && memcmp(tc, "60+0", 4) == 0);
+        assert(fen_record_file_time_control(file, 5, &tc_len) == NULL);
+        free(block);
+        text_buffer_free(&rows);
+        fen_record_close(file);
+        printf("✓ Level %d: %d records, same rows as the CSV, identical bytes for 0/1/3 threads (%zu bytes)\n",
+               levels[l], ARTIFACT_PLIES * COPIES, reference_len);
+    }
+    free(reference);
+    free(csv);
+}
+
+void test_corrupt_files() {
+    printf("Testing corrupt record files...\n");
+    assert(fen_record_open("obj/does_not_exist.bin") == NULL);
+    run_pipeline(PIPELINE_FORMAT_RECORDS, 3, 0, RECORD_PATH);
+    size_t len;
+    char *bytes = read_file(RECORD_PATH, &len);
+
+    // Truncated, bad trailer magic, block index pointing past the data
+    FILE *f = fopen(RECORD_PATH, "wb");
+    fwrite(bytes, 1, len - 1, f);
+    fclose(f);
+    assert(fen_record_open(RECORD_PATH) == NULL);
+
+    FEN_Record_Trailer trailer;
+    memcpy(&trailer, bytes + len - sizeof(trailer), sizeof(trailer));
+    FEN_Record_Block_Entry entry;
+    memcpy(&entry, bytes + trailer.index_offset, sizeof(entry));
+    entry.stored_size += 1000000;
+    memcpy(bytes + trailer.index_offset, &entry, sizeof(entry));
+    f = fopen(RECORD_PATH, "wb");
+    fwrite(bytes, 1, len, f);
+    fclose(f);
+    assert(fen_record_open(RECORD_PATH) == NULL);
+    free(bytes);
+    printf("✓ Rejected by fen_record_open\n");
+}
+
+int main() {
+    printf("=== FEN Record Test Suite ===\n\n");
+    attacks_init();
+
+    test_record_layout();
+    test_position_round_trip();
+    test_time_control_table();
+    test_pipeline_records();
+    test_corrupt_files();
+
+    remove(CORPUS_PATH);
+    remove(CSV_PATH);
+    remove(RECORD_PATH);
+    printf("🎉 All tests passed successfully!\n");
+    return 0;
+}
@@ -0,0 +1,202 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../include/game_filter.h"
+#include "../include/pipeline.h"
+#include "test_util.h"
+
+#define CORPUS_PATH "obj/test_game_filter.pgn"
+#define OUTPUT_PATH "obj/test_game_filter.csv"
+#define COPIES 20
+
+static bool header_passes(const Game_Filter *filter, const char *header) {
+    PGN_Header_Tags tags;
+    pgn_scan_headers(header, strlen(header), &tags);
+    return game_filter_matches(filter, &tags);
+}
+
+void test_enum_strings() {
+    printf("Testing termination and result strings...\n");
+    enum Termination termination;
+    assert(get_termination_from_string("Time forfeit", 12, &termination) && termination == TIME_FORFEIT);
+    assert(get_termination_from_string("Rules infraction", 16, &termination) && termination == RULES_INFRACTION);
+    assert(!get_termination_from_string("Normal ", 7, &termination));
+    assert(!get_termination_from_string("normal", 6, &termination));
+    for (int t = NORMAL; t <= UNTERMINATED; t++) {
+        const char *name = get_termination_string((enum Termination)t);
+        assert(get_termination_from_string(name, strlen(name), &termination) && (int)termination == t);
+    }
+    enum GameResult result;
+    assert(get_game_result_from_string("1/2-1/2", 7, &result) && result == DRAW);
+    assert(get_game_result_from_string("*", 1, &result) && result == ONGOING);
+    assert(!get_game_result_from_string("1-", 2, &result));
+    printf("✓ Every enum value round-trips through its tag string\n");
+}
+
+void test_filter_options() {
+    printf("Testing filter options...\n");
+    Game_Filter filter;
+    game_filter_init(&filter);
+    assert(!game_filter_active(&filter));
+    assert(game_filter_add_time_controls(&filter, "rapid,Classical,600+5,-"));
+    assert(filter.speeds == (1u << SPEED_RAPID | 1u << SPEED_CLASSICAL));
+    assert(filter.time_control_count == 2);
+    assert(strcmp(filter.time_controls[0], "600+5") == 0 && strcmp(filter.time_controls[1], "-") == 0);
+    assert(game_filter_active(&filter));
+    assert(!game_filter_add_time_controls(&filter, "rapid,fast"));
+    assert(!game_filter_add_time_controls(&filter, "rapid,"));
+
+    game_filter_init(&filter);
+    assert(game_filter_add_terminations(&filter, "normal,time-forfeit,RULES_INFRACTION"));
+    assert(filter.terminations == (1u << NORMAL | 1u << TIME_FORFEIT | 1u << RULES_INFRACTION));
+    assert(!game_filter_add_terminations(&filter, "resigned"));
+    assert(game_filter_add_results(&filter, "1-0,1/2-1/2"));
+    assert(filter.results == (1u << WHITE_WINS | 1u << DRAW));
+    assert(!game_filter_add_results(&filter, "white"));
+    printf("✓ Comma-separated lists parse; unknown items are rejected\n");
+}
+
+static int speed_of(const char *value) {
+    PGN_Tag tag = {value, strlen(value)};
+    return game_filter_time_control_speed(&tag);
+}
+
+void test_speed_boundaries() {
+    printf("Testing speed categories...\n");
+    // Each category starts at 30, 180, 480 and 1500 estimated seconds
+    assert(speed_of("29+0") == SPEED_ULTRABULLET && speed_of("30+0") == SPEED_BULLET);
+    assert(speed_of("179+0") == SPEED_BULLET && speed_of("180+0") == SPEED_BLITZ);
+    assert(speed_of("479+0") == SPEED_BLITZ && speed_of("480+0") == SPEED_RAPID);
+    assert(speed_of("1499+0") == SPEED_RAPID && speed_of("1500+0") == SPEED_CLASSICAL);
+    // 140 + 40 * 1 = 180: the increment counts 40 times
+    assert(speed_of("139+1") == SPEED_BULLET && speed_of("140+1") == SPEED_BLITZ);
+    assert(speed_of("0+1") == SPEED_BULLET && speed_of("-") == SPEED_CORRESPONDENCE);
+    assert(speed_of("600") == -1 && speed_of("10+x") == -1);
+    printf("✓ Estimated durations on both sides of every boundary\n");
+}
+
+void test_filter_matches() {
+    printf("Testing filter decisions...\n");
+    const char *rapid = "[Event \"Rated Rapid game\"]\n[Result \"1-0\"]\n[WhiteElo \"1850\"]\n"
+                        "[BlackElo \"2100\"]\n[TimeControl \"600+0\"]\n[Termination \"Normal\"]";
+    const char *bullet = "[Result \"0-1\"]\n[WhiteElo \"1900\"]\n[BlackElo \"1950\"]\n"
+                         "[TimeControl \"60+1\"]\n[Termination \"Time forfeit\"]";
+    const char *unrated = "[Result \"*\"]\n[WhiteElo \"?\"]\n[BlackElo \"1900\"]\n[TimeControl \"-\"]";
+
+    Game_Filter filter;
+    game_filter_init(&filter);
+    assert(header_passes(&filter, rapid) && header_passes(&filter, bullet) && header_passes(&filter, unrated));
+
+    filter.min_elo = 1800;
+    filter.max_elo = 2200;
+    assert(header_passes(&filter, rapid) && header_passes(&filter, bullet));
+    assert(!header_passes(&filter, unrated));
+    filter.max_elo = 2000;
+    assert(!header_passes(&filter, rapid) && header_passes(&filter, bullet));
+
+    game_filter_init(&filter);
+    assert(game_filter_add_time_controls(&filter, "rapid"));
+    assert(header_passes(&filter, rapid) && !header_passes(&filter, bullet) && !header_passes(&filter, unrated));
+    // 60 + 40 * 1 = 100 s estimated: bullet
+    assert(game_filter_add_time_controls(&filter, "bullet,correspondence"));
+    assert(header_passes(&filter, bullet) && header_passes(&filter, unrated));
+    game_filter_init(&filter);
+    assert(game_filter_add_time_controls(&filter, "60+1"));
+    assert(header_passes(&filter, bullet) && !header_passes(&filter, rapid));
+
+    game_filter_init(&filter);
+    assert(game_filter_add_terminations(&filter, "normal"));
+    assert(header_passes(&filter, rapid) && !header_passes(&filter, bullet) && !header_passes(&filter, unrated));
+    game_filter_init(&filter);
+    assert(game_filter_add_results(&filter, "0-1,*"));
+    assert(!header_passes(&filter, rapid) && header_passes(&filter, bullet) && header_passes(&filter, unrated));
+    printf("✓ Elo range, speed, exact time control, termination and result\n");
+}
+
+static Pipeline_Stats run_pipeline(int threads, const Game_Filter *filter, char **output, size_t *len) {
+    Pipeline_Options options;
+    pipeline_default_options(&options);
+    options.threads = threads;
+    options.batch_bytes = 4 * 1024;
+    options.write_header = false;
+    options.filter = *filter;
+    Pipeline_Stats stats = run_pipeline_ok(CORPUS_PATH, OUTPUT_PATH, &options);
+    *output = read_file(OUTPUT_PATH, len);
+    return stats;
+}
+
+void test_pipeline_filter() {
+    printf("Testing the filter in the pipeline...\n");
+    // Blitz 1294/1262, rapid 1583/1565 and rapid 1574/1579, all "Normal"
+    FILE *out = fopen(CORPUS_PATH, "wb");
+    assert(out != NULL);
+    size_t game_bytes[3];
+    for (int c = 0; c < COPIES; c++) {
+        for (int i = 0; i < 3; i++) {
+            char *game = read_artifact(i, &game_bytes[i]);
+            fwrite(game, 1, game_bytes[i], out);
+            fputs("\n\n", out);
+            free(game);
+        }
+    }
+    fclose(out);
+
+    Game_Filter filter;
+    game_filter_init(&filter);
+    assert(game_filter_add_time_controls(&filter, "rapid"));
+    assert(game_filter_add_terminations(&filter, "normal"));
+    filter.min_elo = 1570;
+
+    char *single = NULL;
+    size_t single_len = 0;
+    int threads[2] = {0, 3};
+    for (int t = 0; t < 2; t++) {
+        char *csv;
+        size_t len;
+        Pipeline_Stats stats = run_pipeline(threads[t], &filter, &csv, &len);
+        assert(stats.games == COPIES && stats.plies == 37 * COPIES);
+        assert(stats.filtered_games == 2 * COPIES);
+        // Header plus movetext of the skipped games; the separators are not counted
+        assert(stats.filtered_bytes <= (game_bytes[0] + game_bytes[1]) * COPIES);
+        assert(stats.filtered_bytes + 4 * COPIES >= (game_bytes[0] + game_bytes[1]) * COPIES);
+        for (const char *line = csv; line < csv + len; line = strchr(line, '\n') + 1) {
+            assert(strncmp(line, "600+0,", 6) == 0);
+        }
+        if (single == NULL) {
+            single = csv;
+            single_len = len;
+        } else {
+            assert(len == single_len && memcmp(csv, single, len) == 0);
+            free(csv);
+        }
+    }
+    free(single);
+
+    filter.max_elo = 1500;
+    char *csv;
+    size_t len;
+    Pipeline_Stats stats = run_pipeline(2, &filter, &csv, &len);
+    assert(stats.games == 0 && stats.filtered_games == 3 * COPIES && len == 0);
+    free(csv);
+    printf("✓ Only matching games are converted, same output for 0 and 3 threads\n");
+}
+
+int main() {
+    printf("=== Game Filter Test Suite ===\n\n");
+
+    test_enum_strings();
+    test_filter_options();
+    test_speed_boundaries();
+    test_filter_matches();
+    test_pipeline_filter();
+
+    remove(CORPUS_PATH);
+    remove(OUTPUT_PATH);
+    printf("🎉 All tests passed successfully!\n");
+    return 0;
+}
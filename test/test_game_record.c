@@ -0,0 +1,222 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../include/attacks.h"
+#include "../include/fen_record.h"
+#include "../include/game_record.h"
+#include "../include/pipeline.h"
+#include "test_util.h"
+
+#define CORPUS_PATH "obj/test_game_record.pgn"
+#define GAME_PATH "obj/test_game_record.fengame"
+#define RECORD_PATH "obj/test_game_record.bin"
+
+#define COPIES 40
+// Three plies from a position after 1. e4 c5, plus one that does not resolve
+#define FEN_GAME_PLIES 3
+#define GAMES (3 * COPIES + 1)
+#define PLIES (ARTIFACT_PLIES * COPIES + FEN_GAME_PLIES)
+
+static const char *FEN_GAME =
+    "[Event \"FEN start\"]\n"
+    "[WhiteElo \"2100\"]\n"
+    "[BlackElo \"2050\"]\n"
+    "[TimeControl \"300+3\"]\n"
+    "[SetUp \"1\"]\n"
+    "[FEN \"rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq c6 0 2\"]\n"
+    "\n"
+    "2. Nf3 d6 3. d4 *\n\n";
+
+static const char *BAD_GAME =
+    "[Event \"Bad move\"]\n"
+    "\n"
+    "1. e4 e5 2. Ke3 *\n\n";
+
+// Artifact games, one that starts from a FEN tag and one that is rejected
+static void write_corpus(void) {
+    FILE *out = fopen(CORPUS_PATH, "wb");
+    assert(out != NULL);
+    for (int c = 0; c < COPIES; c++) {
+        append_artifacts(out);
+        if (c == COPIES / 2) {
+            fputs(FEN_GAME, out);
+            fputs(BAD_GAME, out);
+        }
+    }
+    fclose(out);
+}
+
+static void run_pipeline(int format, int level, int threads, const char *path) {
+    Pipeline_Options options;
+    format_options(&options, format, level, threads);
+    Pipeline_Stats stats = run_pipeline_ok(CORPUS_PATH, path, &options);
+    assert(stats.games == GAMES && stats.rejected == 1);
+    assert(stats.plies == PLIES);
+}
+
+void test_layout() {
+    printf("Testing game record layout...\n");
+    assert(sizeof(Game_Record) == 16);
+    assert(sizeof(Game_Record_File_Header) == 32);
+    assert(sizeof(Game_Record_Block_Entry) == 24);
+    assert(sizeof(Game_Record_Trailer) == 48);
+    printf("✓ 16-byte game records, 2 bytes per ply\n");
+}
+
+void test_pipeline_games() {
+    printf("Testing game files against record files...\n");
+    write_corpus();
+    run_pipeline(PIPELINE_FORMAT_RECORDS, 0, 0, RECORD_PATH);
+    FEN_Record_File *records = fen_record_open(RECORD_PATH);
+    assert(records != NULL);
+    const FEN_Record *expected = fen_record_mapped(records);
+    size_t record_bytes = 0;
+    free(read_file(RECORD_PATH, &record_bytes));
+
+    int levels[2] = {0, 3};
+    int threads[3] = {0, 1, 3};
+    for (int l = 0; l < 2; l++) {
+        char *reference = NULL;
+        size_t reference_len = 0;
+        for (int t = 0; t < 3; t++) {
+            run_pipeline(PIPELINE_FORMAT_GAMES, levels[l], threads[t], GAME_PATH);
+            size_t len;
+            char *bytes = read_file(GAME_PATH, &len);
+            if (t == 0) {
+                reference = bytes;
+                reference_len = len;
+            } else {
+                assert(len == reference_len && memcmp(bytes, reference, len) == 0);
+                free(bytes);
+            }
+        }
+        free(reference);
+
+        // Every ply of every game, replayed in order, is the record-file row
+        Game_Record_File *file = game_record_open(GAME_PATH);
+        assert(file != NULL);
+        assert(game_record_count(file) == GAMES);
+        assert(game_record_plies(file) == PLIES);
+        uint64_t row = 0;
+        uint64_t first_row[GAMES + 1];
+        int custom_starts = 0;
+        for (uint64_t g = 0; g < game_record_count(file); g++) {
+            Game_Record_Cursor cursor;
+            first_row[g] = row;
+            assert(game_record_seek(file, g, 0, &cursor));
+            custom_starts += (cursor.info.flags & GAME_RECORD_CUSTOM_START) != 0;
+            FEN_Record record;
+            while (game_record_next(&cursor, &record)) {
+                assert(memcmp(&record, &expected[row], sizeof(record)) == 0);
+                row++;
+            }
+            assert(!cursor.corrupt);
+        }
+        assert(row == PLIES);
+        assert(custom_starts == 1);
+        first_row[GAMES] = row;
+
+        // Random access, backwards so that compressed blocks are reloaded
+        for (uint64_t g = GAMES; g-- > 0;) {
+            uint32_t plies = (uint32_t)(first_row[g + 1] - first_row[g]);
+            uint32_t ply = (uint32_t)(g * 7919 % plies);
+            Game_Record_Cursor cursor;
+            FEN_Record record;
+            assert(game_record_seek(file, g, ply, &cursor));
+            assert(game_record_next(&cursor, &record));
+            assert(memcmp(&record, &expected[first_row[g] + ply], sizeof(record)) == 0);
+            assert(!game_record_seek(file, g, plies + 1, &cursor));
+        }
+        Game_Record_Cursor cursor;
+        assert(!game_record_seek(file, GAMES, 0, &cursor));
+        size_t tc_len;
+        const char *tc = game_record_file_time_control(file, 0, &tc_len);
+        assert(tc != NULL && tc_len == 5 && memcmp(tc, "180+0", 5) == 0);
+        game_record_close(file);
+        size_t len;
+        free(read_file(GAME_PATH, &len));
+        printf("✓ Level %d: %d games, %d plies as in the record file, identical bytes for 0/1/3 threads "
+               "(%zu bytes, %.1fx smaller than records)\n",
+               levels[l], GAMES, PLIES, len, (double)record_bytes / len);
+    }
+    fen_record_close(records);
+}
+
+void test_errors() {
+    printf("Testing corrupt game files and unsupported options...\n");
+    assert(game_record_open("obj/does_not_exist.fengame") == NULL);
+    run_pipeline(PIPELINE_FORMAT_GAMES, 3, 0, GAME_PATH);
+    size_t len;
+    char *bytes = read_file(GAME_PATH, &len);
+
+    FILE *f = fopen(GAME_PATH, "wb");
+    fwrite(bytes, 1, len - 1, f);
+    fclose(f);
+    assert(game_record_open(GAME_PATH) == NULL);
+
+    // A game offset pointing past its block
+    Game_Record_Trailer trailer;
+    memcpy(&trailer, bytes + len - sizeof(trailer), sizeof(trailer));
+    uint32_t *offsets = (uint32_t *)(bytes + trailer.index_offset + trailer.blocks * sizeof(Game_Record_Block_Entry));
+    offsets[1] = 1u << 30;
+    f = fopen(GAME_PATH, "wb");
+    fwrite(bytes, 1, len, f);
+    fclose(f);
+    assert(game_record_open(GAME_PATH) == NULL);
+    free(bytes);
+
+    // A stored move that starts from an empty square: the file opens, but
+    // replay stops at that move
+    run_pipeline(PIPELINE_FORMAT_GAMES, 0, 0, GAME_PATH);
+    bytes = read_file(GAME_PATH, &len);
+    Game_Record first;
+    memcpy(&first, bytes + sizeof(Game_Record_File_Header), sizeof(first));
+    assert(!(first.flags & GAME_RECORD_CUSTOM_START) && first.plies > 5);
+    ChessMove bad = move_encode(SQUARE(4, 4), SQUARE(4, 5), MOVE_QUIET);
+    memcpy(bytes + sizeof(Game_Record_File_Header) + sizeof(Game_Record) + 2 * sizeof(ChessMove), &bad,
+           sizeof(bad));
+    f = fopen(GAME_PATH, "wb");
+    fwrite(bytes, 1, len, f);
+    fclose(f);
+    free(bytes);
+    Game_Record_File *file = game_record_open(GAME_PATH);
+    assert(file != NULL);
+    Game_Record_Cursor cursor;
+    FEN_Record record;
+    assert(game_record_seek(file, 0, 0, &cursor));
+    assert(game_record_next(&cursor, &record) && game_record_next(&cursor, &record));
+    assert(!game_record_next(&cursor, &record) && cursor.corrupt && cursor.ply == 2);
+    assert(!game_record_seek(file, 0, 5, &cursor) && cursor.corrupt);
+    assert(game_record_seek(file, 1, 0, &cursor) && !cursor.corrupt);
+    game_record_close(file);
+
+    Pipeline_Options options;
+    pipeline_default_options(&options);
+    options.format = PIPELINE_FORMAT_GAMES;
+    options.dedup_max_count = 1;
+    Pipeline_Stats stats;
+    assert(!pipeline_run(CORPUS_PATH, STDOUT_FILENO, &options, &stats));
+    assert(strstr(stats.error, "dedup") != NULL);
+    printf("✓ Rejected by game_record_open or on replay; dedup refused for game output\n");
+}
+
+int main() {
+    printf("=== Game Record Test Suite ===\n\n");
+    attacks_init();
+
+    test_layout();
+    test_pipeline_games();
+    test_errors();
+
+    remove(CORPUS_PATH);
+    remove(GAME_PATH);
+    remove(RECORD_PATH);
+    printf("🎉 All tests passed successfully!\n");
+    return 0;
+}
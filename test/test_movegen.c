@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include "../include/attacks.h"
+#include "../include/movegen.h"
+#include "../include/pgn_stream.h"
+#include "../include/pgn_tokenizer.h"
+#include "../include/position.h"
+#include "../include/san.h"
+
+#define ARTIFACT_DIR "src_python/test/test_artifacts/"
+
+// The standard perft positions, with counts small enough for a debug build.
+// bench/bench_perft.c runs the same positions deeper.
+static const struct {
+    const char *fen;
+    int depth;
+    uint64_t nodes;
+} PERFT_CASES[] = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 4, 197281},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3, 97862},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 4, 43238},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 3, 9467},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 3, 62379},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 3, 89890},
+};
+
+void test_perft_positions() {
+    printf("Testing perft on the standard positions...\n");
+    for (size_t i = 0; i < sizeof(PERFT_CASES) / sizeof(PERFT_CASES[0]); i++) {
+        Position pos;
+        assert(position_from_fen(PERFT_CASES[i].fen, &pos));
+        for (int depth = 1; depth <= PERFT_CASES[i].depth; depth++) {
+            uint64_t nodes = perft(&pos, depth);
+            if (depth == PERFT_CASES[i].depth && nodes != PERFT_CASES[i].nodes) {
+                printf("position %zu depth %d: %llu nodes, expected %llu\n", i + 1, depth,
+                       (unsigned long long)nodes, (unsigned long long)PERFT_CASES[i].nodes);
+                assert(false);
+            }
+        }
+    }
+    printf("✓ Node counts match the published values\n");
+}
+
+static int count_moves(const char *fen) {
+    Position pos;
+    assert(position_from_fen(fen, &pos));
+    Move_List list;
+    return generate_legal_moves(&pos, &list);
+}
+
+void test_special_positions() {
+    printf("Testing mate, stalemate, checks and pins...\n");
+    // Fool's mate and a stalemate have no moves
+    assert(count_moves("rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3") == 0);
+    assert(count_moves("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1") == 0);
+    // Knight check: no castling and nothing can block, so king moves only
+    assert(count_moves("4k3/8/8/8/8/5n2/8/R3K2R w KQ - 0 1") == 4);
+    // En passant that would expose the king along the rank is illegal
+    assert(count_moves("8/8/8/K1pP3r/8/8/8/7k w - c6 0 1") == 5);
+
+    Position pos;
+    assert(position_from_fen("4k3/4r3/8/8/8/8/4B3/4K3 w - - 0 1", &pos));
+    // The pinned bishop cannot leave the file
+    assert(!position_is_legal_move(&pos, move_encode(SQUARE(4, 1), SQUARE(3, 2), MOVE_QUIET)));
+    assert(position_is_legal_move(&pos, move_encode(SQUARE(4, 0), SQUARE(3, 0), MOVE_QUIET)));
+    printf("✓ Special positions generate the right moves\n");
+}
+
+// Every move of every position in the artifact games is generated, and
+// every generated move formats to SAN that resolves back to the same move
+void test_artifact_games() {
+    printf("Testing artifact games against the SAN resolver...\n");
+    const char *names[3] = {"game_1.pgn", "game_2.pgn", "game_3.pgn"};
+    int plies = 0;
+    for (int i = 0; i < 3; i++) {
+        char path[256];
+        snprintf(path, sizeof(path), ARTIFACT_DIR "%s", names[i]);
+        PGN_Stream *stream = pgn_stream_open(path);
+        assert(stream != NULL);
+        PGN_Game game;
+        while (pgn_stream_next_game(stream, &game)) {
+            Position pos;
+            position_set_start(&pos);
+            PGN_Tokenizer tokenizer;
+            pgn_tokenizer_init(&tokenizer, game.movetext, game.movetext_len);
+            const char *token;
+            size_t token_len;
+            while (pgn_tokenizer_next(&tokenizer, &token, &token_len)) {
+                ChessMove played;
+                assert(san_to_move(&pos, token, token_len, &played) == SAN_OK);
+                assert(position_is_legal_move(&pos, played));
+
+                Move_List list;
+                generate_legal_moves(&pos, &list);
+                for (int m = 0; m < list.count; m++) {
+                    char san[16];
+                    size_t san_len = san_from_move(&pos, list.moves[m], san);
+                    ChessMove resolved;
+                    assert(san_to_move(&pos, san, san_len, &resolved) == SAN_OK);
+                    assert(resolved == list.moves[m]);
+                }
+                position_make_move(&pos, played);
+                plies++;
+            }
+        }
+        pgn_stream_close(stream);
+    }
+    assert(plies == 61 + 108 + 37);
+    printf("✓ %d played moves are legal and all generated moves resolve\n", plies);
+}
+
+// position_is_legal_move takes exactly the generated moves: tried with all
+// 65536 encodings in each perft position and the positions one move later
+static int check_every_encoding(const Position *pos) {
+    Move_List list;
+    generate_legal_moves(pos, &list);
+    static bool legal[65536];
+    memset(legal, 0, sizeof(legal));
+    for (int m = 0; m < list.count; m++) {
+        legal[list.moves[m]] = true;
+    }
+    for (int move = 0; move < 65536; move++) {
+        if (position_is_legal_move(pos, (ChessMove)move) != legal[move]) {
+            char fen[128];
+            fen[position_write_fen(pos, fen)] = '\0';
+            printf("%s: move 0x%04x %s\n", fen, move, legal[move] ? "rejected" : "accepted");
+            assert(false);
+        }
+    }
+    return list.count;
+}
+
+void test_legal_move_check() {
+    printf("Testing the single-move legality check...\n");
+    const char *extra[] = {"8/8/8/K1pP3r/8/8/8/7k w - c6 0 1", "4k3/8/8/8/8/5n2/8/R3K2R w KQ - 0 1",
+                           "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1", "r3k2r/8/8/8/8/8/8/R3K1R1 b Qkq - 0 1",
+                           "4k3/1P6/8/8/8/8/6p1/4K2R b K - 0 1"};
+    size_t cases = sizeof(PERFT_CASES) / sizeof(PERFT_CASES[0]);
+    size_t total = cases + sizeof(extra) / sizeof(extra[0]);
+    int positions = 0;
+    for (size_t i = 0; i < total; i++) {
+        Position pos;
+        assert(position_from_fen(i < cases ? PERFT_CASES[i].fen : extra[i - cases], &pos));
+        check_every_encoding(&pos);
+        positions++;
+        Move_List list;
+        generate_legal_moves(&pos, &list);
+        for (int m = 0; m < list.count; m++) {
+            Position child = pos;
+            position_make_move(&child, list.moves[m]);
+            check_every_encoding(&child);
+            positions++;
+        }
+    }
+    printf("✓ Same answer as the generator for every encoding in %d positions\n", positions);
+}
+
+int main() {
+    printf("=== Move Generator Test Suite ===\n\n");
+    attacks_init();
+
+    test_perft_positions();
+    test_special_positions();
+    test_artifact_games();
+    test_legal_move_check();
+
+    printf("\n🎉 All tests passed successfully!\n");
+    return 0;
+}
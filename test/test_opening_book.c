@@ -0,0 +1,331 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/attacks.h"
+#include "../include/corpus_gen.h"
+#include "../include/game_filter.h"
+#include "../include/opening_book.h"
+#include "../include/pgn_stream.h"
+#include "../include/pgn_tokenizer.h"
+#include "../include/pipeline.h"
+#include "../include/san.h"
+#include "test_util.h"
+
+#define CORPUS_PATH "obj/test_opening_book.pgn"
+#define BOOK_PATH "obj/test_opening_book.book"
+
+#define COPIES 20
+#define GENERATED 400
+// Artifact copies, generated games, one game from a FEN tag and one rejected
+#define GAMES (3 * COPIES + GENERATED + 1)
+#define MIN_COUNT 3
+
+static const char *FEN_GAME =
+    "[Event \"FEN start\"]\n"
+    "[WhiteElo \"2100\"]\n"
+    "[BlackElo \"2050\"]\n"
+    "[TimeControl \"300+3\"]\n"
+    "[SetUp \"1\"]\n"
+    "[FEN \"rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq c6 0 2\"]\n"
+    "\n"
+    "2. Nf3 d6 3. d4 *\n\n";
+
+static const char *BAD_GAME =
+    "[Event \"Bad move\"]\n"
+    "\n"
+    "1. e4 e5 2. Ke3 *\n\n";
+
+// Counted the slow way: every ply of every game, sorted and summed
+static Opening_Book_Entry *expected;
+static size_t expected_count;
+static size_t expected_positions;
+static uint64_t expected_plies;
+
+static void write_corpus(void) {
+    FILE *out = fopen(CORPUS_PATH, "wb");
+    assert(out != NULL);
+    Corpus_Generator generator;
+    corpus_generator_init(&generator, 7, 0);
+    Text_Buffer game;
+    memset(&game, 0, sizeof(game));
+    for (int c = 0; c < COPIES; c++) {
+        append_artifacts(out);
+        for (int g = 0; g < GENERATED / COPIES; g++) {
+            game.length = 0;
+            assert(corpus_generate_game(&generator, &game));
+            fwrite(game.data, 1, game.length, out);
+        }
+        if (c == COPIES / 2) {
+            fputs(FEN_GAME, out);
+            fputs(BAD_GAME, out);
+        }
+    }
+    text_buffer_free(&game);
+    fclose(out);
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const Opening_Book_Entry *x = (const Opening_Book_Entry *)a;
+    const Opening_Book_Entry *y = (const Opening_Book_Entry *)b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    if (x->move != y->move) return x->move < y->move ? -1 : 1;
+    if (x->elo_band != y->elo_band) return x->elo_band < y->elo_band ? -1 : 1;
+    return (x->speed > y->speed) - (x->speed < y->speed);
+}
+
+static void count_corpus(uint32_t band_width) {
+    size_t capacity = 1 << 16;
+    expected = malloc(capacity * sizeof(Opening_Book_Entry));
+    expected_count = 0;
+    PGN_Stream *stream = pgn_stream_open(CORPUS_PATH);
+    assert(stream != NULL);
+    PGN_Game game;
+    while (pgn_stream_next_game(stream, &game)) {
+        FEN_Plus_Game info;
+        Position pos;
+        assert(fen_plus_start_game(&game, &info, &pos));
+        PGN_Tag time_control = {info.time_control, info.time_control_len};
+        int speed = game_filter_time_control_speed(&time_control);
+        size_t start = expected_count;
+        PGN_Tokenizer tokenizer;
+        pgn_tokenizer_init(&tokenizer, game.movetext, game.movetext_len);
+        const char *token;
+        size_t token_len;
+        bool ok = true;
+        while (ok && pgn_tokenizer_next(&tokenizer, &token, &token_len)) {
+            ChessMove move;
+            if (san_to_move(&pos, token, token_len, &move) != SAN_OK) {
+                ok = false;
+                break;
+            }
+            if (expected_count == capacity) {
+                capacity *= 2;
+                expected = realloc(expected, capacity * sizeof(Opening_Book_Entry));
+            }
+            Opening_Book_Entry *entry = &expected[expected_count++];
+            entry->key = pos.key;
+            entry->move = move;
+            entry->elo_band = (uint8_t)opening_book_elo_band(band_width, info.elo[pos.side_to_move]);
+            entry->speed = speed >= 0 ? (uint8_t)speed : OPENING_BOOK_UNKNOWN;
+            entry->count = 1;
+            position_make_move(&pos, move);
+        }
+        if (!ok) {
+            expected_count = start;
+        }
+    }
+    pgn_stream_close(stream);
+    expected_plies = expected_count;
+    qsort(expected, expected_count, sizeof(Opening_Book_Entry), compare_entries);
+    size_t kept = 0;
+    expected_positions = 0;
+    for (size_t i = 0; i < expected_count; i++) {
+        if (kept > 0 && compare_entries(&expected[kept - 1], &expected[i]) == 0) {
+            expected[kept - 1].count++;
+            continue;
+        }
+        expected_positions += kept == 0 || expected[kept - 1].key != expected[i].key;
+        expected[kept++] = expected[i];
+    }
+    expected_count = kept;
+}
+
+static bool run_pipeline(int threads, size_t memory, uint32_t min_count, const char *temp_dir,
+                         Pipeline_Stats *stats) {
+    Pipeline_Options options;
+    format_options(&options, PIPELINE_FORMAT_BOOK, 0, threads);
+    options.book.memory = memory;
+    options.book.min_count = min_count;
+    options.book.temp_dir = temp_dir;
+    return run_pipeline_to(CORPUS_PATH, BOOK_PATH, &options, stats);
+}
+
+void test_layout() {
+    printf("Testing book layout...\n");
+    assert(sizeof(Opening_Book_Entry) == 16);
+    assert(sizeof(Opening_Book_Position) == 16);
+    assert(sizeof(Opening_Book_Move) == 8);
+    assert(sizeof(Opening_Book_File_Header) == 32);
+    assert(sizeof(Opening_Book_Trailer) == 64);
+    assert(opening_book_elo_band(200, 0) == OPENING_BOOK_UNKNOWN);
+    assert(opening_book_elo_band(200, 1999) == 9);
+    assert(opening_book_elo_band(1, 3000) == OPENING_BOOK_UNKNOWN - 1);
+    printf("✓ 16-byte positions and entries, 8-byte moves; bands clamp below the unknown band\n");
+}
+
+void test_counts() {
+    printf("Testing book counts against a brute-force count...\n");
+    write_corpus();
+    count_corpus(OPENING_BOOK_DEFAULT_ELO_BAND);
+
+    // One big map per worker, then maps so small that every worker spills often
+    int threads[4] = {0, 1, 3, 3};
+    size_t memory[4] = {64 << 20, 64 << 20, 64 << 20, 1};
+    char *reference = NULL;
+    size_t reference_len = 0;
+    uint64_t most_runs = 0;
+    for (int t = 0; t < 4; t++) {
+        Pipeline_Stats stats;
+        bool ok = run_pipeline(threads[t], memory[t], 1, "obj", &stats);
+        if (!ok) {
+            printf("pipeline failed: %s\n", stats.error);
+        }
+        assert(ok);
+        assert(stats.games == GAMES && stats.rejected == 1);
+        assert(stats.plies == expected_plies);
+        assert(stats.book.positions == expected_positions && stats.book.moves == expected_count);
+        size_t len;
+        char *bytes = read_file(BOOK_PATH, &len);
+        if (t == 0) {
+            reference = bytes;
+            reference_len = len;
+        } else {
+            assert(len == reference_len && memcmp(bytes, reference, len) == 0);
+            free(bytes);
+        }
+        most_runs = stats.book.runs > most_runs ? stats.book.runs : most_runs;
+    }
+    free(reference);
+    assert(most_runs > 10);
+
+    Opening_Book *book = opening_book_open(BOOK_PATH);
+    assert(book != NULL);
+    const Opening_Book_Trailer *trailer = opening_book_trailer(book);
+    assert(opening_book_header(book)->elo_band == OPENING_BOOK_DEFAULT_ELO_BAND);
+    assert(trailer->positions == expected_positions && trailer->moves == expected_count);
+    assert(trailer->total_count == expected_plies);
+    const Opening_Book_Move *moves;
+    for (size_t i = 0; i < expected_count;) {
+        size_t count = opening_book_lookup(book, expected[i].key, &moves);
+        assert(count > 0);
+        for (size_t m = 0; m < count; m++, i++) {
+            assert(expected[i].key == expected[i - m].key);
+            assert(moves[m].move == expected[i].move && moves[m].elo_band == expected[i].elo_band);
+            assert(moves[m].speed == expected[i].speed && moves[m].count == expected[i].count);
+        }
+        assert(i == expected_count || expected[i].key != expected[i - 1].key);
+        // A key next to a stored one is almost surely not a position of the corpus
+        assert(opening_book_lookup(book, expected[i - 1].key ^ 1, &moves) == 0 && moves == NULL);
+    }
+    assert(opening_book_lookup(book, 0, &moves) == 0);
+    assert(opening_book_lookup(book, UINT64_MAX, &moves) == 0);
+
+    // Starting position: every game but the FEN one and the rejected one
+    Position start;
+    position_set_start(&start);
+    size_t count = opening_book_lookup(book, start.key, &moves);
+    uint64_t games = 0;
+    for (size_t m = 0; m < count; m++) {
+        games += moves[m].count;
+    }
+    assert(games == GAMES - 1);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    size_t found = 0;
+    for (int round = 0; round < 20; round++) {
+        for (size_t i = 0; i < expected_count; i++) {
+            found += opening_book_lookup(book, expected[i].key, &moves) > 0;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    assert(found == 20 * expected_count);
+    double ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / found;
+    opening_book_close(book);
+    printf("✓ %zu positions, %zu moves as counted by hand, identical bytes for 0/1/3 threads and "
+           "%llu spilled runs; %.0f ns per lookup\n",
+           expected_positions, expected_count, (unsigned long long)most_runs, ns);
+}
+
+void test_min_count() {
+    printf("Testing pruning of rare positions...\n");
+    Pipeline_Stats stats;
+    assert(run_pipeline(2, 1, MIN_COUNT, NULL, &stats));
+    Opening_Book *book = opening_book_open(BOOK_PATH);
+    assert(book != NULL);
+    assert(opening_book_header(book)->min_count == MIN_COUNT);
+    uint64_t kept = 0;
+    uint64_t pruned = 0;
+    for (size_t i = 0; i < expected_count;) {
+        size_t end = i;
+        uint32_t total = 0;
+        for (; end < expected_count && expected[end].key == expected[i].key; end++) {
+            total += expected[end].count;
+        }
+        const Opening_Book_Move *moves;
+        size_t count = opening_book_lookup(book, expected[i].key, &moves);
+        if (total >= MIN_COUNT) {
+            assert(count == end - i);
+            kept++;
+        } else {
+            assert(count == 0);
+            pruned++;
+        }
+        i = end;
+    }
+    assert(stats.book.positions == kept && stats.book.pruned == pruned);
+    assert(opening_book_trailer(book)->positions == kept);
+    opening_book_close(book);
+    printf("✓ %llu positions played at least %d times kept, %llu pruned\n", (unsigned long long)kept,
+           MIN_COUNT, (unsigned long long)pruned);
+}
+
+void test_errors() {
+    printf("Testing corrupt books and unusable options...\n");
+    assert(opening_book_open("obj/does_not_exist.book") == NULL);
+    Pipeline_Stats stats;
+    assert(run_pipeline(0, 64 << 20, 1, NULL, &stats));
+    size_t len;
+    char *bytes = read_file(BOOK_PATH, &len);
+    FILE *f = fopen(BOOK_PATH, "wb");
+    fwrite(bytes, 1, len - 8, f);
+    fclose(f);
+    assert(opening_book_open(BOOK_PATH) == NULL);
+    // A trailer claiming one position more than the file holds
+    Opening_Book_Trailer *trailer = (Opening_Book_Trailer *)(bytes + len - sizeof(Opening_Book_Trailer));
+    trailer->positions++;
+    f = fopen(BOOK_PATH, "wb");
+    fwrite(bytes, 1, len, f);
+    fclose(f);
+    assert(opening_book_open(BOOK_PATH) == NULL);
+    free(bytes);
+
+    // Runs need somewhere to go
+    assert(!run_pipeline(2, 1, 1, "obj/does_not_exist", &stats));
+    assert(strstr(stats.error, "obj/does_not_exist") != NULL);
+
+    Pipeline_Options options;
+    pipeline_default_options(&options);
+    options.format = PIPELINE_FORMAT_BOOK;
+    options.book.elo_band = 0;
+    assert(!pipeline_run(CORPUS_PATH, STDOUT_FILENO, &options, &stats));
+    assert(strstr(stats.error, "Elo band") != NULL);
+    options.book.elo_band = OPENING_BOOK_DEFAULT_ELO_BAND;
+    options.dedup_max_count = 1;
+    assert(!pipeline_run(CORPUS_PATH, STDOUT_FILENO, &options, &stats));
+    assert(strstr(stats.error, "dedup") != NULL);
+    printf("✓ Rejected by opening_book_open; missing temp dir, zero band width and dedup reported\n");
+}
+
+int main() {
+    printf("=== Opening Book Test Suite ===\n\n");
+    attacks_init();
+
+    test_layout();
+    test_counts();
+    test_min_count();
+    test_errors();
+
+    free(expected);
+    remove(CORPUS_PATH);
+    remove(BOOK_PATH);
+    printf("🎉 All tests passed successfully!\n");
+    return 0;
+}
@@ -0,0 +1,253 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zstd.h>
+#include "../include/fen_plus.h"
+#include "../include/pgn_index.h"
+#include "../include/pgn_stream.h"
+#include "../include/pipeline.h"
+#include "test_util.h"
+
+#define FRAMED_PATH "obj/test_pgn_index.pgn.zst"
+#define SEEKABLE_PATH "obj/test_pgn_index_seekable.pgn.zst"
+#define TRUNCATED_PATH "obj/test_pgn_index_truncated.pgn.zst"
+#define OUTPUT_PATH "obj/test_pgn_index.csv"
+#define COPIES 200
+
+// The artifact games COPIES times, with junk in front of the first game
+static char *build_corpus(size_t *len_out) {
+    Text_Buffer corpus = {0};
+    assert(text_buffer_append(&corpus, "\xEF\xBB\xBF\n", 4));
+    for (int c = 0; c < COPIES; c++) {
+        for (int i = 0; i < 3; i++) {
+            size_t len;
+            char *game = read_artifact(i, &len);
+            assert(text_buffer_append(&corpus, game, len));
+            assert(text_buffer_append(&corpus, "\n\n", 2));
+            free(game);
+        }
+    }
+    *len_out = corpus.length;
+    return corpus.data;
+}
+
+// Compresses text as independent frames cut at the given offsets
+static size_t write_frames(const char *path, const char *text, size_t len, const size_t *cuts, size_t cut_count) {
+    Text_Buffer out = {0};
+    size_t start = 0;
+    for (size_t i = 0; i <= cut_count; i++) {
+        size_t end = i < cut_count ? cuts[i] : len;
+        assert(text_buffer_reserve(&out, ZSTD_compressBound(end - start)));
+        size_t r = ZSTD_compress(out.data + out.length, out.capacity - out.length, text + start, end - start, 3);
+        assert(!ZSTD_isError(r));
+        out.length += r;
+        start = end;
+    }
+    write_file(path, out.data, out.length);
+    text_buffer_free(&out);
+    return cut_count + 1;
+}
+
+// Every game of a stream as header '\0' movetext '\0', in order
+static size_t collect_games(PGN_Stream *stream, Text_Buffer *out) {
+    assert(stream != NULL);
+    PGN_Game game;
+    size_t count = 0;
+    out->length = 0;
+    while (pgn_stream_next_game(stream, &game)) {
+        assert(game.index == count);
+        assert(text_buffer_append(out, game.header, game.header_len));
+        assert(text_buffer_append(out, "", 1));
+        assert(text_buffer_append(out, game.movetext, game.movetext_len));
+        assert(text_buffer_append(out, "", 1));
+        count++;
+    }
+    assert(pgn_stream_error(stream) == NULL);
+    pgn_stream_close(stream);
+    return count;
+}
+
+void test_parallel_matches_sequential() {
+    printf("Testing parallel decoding against the sequential reader...\n");
+    size_t len;
+    char *corpus = build_corpus(&len);
+
+    // Frame cuts around game boundaries: right before the newline, between
+    // the newline and "[Event", inside "[Event", and at odd offsets
+    size_t cuts[4 * COPIES * 3];
+    size_t cut_count = 0;
+    int kind = 0;
+    for (const char *p = corpus; (p = strstr(p + 1, "\n[Event")) != NULL; kind++) {
+        size_t at = (size_t)(p - corpus);
+        size_t cut = kind % 4 == 0 ? at : kind % 4 == 1 ? at + 1 : kind % 4 == 2 ? at + 4 : at + 517;
+        if (cut < len && (cut_count == 0 || cut > cuts[cut_count - 1])) {
+            cuts[cut_count++] = cut;
+        }
+    }
+    size_t frames = write_frames(FRAMED_PATH, corpus, len, cuts, cut_count);
+
+    PGN_Index index;
+    assert(pgn_index_build(FRAMED_PATH, &index));
+    assert(index.count == frames);
+    assert(index.frames[0].offset == 0 && index.frames[1].offset == index.frames[0].compressed_size);
+
+    Text_Buffer expected = {0};
+    Text_Buffer actual = {0};
+    size_t games = collect_games(pgn_stream_open(FRAMED_PATH), &expected);
+    assert(games == 3 * COPIES);
+
+    size_t segment_bytes[3] = {1, 700, 1u << 20};
+    int threads[3] = {1, 2, 4};
+    for (int s = 0; s < 3; s++) {
+        for (int t = 0; t < 3; t++) {
+            PGN_Stream *stream = pgn_stream_open_parallel(FRAMED_PATH, &index, threads[t], segment_bytes[s]);
+            assert(collect_games(stream, &actual) == games);
+            assert(actual.length == expected.length && memcmp(actual.data, expected.data, actual.length) == 0);
+        }
+    }
+    printf("✓ %zu games across %zu frames, identical for 1/2/4 threads and any segment size\n", games, frames);
+
+    // Sidecar round trip; an index of another file is refused
+    char sidecar[256];
+    pgn_index_sidecar_path(FRAMED_PATH, sidecar, sizeof(sidecar));
+    assert(pgn_index_save(&index, sidecar));
+    PGN_Index loaded;
+    assert(pgn_index_load(FRAMED_PATH, &loaded));
+    assert(loaded.count == index.count && loaded.file_size == index.file_size);
+    assert(memcmp(loaded.frames, index.frames, index.count * sizeof(PGN_Index_Frame)) == 0);
+    pgn_index_free(&loaded);
+    write_frames(FRAMED_PATH, corpus, len, cuts, cut_count / 2);
+    assert(!pgn_index_load(FRAMED_PATH, &loaded));
+    assert(pgn_stream_open_parallel(FRAMED_PATH, &index, 2, 1) == NULL);
+    remove(sidecar);
+    printf("✓ Sidecar index loads back and goes stale when the file changes\n");
+
+    pgn_index_free(&index);
+    text_buffer_free(&expected);
+    text_buffer_free(&actual);
+    free(corpus);
+}
+
+void test_reencode_seekable() {
+    printf("Testing re-encoding to the seekable format...\n");
+    uint64_t games = 0;
+    assert(pgn_index_reencode(FRAMED_PATH, SEEKABLE_PATH, 16 * 1024, 3, &games));
+    assert(games == 3 * COPIES);
+
+    // No sidecar: the frames come from the seek table
+    PGN_Index index;
+    assert(pgn_index_load(SEEKABLE_PATH, &index));
+    assert(index.count > 10);
+    size_t len;
+    char *data = read_file(SEEKABLE_PATH, &len);
+    for (size_t i = 0; i < index.count; i++) {
+        // Every frame starts with a game and knows its size
+        char head[6];
+        assert(ZSTD_getFrameContentSize(data + index.frames[i].offset, index.frames[i].compressed_size) ==
+               index.frames[i].decompressed_size);
+        ZSTD_DCtx *dctx = ZSTD_createDCtx();
+        ZSTD_outBuffer out = {head, sizeof(head), 0};
+        ZSTD_inBuffer in = {data + index.frames[i].offset, index.frames[i].compressed_size, 0};
+        ZSTD_decompressStream(dctx, &out, &in);
+        ZSTD_freeDCtx(dctx);
+        assert(out.pos == 6 && (i == 0 || memcmp(head, "[Event", 6) == 0));
+    }
+    free(data);
+
+    // Frame walking skips the seek table
+    PGN_Index built;
+    assert(pgn_index_build(SEEKABLE_PATH, &built));
+    assert(built.count == index.count);
+    assert(memcmp(built.frames, index.frames, index.count * sizeof(PGN_Index_Frame)) == 0);
+    pgn_index_free(&built);
+
+    Text_Buffer expected = {0};
+    Text_Buffer actual = {0};
+    assert(collect_games(pgn_stream_open(FRAMED_PATH), &expected) == games);
+    assert(collect_games(pgn_stream_open(SEEKABLE_PATH), &actual) == games);
+    assert(actual.length == expected.length && memcmp(actual.data, expected.data, actual.length) == 0);
+    assert(collect_games(pgn_stream_open_parallel(SEEKABLE_PATH, &index, 3, 1), &actual) == games);
+    assert(actual.length == expected.length && memcmp(actual.data, expected.data, actual.length) == 0);
+    text_buffer_free(&expected);
+    text_buffer_free(&actual);
+    pgn_index_free(&index);
+    printf("✓ %llu games in game-aligned frames, same games sequentially and in parallel\n",
+           (unsigned long long)games);
+}
+
+static char *run_pipeline(int decode_threads, Pipeline_Stats *stats, size_t *len) {
+    Pipeline_Options options;
+    pipeline_default_options(&options);
+    options.threads = 2;
+    options.decode_threads = decode_threads;
+    int fd = open(OUTPUT_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(fd >= 0);
+    assert(pipeline_run(SEEKABLE_PATH, fd, &options, stats));
+    close(fd);
+    return read_file(OUTPUT_PATH, len);
+}
+
+void test_pipeline_decode_threads() {
+    printf("Testing the pipeline with decoder threads...\n");
+    Pipeline_Stats sequential, parallel;
+    size_t sequential_len, parallel_len;
+    char *expected = run_pipeline(0, &sequential, &sequential_len);
+    char *actual = run_pipeline(3, &parallel, &parallel_len);
+    assert(sequential.decode_threads == 0 && parallel.decode_threads == 3);
+    assert(sequential.games == 3 * COPIES && parallel.games == sequential.games);
+    assert(parallel.bytes_decoded == sequential.bytes_decoded);
+    assert(parallel_len == sequential_len && memcmp(expected, actual, parallel_len) == 0);
+    free(expected);
+    free(actual);
+    printf("✓ Same CSV with 3 decoder threads (%zu bytes)\n", parallel_len);
+}
+
+void test_bad_input() {
+    printf("Testing inputs without a usable index...\n");
+    PGN_Index index;
+    assert(!pgn_index_build(ARTIFACT_DIR "game_1.pgn", &index));
+    assert(!pgn_index_load(ARTIFACT_DIR "game_1.pgn", &index));
+
+    // Cut the file in the middle of its last frame
+    assert(pgn_index_load(SEEKABLE_PATH, &index));
+    size_t len;
+    char *data = read_file(SEEKABLE_PATH, &len);
+    PGN_Index_Frame *last = &index.frames[index.count - 1];
+    size_t cut = (size_t)(last->offset + last->compressed_size / 2);
+    write_file(TRUNCATED_PATH, data, cut);
+    free(data);
+    PGN_Index built;
+    assert(!pgn_index_build(TRUNCATED_PATH, &built));
+    last->compressed_size = cut - last->offset;
+    index.file_size = cut;
+    PGN_Stream *stream = pgn_stream_open_parallel(TRUNCATED_PATH, &index, 2, 1);
+    assert(stream != NULL);
+    PGN_Game game;
+    while (pgn_stream_next_game(stream, &game)) {
+    }
+    assert(pgn_stream_error(stream) != NULL);
+    pgn_stream_close(stream);
+    pgn_index_free(&index);
+    printf("✓ Plain PGN has no index; a truncated frame is reported\n");
+}
+
+int main() {
+    printf("=== PGN Index Test Suite ===\n\n");
+
+    test_parallel_matches_sequential();
+    test_reencode_seekable();
+    test_pipeline_decode_threads();
+    test_bad_input();
+
+    remove(FRAMED_PATH);
+    remove(SEEKABLE_PATH);
+    remove(TRUNCATED_PATH);
+    remove(OUTPUT_PATH);
+    printf("🎉 All tests passed successfully!\n");
+    return 0;
+}
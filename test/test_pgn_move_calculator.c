@@ -11,6 +11,14 @@ void free_moves(Move **moves, int count) {
     free(moves);
 }
 
+// Stands in for the move_data.san.notation field the packed Move no longer
+// has: the SAN text the move writes back as, valid until the next call
+const char *san_notation(const Move *move) {
+    static char notation[MOVE_TEXT_MAX];
+    move_format_san(move, notation);
+    return notation;
+}
+
 void test_no_moves(){
     printf("Testing no moves...\n");
     const char *pgn = "1.";
@@ -28,7 +36,7 @@ void test_one_move(){
     assert(move_count == 1);
     Move **moves = get_moves_from_pgn_string(pgn);
     assert(moves != NULL);
-    assert(strcmp(moves[0]->move_data.san.notation, "e4") == 0);
+    assert(strcmp(san_notation(moves[0]), "e4") == 0);
     printf("move count: %d Test passed\n", move_count);
     free_moves(moves, move_count);
 }
@@ -40,8 +48,8 @@ void test_two_moves(){
     assert(move_count == 2);
     Move **moves = get_moves_from_pgn_string(pgn);
     assert(moves != NULL);
-    assert(strcmp(moves[0]->move_data.san.notation, "e4") == 0);
-    assert(strcmp(moves[1]->move_data.san.notation, "e5") == 0);
+    assert(strcmp(san_notation(moves[0]), "e4") == 0);
+    assert(strcmp(san_notation(moves[1]), "e5") == 0);
     printf("move count: %d Test passed\n", move_count);
     free_moves(moves, move_count);
 }
@@ -54,7 +62,20 @@ void test_custom_pgn() {
     printf("move count: %d Test passed\n", move_count);
     Move **moves = get_moves_from_pgn_string(pgn);
     assert(moves != NULL);
-    assert(strcmp(moves[16]->move_data.san.notation, "h3") == 0);
+    assert(strcmp(san_notation(moves[16]), "h3") == 0);
+    free_moves(moves, move_count);
+}
+
+void test_lichess_pgn() {
+    printf("Testing Lichess movetext with comments and result...\n");
+    const char *pgn = "1. e4 { [%eval 0.17] [%clk 0:03:00] } 1... e5 { [%clk 0:02:59] } 2. Nf3 $1 (2. f4 exf4) 2... Nc6 1-0";
+    int move_count = get_move_numbers_from_pgn_string(pgn);
+    assert(move_count == 4);
+    Move **moves = get_moves_from_pgn_string(pgn);
+    assert(moves != NULL);
+    assert(strcmp(san_notation(moves[1]), "e5") == 0);
+    assert(strcmp(san_notation(moves[3]), "Nc6") == 0);
+    printf("move count: %d Test passed\n", move_count);
     free_moves(moves, move_count);
 }
 
@@ -65,6 +86,7 @@ int main() {
     test_one_move();
     test_two_moves();
     test_custom_pgn();
+    test_lichess_pgn();
     
     printf("🎉 All tests passed successfully!\n");
     return 0;
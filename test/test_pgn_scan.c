@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include "../include/pgn_scan.h"
+#include "../include/pgn_stream.h"
+#include "test_util.h"
+
+#define CORPUS_PATH "obj/test_pgn_scan.pgn"
+
+static const PGN_Scan_Impl IMPLS[3] = {PGN_SCAN_SCALAR, PGN_SCAN_SSE2, PGN_SCAN_AVX2};
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// Random text dense in structural characters
+static void fill_random(char *data, size_t len) {
+    const char alphabet[] = "\n[]\"{}e4 Nf3[Event";
+    for (size_t i = 0; i < len; i++) {
+        data[i] = alphabet[rng_next() % (sizeof(alphabet) - 1)];
+    }
+}
+
+static void expect_tag(const PGN_Tag *tag, const char *expected) {
+    if (expected == NULL) {
+        assert(tag->value == NULL);
+        return;
+    }
+    assert(tag->value != NULL);
+    assert(tag->length == strlen(expected) && memcmp(tag->value, expected, tag->length) == 0);
+}
+
+void test_masks_agree() {
+    printf("Testing SIMD masks against the scalar scanner...\n");
+    char block[64];
+    int checked = 0;
+    for (int round = 0; round < 2000; round++) {
+        fill_random(block, sizeof(block));
+        PGN_Scan_Masks reference;
+        assert(pgn_scan_select(PGN_SCAN_SCALAR));
+        pgn_scan_block(block, &reference);
+        for (int i = 0; i < 64; i++) {
+            assert(((reference.newline >> i) & 1) == (block[i] == '\n'));
+            assert(((reference.quote >> i) & 1) == (block[i] == '"'));
+            assert(((reference.close_brace >> i) & 1) == (block[i] == '}'));
+        }
+        for (int impl = 1; impl < 3; impl++) {
+            if (!pgn_scan_select(IMPLS[impl])) {
+                continue;
+            }
+            PGN_Scan_Masks masks;
+            pgn_scan_block(block, &masks);
+            assert(memcmp(&masks, &reference, sizeof(masks)) == 0);
+            checked++;
+        }
+    }
+    pgn_scan_select(PGN_SCAN_AUTO);
+    printf("✓ %d blocks identical across implementations (auto: %s)\n", checked, pgn_scan_impl_name());
+}
+
+void test_headers() {
+    printf("Testing header tag extraction...\n");
+    const char *header =
+        "[Event \"Rated [Blitz] game\"]\n"
+        "[White \"a\\\"b\"]\n"
+        "[Result \"1-0\"]\n"
+        "[WhiteElo \"1294\"]\n"
+        "[WhiteEloX \"9\"]\n"
+        "[BlackElo \"1262\"]\n"
+        "[BlackRatingDiff \"-5\"]\n"
+        "[TimeControl \"180+0\"]\n"
+        "[Termination \"Time forfeit\"]";
+    for (int impl = 0; impl < 3; impl++) {
+        if (!pgn_scan_select(IMPLS[impl])) {
+            continue;
+        }
+        PGN_Header_Tags tags;
+        pgn_scan_headers(header, strlen(header), &tags);
+        expect_tag(&tags.white_elo, "1294");
+        expect_tag(&tags.black_elo, "1262");
+        expect_tag(&tags.time_control, "180+0");
+        expect_tag(&tags.termination, "Time forfeit");
+        expect_tag(&tags.result, "1-0");
+        expect_tag(&tags.fen, NULL);
+
+        const char *short_header = "[FEN \"8/8/8/8/8/8/8/K1k5 w - - 0 1\"]";
+        pgn_scan_headers(short_header, strlen(short_header), &tags);
+        expect_tag(&tags.fen, "8/8/8/8/8/8/8/K1k5 w - - 0 1");
+        expect_tag(&tags.white_elo, NULL);
+
+        pgn_scan_headers("", 0, &tags);
+        expect_tag(&tags.result, NULL);
+        pgn_scan_headers("[Result \"1-0", 12, &tags);
+        expect_tag(&tags.result, NULL);
+    }
+    pgn_scan_select(PGN_SCAN_AUTO);
+    printf("✓ Wanted tags found, look-alike names and unterminated values ignored\n");
+}
+
+// Reference boundary search: every "[Event" at a line start after from
+static size_t find_game_bytewise(const char *data, size_t len, size_t from) {
+    for (size_t i = from; i + 1 < len; i++) {
+        if (data[i] == '\n' && i + 7 <= len && memcmp(data + i + 1, "[Event", 6) == 0) {
+            return i + 1;
+        }
+    }
+    return len;
+}
+
+void test_find_game() {
+    printf("Testing game boundary search...\n");
+    char data[300];
+    int searches = 0;
+    for (int round = 0; round < 3000; round++) {
+        size_t len = rng_next() % sizeof(data);
+        fill_random(data, len);
+        size_t from = len ? rng_next() % len : 0;
+        size_t expected = find_game_bytewise(data, len, from);
+        for (int impl = 0; impl < 3; impl++) {
+            if (!pgn_scan_select(IMPLS[impl])) {
+                continue;
+            }
+            assert(pgn_scan_find_game(data, len, from) == expected);
+            searches++;
+        }
+    }
+
+    // Boundaries straddling the 64-byte block edge, and cut off at the end
+    memset(data, 'x', 200);
+    memcpy(data + 63, "\n[Event", 7);
+    for (int impl = 0; impl < 3; impl++) {
+        if (!pgn_scan_select(IMPLS[impl])) {
+            continue;
+        }
+        assert(pgn_scan_find_game(data, 200, 0) == 64);
+        assert(pgn_scan_find_game(data, 68, 0) == 68);
+        assert(pgn_scan_find_game(data, 200, 64) == 200);
+    }
+    pgn_scan_select(PGN_SCAN_AUTO);
+    printf("✓ %d random searches match a bytewise search\n", searches);
+}
+
+void test_stream_per_impl() {
+    printf("Testing pgn_stream with each implementation...\n");
+    size_t len;
+    char *game = read_file(ARTIFACT_DIR "game_2.pgn", &len);
+    FILE *f = fopen(CORPUS_PATH, "wb");
+    assert(f != NULL);
+    for (int i = 0; i < 500; i++) {
+        assert(fwrite(game, 1, len, f) == len);
+        // Vary the gap so boundaries land at every offset within a block
+        for (int pad = 0; pad < i % 67 + 1; pad++) {
+            fputc('\n', f);
+        }
+    }
+    fclose(f);
+
+    for (int impl = 0; impl < 3; impl++) {
+        if (!pgn_scan_select(IMPLS[impl])) {
+            continue;
+        }
+        PGN_Stream *stream = pgn_stream_open_with_buffer(CORPUS_PATH, 4096);
+        assert(stream != NULL);
+        PGN_Game parsed;
+        int games = 0;
+        while (pgn_stream_next_game(stream, &parsed)) {
+            assert(parsed.header_len + 2 + parsed.movetext_len == len);
+            assert(memcmp(parsed.movetext, game + len - parsed.movetext_len, parsed.movetext_len) == 0);
+            games++;
+        }
+        assert(pgn_stream_error(stream) == NULL);
+        assert(games == 500);
+        pgn_stream_close(stream);
+    }
+    pgn_scan_select(PGN_SCAN_AUTO);
+    free(game);
+    remove(CORPUS_PATH);
+    printf("✓ Same 500 games through a 4 KB buffer\n");
+}
+
+int main() {
+    printf("=== PGN Scanner Test Suite ===\n\n");
+
+    test_masks_agree();
+    test_headers();
+    test_find_game();
+    test_stream_per_impl();
+
+    printf("🎉 All tests passed successfully!\n");
+    return 0;
+}
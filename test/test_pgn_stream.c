@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <zstd.h>
+#include "../include/pgn_stream.h"
+#include "test_util.h"
+
+#define PLAIN_PATH "obj/test_pgn_stream.pgn"
+#define ZST_PATH "obj/test_pgn_stream.pgn.zst"
+
+// Concatenates the three test artifact games `copies` times, with some junk
+// in front of the first game.
+static char *build_corpus(int copies, size_t *len_out) {
+    char *games[3];
+    size_t lens[3];
+    for (int i = 0; i < 3; i++) {
+        games[i] = read_artifact(i, &lens[i]);
+    }
+    const char *junk = "\xEF\xBB\xBF\n\n";
+    size_t total = strlen(junk) + (size_t)copies * (lens[0] + lens[1] + lens[2] + 9);
+    char *corpus = malloc(total + 1);
+    assert(corpus != NULL);
+    size_t pos = 0;
+    memcpy(corpus, junk, strlen(junk));
+    pos += strlen(junk);
+    for (int c = 0; c < copies; c++) {
+        for (int i = 0; i < 3; i++) {
+            memcpy(corpus + pos, games[i], lens[i]);
+            pos += lens[i];
+            memcpy(corpus + pos, "\r\n\n", 3);
+            pos += 3;
+        }
+    }
+    for (int i = 0; i < 3; i++) free(games[i]);
+    *len_out = pos;
+    return corpus;
+}
+
+static void write_compressed(const char *path, const char *data, size_t len, int frames) {
+    size_t bound = ZSTD_compressBound(len) + (size_t)frames * 64;
+    char *out = malloc(bound);
+    assert(out != NULL);
+    size_t out_len = 0;
+    size_t chunk = len / (size_t)frames + 1;
+    for (size_t pos = 0; pos < len; pos += chunk) {
+        size_t n = len - pos < chunk ? len - pos : chunk;
+        size_t r = ZSTD_compress(out + out_len, bound - out_len, data + pos, n, 3);
+        assert(!ZSTD_isError(r));
+        out_len += r;
+    }
+    write_file(path, out, out_len);
+    free(out);
+}
+
+static void check_artifact_game(const PGN_Game *game) {
+    static const char *endings[3] = {"31. Rxg2 1-0", "gxf3 0-1", "Qe6# 1-0"};
+    assert(game->header_len > 0);
+    assert(strncmp(game->header, "[Event \"rated", 13) == 0);
+    assert(game->header[game->header_len - 1] == ']');
+    assert(strncmp(game->movetext, "1. e4", 5) == 0);
+    const char *ending = endings[game->index % 3];
+    size_t ending_len = strlen(ending);
+    assert(game->movetext_len > ending_len);
+    assert(memcmp(game->movetext + game->movetext_len - ending_len, ending, ending_len) == 0);
+}
+
+static int count_games(const char *path, size_t buffer_capacity, size_t *final_capacity) {
+    PGN_Stream *stream = pgn_stream_open_with_buffer(path, buffer_capacity);
+    assert(stream != NULL);
+    PGN_Game game;
+    int count = 0;
+    while (pgn_stream_next_game(stream, &game)) {
+        assert(game.index == (uint64_t)count);
+        check_artifact_game(&game);
+        count++;
+    }
+    assert(pgn_stream_error(stream) == NULL);
+    if (final_capacity) *final_capacity = pgn_stream_buffer_capacity(stream);
+    pgn_stream_close(stream);
+    return count;
+}
+
+void test_plain_pgn() {
+    printf("Testing plain PGN stream...\n");
+    size_t len;
+    char *corpus = build_corpus(1, &len);
+    write_file(PLAIN_PATH, corpus, len);
+
+    assert(count_games(PLAIN_PATH, PGN_STREAM_DEFAULT_BUFFER, NULL) == 3);
+    printf("✓ Found 3 games with default buffer\n");
+
+    // A 256 byte buffer is smaller than one game, so it has to grow
+    size_t capacity;
+    assert(count_games(PLAIN_PATH, 256, &capacity) == 3);
+    assert(capacity >= 1024);
+    printf("✓ Found 3 games with a growing buffer (%zu bytes)\n", capacity);
+    free(corpus);
+}
+
+void test_compressed_pgn() {
+    printf("Testing .pgn.zst stream...\n");
+    size_t len;
+    char *corpus = build_corpus(1, &len);
+    write_compressed(ZST_PATH, corpus, len, 1);
+    assert(count_games(ZST_PATH, PGN_STREAM_DEFAULT_BUFFER, NULL) == 3);
+    assert(count_games(ZST_PATH, 256, NULL) == 3);
+    printf("✓ Found 3 games in a single frame\n");
+
+    write_compressed(ZST_PATH, corpus, len, 4);
+    assert(count_games(ZST_PATH, 512, NULL) == 3);
+    printf("✓ Found 3 games across 4 frames\n");
+    free(corpus);
+}
+
+void test_bounded_buffer() {
+    printf("Testing buffer stays bounded on a large stream...\n");
+    int copies = 4000;
+    size_t len;
+    char *corpus = build_corpus(copies, &len);
+    write_compressed(ZST_PATH, corpus, len, 1);
+
+    size_t capacity;
+    size_t initial = 64 * 1024;
+    assert(count_games(ZST_PATH, initial, &capacity) == copies * 3);
+    assert(capacity == initial);
+    printf("✓ %d games (%zu bytes) decoded through a %zu byte buffer\n", copies * 3, len, capacity);
+
+    PGN_Stream *stream = pgn_stream_open(ZST_PATH);
+    PGN_Game game;
+    while (pgn_stream_next_game(stream, &game)) {
+    }
+    assert(pgn_stream_bytes_decoded(stream) == len);
+    printf("✓ Decoded byte count matches input (%llu)\n",
+           (unsigned long long)pgn_stream_bytes_decoded(stream));
+    pgn_stream_close(stream);
+    free(corpus);
+}
+
+void test_truncated_input() {
+    printf("Testing truncated .zst input...\n");
+    size_t len;
+    char *corpus = build_corpus(50, &len);
+    write_compressed(ZST_PATH, corpus, len, 1);
+    size_t zlen;
+    char *compressed = read_file(ZST_PATH, &zlen);
+    write_file(ZST_PATH, compressed, zlen / 2);
+
+    PGN_Stream *stream = pgn_stream_open(ZST_PATH);
+    PGN_Game game;
+    while (pgn_stream_next_game(stream, &game)) {
+    }
+    assert(pgn_stream_error(stream) != NULL);
+    printf("✓ Reported error: %s\n", pgn_stream_error(stream));
+    pgn_stream_close(stream);
+    free(compressed);
+    free(corpus);
+}
+
+void test_mapped_pgn() {
+    printf("Testing memory-mapped plain PGN...\n");
+    // Large enough to slide the mapping window more than once
+    int copies = 16000;
+    size_t len;
+    char *corpus = build_corpus(copies, &len);
+    assert(len > 2 * PGN_STREAM_MAP_WINDOW);
+    write_file(PLAIN_PATH, corpus, len);
+
+    PGN_Stream *read = pgn_stream_open(PLAIN_PATH);
+    PGN_Stream *mapped = pgn_stream_open_mapped(PLAIN_PATH, 0, 0);
+    assert(read != NULL && mapped != NULL);
+    PGN_Game a, b;
+    int count = 0;
+    while (pgn_stream_next_game(read, &a)) {
+        assert(pgn_stream_next_game(mapped, &b));
+        assert(a.index == b.index && a.offset == b.offset);
+        assert(a.header_len == b.header_len && memcmp(a.header, b.header, a.header_len) == 0);
+        assert(a.movetext_len == b.movetext_len && memcmp(a.movetext, b.movetext, a.movetext_len) == 0);
+        assert(memcmp(b.header, corpus + b.offset, b.header_len) == 0);
+        check_artifact_game(&b);
+        count++;
+    }
+    assert(!pgn_stream_next_game(mapped, &b));
+    assert(pgn_stream_error(mapped) == NULL && pgn_stream_bytes_decoded(mapped) == len);
+    assert(count == copies * 3);
+    pgn_stream_close(read);
+    pgn_stream_close(mapped);
+    printf("✓ Same %d games as the read() stream\n", count);
+
+    // Ranges cut mid-game, mid-line and on a game start; each game lands in
+    // exactly one of them
+    uint64_t cuts[] = {0, 1, len / 3, len / 2 + 17, 0, len};
+    PGN_Stream *probe = pgn_stream_open_mapped(PLAIN_PATH, 2 * len / 3, 0);
+    assert(pgn_stream_next_game(probe, &b));
+    cuts[4] = b.offset;
+    pgn_stream_close(probe);
+    uint64_t last_offset = 0;
+    int total = 0;
+    for (size_t r = 0; r + 1 < sizeof(cuts) / sizeof(cuts[0]); r++) {
+        uint64_t start = cuts[r], end = cuts[r + 1];
+        PGN_Stream *range = pgn_stream_open_mapped(PLAIN_PATH, start, end);
+        assert(range != NULL);
+        while (pgn_stream_next_game(range, &b)) {
+            assert(b.offset >= start && b.offset < end);
+            assert(total == 0 || b.offset > last_offset);
+            last_offset = b.offset;
+            total++;
+        }
+        assert(pgn_stream_error(range) == NULL);
+        pgn_stream_close(range);
+    }
+    assert(total == copies * 3);
+    printf("✓ Byte ranges split the file into %d games, none lost or repeated\n", total);
+
+    PGN_Stream *past_end = pgn_stream_open_mapped(PLAIN_PATH, len + 100, 0);
+    assert(past_end != NULL && !pgn_stream_next_game(past_end, &b));
+    pgn_stream_close(past_end);
+    write_compressed(ZST_PATH, corpus, len / 8, 1);
+    assert(pgn_stream_open_mapped(ZST_PATH, 0, 0) == NULL);
+    assert(pgn_stream_open_mapped("-", 0, 0) == NULL);
+    printf("✓ Empty past the end; .zst and stdin are left to pgn_stream_open\n");
+    free(corpus);
+}
+
+int main() {
+    printf("=== PGN Stream Test Suite ===\n\n");
+
+    test_plain_pgn();
+    test_compressed_pgn();
+    test_bounded_buffer();
+    test_truncated_input();
+    test_mapped_pgn();
+
+    remove(PLAIN_PATH);
+    remove(ZST_PATH);
+    printf("🎉 All tests passed successfully!\n");
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include "../include/attacks.h"
+#include "../include/fen_plus.h"
+#include "../include/pgn_stream.h"
+#include "../include/pgn_tokenizer.h"
+#include "test_util.h"
+
+#define CORPUS_PATH "obj/test_pgn_tokenizer.pgn"
+#define CORPUS_COPIES 400
+
+// Count heap allocations by interposing the allocator; the real functions
+// are glibc's __libc_* entry points.
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static long allocations = 0;
+
+void *malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    allocations++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+// Tokenizes movetext and checks the tokens against the space-separated list
+static void expect_tokens(const char *movetext, const char *expected) {
+    PGN_Tokenizer tokenizer;
+    pgn_tokenizer_init(&tokenizer, movetext, strlen(movetext));
+    const char *token;
+    size_t length;
+    char joined[512] = "";
+    size_t pos = 0;
+    while (pgn_tokenizer_next(&tokenizer, &token, &length)) {
+        if (pos > 0) joined[pos++] = ' ';
+        memcpy(joined + pos, token, length);
+        pos += length;
+        joined[pos] = '\0';
+    }
+    if (strcmp(joined, expected) != 0) {
+        printf("movetext: %s\nexpected: %s\ngot:      %s\n", movetext, expected, joined);
+    }
+    assert(strcmp(joined, expected) == 0);
+}
+
+void test_lichess_movetext() {
+    printf("Testing Lichess movetext...\n");
+    expect_tokens("1. e4 { [%eval 0.17] [%clk 0:03:00] } 1... c5 { [%eval 0.19] [%clk 0:03:00] } "
+                  "2. Nf3?! $6 { [%eval -0.2] [%clk 0:02:58] } 2... d6 3. d4 cxd4 1-0",
+                  "e4 c5 Nf3?! d6 d4 cxd4");
+    expect_tokens("1.e4 e5 2.Nf3 Nc6 3.Bb5 a6 *", "e4 e5 Nf3 Nc6 Bb5 a6");
+    expect_tokens("1. d4 d5\n2. c4 ; Queen's Gambit\n2... e6 1/2-1/2", "d4 d5 c4 e6");
+    printf("✓ Clock and eval comments, NAGs, move numbers and line comments\n");
+
+    expect_tokens("1. e4 (1. d4 d5 (1... Nf6 2. c4 {Indian}) 2. c4) 1... e5 (1... c5 {Sicilian (open)}) 2. Nf3 0-1",
+                  "e4 e5 Nf3");
+    printf("✓ Nested variations, including parentheses inside comments\n");
+
+    expect_tokens("1. e4 e5 2. Nf3 Nf6 3. 0-0 0-0 0-1", "e4 e5 Nf3 Nf6 0-0 0-0");
+    expect_tokens("1. e4 e5 1-0 2. Nf3", "e4 e5");
+    expect_tokens("", "");
+    expect_tokens("1-0", "");
+    expect_tokens("{ only a comment }", "");
+    printf("✓ Results end the game; zero-castling is not a result\n");
+}
+
+void test_fixed_array() {
+    printf("Testing pgn_tokenize_moves...\n");
+    const char *movetext = "1. e4 e5 2. Nf3 Nc6 3. Bb5 a6 1-0";
+    san_move moves[4];
+    int count = pgn_tokenize_moves(movetext, strlen(movetext), moves, 4);
+    assert(count == 6);
+    assert(strcmp(moves[0].notation, "e4") == 0);
+    assert(strcmp(moves[3].notation, "Nc6") == 0);
+    assert(pgn_tokenize_moves(movetext, strlen(movetext), NULL, 0) == 6);
+    printf("✓ Returns the full count and fills up to capacity\n");
+
+    char long_token[64];
+    memset(long_token, 'N', sizeof(long_token) - 1);
+    long_token[sizeof(long_token) - 1] = '\0';
+    assert(pgn_tokenize_moves(long_token, strlen(long_token), moves, 4) == 1);
+    assert(strlen(moves[0].notation) == sizeof(moves[0].notation) - 1);
+    printf("✓ Overlong tokens are truncated\n");
+}
+
+void test_zero_allocations() {
+    printf("Testing steady-state allocations...\n");
+    FILE *corpus = fopen(CORPUS_PATH, "wb");
+    assert(corpus != NULL);
+    for (int i = 0; i < 3; i++) {
+        size_t len;
+        char *game = read_artifact(i, &len);
+        for (int c = 0; c < CORPUS_COPIES; c++) {
+            assert(fwrite(game, 1, len, corpus) == len);
+            assert(fwrite("\n\n", 1, 2, corpus) == 2);
+        }
+        free(game);
+    }
+    fclose(corpus);
+
+    PGN_Stream *stream = pgn_stream_open(CORPUS_PATH);
+    assert(stream != NULL);
+    Text_Buffer out = {0};
+    FEN_Plus_Stats stats = {0};
+    san_move moves[512];
+    PGN_Game game;
+    int games = 0;
+    long warm_up_allocations = 0;
+    while (pgn_stream_next_game(stream, &game)) {
+        if (games == 10) {
+            warm_up_allocations = allocations;
+        }
+        out.length = 0;
+        assert(pgn_tokenize_moves(game.movetext, game.movetext_len, moves, 512) > 0);
+        assert(fen_plus_append_game(&game, NULL, &out, &stats));
+        games++;
+    }
+    long steady_allocations = allocations - warm_up_allocations;
+    assert(pgn_stream_error(stream) == NULL);
+    assert(games == 3 * CORPUS_COPIES && stats.rejected == 0);
+    printf("✓ %d games streamed, tokenized and converted with %ld allocations after warm-up\n",
+           games - 10, steady_allocations);
+    assert(steady_allocations == 0);
+
+    text_buffer_free(&out);
+    pgn_stream_close(stream);
+    remove(CORPUS_PATH);
+}
+
+int main() {
+    printf("=== PGN Tokenizer Test Suite ===\n\n");
+    attacks_init();
+
+    test_lichess_movetext();
+    test_fixed_array();
+    test_zero_allocations();
+
+    printf("🎉 All tests passed successfully!\n");
+    return 0;
+}
@@ -0,0 +1,402 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zstd.h>
+#include "../include/attacks.h"
+#include "../include/fen_plus.h"
+#include "../include/output_writer.h"
+#include "../include/pipeline.h"
+#include "../include/san_cache.h"
+#include "test_util.h"
+
+#define CORPUS_PATH "obj/test_pipeline.pgn"
+#define CORPUS_ZST_PATH "obj/test_pipeline.pgn.zst"
+#define OUTPUT_PATH "obj/test_pipeline.csv"
+#define REPORT_PATH "obj/test_pipeline_report.json"
+
+#define COPIES 200
+
+static const char *BAD_GAME =
+    "[Event \"Broken\"]\n[WhiteElo \"1500\"]\n[BlackElo \"1500\"]\n[TimeControl \"60+0\"]\n\n"
+    "1. e4 e5 2. Ke3 Nc6 1-0\n\n";
+
+static PGN_Game make_game(const char *header, const char *movetext) {
+    PGN_Game game;
+    game.header = header;
+    game.header_len = strlen(header);
+    game.movetext = movetext;
+    game.movetext_len = strlen(movetext);
+    game.index = 0;
+    return game;
+}
+
+static int count_lines(const char *data, size_t len) {
+    int lines = 0;
+    for (size_t i = 0; i < len; i++) {
+        lines += data[i] == '\n';
+    }
+    return lines;
+}
+
+void test_artifact_rows() {
+    printf("Testing FEN+ rows of a test artifact game...\n");
+    size_t len;
+    char *text = read_file(ARTIFACT_DIR "game_1.pgn", &len);
+    char *movetext = strstr(text, "\n\n1. ");
+    assert(movetext != NULL);
+    *movetext = '\0';
+    PGN_Game game = make_game(text, movetext + 2);
+
+    Text_Buffer out = {0};
+    FEN_Plus_Stats stats = {0};
+    assert(fen_plus_append_game(&game, NULL, &out, &stats));
+    assert(stats.games == 1 && stats.rejected == 0 && stats.plies == 61);
+    assert(count_lines(out.data, out.length) == 61);
+
+    const char *expected =
+        "180+0,1,rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1,1294,e2e4\n"
+        "180+0,1,rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1,1262,e7e5\n"
+        "180+0,2,rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq e6 0 2,1294,g1f3\n";
+    assert(out.length > strlen(expected));
+    assert(memcmp(out.data, expected, strlen(expected)) == 0);
+    const char *last_row = "180+0,31,";
+    char *last = out.data + out.length - 1;
+    while (last > out.data && last[-1] != '\n') last--;
+    assert(strncmp(last, last_row, strlen(last_row)) == 0);
+    assert(memcmp(out.data + out.length - 11, ",1294,d2g2\n", 11) == 0);
+    printf("✓ One row per move with FEN before the move, mover's Elo and UCI\n");
+
+    text_buffer_free(&out);
+    free(text);
+}
+
+void test_movetext_syntax() {
+    printf("Testing movetext annotations...\n");
+    const char *header = "[Event \"Annotated\"]\n[WhiteElo \"2000\"]\n[BlackElo \"1900\"]";
+    PGN_Game game = make_game(header,
+        "1. e4 {[%clk 0:03:00]} 1... e5 $1 2.Nf3 (2. f4 exf4 {gambit} (2... d5)) 2... Nc6 ; comment\n"
+        "3. Bb5 a6?! 4. O-O 1/2-1/2");
+    Text_Buffer out = {0};
+    FEN_Plus_Stats stats = {0};
+    assert(fen_plus_append_game(&game, NULL, &out, &stats));
+    assert(stats.plies == 7 && count_lines(out.data, out.length) == 7);
+    // No TimeControl tag: "-"
+    assert(strncmp(out.data, "-,1,", 4) == 0);
+    assert(memcmp(out.data + out.length - 11, ",2000,e1g1\n", 11) == 0);
+    printf("✓ Comments, variations, NAGs and move numbers are skipped\n");
+
+    out.length = 0;
+    PGN_Game from_fen = make_game("[Event \"Study\"]\n[SetUp \"1\"]\n[FEN \"4k3/8/8/8/8/8/4P3/4K3 w - - 0 40\"]",
+                                  "40. e4 Kd7 *");
+    assert(fen_plus_append_game(&from_fen, NULL, &out, &stats));
+    assert(stats.plies == 9);
+    const char *first_row = "-,40,4k3/8/8/8/8/8/4P3/4K3 w - - 0 40,0,e2e4\n";
+    assert(strncmp(out.data, first_row, strlen(first_row)) == 0);
+    printf("✓ [FEN] tag sets the starting position\n");
+    text_buffer_free(&out);
+}
+
+void test_rejected_game() {
+    printf("Testing games with illegal moves...\n");
+    Text_Buffer out = {0};
+    FEN_Plus_Stats stats = {0};
+    assert(text_buffer_append(&out, "previous\n", 9));
+    const char *header = "[Event \"Broken\"]";
+    PGN_Game game = make_game(header, "1. e4 e5 2. Ke3 Nc6 1-0");
+    assert(fen_plus_append_game(&game, NULL, &out, &stats));
+    assert(stats.rejected == 1 && stats.games == 0 && stats.plies == 0);
+    assert(out.length == 9 && memcmp(out.data, "previous\n", 9) == 0);
+    printf("✓ Rows of a rejected game are dropped\n");
+
+    // Moves the SAN resolver finds a piece for, but that may not be played:
+    // ignoring check, walking into check, and an 'x' onto an empty square
+    const char *illegal[3] = {"1. e4 f5 2. Qh5+ Nf6 *", "1. e4 f5 2. Qh5+ g6 3. Qxf7+ Ke7 *",
+                              "1. Nf3 d5 2. Nxe5 *"};
+    San_Cache cache;
+    assert(san_cache_init(&cache, 64 * 1024));
+    for (int pass = 0; pass < 2; pass++) {
+        // The second pass resolves the opening moves from the SAN cache
+        memset(&stats, 0, sizeof(stats));
+        stats.san_cache = &cache;
+        for (int i = 0; i < 3; i++) {
+            PGN_Game bad = make_game(header, illegal[i]);
+            assert(fen_plus_append_game(&bad, NULL, &out, &stats));
+        }
+        assert(stats.rejected == 3 && stats.games == 0 && stats.plies == 0);
+        assert(out.length == 9);
+    }
+    assert(stats.san_cache_hits > 0);
+    PGN_Game fine = make_game(header, "1. e4 f5 2. Qh5+ g6 3. Qxg6+ hxg6 4. Nf3 Rxh2 5. Nxh2 *");
+    assert(fen_plus_append_game(&fine, NULL, &out, &stats));
+    assert(stats.games == 1 && stats.plies == 9);
+    san_cache_free(&cache);
+    printf("✓ Moves into or ignoring check and captures of nothing reject the game\n");
+    text_buffer_free(&out);
+}
+
+// Writes the artifact games COPIES times with a broken game every 50 games
+static size_t write_corpus(void) {
+    Text_Buffer corpus = {0};
+    for (int c = 0; c < COPIES; c++) {
+        for (int i = 0; i < 3; i++) {
+            size_t len;
+            char *game = read_artifact(i, &len);
+            assert(text_buffer_append(&corpus, game, len));
+            assert(text_buffer_append(&corpus, "\n\n", 2));
+            free(game);
+        }
+        if (c % 50 == 0) {
+            assert(text_buffer_append(&corpus, BAD_GAME, strlen(BAD_GAME)));
+        }
+    }
+    write_file(CORPUS_PATH, corpus.data, corpus.length);
+
+    size_t bound = ZSTD_compressBound(corpus.length);
+    char *compressed = malloc(bound);
+    assert(compressed != NULL);
+    size_t compressed_len = ZSTD_compress(compressed, bound, corpus.data, corpus.length, 3);
+    assert(!ZSTD_isError(compressed_len));
+    write_file(CORPUS_ZST_PATH, compressed, compressed_len);
+    free(compressed);
+
+    size_t len = corpus.length;
+    text_buffer_free(&corpus);
+    return len;
+}
+
+static char *run_options_to_file(const char *input, const Pipeline_Options *options, Pipeline_Stats *stats,
+                                 size_t *len_out) {
+    int fd = open(OUTPUT_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(fd >= 0);
+    bool ok = pipeline_run(input, fd, options, stats);
+    if (!ok) {
+        printf("pipeline failed: %s\n", stats->error);
+    }
+    assert(ok);
+    close(fd);
+    return read_file(OUTPUT_PATH, len_out);
+}
+
+static char *run_to_file(const char *input, int threads, size_t batch_bytes,
+                         Pipeline_Stats *stats, size_t *len_out) {
+    Pipeline_Options options;
+    pipeline_default_options(&options);
+    options.threads = threads;
+    options.batch_bytes = batch_bytes;
+    return run_options_to_file(input, &options, stats, len_out);
+}
+
+void test_thread_counts_identical() {
+    printf("Testing output is identical for every thread count...\n");
+    size_t corpus_len = write_corpus();
+
+    Pipeline_Stats stats;
+    size_t reference_len;
+    char *reference = run_to_file(CORPUS_PATH, 0, 8 * 1024, &stats, &reference_len);
+    assert(stats.games == 3 * COPIES && stats.rejected == COPIES / 50);
+    assert(stats.plies == (uint64_t)ARTIFACT_PLIES * COPIES);
+    assert(stats.bytes_decoded == corpus_len);
+    assert(count_lines(reference, reference_len) == ARTIFACT_PLIES * COPIES + 1);
+    assert(strncmp(reference, FEN_PLUS_CSV_HEADER, strlen(FEN_PLUS_CSV_HEADER)) == 0);
+    printf("✓ Single-threaded run: %llu games, %llu rows\n",
+           (unsigned long long)stats.games, (unsigned long long)stats.plies);
+
+    // The same three games over and over: after the first copy, every
+    // opening move comes from the SAN cache
+    assert(stats.san_cache_memory == SAN_CACHE_DEFAULT_MEMORY);
+    assert(stats.san_cache_misses > 0 && stats.san_cache_hits > (COPIES - 2) * stats.san_cache_misses / 2);
+    Pipeline_Options options;
+    pipeline_default_options(&options);
+    options.threads = 0;
+    options.san_cache_memory = 0;
+    size_t uncached_len;
+    char *uncached = run_options_to_file(CORPUS_PATH, &options, &stats, &uncached_len);
+    assert(uncached_len == reference_len && memcmp(uncached, reference, uncached_len) == 0);
+    assert(stats.san_cache_hits == 0 && stats.san_cache_misses == 0 && stats.san_cache_memory == 0);
+    free(uncached);
+    printf("✓ Rows are the same with and without the SAN cache\n");
+
+    int thread_counts[] = {1, 2, 3, 8};
+    size_t batch_sizes[] = {8 * 1024, 1, PIPELINE_DEFAULT_BATCH_BYTES};
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        for (size_t b = 0; b < sizeof(batch_sizes) / sizeof(batch_sizes[0]); b++) {
+            size_t len;
+            char *output = run_to_file(CORPUS_PATH, thread_counts[t], batch_sizes[b], &stats, &len);
+            assert(len == reference_len && memcmp(output, reference, len) == 0);
+            assert(stats.games == 3 * COPIES && stats.plies == (uint64_t)ARTIFACT_PLIES * COPIES);
+            free(output);
+        }
+    }
+    printf("✓ 1, 2, 3 and 8 workers with tiny to large batches match byte for byte\n");
+
+    size_t len;
+    char *output = run_to_file(CORPUS_ZST_PATH, 4, 16 * 1024, &stats, &len);
+    assert(len == reference_len && memcmp(output, reference, len) == 0);
+    assert(stats.bytes_read < stats.bytes_decoded);
+    free(output);
+    printf("✓ Compressed input produces the same rows\n");
+    free(reference);
+}
+
+// Value of a top-level number member of the report
+static double report_number(const char *report, const char *name) {
+    char key[64];
+    snprintf(key, sizeof(key), "\"%s\": ", name);
+    const char *at = strstr(report, key);
+    assert(at != NULL);
+    return atof(at + strlen(key));
+}
+
+void test_run_report() {
+    printf("Testing the JSON run report...\n");
+    Pipeline_Options options;
+    pipeline_default_options(&options);
+    options.threads = 2;
+    options.batch_bytes = 16 * 1024;
+    options.format = PIPELINE_FORMAT_RECORDS;
+    options.report_path = REPORT_PATH;
+    int fd = open(OUTPUT_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(fd >= 0);
+    // Asked for before the run, so the writer takes a partial report after
+    // its first batch; the final one replaces it
+    pipeline_request_report();
+    Pipeline_Stats stats;
+    assert(pipeline_run(CORPUS_ZST_PATH, fd, &options, &stats));
+    close(fd);
+
+    size_t len;
+    char *report = read_file(REPORT_PATH, &len);
+    assert(report[0] == '{' && report[len - 2] == '}');
+    assert(strstr(report, "\"complete\": true") != NULL);
+    assert(report_number(report, "games") == stats.games);
+    assert(report_number(report, "plies") == stats.plies);
+    assert(report_number(report, "bytes_decoded") == stats.bytes_decoded);
+    assert(report_number(report, "peak_rss_bytes") > 0);
+    const char *stages[] = {"decompress", "scan", "san", "format", "compress", "write"};
+    for (size_t i = 0; i < sizeof(stages) / sizeof(stages[0]); i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "\"%s\": {\"seconds\": ", stages[i]);
+        assert(strstr(report, key) != NULL);
+    }
+    assert(strstr(report, "\"game_latency_us\": {") != NULL);
+    assert(report_number(report, "hits") == stats.san_cache_hits && stats.san_cache_hits > 0);
+    assert(report_number(report, "hit_rate") > 0.5);
+#if PERF_COUNTERS
+    assert(report_number(report, "hit_ns") > 0 && report_number(report, "miss_ns") > 0);
+    // Every game is timed, the rejected ones included
+    assert(strstr(report, "\"counters\": true") != NULL);
+    assert(report_number(report, "sampled_games") > 0);
+    char games[64];
+    snprintf(games, sizeof(games), "\"game_latency_us\": {\"games\": %llu,",
+             (unsigned long long)(stats.games + stats.rejected));
+    assert(strstr(report, games) != NULL);
+    assert(strstr(report, "\"le\": ") != NULL);
+#endif
+    free(report);
+    remove(REPORT_PATH);
+    printf("✓ Report has the totals, every stage and the latency histogram\n");
+}
+
+void test_errors() {
+    printf("Testing pipeline errors...\n");
+    Pipeline_Options options;
+    pipeline_default_options(&options);
+    Pipeline_Stats stats;
+    int fd = open(OUTPUT_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(fd >= 0);
+    assert(!pipeline_run("obj/does_not_exist.pgn", fd, &options, &stats));
+    assert(strstr(stats.error, "does_not_exist") != NULL);
+    close(fd);
+    printf("✓ Missing input is reported\n");
+
+    // A write error stops the reader and workers instead of converting the rest
+    fd = open(OUTPUT_PATH, O_RDONLY);
+    assert(fd >= 0);
+    options.threads = 4;
+    options.batch_bytes = 1;
+    assert(!pipeline_run(CORPUS_PATH, fd, &options, &stats));
+    assert(strstr(stats.error, "write error") != NULL);
+    assert(stats.batches > 0 && stats.batches < 3 * COPIES);
+    close(fd);
+    printf("✓ A failed write ends a threaded run after %llu of %d batches\n",
+           (unsigned long long)stats.batches, 3 * COPIES + COPIES / 50);
+}
+
+void test_output_writer() {
+    printf("Testing buffered output writer...\n");
+    size_t total = 3 * OUTPUT_WRITER_BLOCK + 12345;
+    char *data = malloc(total);
+    assert(data != NULL);
+    for (size_t i = 0; i < total; i++) {
+        data[i] = (char)('a' + i % 26);
+    }
+
+    int fd = open(OUTPUT_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(fd >= 0);
+    Output_Writer writer;
+    assert(output_writer_init(&writer, fd));
+    // Small rows, then a chunk larger than two blocks, then small rows again
+    size_t pos = 0;
+    for (size_t chunk = 1; pos + chunk <= OUTPUT_WRITER_BLOCK / 2; chunk = chunk % 97 + 1) {
+        assert(output_writer_write(&writer, data + pos, chunk));
+        pos += chunk;
+    }
+    assert(writer.write_calls == 0);
+    size_t big = 2 * OUTPUT_WRITER_BLOCK + 777;
+    assert(output_writer_write(&writer, data + pos, big));
+    pos += big;
+    assert(writer.bytes_written % OUTPUT_WRITER_BLOCK == 0);
+    assert(output_writer_write(&writer, data + pos, total - pos));
+    assert(output_writer_flush(&writer));
+    assert(writer.bytes_written == total);
+    output_writer_free(&writer);
+    close(fd);
+
+    size_t len;
+    char *back = read_file(OUTPUT_PATH, &len);
+    assert(len == total && memcmp(back, data, total) == 0);
+    free(back);
+    free(data);
+
+    // A descriptor that cannot be written reports errno on flush
+    fd = open(OUTPUT_PATH, O_RDONLY);
+    assert(fd >= 0);
+    assert(output_writer_init(&writer, fd));
+    assert(output_writer_write(&writer, "x", 1));
+    assert(!output_writer_flush(&writer));
+    assert(writer.error != 0);
+    assert(!output_writer_write(&writer, "x", 1));
+    output_writer_free(&writer);
+
+    Pipeline_Options options;
+    pipeline_default_options(&options);
+    Pipeline_Stats stats;
+    assert(!pipeline_run(ARTIFACT_DIR "game_1.pgn", fd, &options, &stats));
+    assert(strstr(stats.error, "write error") != NULL);
+    close(fd);
+    printf("✓ Output intact across block boundaries, write errors reported\n");
+}
+
+int main() {
+    printf("=== Pipeline Test Suite ===\n\n");
+    attacks_init();
+
+    test_artifact_rows();
+    test_movetext_syntax();
+    test_rejected_game();
+    test_thread_counts_identical();
+    test_run_report();
+    test_errors();
+    test_output_writer();
+
+    remove(CORPUS_PATH);
+    remove(CORPUS_ZST_PATH);
+    remove(OUTPUT_PATH);
+    printf("🎉 All tests passed successfully!\n");
+    return 0;
+}
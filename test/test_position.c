@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include "../include/fen_utils.h"
+#include "../include/position.h"
+
+static const char *ROUND_TRIP_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "rnbqkbnr/pppp1p2/7p/4pPp1/4P3/8/PPPP2PP/RNBQKBNR w KQkq g6 0 4",
+    "rnbqkbnr/pppp1ppp/4p3/8/8/5N2/PPPPPPPP/RNBQKBR1 b Qkq - 1 2",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "4k3/8/8/8/8/8/8/4K3 b - - 99 120",
+};
+
+// Applies a UCI move string and checks the resulting FEN
+static void play(Position *pos, const char *uci, const char *expected_fen) {
+    int from = square_from_string(uci);
+    int to = square_from_string(uci + 2);
+    int promotion = PAWN;
+    if (uci[4] != '\0') {
+        promotion = PIECE_TYPE(piece_from_char(uci[4]));
+    }
+    ChessMove move = position_encode_move(pos, from, to, promotion);
+    assert(move != NULL_MOVE);
+    position_make_move(pos, move);
+
+    char fen[100];
+    assert(position_to_fen(pos, fen));
+    if (strcmp(fen, expected_fen) != 0) {
+        printf("after %s expected %s\n          got %s\n", uci, expected_fen, fen);
+    }
+    assert(strcmp(fen, expected_fen) == 0);
+
+    // The incremental key matches the key of the same position parsed fresh
+    Position parsed;
+    assert(position_from_fen(expected_fen, &parsed));
+    assert(pos->key == parsed.key);
+}
+
+void test_layout() {
+    printf("Testing Position layout...\n");
+    assert(sizeof(Position) <= 128);
+    printf("✓ sizeof(Position) = %zu bytes\n", sizeof(Position));
+}
+
+void test_round_trip() {
+    printf("Testing FEN_Board <-> Position round trip...\n");
+    for (size_t i = 0; i < sizeof(ROUND_TRIP_FENS) / sizeof(ROUND_TRIP_FENS[0]); i++) {
+        FEN_Board *board = create_fen_board((char *)ROUND_TRIP_FENS[i]);
+        assert(board != NULL);
+        Position pos;
+        assert(position_from_fen_board(board, &pos));
+
+        FEN_Board back;
+        assert(position_to_fen_board(&pos, &back));
+        assert(memcmp(back.board, board->board, sizeof(back.board)) == 0);
+        assert(strcmp(back.castling_rights, board->castling_rights) == 0);
+        assert(back.en_passant_square_file == board->en_passant_square_file);
+        assert(back.en_passant_square_rank == board->en_passant_square_rank);
+
+        char fen[100];
+        assert(fen_board_to_fen_string(&back, fen));
+        assert(strcmp(fen, ROUND_TRIP_FENS[i]) == 0);
+        printf("✓ %s\n", fen);
+        free(board);
+    }
+}
+
+void test_write_fen() {
+    printf("Testing direct FEN encoder against the FEN_Board path...\n");
+    for (size_t i = 0; i < sizeof(ROUND_TRIP_FENS) / sizeof(ROUND_TRIP_FENS[0]); i++) {
+        Position pos;
+        assert(position_from_fen(ROUND_TRIP_FENS[i], &pos));
+
+        char legacy[100];
+        FEN_Board board;
+        assert(position_to_fen_board(&pos, &board));
+        assert(fen_board_to_fen_string(&board, legacy));
+
+        char out[FEN_MAX_LENGTH + 1];
+        memset(out, '#', sizeof(out));
+        size_t length = position_write_fen(&pos, out);
+        assert(length == strlen(legacy) && memcmp(out, legacy, length) == 0);
+        assert(out[length] == '#');
+    }
+
+    // Alternating pieces and single empties, all rights, three-digit clocks.
+    // Not a legal position, so the FEN parser rejects it: set the board up
+    // square by square instead.
+    const char *longest = "r1b1k1n1/1p1p1p1p/p1p1p1p1/1P1P1P1P/P1P1P1P1/1p1p1p1p/P1P1P1P1/R1B1K1N1 w KQkq - 999 999";
+    Position pos;
+    assert(!position_from_fen(longest, &pos));
+    FEN_Board board = {.side_to_move = 0, .castling_rights = "KQkq", .en_passant_square_file = -1,
+                       .en_passant_square_rank = -1, .halfmove_clock = 999, .fullmove_number = 999};
+    for (int square = 0; square < 64; square++) {
+        const char *rank = longest + 9 * (7 - square / 8);
+        board.board[square / 8][square % 8] = rank[square % 8] == '1' ? ' ' : rank[square % 8];
+    }
+    assert(position_from_fen_board(&board, &pos));
+    char out[FEN_MAX_LENGTH + 1];
+    size_t length = position_write_fen(&pos, out);
+    assert(length <= FEN_MAX_LENGTH && memcmp(out, longest, length) == 0);
+    printf("✓ Byte-identical to fen_board_to_fen_string, no terminator written\n");
+}
+
+void test_start_position() {
+    printf("Testing start position...\n");
+    Position pos, parsed;
+    position_set_start(&pos);
+    FEN_Board *board = generate_starting_position_fen();
+    assert(position_from_fen_board(board, &parsed));
+    assert(memcmp(&pos, &parsed, sizeof(pos)) == 0);
+    assert(bitboard_count(position_occupied(&pos)) == 32);
+    assert(position_piece_at(&pos, square_from_string("e1")) == WHITE_KING);
+    assert(position_piece_at(&pos, square_from_string("d8")) == BLACK_QUEEN);
+    assert(position_piece_at(&pos, square_from_string("e4")) == NO_PIECE);
+    printf("✓ position_set_start matches the parsed start FEN\n");
+    free(board);
+}
+
+void test_make_move_castling() {
+    printf("Testing make_move with castling...\n");
+    Position pos;
+    position_set_start(&pos);
+    play(&pos, "e2e4", "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+    play(&pos, "e7e5", "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq e6 0 2");
+    play(&pos, "g1f3", "rnbqkbnr/pppp1ppp/8/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2");
+    play(&pos, "b8c6", "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+    play(&pos, "f1c4", "r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 3 3");
+    play(&pos, "f8c5", "r1bqk1nr/pppp1ppp/2n5/2b1p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4");
+    play(&pos, "e1g1", "r1bqk1nr/pppp1ppp/2n5/2b1p3/2B1P3/5N2/PPPP1PPP/RNBQ1RK1 b kq - 5 4");
+    printf("✓ Kingside castling moves the rook and clears white's rights\n");
+
+    assert(position_from_fen("r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1", &pos));
+    play(&pos, "e8c8", "2kr3r/8/8/8/8/8/8/R3K2R w KQ - 1 2");
+    play(&pos, "h1h8", "2kr3R/8/8/8/8/8/8/R3K3 b Q - 0 2");
+    printf("✓ Queenside castling and rook moves update rights\n");
+}
+
+void test_make_move_en_passant_and_promotion() {
+    printf("Testing make_move with en passant and promotion...\n");
+    Position pos;
+    assert(position_from_fen("rnbqkbnr/pppp1p2/7p/4pPp1/4P3/8/PPPP2PP/RNBQKBNR w KQkq g6 0 4", &pos));
+    play(&pos, "f5g6", "rnbqkbnr/pppp1p2/6Pp/4p3/4P3/8/PPPP2PP/RNBQKBNR b KQkq - 0 4");
+    printf("✓ En passant removes the captured pawn\n");
+
+    assert(position_from_fen("r3k3/1P6/8/8/8/8/6p1/4K2R w Kq - 0 1", &pos));
+    play(&pos, "b7a8n", "N3k3/8/8/8/8/8/6p1/4K2R b K - 0 1");
+    play(&pos, "g2h1q", "N3k3/8/8/8/8/8/8/4K2q w - - 0 2");
+    printf("✓ Capturing promotions replace the pawn and clear castling rights\n");
+
+    assert(position_from_fen("4k3/1P6/8/8/8/8/8/4K3 w - - 0 1", &pos));
+    play(&pos, "b7b8q", "1Q2k3/8/8/8/8/8/8/4K3 b - - 0 1");
+    printf("✓ Quiet promotion\n");
+}
+
+static uint64_t key_after(const char *moves) {
+    Position pos;
+    position_set_start(&pos);
+    for (const char *uci = moves; *uci != '\0'; uci += uci[4] == ' ' ? 5 : 4) {
+        ChessMove move = position_encode_move(&pos, square_from_string(uci), square_from_string(uci + 2), PAWN);
+        assert(move != NULL_MOVE);
+        position_make_move(&pos, move);
+    }
+    return pos.key;
+}
+
+void test_zobrist_key() {
+    printf("Testing Zobrist keys...\n");
+    Position start;
+    position_set_start(&start);
+    assert(start.key != 0 && start.key == position_compute_key(&start));
+
+    // Transpositions reach the same key, knight tours back to the start too
+    assert(key_after("g1f3 g8f6 b1c3 b8c6") == key_after("b1c3 b8c6 g1f3 g8f6"));
+    assert(key_after("g1f3 g8f6 f3g1 f6g8") == start.key);
+    assert(key_after("e2e3 e7e6 g1f3") == key_after("g1f3 e7e6 e2e3"));
+    // ...unless one order ends on a double push, which leaves an en passant square
+    assert(key_after("e2e4 e7e5 g1f3") != key_after("g1f3 e7e5 e2e4"));
+
+    // Side to move, en passant and castling rights all change the key
+    Position a, b;
+    assert(position_from_fen("4k3/8/8/8/8/8/8/4K3 w - - 0 1", &a));
+    assert(position_from_fen("4k3/8/8/8/8/8/8/4K3 b - - 0 1", &b));
+    assert(a.key != b.key);
+    assert(position_from_fen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", &a));
+    assert(position_from_fen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1", &b));
+    assert(a.key != b.key);
+    assert(position_from_fen("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1", &a));
+    assert(position_from_fen("r3k2r/8/8/8/8/8/8/R3K2R w Kkq - 0 1", &b));
+    assert(a.key != b.key);
+    // Clocks do not
+    assert(position_from_fen("r3k2r/8/8/8/8/8/8/R3K2R w Kkq - 17 40", &a));
+    assert(a.key == b.key);
+    printf("✓ Incremental keys match fresh ones, transpositions agree\n");
+}
+
+int main() {
+    printf("=== Position Test Suite ===\n\n");
+
+    test_layout();
+    test_round_trip();
+    test_write_fen();
+    test_start_position();
+    test_make_move_castling();
+    test_make_move_en_passant_and_promotion();
+    test_zobrist_key();
+
+    printf("🎉 All tests passed successfully!\n");
+    return 0;
+}
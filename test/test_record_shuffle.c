@@ -0,0 +1,258 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../include/attacks.h"
+#include "../include/fen_record.h"
+#include "../include/pipeline.h"
+#include "../include/record_shuffle.h"
+#include "../include/shard_writer.h"
+#include "test_util.h"
+
+#define CORPUS_PATH "obj/test_record_shuffle.pgn"
+#define RECORD_PATH "obj/test_record_shuffle.fenrec"
+#define SHARD_DIR "obj/test_record_shuffle_shards"
+#define SPLIT_DIR "obj/test_record_shuffle_out"
+
+#define COPIES 40
+#define GAMES (3 * COPIES)
+#define PLIES ((61 + 108 + 37) * COPIES)
+#define MAX_SHARDS 64
+
+// A record with its time control spelled out, since ids are per file
+typedef struct {
+    FEN_Record record;
+    char time_control[32];
+} Named_Record;
+
+// Every record of a file, raw or compressed, in file order
+static size_t read_records(const char *path, Named_Record *out, size_t capacity) {
+    FEN_Record_File *file = fen_record_open(path);
+    assert(file != NULL);
+    size_t count = (size_t)fen_record_count(file);
+    assert(count <= capacity);
+    FEN_Record *records = malloc((count + 1) * sizeof(FEN_Record));
+    size_t at = 0;
+    for (size_t b = 0; b < fen_record_block_count(file); b++) {
+        size_t n = fen_record_read_block(file, b, records + at);
+        assert(n == fen_record_block_records(file, b));
+        at += n;
+    }
+    assert(at == count);
+    for (size_t i = 0; i < count; i++) {
+        memset(&out[i], 0, sizeof(out[i]));
+        out[i].record = records[i];
+        size_t length;
+        const char *name = fen_record_file_time_control(file, records[i].time_control, &length);
+        assert(name != NULL && length < sizeof(out[i].time_control));
+        memcpy(out[i].time_control, name, length);
+    }
+    free(records);
+    fen_record_close(file);
+    return count;
+}
+
+static int compare_named(const void *a, const void *b) {
+    return memcmp(a, b, sizeof(Named_Record));
+}
+
+static void run_pipeline(const char *output_dir) {
+    Pipeline_Options options;
+    // Raw shards, so that there are several of them
+    format_options(&options, PIPELINE_FORMAT_RECORDS, output_dir != NULL ? 0 : 3, 0);
+    options.output_dir = output_dir;
+    options.shard_bytes = 32 * 1024;
+    Pipeline_Stats stats = run_pipeline_ok(CORPUS_PATH, output_dir == NULL ? RECORD_PATH : NULL, &options);
+    assert(stats.plies == PLIES);
+}
+
+static void shuffle(const char *const *inputs, int count, const Record_Shuffle_Options *options,
+                    Named_Record *splits[RECORD_SHUFFLE_SPLITS], size_t sizes[RECORD_SHUFFLE_SPLITS]) {
+    Record_Shuffle_Stats stats;
+    bool ok = record_shuffle_run(inputs, count, SPLIT_DIR, options, &stats);
+    if (!ok) {
+        printf("shuffle failed: %s\n", stats.error);
+    }
+    assert(ok);
+    assert(stats.input_records == PLIES);
+    for (int split = 0; split < RECORD_SHUFFLE_SPLITS; split++) {
+        char path[256];
+        snprintf(path, sizeof(path), SPLIT_DIR "/%s.fenrec", RECORD_SHUFFLE_SPLIT_NAMES[split]);
+        splits[split] = malloc((PLIES + 1) * sizeof(Named_Record));
+        sizes[split] = read_records(path, splits[split], PLIES);
+        assert(sizes[split] == stats.records[split]);
+    }
+}
+
+static void free_splits(Named_Record *splits[RECORD_SHUFFLE_SPLITS]) {
+    for (int split = 0; split < RECORD_SHUFFLE_SPLITS; split++) {
+        free(splits[split]);
+    }
+}
+
+static bool same_splits(Named_Record *a[RECORD_SHUFFLE_SPLITS], size_t a_sizes[RECORD_SHUFFLE_SPLITS],
+                        Named_Record *b[RECORD_SHUFFLE_SPLITS], size_t b_sizes[RECORD_SHUFFLE_SPLITS]) {
+    for (int split = 0; split < RECORD_SHUFFLE_SPLITS; split++) {
+        if (a_sizes[split] != b_sizes[split] ||
+            memcmp(a[split], b[split], a_sizes[split] * sizeof(Named_Record)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_shuffle() {
+    printf("Testing the shuffle of a record file...\n");
+    write_artifact_corpus(CORPUS_PATH, COPIES);
+    run_pipeline(NULL);
+    Named_Record *input = malloc((PLIES + 1) * sizeof(Named_Record));
+    assert(read_records(RECORD_PATH, input, PLIES) == PLIES);
+    mkdir(SPLIT_DIR, 0755);
+
+    Record_Shuffle_Options options;
+    record_shuffle_default_options(&options);
+    options.threads = 0;
+    options.val_fraction = 0.1;
+    options.test_fraction = 0.1;
+    const char *inputs[1] = {RECORD_PATH};
+    Named_Record *splits[RECORD_SHUFFLE_SPLITS];
+    size_t sizes[RECORD_SHUFFLE_SPLITS];
+    shuffle(inputs, 1, &options, splits, sizes);
+
+    // The same records, each game in the split its index hashes to
+    Named_Record *all = malloc((PLIES + 1) * sizeof(Named_Record));
+    size_t total = 0;
+    int games_in[RECORD_SHUFFLE_SPLITS] = {0};
+    bool seen[GAMES] = {false};
+    for (int split = 0; split < RECORD_SHUFFLE_SPLITS; split++) {
+        for (size_t i = 0; i < sizes[split]; i++) {
+            uint32_t game = splits[split][i].record.game;
+            assert(game < GAMES);
+            assert(record_shuffle_split(game, &options) == split);
+            if (!seen[game]) {
+                seen[game] = true;
+                games_in[split]++;
+            }
+        }
+        memcpy(all + total, splits[split], sizes[split] * sizeof(Named_Record));
+        total += sizes[split];
+    }
+    assert(total == PLIES);
+    assert(games_in[RECORD_SHUFFLE_TRAIN] > 0 && games_in[RECORD_SHUFFLE_VAL] > 0 &&
+           games_in[RECORD_SHUFFLE_TEST] > 0);
+    Named_Record *sorted = malloc((PLIES + 1) * sizeof(Named_Record));
+    memcpy(sorted, input, PLIES * sizeof(Named_Record));
+    qsort(sorted, PLIES, sizeof(Named_Record), compare_named);
+    qsort(all, PLIES, sizeof(Named_Record), compare_named);
+    assert(memcmp(sorted, all, PLIES * sizeof(Named_Record)) == 0);
+
+    // Shuffled: neighbours in the output rarely come from the same game
+    size_t same_game = 0;
+    for (size_t i = 1; i < sizes[RECORD_SHUFFLE_TRAIN]; i++) {
+        same_game += splits[RECORD_SHUFFLE_TRAIN][i].record.game == splits[RECORD_SHUFFLE_TRAIN][i - 1].record.game;
+    }
+    assert(same_game * 20 < sizes[RECORD_SHUFFLE_TRAIN]);
+    printf("✓ %d records into %zu/%zu/%zu (games %d/%d/%d), none lost or leaked across splits\n", PLIES,
+           sizes[0], sizes[1], sizes[2], games_in[0], games_in[1], games_in[2]);
+
+    // Threads, buckets, memory and block layout do not change the order
+    Record_Shuffle_Options other = options;
+    other.threads = 3;
+    other.buckets = 7;
+    other.compression_level = 0;
+    other.block_records = 100;
+    other.memory = 256 * 1024;
+    Named_Record *again[RECORD_SHUFFLE_SPLITS];
+    size_t again_sizes[RECORD_SHUFFLE_SPLITS];
+    shuffle(inputs, 1, &other, again, again_sizes);
+    assert(same_splits(splits, sizes, again, again_sizes));
+    free_splits(again);
+    printf("✓ Same order with 3 threads, 7 buckets per split, raw 100-record blocks\n");
+
+    // The shards of a sharded run, read in order, are the same input
+    mkdir(SHARD_DIR, 0755);
+    run_pipeline(SHARD_DIR);
+    char paths[MAX_SHARDS][256];
+    const char *shards[MAX_SHARDS];
+    int shard_count = 0;
+    for (; shard_count < MAX_SHARDS; shard_count++) {
+        shard_path(SHARD_DIR, (uint64_t)shard_count, ".fenrec", paths[shard_count], sizeof(paths[shard_count]));
+        if (access(paths[shard_count], F_OK) != 0) {
+            break;
+        }
+        shards[shard_count] = paths[shard_count];
+    }
+    assert(shard_count > 1);
+    shuffle(shards, shard_count, &options, again, again_sizes);
+    assert(same_splits(splits, sizes, again, again_sizes));
+    free_splits(again);
+    printf("✓ Same order from %d shards, time controls merged by name\n", shard_count);
+
+    // Another seed, another order and another split
+    other = options;
+    other.seed = 2;
+    shuffle(inputs, 1, &other, again, again_sizes);
+    assert(!same_splits(splits, sizes, again, again_sizes));
+    free_splits(again);
+    printf("✓ Another seed gives another order\n");
+
+    for (int i = 0; i < shard_count; i++) {
+        remove(paths[i]);
+    }
+    remove(SHARD_DIR "/" SHARD_CHECKPOINT_NAME);
+    rmdir(SHARD_DIR);
+    free_splits(splits);
+    free(input);
+    free(all);
+    free(sorted);
+}
+
+void test_errors() {
+    printf("Testing shuffle errors...\n");
+    Record_Shuffle_Options options;
+    record_shuffle_default_options(&options);
+    options.threads = 0;
+    Record_Shuffle_Stats stats;
+    const char *missing[1] = {"obj/does_not_exist.fenrec"};
+    assert(!record_shuffle_run(missing, 1, SPLIT_DIR, &options, &stats));
+    assert(strstr(stats.error, "does_not_exist") != NULL);
+    const char *inputs[1] = {RECORD_PATH};
+    options.val_fraction = 0.6;
+    options.test_fraction = 0.6;
+    assert(!record_shuffle_run(inputs, 1, SPLIT_DIR, &options, &stats));
+    options.val_fraction = 0.1;
+    options.test_fraction = 0.1;
+    assert(!record_shuffle_run(inputs, 1, "obj/no_such_dir", &options, &stats));
+    assert(strstr(stats.error, "no_such_dir") != NULL);
+    // 1024 buckets per split leave each scatter buffer a handful of entries
+    options.buckets = 1024;
+    options.memory = 64 * 1024;
+    assert(!record_shuffle_run(inputs, 1, SPLIT_DIR, &options, &stats));
+    assert(strstr(stats.error, "memory ceiling") != NULL);
+    printf("✓ Missing inputs, bad fractions, a missing output directory and too little memory are reported\n");
+}
+
+int main() {
+    printf("=== Record Shuffle Test Suite ===\n\n");
+    attacks_init();
+
+    test_shuffle();
+    test_errors();
+
+    for (int split = 0; split < RECORD_SHUFFLE_SPLITS; split++) {
+        char path[256];
+        snprintf(path, sizeof(path), SPLIT_DIR "/%s.fenrec", RECORD_SHUFFLE_SPLIT_NAMES[split]);
+        remove(path);
+    }
+    rmdir(SPLIT_DIR);
+    remove(CORPUS_PATH);
+    remove(RECORD_PATH);
+    printf("🎉 All tests passed successfully!\n");
+    return 0;
+}
@@ -0,0 +1,349 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include "../include/fen_utils.h"
+#include "../include/position.h"
+#include "../include/attacks.h"
+#include "../include/san.h"
+#include "../include/san_cache.h"
+
+#define ARTIFACT_DIR "src_python/test/test_artifacts/"
+
+// Resolves san in fen and checks the UCI result
+static void expect_uci(const char *fen, const char *san, const char *expected_uci) {
+    Position pos;
+    assert(position_from_fen(fen, &pos));
+    ChessMove move;
+    enum SanStatus status = san_to_move(&pos, san, strlen(san), &move);
+    if (status != SAN_OK) {
+        printf("%s in %s: %s\n", san, fen, san_status_string(status));
+    }
+    assert(status == SAN_OK);
+    char uci[6];
+    move_to_uci(move, uci);
+    if (strcmp(uci, expected_uci) != 0) {
+        printf("%s in %s: expected %s got %s\n", san, fen, expected_uci, uci);
+    }
+    assert(strcmp(uci, expected_uci) == 0);
+}
+
+static void expect_status(const char *fen, const char *san, enum SanStatus expected) {
+    Position pos;
+    assert(position_from_fen(fen, &pos));
+    ChessMove move;
+    assert(san_to_move(&pos, san, strlen(san), &move) == expected);
+}
+
+void test_simple_moves() {
+    printf("Testing simple moves...\n");
+    const char *start = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    expect_uci(start, "e4", "e2e4");
+    expect_uci(start, "e3", "e2e3");
+    expect_uci(start, "Nf3", "g1f3");
+    expect_uci(start, "Nc3", "b1c3");
+    expect_uci("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", "d5", "d7d5");
+    printf("✓ Pawn pushes and knight moves\n");
+
+    const char *open = "rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2";
+    expect_uci(open, "exd5", "e4d5");
+    expect_uci(open, "Bb5+", "f1b5");
+    expect_uci(open, "Qh5!?", "d1h5");
+    expect_uci(open, "Ke2", "e1e2");
+    printf("✓ Captures, suffixes and king moves\n");
+}
+
+void test_disambiguation() {
+    printf("Testing disambiguation...\n");
+    const char *knights = "r1bqkb1r/ppp1pppp/5n2/8/8/8/PPPPPPPP/RNBQKBNR b KQkq - 0 1";
+    expect_uci("rnbqkb1r/ppp1pppp/5n2/8/8/8/PPPPPPPP/RNBQKBNR b KQkq - 0 1", "Nbd7", "b8d7");
+    expect_uci("rnbqkb1r/ppp1pppp/5n2/8/8/8/PPPPPPPP/RNBQKBNR b KQkq - 0 1", "Nfd5", "f6d5");
+    expect_status(knights, "Nd7", SAN_OK);
+    expect_status("rnbqkb1r/ppp1pppp/5n2/8/8/8/PPPPPPPP/RNBQKBNR b KQkq - 0 1", "Nd7", SAN_AMBIGUOUS);
+    printf("✓ File disambiguation\n");
+
+    expect_uci("4k3/8/8/8/8/4R3/8/K3R3 w - - 0 1", "R1e2", "e1e2");
+    expect_uci("4k3/8/8/8/8/4R3/8/K3R3 w - - 0 1", "R3e2", "e3e2");
+    printf("✓ Rank disambiguation\n");
+
+    expect_uci("4k3/8/8/8/4Q2Q/8/8/K6Q w - - 0 1", "Qh4e1", "h4e1");
+    expect_uci("4k3/8/8/8/4Q2Q/8/8/K6Q w - - 0 1", "Qe4e1", "e4e1");
+    expect_uci("4k3/8/8/8/4Q2Q/8/8/K6Q w - - 0 1", "Qh1e1", "h1e1");
+    printf("✓ Full square disambiguation\n");
+
+    // The f3 knight is pinned along the third rank, so Nd2 means Nb1-d2
+    expect_uci("4k3/8/8/8/8/r4N1K/8/1N6 w - - 0 1", "Nd2", "b1d2");
+    expect_status("4k3/8/8/8/8/5N1K/8/1N6 w - - 0 1", "Nd2", SAN_AMBIGUOUS);
+    printf("✓ Pins break ties between candidates\n");
+}
+
+void test_special_moves() {
+    printf("Testing castling, promotion and en passant...\n");
+    const char *castle = "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1";
+    expect_uci(castle, "O-O", "e1g1");
+    expect_uci(castle, "O-O-O", "e1c1");
+    expect_uci(castle, "0-0+", "e1g1");
+    expect_uci("r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1", "O-O-O", "e8c8");
+    expect_status("r3k2r/8/8/8/8/8/8/R3K2R w Qkq - 0 1", "O-O", SAN_NO_PIECE);
+    printf("✓ Castling\n");
+
+    const char *promo = "3qk3/2P5/8/8/8/8/5p2/4K1N1 w - - 0 1";
+    expect_uci(promo, "c8=Q", "c7c8q");
+    expect_uci(promo, "cxd8=N+", "c7d8n");
+    expect_uci(promo, "c8R", "c7c8r");
+    expect_uci("3qk3/2P5/8/8/8/8/5p2/4K1N1 b - - 0 1", "fxg1=Q", "f2g1q");
+    expect_uci("3qk3/2P5/8/8/8/8/5p2/4K1N1 b - - 0 1", "f1=B+", "f2f1b");
+    expect_status(promo, "c8", SAN_SYNTAX_ERROR);
+    printf("✓ Promotions\n");
+
+    expect_uci("rnbqkbnr/pppp1p2/7p/4pPp1/4P3/8/PPPP2PP/RNBQKBNR w KQkq g6 0 4", "fxg6", "f5g6");
+    printf("✓ En passant\n");
+}
+
+void test_errors() {
+    printf("Testing invalid moves...\n");
+    const char *start = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    expect_status(start, "e5", SAN_NO_PIECE);
+    expect_status(start, "Ke2", SAN_NO_PIECE);
+    expect_status(start, "Nd2", SAN_NO_PIECE);
+    expect_status(start, "Z4", SAN_SYNTAX_ERROR);
+    expect_status(start, "e9", SAN_SYNTAX_ERROR);
+    expect_status(start, "", SAN_SYNTAX_ERROR);
+    expect_status(start, "O-O-", SAN_SYNTAX_ERROR);
+    printf("✓ Invalid moves are rejected\n");
+}
+
+void test_legacy_api() {
+    printf("Testing translate_san_to_uci and find_move_starting_position_of_piece...\n");
+    FEN_Board *board = generate_starting_position_fen();
+    Move *move = get_move_from_san("Nf3");
+    assert(translate_san_to_uci(move, board));
+    assert(strcmp(move_type_string(move), "uci") == 0);
+    char text[MOVE_TEXT_MAX];
+    assert(move_format_uci(move, text) == 4);
+    assert(strcmp(text, "g1f3") == 0);
+    assert(move_player(move) == 'w');
+    free(move);
+
+    move = get_move_from_san("Nf6");
+    assert(!translate_san_to_uci(move, board));
+    free(move);
+
+    char from[3];
+    assert(find_move_starting_position_of_piece('P', board, "e4", from));
+    assert(strcmp(from, "e2") == 0);
+    assert(find_move_starting_position_of_piece('n', board, "c6", from));
+    assert(strcmp(from, "b8") == 0);
+    assert(!find_move_starting_position_of_piece('Q', board, "d4", from));
+    printf("✓ Legacy FEN_Board API resolves moves\n");
+    free(board);
+}
+
+// Packs san without a board and checks it formats back as expected
+static void expect_san_round_trip(const char *san, const char *expected) {
+    Move move;
+    char text[MOVE_TEXT_MAX];
+    assert(move_parse_san(san, strlen(san), &move));
+    assert(move_tag(&move) == MOVE_TAG_SAN);
+    move_format_san(&move, text);
+    if (strcmp(text, expected) != 0) {
+        printf("%s formats as %s, expected %s\n", san, text, expected);
+        assert(false);
+    }
+}
+
+void test_packed_moves() {
+    printf("Testing packed moves...\n");
+    assert(sizeof(Move) == 4);
+    expect_san_round_trip("e4", "e4");
+    expect_san_round_trip("Nbxd7+", "Nbxd7+");
+    expect_san_round_trip("R1e2", "R1e2");
+    expect_san_round_trip("Qh4xe1#", "Qh4xe1#");
+    expect_san_round_trip("exd8=Q+", "exd8=Q+");
+    expect_san_round_trip("e8Q", "e8=Q");
+    expect_san_round_trip("ed5", "exd5");
+    expect_san_round_trip("0-0-0", "O-O-O");
+    expect_san_round_trip("Nf3!?", "Nf3");
+
+    Move move;
+    const char *invalid[] = {"", "e", "e9", "Zf3", "O-O-", "Nf3x", "Naaa3", "--"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        assert(!move_parse_san(invalid[i], strlen(invalid[i]), &move));
+    }
+    assert(!move_parse_uci("e2e9", 4, &move));
+    assert(!move_parse_uci("e7e8k", 5, &move));
+
+    // Resolving fills in the origin and special-move bits and keeps the SAN
+    char text[MOVE_TEXT_MAX];
+    FEN_Board *board = create_fen_board("r3k2r/1P6/8/3pP3/8/8/8/R3K2R w KQkq d6 0 1");
+    const char *cases[][2] = {
+        {"exd6", "e5d6"}, {"bxa8=N", "b7a8n"}, {"O-O-O", "e1c1"}, {"Rxa8+", "a1a8"},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        assert(move_parse_san(cases[i][0], strlen(cases[i][0]), &move));
+        assert(move_format_uci(&move, text) == 0);
+        assert(translate_san_to_uci(&move, board));
+        assert(move_tag(&move) == MOVE_TAG_UCI);
+        move_format_uci(&move, text);
+        assert(strcmp(text, cases[i][1]) == 0);
+        move_format_san(&move, text);
+        assert(strcmp(text, cases[i][0]) == 0);
+    }
+    free(board);
+
+    assert(move_parse_uci("g1f3", 4, &move));
+    assert(move_format_san(&move, text) == 0);
+    assert(move_player(&move) == '?');
+    move_set_player(&move, 'b');
+    assert(move_player(&move) == 'b');
+    assert(move_format_uci(&move, text) == 4 && strcmp(text, "g1f3") == 0);
+    printf("✓ Moves pack into 4 bytes and format back as SAN and UCI\n");
+}
+
+// Replays a test artifact game move by move, formatting every resolved move
+// back to SAN and comparing it with the original token.
+static int replay_game(const char *path) {
+    FILE *f = fopen(path, "rb");
+    assert(f != NULL);
+    char text[4096];
+    size_t len = fread(text, 1, sizeof(text) - 1, f);
+    text[len] = '\0';
+    fclose(f);
+
+    char *movetext = strstr(text, "\n1. ");
+    assert(movetext != NULL);
+
+    Position pos;
+    position_set_start(&pos);
+    int plies = 0;
+    char *save;
+    for (char *token = strtok_r(movetext, " \n", &save); token; token = strtok_r(NULL, " \n", &save)) {
+        if ((token[0] >= '0' && token[0] <= '9') || token[0] == '*') {
+            continue; // move number or result
+        }
+        ChessMove move;
+        assert(san_to_move(&pos, token, strlen(token), &move) == SAN_OK);
+
+        char san[16];
+        size_t san_len = san_from_move(&pos, move, san);
+        size_t token_len = strlen(token);
+        if (token[token_len - 1] == '#') token_len--;
+        if (san[san_len - 1] == '+') san_len--;
+        if (token[token_len - 1] == '+') token_len--;
+        assert(san_len == token_len && memcmp(san, token, san_len) == 0);
+
+        position_make_move(&pos, move);
+        plies++;
+    }
+    return plies;
+}
+
+void test_artifact_games() {
+    printf("Testing test artifact games...\n");
+    assert(replay_game(ARTIFACT_DIR "game_1.pgn") == 61);
+    assert(replay_game(ARTIFACT_DIR "game_2.pgn") == 108);
+    assert(replay_game(ARTIFACT_DIR "game_3.pgn") == 37);
+    printf("✓ All moves resolve and format back to the same SAN\n");
+}
+
+// Resolves san through the cache and checks it agrees with san_to_move
+static enum San_Cache_Lookup cached_lookup(San_Cache *cache, const Position *pos, const char *san) {
+    ChessMove cached, direct;
+    enum San_Cache_Lookup lookup;
+    enum SanStatus status = san_cache_resolve(cache, pos, san, strlen(san), &cached, &lookup);
+    assert(status == san_to_move(pos, san, strlen(san), &direct));
+    assert(status != SAN_OK || cached == direct);
+    return lookup;
+}
+
+void test_san_cache() {
+    printf("Testing the SAN cache...\n");
+    San_Cache cache;
+    assert(!san_cache_init(&cache, sizeof(San_Cache_Entry)));
+    assert(san_cache_init(&cache, 4096 + 100));
+    assert(san_cache_memory(&cache) == 4096);
+
+    Position start;
+    position_set_start(&start);
+    assert(cached_lookup(&cache, &start, "e4") == SAN_CACHE_MISS);
+    assert(cached_lookup(&cache, &start, "e4") == SAN_CACHE_HIT);
+    assert(cached_lookup(&cache, &start, "e4!?") == SAN_CACHE_HIT);
+    assert(cached_lookup(&cache, &start, "Nf3") == SAN_CACHE_MISS);
+    assert(cached_lookup(&cache, &start, "Nf3") == SAN_CACHE_HIT);
+    // Errors are not stored
+    assert(cached_lookup(&cache, &start, "e5") == SAN_CACHE_MISS);
+    assert(cached_lookup(&cache, &start, "e5") == SAN_CACHE_MISS);
+    assert(cached_lookup(&cache, &start, "Nf3xe5") == SAN_CACHE_MISS);
+    assert(cached_lookup(&cache, &start, "Ng1xe5xx") == SAN_CACHE_BYPASS);
+    assert(cached_lookup(NULL, &start, "e4") == SAN_CACHE_BYPASS);
+
+    // Same token, different position: the side to move is in the key
+    Position black;
+    assert(position_from_fen("rnbqkbnr/pppppppp/8/8/8/5N2/PPPPPPPP/RNBQKB1R b KQkq - 1 1", &black));
+    assert(cached_lookup(&cache, &black, "Nf6") == SAN_CACHE_MISS);
+    assert(cached_lookup(&cache, &black, "Nf6") == SAN_CACHE_HIT);
+
+    // Past the opening, positions are resolved without looking
+    Position late = start;
+    late.fullmove_number = SAN_CACHE_MAX_MOVE + 1;
+    assert(cached_lookup(&cache, &late, "e4") == SAN_CACHE_BYPASS);
+
+    // Three games played twice: the second time every opening move hits
+    san_cache_free(&cache);
+    assert(san_cache_init(&cache, SAN_CACHE_DEFAULT_MEMORY));
+    const char *names[3] = {"game_1.pgn", "game_2.pgn", "game_3.pgn"};
+    int lookups[3] = {0};
+    for (int round = 0; round < 2; round++) {
+        for (int g = 0; g < 3; g++) {
+            char path[256];
+            snprintf(path, sizeof(path), ARTIFACT_DIR "%s", names[g]);
+            FILE *f = fopen(path, "rb");
+            assert(f != NULL);
+            char text[4096];
+            size_t len = fread(text, 1, sizeof(text) - 1, f);
+            text[len] = '\0';
+            fclose(f);
+            Position pos;
+            position_set_start(&pos);
+            char *save;
+            char *movetext = strstr(text, "\n1. ");
+            for (char *token = strtok_r(movetext, " \n", &save); token; token = strtok_r(NULL, " \n", &save)) {
+                if ((token[0] >= '0' && token[0] <= '9') || token[0] == '*') {
+                    continue;
+                }
+                ChessMove move;
+                enum San_Cache_Lookup lookup;
+                assert(san_cache_resolve(&cache, &pos, token, strlen(token), &move, &lookup) == SAN_OK);
+                if (pos.fullmove_number > SAN_CACHE_MAX_MOVE) {
+                    assert(lookup == SAN_CACHE_BYPASS);
+                } else {
+                    assert(round == 0 || lookup == SAN_CACHE_HIT);
+                }
+                lookups[lookup]++;
+                position_make_move(&pos, move);
+            }
+        }
+    }
+    assert(lookups[SAN_CACHE_HIT] > lookups[SAN_CACHE_MISS]);
+    san_cache_free(&cache);
+    printf("✓ Opening moves come back from the cache, equal to san_to_move\n");
+}
+
+int main() {
+    printf("=== SAN Resolver Test Suite ===\n\n");
+    attacks_init();
+
+    test_simple_moves();
+    test_disambiguation();
+    test_special_moves();
+    test_errors();
+    test_legacy_api();
+    test_packed_moves();
+    test_artifact_games();
+    test_san_cache();
+
+    printf("🎉 All tests passed successfully!\n");
+    return 0;
+}
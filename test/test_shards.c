@@ -0,0 +1,411 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+#include "../include/fen_plus.h"
+#include "../include/fen_record.h"
+#include "../include/pgn_index.h"
+#include "../include/pgn_stream.h"
+#include "../include/pipeline.h"
+#include "../include/shard_writer.h"
+#include "test_util.h"
+
+#define PLAIN_PATH "obj/test_shards.pgn"
+#define FRAME_PATH "obj/test_shards.pgn.zst"
+#define SEEKABLE_PATH "obj/test_shards_seekable.pgn.zst"
+#define OUTPUT_PATH "obj/test_shards.csv"
+#define SHARD_DIR "obj/test_shards_output"
+#define COPIES 40
+#define GAMES (3 * COPIES)
+
+static bool file_exists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+// Removes the shards, their temporary files and the checkpoint
+static void clear_shard_dir(void) {
+    char path[256];
+    mkdir(SHARD_DIR, 0755);
+    for (int i = 0; i < 1000; i++) {
+        const char *extensions[4] = {".csv", ".csv.zst", ".fenrec", ".fenrec.tmp"};
+        for (int e = 0; e < 4; e++) {
+            shard_path(SHARD_DIR, (uint64_t)i, extensions[e], path, sizeof(path));
+            remove(path);
+        }
+    }
+    remove(SHARD_DIR "/" SHARD_CHECKPOINT_NAME);
+}
+
+// The artifact games COPIES times with a comment line in front, plain and
+// as one zstd frame; the seekable copy is built by the test that needs it
+static char *build_corpus(size_t *len_out) {
+    Text_Buffer corpus = {0};
+    assert(text_buffer_append(&corpus, "; exported\n", 11));
+    for (int c = 0; c < COPIES; c++) {
+        for (int i = 0; i < 3; i++) {
+            size_t len;
+            char *game = read_artifact(i, &len);
+            assert(text_buffer_append(&corpus, game, len));
+            assert(text_buffer_append(&corpus, "\n\n", 2));
+            free(game);
+        }
+    }
+    write_file(PLAIN_PATH, corpus.data, corpus.length);
+    size_t bound = ZSTD_compressBound(corpus.length);
+    char *compressed = malloc(bound);
+    size_t size = ZSTD_compress(compressed, bound, corpus.data, corpus.length, 3);
+    assert(!ZSTD_isError(size));
+    write_file(FRAME_PATH, compressed, size);
+    free(compressed);
+    *len_out = corpus.length;
+    return corpus.data;
+}
+
+void test_checkpoint_file() {
+    printf("Testing the checkpoint file...\n");
+    clear_shard_dir();
+    Shard_Checkpoint checkpoint;
+    errno = 0;
+    assert(!shard_checkpoint_load(SHARD_DIR, &checkpoint) && errno == ENOENT);
+
+    Shard_Checkpoint saved = {0};
+    saved.input_size = 123456789012ull;
+    saved.next_game = 4000000000ull;
+    saved.offset = 98765432109ull;
+    saved.shard = 42;
+    saved.plies = 7;
+    saved.complete = true;
+    assert(text_buffer_append(&saved.time_controls, "\x05" "600+0" "\x01" "-" "\x09" "1 day + 0", 18));
+    assert(shard_checkpoint_save(SHARD_DIR, &saved));
+    assert(!file_exists(SHARD_DIR "/" SHARD_CHECKPOINT_NAME ".tmp"));
+    assert(shard_checkpoint_load(SHARD_DIR, &checkpoint));
+    assert(checkpoint.input_size == saved.input_size && checkpoint.next_game == saved.next_game);
+    assert(checkpoint.offset == saved.offset && checkpoint.shard == 42 && checkpoint.plies == 7);
+    assert(checkpoint.games == 0 && checkpoint.complete);
+    assert(checkpoint.time_controls.length == saved.time_controls.length);
+    assert(memcmp(checkpoint.time_controls.data, saved.time_controls.data, saved.time_controls.length) == 0);
+    shard_checkpoint_free(&checkpoint);
+    shard_checkpoint_free(&saved);
+
+    // A checkpoint missing a field is refused
+    size_t len;
+    char *text = read_file(SHARD_DIR "/" SHARD_CHECKPOINT_NAME, &len);
+    char *line = strstr(text, "offset ");
+    write_file(SHARD_DIR "/" SHARD_CHECKPOINT_NAME, text, (size_t)(line - text));
+    free(text);
+    errno = 0;
+    assert(!shard_checkpoint_load(SHARD_DIR, &checkpoint) && errno == EINVAL);
+    remove(SHARD_DIR "/" SHARD_CHECKPOINT_NAME);
+    printf("✓ Checkpoint and its time-control table load back; an incomplete one is refused\n");
+}
+
+// The first game a stream seeked to offset returns, checked against the
+// corpus text at its offset; the slices are gone once this returns
+static bool first_game_after(const char *path, const PGN_Index *index, uint64_t offset, uint64_t first_index,
+                             const char *corpus, PGN_Game *game) {
+    PGN_Stream *stream = pgn_stream_open(path);
+    assert(stream != NULL);
+    assert(pgn_stream_seek(stream, offset, first_index, index));
+    bool found = pgn_stream_next_game(stream, game);
+    assert(pgn_stream_error(stream) == NULL);
+    assert(!found || memcmp(game->header, corpus + game->offset, game->header_len) == 0);
+    pgn_stream_close(stream);
+    return found;
+}
+
+void test_stream_seek() {
+    printf("Testing stream seeks to decoded offsets...\n");
+    size_t len;
+    char *corpus = build_corpus(&len);
+    uint64_t games = 0;
+    assert(pgn_index_reencode(FRAME_PATH, SEEKABLE_PATH, 8 * 1024, 3, &games));
+    assert(games == GAMES);
+    PGN_Index index;
+    assert(pgn_index_load(SEEKABLE_PATH, &index));
+    assert(index.count > 4);
+
+    // Every game knows where its "[Event" line starts
+    uint64_t offsets[GAMES];
+    PGN_Stream *stream = pgn_stream_open(PLAIN_PATH);
+    PGN_Game game;
+    for (size_t i = 0; i < GAMES; i++) {
+        assert(pgn_stream_next_game(stream, &game));
+        offsets[i] = game.offset;
+        assert(memcmp(corpus + game.offset, game.header, game.header_len) == 0);
+        assert(pgn_stream_offset(stream) > game.offset);
+    }
+    assert(!pgn_stream_next_game(stream, &game));
+    assert(pgn_stream_offset(stream) == len);
+    pgn_stream_close(stream);
+
+    const char *paths[3] = {PLAIN_PATH, FRAME_PATH, SEEKABLE_PATH};
+    const PGN_Index *indexes[3] = {NULL, NULL, &index};
+    for (int p = 0; p < 3; p++) {
+        for (size_t i = 0; i < GAMES; i += 7) {
+            // At a game start the game itself comes first; one byte later,
+            // or in the middle of its movetext, the next one does
+            uint64_t targets[3] = {offsets[i], offsets[i] + 1, offsets[i] + 300};
+            for (int t = 0; t < 3; t++) {
+                size_t expected = t == 0 ? i : i + 1;
+                bool found = first_game_after(paths[p], indexes[p], targets[t], 1000, corpus, &game);
+                assert(found == (expected < GAMES));
+                assert(!found || (game.offset == offsets[expected] && game.index == 1000));
+            }
+        }
+        assert(!first_game_after(paths[p], indexes[p], len, 0, corpus, &game));
+        PGN_Stream *past = pgn_stream_open(paths[p]);
+        assert(!pgn_stream_seek(past, len + 10, 0, indexes[p]));
+        pgn_stream_close(past);
+    }
+    pgn_index_free(&index);
+    free(corpus);
+    printf("✓ Plain, single-frame and seekable inputs resume at the first game at or after an offset\n");
+}
+
+static Pipeline_Stats run_pipeline(const char *input, const Pipeline_Options *options, char **output,
+                                   size_t *len) {
+    int fd = open(OUTPUT_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(fd >= 0);
+    Pipeline_Stats stats;
+    bool ok = pipeline_run(input, fd, options, &stats);
+    if (!ok) {
+        printf("pipeline failed: %s\n", stats.error);
+    }
+    assert(ok);
+    close(fd);
+    if (output != NULL) {
+        *output = read_file(OUTPUT_PATH, len);
+    }
+    return stats;
+}
+
+void test_range_split() {
+    printf("Testing byte-range splits...\n");
+    Pipeline_Options options;
+    pipeline_default_options(&options);
+    options.threads = 2;
+    options.batch_bytes = 8 * 1024;
+    options.write_header = false;
+    char *expected;
+    size_t expected_len;
+    Pipeline_Stats full = run_pipeline(FRAME_PATH, &options, &expected, &expected_len);
+    assert(full.games == GAMES);
+
+    // Cuts anywhere, including inside a game: each game goes to the range
+    // its "[Event" line starts in
+    uint64_t cuts[4] = {0, 10007, 54321, 0};
+    Text_Buffer joined = {0};
+    uint64_t games = 0;
+    for (int r = 0; r < 3; r++) {
+        options.range_start = cuts[r];
+        options.range_end = cuts[r + 1];
+        char *part;
+        size_t part_len;
+        Pipeline_Stats stats = run_pipeline(r == 1 ? PLAIN_PATH : FRAME_PATH, &options, &part, &part_len);
+        assert(stats.start_offset == cuts[r] && stats.decode_threads == 0);
+        games += stats.games;
+        assert(text_buffer_append(&joined, part, part_len));
+        free(part);
+    }
+    assert(games == GAMES);
+    assert(joined.length == expected_len && memcmp(joined.data, expected, expected_len) == 0);
+    text_buffer_free(&joined);
+    free(expected);
+    printf("✓ Three ranges convert every game exactly once\n");
+}
+
+void test_sharded_csv() {
+    printf("Testing CSV shards...\n");
+    clear_shard_dir();
+    Pipeline_Options options;
+    pipeline_default_options(&options);
+    options.threads = 3;
+    options.batch_bytes = 4 * 1024;
+    char *expected;
+    size_t expected_len;
+    run_pipeline(PLAIN_PATH, &options, &expected, &expected_len);
+
+    options.output_dir = SHARD_DIR;
+    options.shard_bytes = 16 * 1024;
+    Pipeline_Stats stats = run_pipeline(PLAIN_PATH, &options, NULL, NULL);
+    assert(stats.shards > 3 && stats.first_shard == 0 && stats.games == GAMES);
+
+    // Every shard is a whole .csv.zst with its own header line
+    size_t header_len = strlen(FEN_PLUS_CSV_HEADER);
+    Text_Buffer joined = {0};
+    assert(text_buffer_append(&joined, FEN_PLUS_CSV_HEADER, header_len));
+    uint64_t bytes = 0;
+    for (uint64_t i = 0; i < stats.shards; i++) {
+        char path[256];
+        size_t len;
+        shard_path(SHARD_DIR, i, ".csv.zst", path, sizeof(path));
+        char *data = read_file(path, &len);
+        bytes += len;
+        Text_Buffer csv = {0};
+        for (size_t at = 0; at < len;) {
+            size_t frame = ZSTD_findFrameCompressedSize(data + at, len - at);
+            unsigned long long size = ZSTD_getFrameContentSize(data + at, frame);
+            assert(!ZSTD_isError(frame) && size != ZSTD_CONTENTSIZE_ERROR && size != ZSTD_CONTENTSIZE_UNKNOWN);
+            assert(text_buffer_reserve(&csv, size));
+            assert(ZSTD_decompress(csv.data + csv.length, size, data + at, frame) == size);
+            csv.length += size;
+            at += frame;
+        }
+        assert(csv.length > header_len && memcmp(csv.data, FEN_PLUS_CSV_HEADER, header_len) == 0);
+        assert(csv.data[csv.length - 1] == '\n');
+        assert(text_buffer_append(&joined, csv.data + header_len, csv.length - header_len));
+        text_buffer_free(&csv);
+        free(data);
+    }
+    assert(bytes == stats.bytes_written);
+    char path[256];
+    shard_path(SHARD_DIR, stats.shards, ".csv.zst", path, sizeof(path));
+    assert(!file_exists(path));
+    assert(joined.length == expected_len && memcmp(joined.data, expected, expected_len) == 0);
+
+    Shard_Checkpoint checkpoint;
+    assert(shard_checkpoint_load(SHARD_DIR, &checkpoint));
+    assert(checkpoint.complete && checkpoint.shard == stats.shards && checkpoint.next_game == GAMES);
+    assert(checkpoint.games == GAMES && checkpoint.bytes_written == bytes);
+    assert(checkpoint.time_controls.length == 0);
+    shard_checkpoint_free(&checkpoint);
+
+    // Resuming a finished conversion does nothing
+    options.resume = true;
+    stats = run_pipeline(PLAIN_PATH, &options, NULL, NULL);
+    assert(stats.games == 0 && stats.shards == 0 && stats.first_shard == checkpoint.shard);
+    text_buffer_free(&joined);
+    free(expected);
+    printf("✓ Shards rejoin to the single-file CSV; a finished job resumes to nothing\n");
+}
+
+static char *shard_contents(uint64_t shard, size_t *len) {
+    char path[256];
+    shard_path(SHARD_DIR, shard, ".fenrec", path, sizeof(path));
+    return read_file(path, len);
+}
+
+void test_resume_records() {
+    printf("Testing resume after an interruption...\n");
+    clear_shard_dir();
+    Pipeline_Options options;
+    pipeline_default_options(&options);
+    options.threads = 2;
+    options.batch_bytes = 4 * 1024;
+    options.format = PIPELINE_FORMAT_RECORDS;
+    options.output_dir = SHARD_DIR;
+    options.shard_bytes = 8 * 1024;
+    Pipeline_Stats full = run_pipeline(FRAME_PATH, &options, NULL, NULL);
+    uint64_t shards = full.shards;
+    assert(shards > 4);
+    char *originals[64];
+    size_t original_lens[64];
+    assert(shards <= 64);
+    for (uint64_t i = 0; i < shards; i++) {
+        originals[i] = shard_contents(i, &original_lens[i]);
+    }
+
+    // Where shard m starts in the input: its first record's game
+    uint64_t offsets[GAMES];
+    PGN_Stream *stream = pgn_stream_open(FRAME_PATH);
+    PGN_Game game;
+    for (size_t i = 0; i < GAMES; i++) {
+        assert(pgn_stream_next_game(stream, &game));
+        offsets[i] = game.offset;
+    }
+    pgn_stream_close(stream);
+
+    uint64_t stops[2] = {1, shards - 2};
+    for (int s = 0; s < 2; s++) {
+        uint64_t m = stops[s];
+        char path[256];
+        shard_path(SHARD_DIR, m, ".fenrec", path, sizeof(path));
+        FEN_Record_File *file = fen_record_open(path);
+        assert(file != NULL);
+        FEN_Record first[4096];
+        assert(fen_record_block_records(file, 0) <= 4096);
+        assert(fen_record_read_block(file, 0, first) > 0);
+        fen_record_close(file);
+
+        // The state of a run killed while writing shard m: the checkpoint
+        // written after shard m - 1, a partial temporary file, and no
+        // shards past m - 1
+        Shard_Checkpoint checkpoint;
+        assert(shard_checkpoint_load(SHARD_DIR, &checkpoint));
+        checkpoint.next_game = first[0].game;
+        checkpoint.offset = offsets[first[0].game];
+        checkpoint.shard = m;
+        checkpoint.complete = false;
+        assert(shard_checkpoint_save(SHARD_DIR, &checkpoint));
+        shard_checkpoint_free(&checkpoint);
+        for (uint64_t i = m; i < shards; i++) {
+            shard_path(SHARD_DIR, i, ".fenrec", path, sizeof(path));
+            remove(path);
+        }
+        shard_path(SHARD_DIR, m, ".fenrec.tmp", path, sizeof(path));
+        write_file(path, "partial", 7);
+
+        options.resume = true;
+        Pipeline_Stats stats = run_pipeline(FRAME_PATH, &options, NULL, NULL);
+        assert(stats.first_shard == m && stats.shards == shards - m);
+        assert(stats.start_offset == checkpoint.offset);
+        assert(!file_exists(path));
+        for (uint64_t i = 0; i < shards; i++) {
+            size_t len;
+            char *data = shard_contents(i, &len);
+            assert(len == original_lens[i] && memcmp(data, originals[i], len) == 0);
+            free(data);
+        }
+        assert(shard_checkpoint_load(SHARD_DIR, &checkpoint));
+        assert(checkpoint.complete && checkpoint.next_game == GAMES);
+        // Both time controls of the corpus, 180+0 first
+        assert(checkpoint.time_controls.length == 12 && memcmp(checkpoint.time_controls.data, "\x05" "180+0", 6) == 0);
+        shard_checkpoint_free(&checkpoint);
+    }
+
+    // A checkpoint of another input is refused
+    options.resume = true;
+    int fd = open(OUTPUT_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    Pipeline_Stats stats;
+    assert(!pipeline_run(PLAIN_PATH, fd, &options, &stats));
+    assert(strstr(stats.error, "another input") != NULL);
+    // Rows the interrupted run kept are not in a fresh dedup table
+    options.dedup_max_count = 1;
+    assert(!pipeline_run(FRAME_PATH, fd, &options, &stats));
+    assert(strstr(stats.error, "dedup") != NULL);
+    options.dedup_max_count = 0;
+    close(fd);
+
+    for (uint64_t i = 0; i < shards; i++) {
+        free(originals[i]);
+    }
+    printf("✓ Resumed runs rebuild the missing shards byte for byte (%llu shards)\n",
+           (unsigned long long)shards);
+}
+
+int main() {
+    printf("=== Shards Test Suite ===\n\n");
+
+    test_checkpoint_file();
+    test_stream_seek();
+    test_range_split();
+    test_sharded_csv();
+    test_resume_records();
+
+    clear_shard_dir();
+    rmdir(SHARD_DIR);
+    remove(PLAIN_PATH);
+    remove(FRAME_PATH);
+    remove(SEEKABLE_PATH);
+    remove(OUTPUT_PATH);
+    printf("🎉 All tests passed successfully!\n");
+    return 0;
+}
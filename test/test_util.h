@@ -0,0 +1,103 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+// Fixtures shared by the test suites: whole files, the artifact corpus and
+// pipeline runs into a file
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../include/pipeline.h"
+
+#define ARTIFACT_DIR "src_python/test/test_artifacts/"
+// Plies of game_1.pgn, game_2.pgn and game_3.pgn together
+#define ARTIFACT_PLIES (61 + 108 + 37)
+
+// Whole file, NUL-terminated
+static inline char *read_file(const char *path, size_t *len_out) {
+    FILE *f = fopen(path, "rb");
+    assert(f != NULL);
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = malloc((size_t)len + 1);
+    assert(data != NULL);
+    assert(fread(data, 1, (size_t)len, f) == (size_t)len);
+    data[len] = '\0';
+    fclose(f);
+    *len_out = (size_t)len;
+    return data;
+}
+
+static inline void write_file(const char *path, const void *data, size_t len) {
+    FILE *f = fopen(path, "wb");
+    assert(f != NULL);
+    assert(fwrite(data, 1, len, f) == len);
+    fclose(f);
+}
+
+// Artifact game 0, 1 or 2
+static inline char *read_artifact(int game, size_t *len_out) {
+    char path[256];
+    snprintf(path, sizeof(path), ARTIFACT_DIR "game_%d.pgn", game + 1);
+    return read_file(path, len_out);
+}
+
+// The three artifact games, each followed by a blank line
+static inline void append_artifacts(FILE *out) {
+    for (int i = 0; i < 3; i++) {
+        size_t len;
+        char *game = read_artifact(i, &len);
+        fwrite(game, 1, len, out);
+        fputs("\n\n", out);
+        free(game);
+    }
+}
+
+static inline void write_artifact_corpus(const char *path, int copies) {
+    FILE *out = fopen(path, "wb");
+    assert(out != NULL);
+    for (int c = 0; c < copies; c++) {
+        append_artifacts(out);
+    }
+    fclose(out);
+}
+
+// Defaults with the settings the format tests vary, in 16 KB batches
+static inline void format_options(Pipeline_Options *options, int format, int level, int threads) {
+    pipeline_default_options(options);
+    options->format = format;
+    options->compression_level = level;
+    options->threads = threads;
+    options->batch_bytes = 16 * 1024;
+}
+
+// Runs the pipeline from input into output_path, or into options->output_dir
+// when output_path is NULL
+static inline bool run_pipeline_to(const char *input, const char *output_path, const Pipeline_Options *options,
+                                   Pipeline_Stats *stats) {
+    int fd = output_path != NULL ? open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    assert(output_path == NULL || fd >= 0);
+    bool ok = pipeline_run(input, fd, options, stats);
+    if (fd >= 0) {
+        close(fd);
+    }
+    return ok;
+}
+
+// run_pipeline_to for runs that must succeed
+static inline Pipeline_Stats run_pipeline_ok(const char *input, const char *output_path,
+                                             const Pipeline_Options *options) {
+    Pipeline_Stats stats;
+    bool ok = run_pipeline_to(input, output_path, options, &stats);
+    if (!ok) {
+        printf("pipeline failed: %s\n", stats.error);
+    }
+    assert(ok);
+    return stats;
+}
+
+#endif
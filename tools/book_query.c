@@ -0,0 +1,130 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/attacks.h"
+#include "../include/file_io.h"
+#include "../include/game_filter.h"
+#include "../include/opening_book.h"
+#include "../include/position.h"
+#include "../include/san.h"
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [options] <book> <fen>...\n"
+            "  print the moves a book (chess_pipeline --format book) holds for each position,\n"
+            "  most played first, summed over the Elo bands and speeds that match\n"
+            "  --min-elo N     only moves by players rated at least N (by band)\n"
+            "  --max-elo N     only moves by players rated at most N (by band)\n"
+            "  --speed LIST    only these speeds, e.g. blitz,rapid\n"
+            "  --detail        one line per move, band and speed instead of per move\n",
+            program);
+}
+
+typedef struct {
+    ChessMove move;
+    uint64_t count;
+} Move_Total;
+
+static int by_count(const void *a, const void *b) {
+    const Move_Total *x = (const Move_Total *)a;
+    const Move_Total *y = (const Move_Total *)b;
+    return x->count != y->count ? (x->count < y->count ? 1 : -1) : (x->move > y->move) - (x->move < y->move);
+}
+
+int main(int argc, char **argv) {
+    int min_elo = 0;
+    int max_elo = 0;
+    bool detail = false;
+    Game_Filter speeds;
+    game_filter_init(&speeds);
+    int first = argc;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--min-elo") == 0 && i + 1 < argc) {
+            min_elo = atoi(argv[++i]);
+        } else if (strcmp(arg, "--max-elo") == 0 && i + 1 < argc) {
+            max_elo = atoi(argv[++i]);
+        } else if (strcmp(arg, "--speed") == 0 && i + 1 < argc) {
+            if (!game_filter_add_time_controls(&speeds, argv[++i]) || speeds.time_control_count > 0) {
+                fprintf(stderr, "--speed: cannot parse %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(arg, "--detail") == 0) {
+            detail = true;
+        } else if (arg[0] != '-') {
+            first = i;
+            break;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (argc - first < 2) {
+        usage(argv[0]);
+        return 2;
+    }
+    attacks_init();
+    Opening_Book *book = opening_book_open(argv[first]);
+    if (book == NULL) {
+        fprintf(stderr, "error: %s is not a book\n", argv[first]);
+        return 1;
+    }
+    uint32_t width = opening_book_header(book)->elo_band;
+    int status = 0;
+    for (int i = first + 1; i < argc; i++) {
+        Position pos;
+        if (!position_from_fen(argv[i], &pos)) {
+            fprintf(stderr, "error: cannot parse the FEN %s\n", argv[i]);
+            status = 1;
+            continue;
+        }
+        const Opening_Book_Move *moves;
+        double start = file_io_seconds();
+        size_t count = opening_book_lookup(book, pos.key, &moves);
+        double micros = (file_io_seconds() - start) * 1e6;
+        Move_Total *totals = (Move_Total *)calloc(count + 1, sizeof(Move_Total));
+        size_t distinct = 0;
+        uint64_t total = 0;
+        printf("%s\n", argv[i]);
+        for (size_t m = 0; m < count; m++) {
+            const Opening_Book_Move *move = &moves[m];
+            // A band passes if any rating in it is within the limits
+            bool rated = move->elo_band != OPENING_BOOK_UNKNOWN;
+            int low = (int)(move->elo_band * width);
+            int high = low + (int)width - 1;
+            if ((min_elo > 0 && (!rated || high < min_elo)) || (max_elo > 0 && (!rated || low > max_elo)) ||
+                (speeds.speeds != 0 && (move->speed == OPENING_BOOK_UNKNOWN || !(speeds.speeds & (1u << move->speed))))) {
+                continue;
+            }
+            char uci[6];
+            uci[move_to_uci(move->move, uci)] = '\0';
+            if (detail) {
+                char band[32] = "unrated";
+                if (rated) {
+                    snprintf(band, sizeof(band), "%d-%d", low, high);
+                }
+                printf("  %-5s %-10s %-14s %u\n", uci, band, game_filter_speed_name(move->speed), move->count);
+            }
+            if (distinct == 0 || totals[distinct - 1].move != move->move) {
+                totals[distinct++].move = move->move;
+            }
+            totals[distinct - 1].count += move->count;
+            total += move->count;
+        }
+        if (!detail) {
+            qsort(totals, distinct, sizeof(Move_Total), by_count);
+            for (size_t m = 0; m < distinct; m++) {
+                char uci[6];
+                uci[move_to_uci(totals[m].move, uci)] = '\0';
+                printf("  %-5s %10llu  %5.1f%%\n", uci, (unsigned long long)totals[m].count,
+                       100.0 * totals[m].count / total);
+            }
+        }
+        printf("  %llu moves played from here, %zu entries, looked up in %.1f us\n",
+               (unsigned long long)total, count, micros);
+        free(totals);
+    }
+    opening_book_close(book);
+    return status;
+}
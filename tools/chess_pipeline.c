@@ -0,0 +1,205 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/dedup.h"
+#include "../include/pipeline.h"
+#include "../include/san_cache.h"
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [options] <input.pgn[.zst] | ->\n"
+            "  -o, --output PATH   write to PATH instead of stdout\n"
+            "  --output-dir DIR    write shards DIR/part-00000.csv.zst, ... and a checkpoint after each\n"
+            "  --shard-mb N        start a new shard after N MB of output (default %llu)\n"
+            "  --resume            continue after the last finished shard in --output-dir\n"
+            "  --range START:END   only games starting at decoded input bytes [START, END);\n"
+            "                      END may be left out to run to the end\n"
+            "  --format FORMAT     csv (default), records: binary FEN+ records, see fen_record.h,\n"
+            "                      arrow: columnar Arrow IPC file, see arrow_ipc.h,\n"
+            "                      games: one entry per game, see game_record.h,\n"
+            "                      or book: move counts per position, see opening_book.h\n"
+            "  --level N           zstd level of record blocks and CSV shards (default %d, 0 = uncompressed)\n"
+            "  --threads N         worker threads (default: online CPUs, 0 = single-threaded)\n"
+            "  --decode-threads N  decompress with N threads if the input has a frame index\n"
+            "                      (see pgn_index; default 0 = on the reader thread)\n"
+            "  --no-mmap           read a plain .pgn input with read() instead of mapping it\n"
+            "  --batch-kb N        PGN kilobytes per work unit (default %d)\n"
+            "  --no-header         do not write the CSV header line\n"
+            "  --dedup N           keep at most N rows per (position, move) pair\n"
+            "  --dedup-keep-every K  beyond N, keep every Kth occurrence instead of none\n"
+            "  --dedup-mb N        memory for the dedup table in MB (default %u)\n"
+            "  --san-cache-kb N    memory per worker for SAN moves resolved in opening positions\n"
+            "                      (default %u, 0 = resolve every move)\n"
+            "  --min-elo N         only games where both players are rated at least N\n"
+            "  --max-elo N         only games where both players are rated at most N\n"
+            "  --time-control LIST only these speeds or TimeControl values, e.g. rapid,classical or 600+0\n"
+            "  --termination LIST  only these terminations, e.g. normal,time-forfeit\n"
+            "  --result LIST       only these results, e.g. 1-0,0-1\n"
+            "  --book-mb N         memory for the book's per-worker maps in MB, over all workers (default %u)\n"
+            "  --elo-band N        Elo points per book band (default %u)\n"
+            "  --min-count N       leave positions played fewer than N times out of the book\n"
+            "  --temp-dir DIR      book run files (default: $TMPDIR or /tmp)\n"
+            "  --report PATH       write a JSON run report to PATH at exit; kill -USR1 writes\n"
+            "                      a partial one while the conversion runs\n"
+            "  --quiet             do not print the throughput report\n",
+            program, (unsigned long long)(PIPELINE_DEFAULT_SHARD_BYTES >> 20), PIPELINE_DEFAULT_COMPRESSION_LEVEL, PIPELINE_DEFAULT_BATCH_BYTES / 1024,
+            DEDUP_DEFAULT_MEMORY >> 20, SAN_CACHE_DEFAULT_MEMORY >> 10, OPENING_BOOK_DEFAULT_MEMORY >> 20,
+            OPENING_BOOK_DEFAULT_ELO_BAND);
+}
+
+static void on_report_signal(int signal) {
+    (void)signal;
+    pipeline_request_report();
+}
+
+int main(int argc, char **argv) {
+    Pipeline_Options options;
+    pipeline_default_options(&options);
+    const char *input = NULL;
+    const char *output = NULL;
+    int quiet = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if ((strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0) && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(arg, "--output-dir") == 0 && i + 1 < argc) {
+            options.output_dir = argv[++i];
+        } else if (strcmp(arg, "--shard-mb") == 0 && i + 1 < argc) {
+            options.shard_bytes = (uint64_t)strtoull(argv[++i], NULL, 10) << 20;
+        } else if (strcmp(arg, "--resume") == 0) {
+            options.resume = true;
+        } else if (strcmp(arg, "--range") == 0 && i + 1 < argc) {
+            char *colon;
+            options.range_start = strtoull(argv[++i], &colon, 10);
+            options.range_end = *colon == ':' && colon[1] != '\0' ? strtoull(colon + 1, NULL, 10) : 0;
+            if (*colon != ':' || (options.range_end != 0 && options.range_end <= options.range_start)) {
+                fprintf(stderr, "--range: cannot parse %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(arg, "--format") == 0 && i + 1 < argc) {
+            const char *format = argv[++i];
+            if (strcmp(format, "csv") == 0) {
+                options.format = PIPELINE_FORMAT_CSV;
+            } else if (strcmp(format, "records") == 0) {
+                options.format = PIPELINE_FORMAT_RECORDS;
+            } else if (strcmp(format, "arrow") == 0) {
+                options.format = PIPELINE_FORMAT_ARROW;
+            } else if (strcmp(format, "games") == 0) {
+                options.format = PIPELINE_FORMAT_GAMES;
+            } else if (strcmp(format, "book") == 0) {
+                options.format = PIPELINE_FORMAT_BOOK;
+            } else {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(arg, "--level") == 0 && i + 1 < argc) {
+            options.compression_level = atoi(argv[++i]);
+        } else if (strcmp(arg, "--threads") == 0 && i + 1 < argc) {
+            options.threads = atoi(argv[++i]);
+        } else if (strcmp(arg, "--decode-threads") == 0 && i + 1 < argc) {
+            options.decode_threads = atoi(argv[++i]);
+        } else if (strcmp(arg, "--batch-kb") == 0 && i + 1 < argc) {
+            options.batch_bytes = (size_t)atol(argv[++i]) * 1024;
+        } else if (strcmp(arg, "--dedup") == 0 && i + 1 < argc) {
+            options.dedup_max_count = (uint32_t)atol(argv[++i]);
+        } else if (strcmp(arg, "--dedup-keep-every") == 0 && i + 1 < argc) {
+            options.dedup_keep_every = (uint32_t)atol(argv[++i]);
+        } else if (strcmp(arg, "--dedup-mb") == 0 && i + 1 < argc) {
+            options.dedup_memory = (size_t)atol(argv[++i]) << 20;
+        } else if (strcmp(arg, "--san-cache-kb") == 0 && i + 1 < argc) {
+            options.san_cache_memory = (size_t)atol(argv[++i]) << 10;
+        } else if (strcmp(arg, "--min-elo") == 0 && i + 1 < argc) {
+            options.filter.min_elo = atoi(argv[++i]);
+        } else if (strcmp(arg, "--max-elo") == 0 && i + 1 < argc) {
+            options.filter.max_elo = atoi(argv[++i]);
+        } else if (strcmp(arg, "--time-control") == 0 && i + 1 < argc) {
+            if (!game_filter_add_time_controls(&options.filter, argv[++i])) {
+                fprintf(stderr, "--time-control: cannot parse %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(arg, "--termination") == 0 && i + 1 < argc) {
+            if (!game_filter_add_terminations(&options.filter, argv[++i])) {
+                fprintf(stderr, "--termination: cannot parse %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(arg, "--result") == 0 && i + 1 < argc) {
+            if (!game_filter_add_results(&options.filter, argv[++i])) {
+                fprintf(stderr, "--result: cannot parse %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(arg, "--no-mmap") == 0) {
+            options.map_input = false;
+        } else if (strcmp(arg, "--no-header") == 0) {
+            options.write_header = false;
+        } else if (strcmp(arg, "--book-mb") == 0 && i + 1 < argc) {
+            options.book.memory = (size_t)atol(argv[++i]) << 20;
+        } else if (strcmp(arg, "--elo-band") == 0 && i + 1 < argc) {
+            options.book.elo_band = (uint32_t)atol(argv[++i]);
+        } else if (strcmp(arg, "--min-count") == 0 && i + 1 < argc) {
+            options.book.min_count = (uint32_t)atol(argv[++i]);
+        } else if (strcmp(arg, "--temp-dir") == 0 && i + 1 < argc) {
+            options.book.temp_dir = argv[++i];
+        } else if (strcmp(arg, "--report") == 0 && i + 1 < argc) {
+            options.report_path = argv[++i];
+        } else if (strcmp(arg, "--quiet") == 0) {
+            quiet = 1;
+        } else if (input == NULL && (arg[0] != '-' || strcmp(arg, "-") == 0)) {
+            input = arg;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (input == NULL || options.threads < 0 || options.decode_threads < 0 || options.batch_bytes == 0 ||
+        options.compression_level < 0 || options.shard_bytes == 0 || (output != NULL && options.output_dir != NULL) ||
+        (options.resume && options.output_dir == NULL)) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (options.output_dir != NULL && mkdir(options.output_dir, 0755) != 0 && errno != EEXIST) {
+        perror(options.output_dir);
+        return 1;
+    }
+
+    int fd = STDOUT_FILENO;
+    if (output != NULL) {
+        fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            perror(output);
+            return 1;
+        }
+    }
+
+    if (options.report_path != NULL) {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = on_report_signal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGUSR1, &action, NULL);
+    }
+
+    Pipeline_Stats stats;
+    bool ok = pipeline_run(input, fd, &options, &stats);
+    if (output != NULL && close(fd) != 0) {
+        perror(output);
+        ok = false;
+    }
+    if (!quiet) {
+        pipeline_print_report(&stats, stderr);
+    }
+    if (!ok) {
+        if (stats.error[0] != '\0') {
+            fprintf(stderr, "error: %s\n", stats.error);
+        }
+        return 1;
+    }
+    return 0;
+}
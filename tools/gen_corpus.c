@@ -0,0 +1,136 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zstd.h>
+#include "../include/corpus_gen.h"
+
+// PGN text generated between writes
+#define CHUNK_BYTES (4u << 20)
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [options] -o <output.pgn[.zst]>\n"
+            "  --mb N        stop after N MB of PGN text (default 64)\n"
+            "  --games N     stop after N games instead\n"
+            "  --seed N      corpus seed (default 1); the same seed gives the same bytes\n"
+            "  --level N     zstd level for a .zst output (default 3)\n"
+            "Writes Lichess-like games: random legal moves with clock comments, a few\n"
+            "with evaluations, and the tag set of a Lichess dump.\n",
+            program);
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool ends_with(const char *text, const char *suffix) {
+    size_t length = strlen(text), suffix_len = strlen(suffix);
+    return length >= suffix_len && strcmp(text + length - suffix_len, suffix) == 0;
+}
+
+// Writes text, compressed as part of one zstd stream when cctx is set
+static bool write_chunk(FILE *out, ZSTD_CCtx *cctx, const char *text, size_t length, bool last,
+                        char *compressed, size_t compressed_capacity) {
+    if (cctx == NULL) {
+        return fwrite(text, 1, length, out) == length;
+    }
+    ZSTD_inBuffer input = {text, length, 0};
+    ZSTD_EndDirective mode = last ? ZSTD_e_end : ZSTD_e_continue;
+    for (;;) {
+        ZSTD_outBuffer output = {compressed, compressed_capacity, 0};
+        size_t remaining = ZSTD_compressStream2(cctx, &output, &input, mode);
+        if (ZSTD_isError(remaining) || fwrite(compressed, 1, output.pos, out) != output.pos) {
+            return false;
+        }
+        if (last ? remaining == 0 : input.pos == input.size) {
+            return true;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *output = NULL;
+    uint64_t max_bytes = 64ull << 20;
+    uint64_t max_games = 0;
+    uint64_t seed = 1;
+    int level = 3;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if ((strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0) && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(arg, "--mb") == 0 && i + 1 < argc) {
+            max_bytes = strtoull(argv[++i], NULL, 10) << 20;
+        } else if (strcmp(arg, "--games") == 0 && i + 1 < argc) {
+            max_games = strtoull(argv[++i], NULL, 10);
+            max_bytes = 0;
+        } else if (strcmp(arg, "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--level") == 0 && i + 1 < argc) {
+            level = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (output == NULL || (max_bytes == 0 && max_games == 0)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    FILE *out = fopen(output, "wb");
+    if (out == NULL) {
+        perror(output);
+        return 1;
+    }
+    ZSTD_CCtx *cctx = NULL;
+    char *compressed = NULL;
+    size_t compressed_capacity = ZSTD_CStreamOutSize();
+    if (ends_with(output, ".zst")) {
+        cctx = ZSTD_createCCtx();
+        compressed = (char *)malloc(compressed_capacity);
+        if (cctx == NULL || compressed == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+    }
+
+    double start = now_seconds();
+    Corpus_Generator generator;
+    corpus_generator_init(&generator, seed, 0);
+    Text_Buffer chunk = {0};
+    uint64_t total = 0;
+    bool ok = true;
+    bool done = false;
+    while (ok && !done) {
+        chunk.length = 0;
+        while (ok && chunk.length < CHUNK_BYTES) {
+            ok = corpus_generate_game(&generator, &chunk);
+            done = max_games > 0 ? generator.next_game >= max_games : total + chunk.length >= max_bytes;
+            if (done) {
+                break;
+            }
+        }
+        total += chunk.length;
+        ok = ok && write_chunk(out, cctx, chunk.data, chunk.length, done, compressed, compressed_capacity);
+    }
+    if (fclose(out) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        perror(output);
+    }
+    double elapsed = now_seconds() - start;
+    fprintf(stderr, "%llu games, %llu plies, %.1f MB of PGN in %.1f s (%.1f MB/s)\n",
+            (unsigned long long)generator.next_game, (unsigned long long)generator.plies, total / 1048576.0,
+            elapsed, elapsed > 0 ? total / 1048576.0 / elapsed : 0.0);
+    text_buffer_free(&chunk);
+    ZSTD_freeCCtx(cctx);
+    free(compressed);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/pgn_index.h"
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s build <input.pgn.zst>\n"
+            "           list the zstd frames of the input in <input>.idx\n"
+            "       %s reencode [--frame-kb N] [--level N] <input.pgn[.zst]> <output.pgn.zst>\n"
+            "           rewrite the input in the zstd seekable format, with frames of about\n"
+            "           N KB of PGN (default %u) cut at game boundaries, zstd level 9 by default\n"
+            "       %s info <input.pgn.zst>\n"
+            "           print the frame index in use\n",
+            program, program, PGN_INDEX_DEFAULT_FRAME_BYTES >> 10, program);
+}
+
+static void print_summary(const char *path, const PGN_Index *index) {
+    uint64_t compressed = 0, decompressed = 0;
+    for (size_t i = 0; i < index->count; i++) {
+        compressed += index->frames[i].compressed_size;
+        decompressed += index->frames[i].decompressed_size;
+    }
+    fprintf(stderr, "%s: %zu frames, %.1f MB compressed", path, index->count, compressed / 1048576.0);
+    if (decompressed > 0) {
+        fprintf(stderr, ", %.1f MB decoded", decompressed / 1048576.0);
+    }
+    fprintf(stderr, "\n");
+    if (index->count == 1) {
+        fprintf(stderr, "a single frame cannot be decoded in parallel; re-encode it first\n");
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 2;
+    }
+    const char *command = argv[1];
+    if (strcmp(command, "build") == 0 && argc == 3) {
+        PGN_Index index;
+        if (!pgn_index_build(argv[2], &index)) {
+            fprintf(stderr, "%s: not a readable zstd file\n", argv[2]);
+            return 1;
+        }
+        char index_path[4096];
+        pgn_index_sidecar_path(argv[2], index_path, sizeof(index_path));
+        bool ok = pgn_index_save(&index, index_path);
+        if (ok) {
+            print_summary(argv[2], &index);
+        } else {
+            perror(index_path);
+        }
+        pgn_index_free(&index);
+        return ok ? 0 : 1;
+    }
+    if (strcmp(command, "info") == 0 && argc == 3) {
+        PGN_Index index;
+        if (!pgn_index_load(argv[2], &index)) {
+            fprintf(stderr, "%s: no index; run '%s build' or '%s reencode' first\n", argv[2], argv[0], argv[0]);
+            return 1;
+        }
+        print_summary(argv[2], &index);
+        pgn_index_free(&index);
+        return 0;
+    }
+    if (strcmp(command, "reencode") == 0) {
+        size_t frame_bytes = PGN_INDEX_DEFAULT_FRAME_BYTES;
+        int level = 9;
+        int i = 2;
+        for (; i + 2 < argc; i += 2) {
+            if (strcmp(argv[i], "--frame-kb") == 0) {
+                frame_bytes = (size_t)atol(argv[i + 1]) << 10;
+            } else if (strcmp(argv[i], "--level") == 0) {
+                level = atoi(argv[i + 1]);
+            } else {
+                break;
+            }
+        }
+        if (i + 2 != argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        uint64_t games = 0;
+        if (!pgn_index_reencode(argv[i], argv[i + 1], frame_bytes, level, &games)) {
+            fprintf(stderr, "cannot re-encode %s to %s\n", argv[i], argv[i + 1]);
+            return 1;
+        }
+        PGN_Index index;
+        if (pgn_index_load(argv[i + 1], &index)) {
+            print_summary(argv[i + 1], &index);
+            pgn_index_free(&index);
+        }
+        fprintf(stderr, "%llu games\n", (unsigned long long)games);
+        return 0;
+    }
+    usage(argv[0]);
+    return 2;
+}
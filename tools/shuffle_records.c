@@ -0,0 +1,96 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include "../include/record_shuffle.h"
+
+static void usage(const char *program) {
+    Record_Shuffle_Options defaults;
+    record_shuffle_default_options(&defaults);
+    fprintf(stderr,
+            "usage: %s [options] -o DIR <input.fenrec>...\n"
+            "  shuffle record files (chess_pipeline --format records) globally into\n"
+            "  DIR/train.fenrec, DIR/val.fenrec and DIR/test.fenrec, split by game\n"
+            "  -o, --output-dir DIR  where the split files go\n"
+            "  --seed N              seeds the order and the split (default %llu)\n"
+            "  --val F               fraction of games for validation (default %g)\n"
+            "  --test F              fraction of games for testing (default %g)\n"
+            "  --memory-mb N         memory for buffers and buckets, over all threads (default %zu)\n"
+            "  --threads N           threads (default: online CPUs, 0 = single-threaded)\n"
+            "  --level N             zstd level of the output blocks (default %d, 0 = uncompressed)\n"
+            "  --block-records N     records per output block (default %u)\n"
+            "  --buckets N           buckets per split instead of sizing them from the memory\n"
+            "  --temp-dir DIR        bucket files (default: the output directory)\n"
+            "  --quiet               do not print the report\n",
+            program, (unsigned long long)defaults.seed, defaults.val_fraction, defaults.test_fraction,
+            defaults.memory >> 20, defaults.compression_level, defaults.block_records);
+}
+
+int main(int argc, char **argv) {
+    Record_Shuffle_Options options;
+    record_shuffle_default_options(&options);
+    const char *output_dir = NULL;
+    const char **inputs = (const char **)calloc((size_t)argc, sizeof(char *));
+    int input_count = 0;
+    int quiet = 0;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if ((strcmp(arg, "-o") == 0 || strcmp(arg, "--output-dir") == 0) && i + 1 < argc) {
+            output_dir = argv[++i];
+        } else if (strcmp(arg, "--seed") == 0 && i + 1 < argc) {
+            options.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--val") == 0 && i + 1 < argc) {
+            options.val_fraction = atof(argv[++i]);
+        } else if (strcmp(arg, "--test") == 0 && i + 1 < argc) {
+            options.test_fraction = atof(argv[++i]);
+        } else if (strcmp(arg, "--memory-mb") == 0 && i + 1 < argc) {
+            options.memory = (size_t)atol(argv[++i]) << 20;
+        } else if (strcmp(arg, "--threads") == 0 && i + 1 < argc) {
+            options.threads = atoi(argv[++i]);
+        } else if (strcmp(arg, "--level") == 0 && i + 1 < argc) {
+            options.compression_level = atoi(argv[++i]);
+        } else if (strcmp(arg, "--block-records") == 0 && i + 1 < argc) {
+            options.block_records = (uint32_t)atol(argv[++i]);
+        } else if (strcmp(arg, "--buckets") == 0 && i + 1 < argc) {
+            options.buckets = (uint32_t)atol(argv[++i]);
+        } else if (strcmp(arg, "--temp-dir") == 0 && i + 1 < argc) {
+            options.temp_dir = argv[++i];
+        } else if (strcmp(arg, "--quiet") == 0) {
+            quiet = 1;
+        } else if (arg[0] != '-') {
+            inputs[input_count++] = arg;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (input_count == 0 || output_dir == NULL || options.threads < 0 || options.compression_level < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (mkdir(output_dir, 0755) != 0 && errno != EEXIST) {
+        perror(output_dir);
+        return 1;
+    }
+    // Every bucket file stays open through both passes
+    struct rlimit files;
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    Record_Shuffle_Stats stats;
+    bool ok = record_shuffle_run(inputs, input_count, output_dir, &options, &stats);
+    if (!quiet && ok) {
+        record_shuffle_print_report(&stats, stderr);
+    }
+    free(inputs);
+    if (!ok) {
+        fprintf(stderr, "error: %s\n", stats.error);
+        return 1;
+    }
+    return 0;
+}